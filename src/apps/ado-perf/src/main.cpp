@@ -3,7 +3,9 @@
 #include <common/cycles.h>
 #include <common/str_utils.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <boost/program_options.hpp>
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <sstream>
@@ -16,6 +18,8 @@ struct Options {
   unsigned    port;
   bool        async;
   std::string test;
+  unsigned    batch;
+  unsigned    idle_usec;
 } g_options{};
 
 Component::IMCAS* init(const std::string& server_hostname, int port);
@@ -34,7 +38,9 @@ int main(int argc, char* argv[])
         "device", po::value<std::string>()->default_value("mlx5_0"), "Device (e.g. mlnx5_0)")(
         "port", po::value<unsigned>()->default_value(11911), "Server port")(
         "debug", po::value<unsigned>()->default_value(0), "Debug level")("async", "Use asynchronous invocation")(
-        "test", po::value<std::string>()->default_value("put"), "Test to run (put, get, erase)");
+        "test", po::value<std::string>()->default_value("put"), "Test to run (put, get, erase, erase-batch, latency)")(
+        "batch", po::value<unsigned>()->default_value(64), "Keys per invocation for erase-batch")(
+        "idle", po::value<unsigned>()->default_value(1000), "Idle time between invocations for latency (usec)");
 
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(desc).positional(g_pos).run(), vm);
@@ -55,6 +61,8 @@ int main(int argc, char* argv[])
     g_options.debug_level = vm["debug"].as<unsigned>();
     g_options.async       = vm.count("async");
     g_options.test        = vm["test"].as<std::string>();
+    g_options.batch       = std::max(vm["batch"].as<unsigned>(), 1U);
+    g_options.idle_usec   = vm["idle"].as<unsigned>();
 
     // mcas::Global::debug_level = g_options.debug_level =
     //     vm["debug"].as<unsigned>();
@@ -160,6 +168,42 @@ void do_work(Component::IMCAS* mcas)
     secs = std::chrono::duration<double>(clock::now() - start_time).count();
     PLOG("now calculating erase throghput....");
   }
+  else if (g_options.test == "erase-batch") {
+    /* same invocations as "erase", g_options.batch keys per round trip */
+    std::vector<status_t>                                    status;
+    std::vector<std::vector<Component::IMCAS::ADO_response>> responses;
+    const std::vector<std::string>                           requests(g_options.batch, "erase");
+
+    start_time = clock::now();
+    for (unsigned i = 0; i < iterations; i += g_options.batch) {
+      const unsigned           n = std::min(g_options.batch, iterations - i);
+      std::vector<std::string> keys(key_samples.begin() + i, key_samples.begin() + i + n);
+      mcas->invoke_ado_batch(pool, keys, std::vector<std::string>(requests.begin(), requests.begin() + n),
+                             flags & ~IMCAS::ADO_FLAG_ASYNC, status, responses);
+    }
+    __sync_synchronize();
+    secs = std::chrono::duration<double>(clock::now() - start_time).count();
+    PLOG("now calculating batched erase throughput (batch=%u)....", g_options.batch);
+  }
+  else if (g_options.test == "latency") {
+    /* invocations spaced out so that the ADO goes idle in between;
+       measures wake-up as well as round trip */
+    const unsigned      samples = 10000;
+    std::vector<double> usec;
+    usec.reserve(samples);
+    for (unsigned i = 0; i < samples; i++) {
+      if (g_options.idle_usec) usleep(g_options.idle_usec);
+      auto t0 = clock::now();
+      mcas->invoke_ado(pool, key_samples[i], "ping", flags & ~IMCAS::ADO_FLAG_ASYNC, response);
+      usec.push_back(std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+    }
+    std::sort(usec.begin(), usec.end());
+    PINF("Idle ADO invocation latency (idle=%uus, samples=%u)", g_options.idle_usec, samples);
+    PINF("min: %.1f us p50: %.1f us p99: %.1f us p99.9: %.1f us max: %.1f us", usec.front(), usec[samples / 2],
+         usec[samples * 99 / 100], usec[samples * 999 / 1000], usec.back());
+    mcas->delete_pool(pool);
+    return;
+  }
 
   double per_sec = double(iterations) / secs;
   PINF("Synchronous ADO RTT");
@@ -0,0 +1,341 @@
+#include "exp_open_loop.h"
+
+#include "data.h"
+#include "program_options.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+  std::runtime_error op_failure(const char *op_, status_t rc_)
+  {
+    std::ostringstream e;
+    e << op_ << " rc != S_OK: " << rc_;
+    return std::runtime_error(e.str());
+  }
+
+  const struct
+  {
+    const char *name;
+    double pct;
+  } report_percentiles[] =
+  {
+    { "p50", 50.0 },
+    { "p90", 90.0 },
+    { "p99", 99.0 },
+    { "p99.9", 99.9 },
+    { "p99.99", 99.99 },
+  };
+}
+
+std::mutex ExperimentOpenLoop::_summary_lock;
+std::unique_ptr<Hdr_histogram> ExperimentOpenLoop::_total_response;
+std::unique_ptr<Hdr_histogram> ExperimentOpenLoop::_total_service;
+double ExperimentOpenLoop::_total_rate = 0.0;
+double ExperimentOpenLoop::_total_iops = 0.0;
+
+ExperimentOpenLoop::ExperimentOpenLoop(const ProgramOptions &options)
+  : Experiment("open_loop", options)
+  , _rate(options.rate)
+  , _outstanding(options.outstanding)
+  , _rd_pct(options.read_pct)
+  , _shared_client(options.client_mode == "shared")
+  , _mcas(nullptr)
+  , _key_chooser(
+      make_key_chooser(
+        options.key_distribution.empty() ? "uniform" : options.key_distribution
+        , options.zipf_theta
+        , options.hotspot_fraction
+        , options.hotspot_op_fraction
+      )
+    )
+  , _rnd{}
+  , _interarrival()
+  , _rand_pct(0, 99)
+  , _cycles_per_ns(double(Common::get_rdtsc_frequency_mhz()) / 1000.0)
+  , _record_count(0)
+  , _start(0)
+  , _next_arrival(0.0)
+  , _issued(0)
+  , _completed(0)
+  , _slots()
+  , _free_slots()
+  , _done_handles()
+  , _done_status()
+  , _response(HIGHEST_TRACKABLE_NS, SIGNIFICANT_DIGITS)
+  , _service(HIGHEST_TRACKABLE_NS, SIGNIFICANT_DIGITS)
+  , _continuous(options.continuous)
+{
+  /* the exponential distribution draws gaps in cycles */
+  _interarrival = std::exponential_distribution<double>(_rate / (_cycles_per_ns * 1e9));
+}
+
+void ExperimentOpenLoop::initialize_custom(unsigned core)
+{
+  _rnd.seed(core);
+
+  /* With one client shared by every worker, a poll could retire another
+   * worker's requests, so only a private connection is driven asynchronously */
+  if ( component_is("mcas") && ! _shared_client )
+  {
+    auto iid = Component::IMCAS::iid();
+    _mcas = static_cast<Component::IMCAS *>(store()->query_interface(iid));
+  }
+
+  if ( ! _mcas && _outstanding != 1 )
+  {
+    PWRN("[%u] %s: requests are issued synchronously; --outstanding %u treated as 1", core, test_name().c_str(), _outstanding);
+    _outstanding = 1;
+  }
+
+  _slots.resize(_outstanding, request{Component::IMCAS::ASYNC_HANDLE_INIT, 0, 0, nullptr, 0, false});
+  _free_slots.clear();
+  for ( unsigned i = _outstanding; i != 0; --i )
+  {
+    _free_slots.push_back(i - 1);
+  }
+  _done_handles.resize(_outstanding);
+  _done_status.resize(_outstanding);
+}
+
+bool ExperimentOpenLoop::more_arrivals() const
+{
+  return
+    _end_time_directed
+    ? std::chrono::high_resolution_clock::now() < *_end_time_directed
+    : ( _continuous || _issued != pool_num_objects() )
+    ;
+}
+
+void ExperimentOpenLoop::complete(request &r, status_t status, cpu_time_t now)
+{
+  if ( status != S_OK )
+  {
+    throw op_failure("request", status);
+  }
+
+  if ( r.value )
+  {
+    store()->free_memory(r.value);
+    r.value = nullptr;
+  }
+
+  _service.record(std::uint64_t(double(now - r.issued) / _cycles_per_ns));
+  _response.record(std::uint64_t(double(now - r.scheduled) / _cycles_per_ns));
+  ++_completed;
+}
+
+bool ExperimentOpenLoop::issue(cpu_time_t scheduled)
+{
+  const auto index = _key_chooser->next(_rnd, _record_count);
+  const bool is_read = _rand_pct(_rnd) < _rd_pct;
+  const auto slot = _free_slots.back();
+  auto &r = _slots[slot];
+  r.scheduled = scheduled;
+  r.value = nullptr;
+  r.value_len = 0;
+  r.issued = rdtsc();
+
+  if ( _mcas )
+  {
+    auto rc =
+      is_read
+      ? _mcas->async_get(pool(), g_data->key_as_string(index), r.value, r.value_len, r.handle)
+      : _mcas->async_put(pool(), g_data->key_as_string(index), g_data->value(index), g_data->value_len(), r.handle)
+      ;
+    if ( rc == E_BUSY )
+    {
+      /* client window full: the request stays due and is retried */
+      return false;
+    }
+    if ( rc != S_OK )
+    {
+      throw op_failure(is_read ? "async_get" : "async_put", rc);
+    }
+    r.in_use = true;
+    _free_slots.pop_back();
+  }
+  else
+  {
+    auto rc =
+      is_read
+      ? store()->get(pool(), g_data->key_as_string(index), r.value, r.value_len)
+      : store()->put(pool(), g_data->key_as_string(index), g_data->value(index), g_data->value_len())
+      ;
+    if ( rc != S_OK )
+    {
+      throw op_failure(is_read ? "get" : "put", rc);
+    }
+    complete(r, S_OK, rdtsc());
+  }
+  return true;
+}
+
+void ExperimentOpenLoop::poll()
+{
+  const auto n = _mcas->poll_completions(_done_handles.data(), _done_status.data(), _done_handles.size());
+  if ( n == 0 )
+  {
+    return;
+  }
+  const auto now = rdtsc();
+  for ( std::size_t i = 0; i != n; ++i )
+  {
+    const auto it =
+      std::find_if(
+        _slots.begin()
+        , _slots.end()
+        , [this, i] (const request &r) { return r.in_use && r.handle == _done_handles[i]; }
+      );
+    if ( it == _slots.end() )
+    {
+      throw std::logic_error("open_loop: completion for unknown request");
+    }
+    it->in_use = false;
+    complete(*it, _done_status[i], now);
+    _free_slots.push_back(unsigned(it - _slots.begin()));
+  }
+}
+
+bool ExperimentOpenLoop::do_work(unsigned core)
+{
+  // handle first time setup
+  if ( _first_iter )
+  {
+    // seed the pool with elements from _data
+    _populate_pool_to_capacity(core);
+    _record_count = pool_element_end();
+
+    wait_for_delayed_start(core);
+
+    PLOG("[%u] Starting open loop at %g ops/s, up to %u outstanding...", core, _rate, _outstanding);
+    _first_iter = false;
+
+    timer.start();
+    if ( _duration_directed )
+    {
+      _end_time_directed = std::chrono::high_resolution_clock::now() + *_duration_directed;
+    }
+    _start = rdtsc();
+    _next_arrival = _interarrival(_rnd);
+  }
+
+  try
+  {
+    if ( _mcas )
+    {
+      poll();
+    }
+
+    /* Issue every request whose arrival time has passed. A request which
+     * cannot be issued yet keeps its original arrival time, so the wait
+     * shows up in its response latency. */
+    auto now = rdtsc();
+    while (
+      ! _free_slots.empty()
+      && _start + cpu_time_t(_next_arrival) <= now
+      && more_arrivals()
+      && issue(_start + cpu_time_t(_next_arrival))
+    )
+    {
+      ++_issued;
+      _next_arrival += _interarrival(_rnd);
+      now = rdtsc();
+    }
+  }
+  catch ( std::exception &e )
+  {
+    PERR("%s threw exception %s! Ending experiment.", test_name().c_str(), e.what());
+    throw;
+  }
+  catch ( ... )
+  {
+    PERR("%s threw unknown object! Ending experiment.", test_name().c_str());
+    throw;
+  }
+
+  auto do_more = more_arrivals() || in_flight() != 0;
+
+  if ( ! do_more )
+  {
+    PINF("[%u] %s: reached total number of operations. Exiting.", core, test_name().c_str());
+  }
+
+  return do_more;
+}
+
+void ExperimentOpenLoop::print_percentiles(const std::string &prefix_, const char *label_, const Hdr_histogram &h_)
+{
+  std::ostringstream s;
+  for ( const auto &p : report_percentiles )
+  {
+    s << " " << p.name << " " << double(h_.percentile(p.pct)) / 1000.0;
+  }
+  s << " max " << double(h_.max()) / 1000.0;
+  PINF("%s %s latency (us):%s", prefix_.c_str(), label_, s.str().c_str());
+}
+
+rapidjson::Value ExperimentOpenLoop::percentiles_to_report(const Hdr_histogram &h_, rapidjson::Document &document_)
+{
+  rapidjson::Value v(rapidjson::kObjectType);
+  v.AddMember("count", h_.count(), document_.GetAllocator());
+  v.AddMember("mean_ns", h_.mean(), document_.GetAllocator());
+  for ( const auto &p : report_percentiles )
+  {
+    rapidjson::Value name((std::string(p.name) + "_ns").c_str(), document_.GetAllocator());
+    v.AddMember(name, h_.percentile(p.pct), document_.GetAllocator());
+  }
+  v.AddMember("max_ns", h_.max(), document_.GetAllocator());
+  return v;
+}
+
+void ExperimentOpenLoop::cleanup_custom(unsigned core)
+{
+  timer.stop();
+  const double run_time = timer.get_time_in_seconds();
+  const double iops = double(_completed) / run_time;
+  const auto prefix = "[" + std::to_string(core) + "] " + test_name() + ":";
+  PINF("%s target %g ops/s, achieved %g ops/s (%zu operations over %2g seconds)", prefix.c_str(), _rate, iops, _completed, run_time);
+  print_percentiles(prefix, "response", _response);
+  print_percentiles(prefix, "service", _service);
+  _update_aggregate_iops(iops);
+
+  {
+    std::lock_guard<std::mutex> g(_summary_lock);
+    if ( ! _total_response )
+    {
+      _total_response.reset(new Hdr_histogram(HIGHEST_TRACKABLE_NS, SIGNIFICANT_DIGITS));
+      _total_service.reset(new Hdr_histogram(HIGHEST_TRACKABLE_NS, SIGNIFICANT_DIGITS));
+    }
+    _total_response->merge(_response);
+    _total_service->merge(_service);
+    _total_rate += _rate;
+    _total_iops += iops;
+  }
+
+  if ( is_json_reporting() )
+  {
+    std::lock_guard<std::mutex> g(g_write_lock);
+    rapidjson::Document document = _get_report_document();
+    rapidjson::Value experiment_object(rapidjson::kObjectType);
+    experiment_object.AddMember("target_rate", _rate, document.GetAllocator());
+    experiment_object.AddMember("IOPS", iops, document.GetAllocator());
+    experiment_object.AddMember("outstanding", _outstanding, document.GetAllocator());
+    experiment_object.AddMember("response", percentiles_to_report(_response, document), document.GetAllocator());
+    experiment_object.AddMember("service", percentiles_to_report(_service, document), document.GetAllocator());
+    _report_document_save(document, core, experiment_object);
+  }
+}
+
+void ExperimentOpenLoop::summarize()
+{
+  std::lock_guard<std::mutex> g(_summary_lock);
+  if ( _total_response )
+  {
+    PINF("[TOTAL] open_loop target %g ops/s, achieved %g ops/s (%lu operations)", _total_rate, _total_iops, static_cast<unsigned long>(_total_response->count()));
+    print_percentiles("[TOTAL]", "response", *_total_response);
+    print_percentiles("[TOTAL]", "service", *_total_service);
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef __EXP_OPEN_LOOP_H__
+#define __EXP_OPEN_LOOP_H__
+
+#include "experiment.h"
+
+#include "hdr_histogram.h"
+#include "key_distribution.h"
+
+#include <api/mcas_itf.h>
+
+#include <common/cycles.h>
+
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+/*
+ * Open-loop load: requests arrive as a Poisson process at --rate per
+ * core, independent of completions, and up to --outstanding requests are
+ * in flight (asynchronous operations on mcas, otherwise one at a time).
+ *
+ * Response latency is measured from each request's scheduled arrival,
+ * not from when it was issued, so time a request spends waiting behind a
+ * slow one is counted (no coordinated omission). Service latency, from
+ * issue to completion, is reported alongside.
+ */
+class ExperimentOpenLoop : public Experiment
+{
+  struct request
+  {
+    Component::IMCAS::async_handle_t handle;
+    cpu_time_t scheduled;
+    cpu_time_t issued;
+    void *value; /* async_get result */
+    std::size_t value_len;
+    bool in_use;
+  };
+
+  static constexpr std::uint64_t HIGHEST_TRACKABLE_NS = 3600ULL * 1000000000ULL;
+  static constexpr unsigned SIGNIFICANT_DIGITS = 3;
+
+  double _rate;
+  unsigned _outstanding;
+  unsigned _rd_pct;
+  bool _shared_client;
+  Component::IMCAS *_mcas; /* set if requests are issued asynchronously */
+  std::unique_ptr<Key_chooser> _key_chooser;
+  std::mt19937_64 _rnd;
+  std::exponential_distribution<double> _interarrival; /* in cycles */
+  std::uniform_int_distribution<unsigned> _rand_pct;
+  double _cycles_per_ns;
+  std::size_t _record_count;
+  cpu_time_t _start;
+  double _next_arrival; /* cycles after _start */
+  std::size_t _issued;
+  std::size_t _completed;
+  /* in-flight requests; slots do not move, as async_get writes through
+   * pointers to value and value_len */
+  std::vector<request> _slots;
+  std::vector<unsigned> _free_slots;
+  std::vector<Component::IMCAS::async_handle_t> _done_handles;
+  std::vector<status_t> _done_status;
+  Hdr_histogram _response;
+  Hdr_histogram _service;
+  bool _continuous;
+
+  static std::mutex _summary_lock;
+  static std::unique_ptr<Hdr_histogram> _total_response;
+  static std::unique_ptr<Hdr_histogram> _total_service;
+  static double _total_rate;
+  static double _total_iops;
+
+  bool issue(cpu_time_t scheduled);
+  void complete(request &r, status_t status, cpu_time_t now);
+  void poll();
+  bool more_arrivals() const;
+  std::size_t in_flight() const { return _slots.size() - _free_slots.size(); }
+
+  static void print_percentiles(const std::string &prefix, const char *label, const Hdr_histogram &h);
+  static rapidjson::Value percentiles_to_report(const Hdr_histogram &h, rapidjson::Document &document);
+
+public:
+  ExperimentOpenLoop(const ProgramOptions &options);
+  ExperimentOpenLoop(const ExperimentOpenLoop &) = delete;
+  ExperimentOpenLoop &operator=(const ExperimentOpenLoop &) = delete;
+  void initialize_custom(unsigned core) override;
+  bool do_work(unsigned core) override;
+  void cleanup_custom(unsigned core) override;
+  static void summarize();
+};
+
+#endif // __EXP_OPEN_LOOP_H__
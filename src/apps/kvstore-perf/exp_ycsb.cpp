@@ -0,0 +1,253 @@
+#include "exp_ycsb.h"
+
+#include "data.h"
+#include "program_options.h"
+
+#include <common/str_utils.h>
+
+#include <algorithm>
+#include <cctype> /* toupper */
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+  std::runtime_error op_failure(const char *op_, std::size_t index_, int rc_)
+  {
+    std::ostringstream e;
+    e << op_ << " rc != S_OK: " << rc_ << " @ index " << index_;
+    return std::runtime_error(e.str());
+  }
+}
+
+const ExperimentYcsb::mix &ExperimentYcsb::workload_mix(char workload_)
+{
+  /* read, update, insert, scan, read-modify-write */
+  static const mix mixes[] =
+  {
+    { 'a', 50, 50, 0, 0, 0, "zipfian" }, /* update heavy */
+    { 'b', 95, 5, 0, 0, 0, "zipfian" },  /* read mostly */
+    { 'c', 100, 0, 0, 0, 0, "zipfian" }, /* read only */
+    { 'd', 95, 0, 5, 0, 0, "latest" },   /* read latest */
+    { 'e', 0, 0, 5, 95, 0, "zipfian" },  /* short ranges */
+    { 'f', 50, 0, 0, 0, 50, "zipfian" }, /* read-modify-write */
+  };
+
+  for ( const auto &m : mixes )
+  {
+    if ( m.workload == workload_ )
+    {
+      return m;
+    }
+  }
+  throw std::logic_error(std::string("no YCSB workload ") + workload_);
+}
+
+ExperimentYcsb::ExperimentYcsb(char workload_, const ProgramOptions &options)
+  : Experiment(std::string("ycsb_") + workload_, options)
+  , _mix(workload_mix(workload_))
+  , _key_chooser(
+      make_key_chooser(
+        options.key_distribution.empty() ? _mix.default_distribution : options.key_distribution
+        , options.zipf_theta
+        , options.hotspot_fraction
+        , options.hotspot_op_fraction
+      )
+    )
+  , _value_length_chooser(options.value_length_distribution, options.value_length_min, options.value_length, options.zipf_theta)
+  , _rnd{}
+  , _rand_pct(0, 99)
+  , _i(0)
+  , _record_count(0)
+  , _sw()
+  , _op_rd{"read", 0, 0.0, BinStatistics()}
+  , _op_up{"update", 0, 0.0, BinStatistics()}
+  , _op_in{"insert", 0, 0.0, BinStatistics()}
+  , _op_sc{"scan", 0, 0.0, BinStatistics()}
+  , _op_rmw{"read-modify-write", 0, 0.0, BinStatistics()}
+  , _continuous(options.continuous)
+{
+}
+
+void ExperimentYcsb::initialize_custom(unsigned core)
+{
+  _rnd.seed(core);
+  for ( auto op : { &_op_rd, &_op_up, &_op_in, &_op_sc, &_op_rmw } )
+  {
+    op->latency = BinStatistics(bin_count(), bin_threshold_min(), bin_threshold_max());
+  }
+}
+
+void ExperimentYcsb::read(std::size_t index_)
+{
+  void * pval = nullptr;
+  size_t pval_len = 0;
+  auto rc = store()->get(pool(), g_data->key_as_string(index_), pval, pval_len);
+  if ( rc != S_OK )
+  {
+    throw op_failure("get", index_, rc);
+  }
+  store()->free_memory(pval);
+}
+
+void ExperimentYcsb::update(std::size_t index_)
+{
+  auto rc = store()->put(pool(), g_data->key_as_string(index_), g_data->value(index_), _value_length_chooser.next(_rnd));
+  if ( rc != S_OK )
+  {
+    throw op_failure("put", index_, rc);
+  }
+}
+
+bool ExperimentYcsb::do_work(unsigned core)
+{
+  // handle first time setup
+  if ( _first_iter )
+  {
+    // seed the pool with elements from _data
+    _populate_pool_to_capacity(core);
+    _record_count = pool_element_end();
+
+    /* inserting workloads need room: drop the tail of the loaded records */
+    if ( _mix.insert_pct != 0 )
+    {
+      const auto reserve = std::max<std::size_t>(1, _record_count * INSERT_RESERVE_PCT / 100);
+      _erase_pool_entries_in_range(_record_count - reserve, _record_count);
+      _record_count -= reserve;
+    }
+
+    wait_for_delayed_start(core);
+
+    PLOG("[%u] Starting YCSB workload %c (%zu records)...", core, std::toupper(_mix.workload), _record_count);
+    _first_iter = false;
+
+    timer.start();
+    if ( _duration_directed )
+    {
+      _end_time_directed = std::chrono::high_resolution_clock::now() + *_duration_directed;
+    }
+  }
+
+  op_stats *op = &_op_rd;
+  try
+  {
+    auto pct = _rand_pct(_rnd);
+
+    if ( pct < _mix.read_pct )
+    {
+      const auto index = _key_chooser->next(_rnd, _record_count);
+      _sw.start();
+      read(index);
+    }
+    else if ( (pct -= _mix.read_pct) < _mix.update_pct )
+    {
+      op = &_op_up;
+      const auto index = _key_chooser->next(_rnd, _record_count);
+      _sw.start();
+      update(index);
+    }
+    else if ( (pct -= _mix.update_pct) < _mix.insert_pct )
+    {
+      op = &_op_in;
+      _sw.start();
+      if ( _record_count < pool_element_end() )
+      {
+        update(_record_count);
+        ++_record_count;
+      }
+      else
+      {
+        /* insert space exhausted: rewrite the latest record */
+        update(_record_count - 1);
+      }
+    }
+    else if ( (pct -= _mix.insert_pct) < _mix.scan_pct )
+    {
+      /* The stores have no ordered key iteration, so a scan reads a run
+       * of consecutively loaded records starting at the chosen key */
+      op = &_op_sc;
+      const auto index = _key_chooser->next(_rnd, _record_count);
+      const auto length = std::uniform_int_distribution<std::size_t>(1, MAX_SCAN_LENGTH)(_rnd);
+      const auto end = std::min(index + length, _record_count);
+      _sw.start();
+      for ( auto i = index; i != end; ++i )
+      {
+        read(i);
+      }
+    }
+    else
+    {
+      op = &_op_rmw;
+      const auto index = _key_chooser->next(_rnd, _record_count);
+      _sw.start();
+      read(index);
+      update(index);
+    }
+
+    _sw.stop();
+    const auto lap = _sw.get_lap_time_in_seconds();
+    op->latency.update(lap);
+    op->total_secs += lap;
+    ++op->count;
+  }
+  catch ( std::exception &e )
+  {
+    PERR("%s in %s threw exception %s! Ending experiment.", op->name, test_name().c_str(), e.what());
+    throw;
+  }
+  catch ( ... )
+  {
+    PERR("%s in %s threw unknown object! Ending experiment.", op->name, test_name().c_str());
+    throw;
+  }
+
+  ++_i;
+
+  auto do_more =
+    _end_time_directed
+    ? std::chrono::high_resolution_clock::now() < *_end_time_directed
+    : ( _continuous || _i != pool_num_objects() )
+    ;
+
+  if ( ! do_more )
+  {
+    PINF("[%u] %s: reached total number of operations. Exiting.", core, test_name().c_str());
+  }
+
+  return do_more;
+}
+
+void ExperimentYcsb::cleanup_custom(unsigned core)
+{
+  timer.stop();
+  const double run_time = timer.get_time_in_seconds();
+  const double iops = double(_i) / run_time;
+  PINF("[%u] %s: IOPS--> %u (%lu operations over %2g seconds)", core, test_name().c_str(), unsigned(iops), _i, run_time);
+  _update_aggregate_iops(iops);
+
+  for ( auto op : { &_op_rd, &_op_up, &_op_in, &_op_sc, &_op_rmw } )
+  {
+    if ( op->count )
+    {
+      PINF("[%u] %s: %s count %lu mean latency %g s", core, test_name().c_str(), op->name, op->count, op->total_secs / double(op->count));
+    }
+  }
+
+  if ( is_json_reporting() )
+  {
+    std::lock_guard<std::mutex> g(g_write_lock);
+    rapidjson::Document document = _get_report_document();
+    rapidjson::Value experiment_object(rapidjson::kObjectType);
+    experiment_object.AddMember("IOPS", double(iops), document.GetAllocator());
+    for ( auto op : { &_op_rd, &_op_up, &_op_in, &_op_sc, &_op_rmw } )
+    {
+      if ( op->count )
+      {
+        rapidjson::Value name(op->name, document.GetAllocator());
+        experiment_object.AddMember(name, _add_statistics_to_report(op->latency, document), document.GetAllocator());
+      }
+    }
+    _report_document_save(document, core, experiment_object);
+  }
+}
@@ -0,0 +1,85 @@
+#ifndef __EXP_YCSB_H__
+#define __EXP_YCSB_H__
+
+#include "experiment.h"
+
+#include "key_distribution.h"
+#include "statistics.h"
+#include "stopwatch.h"
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+
+/*
+ * The YCSB core workloads A-F with a configurable key popularity
+ * distribution (--key_distribution) and value length distribution
+ * (--value_length_distribution).
+ */
+class ExperimentYcsb : public Experiment
+{
+public:
+  struct mix
+  {
+    char workload;
+    unsigned read_pct;
+    unsigned update_pct;
+    unsigned insert_pct;
+    unsigned scan_pct;
+    unsigned rmw_pct; /* read-modify-write */
+    const char *default_distribution;
+  };
+
+private:
+  struct op_stats
+  {
+    const char *name;
+    unsigned long count;
+    double total_secs;
+    BinStatistics latency;
+  };
+
+  static constexpr std::size_t MAX_SCAN_LENGTH = 100;
+  static constexpr unsigned INSERT_RESERVE_PCT = 10; /* of loaded records, kept free for inserts */
+
+  const mix _mix;
+  std::unique_ptr<Key_chooser> _key_chooser;
+  Value_length_chooser _value_length_chooser;
+  std::mt19937_64 _rnd;
+  std::uniform_int_distribution<unsigned> _rand_pct;
+  std::size_t _i;
+  std::size_t _record_count; /* records [0, _record_count) are present */
+  Stopwatch _sw;
+  op_stats _op_rd;
+  op_stats _op_up;
+  op_stats _op_in;
+  op_stats _op_sc;
+  op_stats _op_rmw;
+  bool _continuous;
+
+  static const mix &workload_mix(char workload);
+
+  void read(std::size_t index);
+  void update(std::size_t index);
+
+protected:
+  ExperimentYcsb(char workload, const ProgramOptions &options);
+
+public:
+  void initialize_custom(unsigned core) override;
+  bool do_work(unsigned core) override;
+  void cleanup_custom(unsigned core) override;
+};
+
+template <char W>
+  class ExperimentYcsbWorkload
+    : public ExperimentYcsb
+  {
+  public:
+    explicit ExperimentYcsbWorkload(const ProgramOptions &options)
+      : ExperimentYcsb(W, options)
+    {}
+  };
+
+#endif // __EXP_YCSB_H__
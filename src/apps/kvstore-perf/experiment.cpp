@@ -35,6 +35,7 @@
 #define HT_SIZE_FACTOR 1 /* already factor 3 in hstore */
 
 Data * Experiment::g_data;
+Component::IKVStore * Experiment::g_shared_store;
 std::mutex Experiment::g_write_lock;
 double Experiment::g_iops;
 
@@ -148,6 +149,7 @@ Experiment::Experiment(std::string name_, const ProgramOptions &options)
   , _store()
   , _pool()
   , _server_address(options.server_address)
+  , _client_mode(options.client_mode)
   , _port(options.port)
   , _port_increment(options.port_increment ? *options.port_increment : 0)
   , _device_name(options.device_name)
@@ -284,7 +286,25 @@ int Experiment::initialize_store(unsigned core)
       {
         throw std::runtime_error("Component " + _component + " has no device_name");
       }
-      _store = fact->create(_debug_level, _owner, url, *_device_name);
+      if ( _client_mode == "instance" )
+      {
+        _store = fact->create(_debug_level, _owner, url, *_device_name);
+      }
+      else
+      {
+        /* one client for all workers; it keeps a reference for the life of the process */
+        std::lock_guard<std::mutex> g(g_write_lock);
+        if ( ! g_shared_store )
+        {
+          if ( _client_mode == "thread" )
+          {
+            setenv("MCAS_THREAD_CONNECTIONS", "1", 1);
+          }
+          g_shared_store = fact->create(_debug_level, _owner, url, *_device_name);
+        }
+        _store = g_shared_store;
+        _store->add_ref();
+      }
       PMAJOR("mcas component instance: %p", static_cast<const void *>(_store));
     }
     else if ( component_is( "hstore" ) || component_is("dummystore") ) {
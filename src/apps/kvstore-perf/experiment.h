@@ -56,6 +56,7 @@ private:
   Component::IKVStore *                 _store;
   Component::IKVStore::pool_t           _pool;
   std::string                           _server_address;
+  std::string                           _client_mode;
   unsigned                              _port;
   unsigned                              _port_increment;
   boost::optional<std::string>          _device_name;
@@ -94,6 +95,7 @@ private:
 
 public:
   static Data * g_data;
+  static Component::IKVStore * g_shared_store; /* --client_mode shared or thread */
   static std::mutex g_write_lock;
   static double g_iops;
 
@@ -0,0 +1,162 @@
+#ifndef __HDR_HISTOGRAM_H__
+#define __HDR_HISTOGRAM_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * High dynamic range histogram of integer values (here: nanoseconds), after
+ * Gil Tene's HdrHistogram. Values are kept to a fixed number of significant
+ * decimal digits over the whole range [1, highest_trackable]; recording is
+ * a bit scan and an increment.
+ */
+class Hdr_histogram
+{
+  std::uint64_t _highest_trackable;
+  unsigned _sub_bucket_half_count_magnitude;
+  std::uint64_t _sub_bucket_half_count;
+  std::uint64_t _sub_bucket_mask;
+  std::vector<std::uint64_t> _counts;
+  std::uint64_t _total;
+  std::uint64_t _min;
+  std::uint64_t _max;
+
+  static unsigned clz(std::uint64_t v) { return unsigned(__builtin_clzll(v)); }
+
+  unsigned bucket_index(std::uint64_t v) const
+  {
+    const unsigned pow2ceiling = 64 - clz(v | _sub_bucket_mask);
+    return pow2ceiling - (_sub_bucket_half_count_magnitude + 1);
+  }
+
+  std::size_t counts_index(std::uint64_t v) const
+  {
+    const auto b = bucket_index(v);
+    const auto sub = v >> b;
+    return std::size_t(((std::uint64_t(b) + 1) << _sub_bucket_half_count_magnitude) + (sub - _sub_bucket_half_count));
+  }
+
+  /* lowest value that maps to counts index i */
+  std::uint64_t value_at_index(std::size_t i) const
+  {
+    long b = long(i >> _sub_bucket_half_count_magnitude) - 1;
+    std::uint64_t sub = (i & (_sub_bucket_half_count - 1)) + _sub_bucket_half_count;
+    if ( b < 0 )
+    {
+      sub -= _sub_bucket_half_count;
+      b = 0;
+    }
+    return sub << b;
+  }
+
+  std::uint64_t highest_equivalent(std::uint64_t v) const
+  {
+    return v + (std::uint64_t(1) << bucket_index(v)) - 1;
+  }
+
+public:
+  Hdr_histogram(std::uint64_t highest_trackable_, unsigned significant_digits_)
+    : _highest_trackable(highest_trackable_)
+    , _sub_bucket_half_count_magnitude()
+    , _sub_bucket_half_count()
+    , _sub_bucket_mask()
+    , _counts()
+    , _total(0)
+    , _min(UINT64_MAX)
+    , _max(0)
+  {
+    if ( significant_digits_ < 1 || 5 < significant_digits_ || highest_trackable_ < 2 )
+    {
+      throw std::domain_error("Hdr_histogram: bad range or precision");
+    }
+    const double largest_single_unit = 2.0 * std::pow(10.0, significant_digits_);
+    const auto sub_bucket_count_magnitude = unsigned(std::ceil(std::log2(largest_single_unit)));
+    _sub_bucket_half_count_magnitude = sub_bucket_count_magnitude - 1;
+    const std::uint64_t sub_bucket_count = std::uint64_t(1) << sub_bucket_count_magnitude;
+    _sub_bucket_half_count = sub_bucket_count / 2;
+    _sub_bucket_mask = sub_bucket_count - 1;
+
+    unsigned bucket_count = 1;
+    for ( auto smallest_untrackable = sub_bucket_count; smallest_untrackable <= highest_trackable_; ++bucket_count )
+    {
+      if ( smallest_untrackable > UINT64_MAX / 2 )
+      {
+        ++bucket_count;
+        break;
+      }
+      smallest_untrackable <<= 1;
+    }
+    _counts.resize((bucket_count + 1) * _sub_bucket_half_count);
+  }
+
+  void record(std::uint64_t v)
+  {
+    v = std::min(v, _highest_trackable);
+    ++_counts[counts_index(v)];
+    ++_total;
+    _min = std::min(_min, v);
+    _max = std::max(_max, v);
+  }
+
+  void merge(const Hdr_histogram &other)
+  {
+    if ( other._counts.size() != _counts.size() )
+    {
+      throw std::domain_error("Hdr_histogram: merge of different layouts");
+    }
+    for ( std::size_t i = 0; i != _counts.size(); ++i )
+    {
+      _counts[i] += other._counts[i];
+    }
+    _total += other._total;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+  }
+
+  std::uint64_t count() const { return _total; }
+  std::uint64_t min() const { return _total ? _min : 0; }
+  std::uint64_t max() const { return _max; }
+
+  /* value at or below which pct percent of the recorded values fall */
+  std::uint64_t percentile(double pct) const
+  {
+    if ( _total == 0 )
+    {
+      return 0;
+    }
+    const auto target = std::max<std::uint64_t>(1, std::uint64_t(std::ceil(pct / 100.0 * double(_total))));
+    std::uint64_t seen = 0;
+    for ( std::size_t i = 0; i != _counts.size(); ++i )
+    {
+      seen += _counts[i];
+      if ( target <= seen )
+      {
+        return std::min(highest_equivalent(value_at_index(i)), _max);
+      }
+    }
+    return _max;
+  }
+
+  double mean() const
+  {
+    if ( _total == 0 )
+    {
+      return 0.0;
+    }
+    double sum = 0.0;
+    for ( std::size_t i = 0; i != _counts.size(); ++i )
+    {
+      if ( _counts[i] )
+      {
+        const auto lo = value_at_index(i);
+        sum += double(_counts[i]) * (double(lo) + double(highest_equivalent(lo))) / 2.0;
+      }
+    }
+    return sum / double(_total);
+  }
+};
+
+#endif // __HDR_HISTOGRAM_H__
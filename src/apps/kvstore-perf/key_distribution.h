@@ -0,0 +1,231 @@
+#ifndef __KEY_DISTRIBUTION_H__
+#define __KEY_DISTRIBUTION_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+/*
+ * Record choosers for skewed workloads, after the YCSB generators
+ * (Cooper et al., "Benchmarking Cloud Serving Systems with YCSB", SoCC'10).
+ * Each returns a record index in [0, record_count); record_count may grow
+ * between calls as records are inserted.
+ */
+
+class Key_chooser
+{
+public:
+  virtual ~Key_chooser() {}
+  virtual std::size_t next(std::mt19937_64 &rnd, std::size_t record_count) = 0;
+};
+
+class Key_chooser_uniform
+  : public Key_chooser
+{
+public:
+  std::size_t next(std::mt19937_64 &rnd, std::size_t record_count) override
+  {
+    return std::uniform_int_distribution<std::size_t>(0, record_count - 1)(rnd);
+  }
+};
+
+/* Zipfian over item ranks, rank 0 most popular (Gray et al., "Quickly
+ * generating billion-record synthetic databases", SIGMOD'94). The zeta
+ * constant is extended incrementally as record_count grows.
+ */
+class Zipfian
+{
+  double _theta;
+  double _alpha;
+  double _zeta2;
+  std::size_t _n;
+  double _zetan;
+  double _eta;
+  std::uniform_real_distribution<double> _u;
+
+  void extend(std::size_t n)
+  {
+    if ( n < _n )
+    {
+      _n = 0;
+      _zetan = 0.0;
+    }
+    for ( ; _n < n; ++_n )
+    {
+      _zetan += 1.0 / std::pow(double(_n + 1), _theta);
+    }
+    _eta = (1.0 - std::pow(2.0 / double(n), 1.0 - _theta)) / (1.0 - _zeta2 / _zetan);
+  }
+
+public:
+  explicit Zipfian(double theta_)
+    : _theta(theta_)
+    , _alpha(1.0 / (1.0 - theta_))
+    , _zeta2(1.0 + 1.0 / std::pow(2.0, theta_))
+    , _n(0)
+    , _zetan(0.0)
+    , _eta(0.0)
+    , _u(0.0, 1.0)
+  {
+    if ( ! (0.0 < theta_ && theta_ < 1.0) )
+    {
+      throw std::domain_error("zipfian theta must be in (0, 1)");
+    }
+  }
+
+  /* rank in [0, n) */
+  std::size_t next(std::mt19937_64 &rnd, std::size_t n)
+  {
+    if ( n != _n )
+    {
+      extend(n);
+    }
+    const double u = _u(rnd);
+    const double uz = u * _zetan;
+    if ( uz < 1.0 ) { return 0; }
+    if ( uz < _zeta2 ) { return std::min<std::size_t>(1, n - 1); }
+    const auto r = std::size_t(double(n) * std::pow(_eta * u - _eta + 1.0, _alpha));
+    return std::min(r, n - 1);
+  }
+};
+
+/* Zipfian popularity with the popular items scattered over the key space */
+class Key_chooser_zipfian
+  : public Key_chooser
+{
+  Zipfian _zipf;
+
+  static std::uint64_t fnv1a(std::uint64_t v)
+  {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for ( unsigned i = 0; i != 8; ++i )
+    {
+      h = (h ^ (v & 0xff)) * 0x100000001b3ULL;
+      v >>= 8;
+    }
+    return h;
+  }
+
+public:
+  explicit Key_chooser_zipfian(double theta_)
+    : _zipf(theta_)
+  {}
+
+  std::size_t next(std::mt19937_64 &rnd, std::size_t record_count) override
+  {
+    return fnv1a(_zipf.next(rnd, record_count)) % record_count;
+  }
+};
+
+/* Zipfian over recency: the most recently inserted record is most popular */
+class Key_chooser_latest
+  : public Key_chooser
+{
+  Zipfian _zipf;
+
+public:
+  explicit Key_chooser_latest(double theta_)
+    : _zipf(theta_)
+  {}
+
+  std::size_t next(std::mt19937_64 &rnd, std::size_t record_count) override
+  {
+    return record_count - 1 - _zipf.next(rnd, record_count);
+  }
+};
+
+/* A hot set of hot_fraction of the records receives hot_op_fraction of the operations */
+class Key_chooser_hotspot
+  : public Key_chooser
+{
+  double _hot_fraction;
+  double _hot_op_fraction;
+  std::uniform_real_distribution<double> _u;
+
+public:
+  Key_chooser_hotspot(double hot_fraction_, double hot_op_fraction_)
+    : _hot_fraction(hot_fraction_)
+    , _hot_op_fraction(hot_op_fraction_)
+    , _u(0.0, 1.0)
+  {
+    if ( ! (0.0 < hot_fraction_ && hot_fraction_ < 1.0) || ! (0.0 <= hot_op_fraction_ && hot_op_fraction_ <= 1.0) )
+    {
+      throw std::domain_error("hotspot fractions out of range");
+    }
+  }
+
+  std::size_t next(std::mt19937_64 &rnd, std::size_t record_count) override
+  {
+    const auto hot = std::max<std::size_t>(1, std::size_t(double(record_count) * _hot_fraction));
+    if ( _u(rnd) < _hot_op_fraction || hot == record_count )
+    {
+      return std::uniform_int_distribution<std::size_t>(0, hot - 1)(rnd);
+    }
+    return std::uniform_int_distribution<std::size_t>(hot, record_count - 1)(rnd);
+  }
+};
+
+inline std::unique_ptr<Key_chooser> make_key_chooser(
+  const std::string &name_
+  , double theta_
+  , double hot_fraction_
+  , double hot_op_fraction_
+)
+{
+  if ( name_ == "uniform" ) { return std::unique_ptr<Key_chooser>(new Key_chooser_uniform()); }
+  if ( name_ == "zipfian" ) { return std::unique_ptr<Key_chooser>(new Key_chooser_zipfian(theta_)); }
+  if ( name_ == "latest" ) { return std::unique_ptr<Key_chooser>(new Key_chooser_latest(theta_)); }
+  if ( name_ == "hotspot" ) { return std::unique_ptr<Key_chooser>(new Key_chooser_hotspot(hot_fraction_, hot_op_fraction_)); }
+  throw std::domain_error("unknown key distribution '" + name_ + "'");
+}
+
+/* Value lengths in [min, max]: constant (max), uniform, or zipfian favoring short values */
+class Value_length_chooser
+{
+  enum class kind { constant, uniform, zipfian } _kind;
+  std::size_t _min;
+  std::size_t _max;
+  Zipfian _zipf;
+
+  static kind parse(const std::string &name_)
+  {
+    if ( name_ == "constant" ) { return kind::constant; }
+    if ( name_ == "uniform" ) { return kind::uniform; }
+    if ( name_ == "zipfian" ) { return kind::zipfian; }
+    throw std::domain_error("unknown value length distribution '" + name_ + "'");
+  }
+
+public:
+  Value_length_chooser(const std::string &name_, std::size_t min_, std::size_t max_, double theta_)
+    : _kind(parse(name_))
+    , _min(min_)
+    , _max(max_)
+    , _zipf(theta_)
+  {
+    if ( _kind != kind::constant && ! ( 0 < min_ && min_ <= max_ ) )
+    {
+      throw std::domain_error("value length range must satisfy 0 < min <= max");
+    }
+  }
+
+  std::size_t next(std::mt19937_64 &rnd)
+  {
+    switch ( _kind )
+    {
+    case kind::uniform:
+      return std::uniform_int_distribution<std::size_t>(_min, _max)(rnd);
+    case kind::zipfian:
+      return _min + _zipf.next(rnd, _max - _min + 1);
+    case kind::constant:
+    default:
+      return _max;
+    }
+  }
+};
+
+#endif // __KEY_DISTRIBUTION_H__
@@ -5,9 +5,11 @@
 #include "exp_get.h"
 #include "exp_get_direct.h"
 #include "exp_erase.h"
+#include "exp_open_loop.h"
 #include "exp_put_direct.h"
 #include "exp_throughput.h"
 #include "exp_update.h"
+#include "exp_ycsb.h"
 #include "get_cpu_mask_from_string.h"
 #include "get_vector_from_string.h"
 #include "program_options.h"
@@ -57,6 +59,13 @@ namespace
     { "throughput", run_exp<ExperimentThroughput> },
     { "erase", run_exp<ExperimentErase> },
     { "update", run_exp<ExperimentUpdate> },
+    { "ycsb_a", run_exp<ExperimentYcsbWorkload<'a'>> },
+    { "ycsb_b", run_exp<ExperimentYcsbWorkload<'b'>> },
+    { "ycsb_c", run_exp<ExperimentYcsbWorkload<'c'>> },
+    { "ycsb_d", run_exp<ExperimentYcsbWorkload<'d'>> },
+    { "ycsb_e", run_exp<ExperimentYcsbWorkload<'e'>> },
+    { "ycsb_f", run_exp<ExperimentYcsbWorkload<'f'>> },
+    { "open_loop", run_exp<ExperimentOpenLoop> },
   };
 }
 
@@ -61,6 +61,14 @@ try
   , summary( vm_.count("summary") )
   , read_pct( clamp(vm_["read_pct"].as<unsigned>(), 0U, 100U) )
   , insert_erase_pct( clamp(vm_["insert_erase_pct"].as<unsigned>(), 0U, 100U) )
+  , key_distribution( vm_.count("key_distribution") ? vm_["key_distribution"].as<std::string>() : "" )
+  , zipf_theta(vm_["zipf_theta"].as<double>())
+  , hotspot_fraction(vm_["hotspot_fraction"].as<double>())
+  , hotspot_op_fraction(vm_["hotspot_op_fraction"].as<double>())
+  , value_length_distribution(vm_["value_length_distribution"].as<std::string>())
+  , value_length_min( vm_.count("value_length_min") ? vm_["value_length_min"].as<unsigned>() : value_length )
+  , rate(vm_["rate"].as<double>())
+  , outstanding(vm_["outstanding"].as<unsigned>())
   , devices(vm_.count("devices") ? vm_["devices"].as<std::string>() : cores)
   , time_secs()
   , path( vm_.count("path") ? vm_["path"].as<std::string>() : boost::optional<std::string>() )
@@ -77,6 +85,7 @@ try
   , report_interval(vm_["report_interval"].as<unsigned>())
   , owner(vm_["owner"].as<std::string>())
   , server_address(vm_["server"].as<std::string>())
+  , client_mode(vm_["client_mode"].as<std::string>())
   , port(vm_["port"].as<unsigned>())
   , port_increment( vm_.count("port_increment") ? vm_["port_increment"].as<unsigned>() : boost::optional<unsigned>())
   , device_name(vm_.count("device_name") ? vm_["device_name"].as<std::string>() : boost::optional<std::string>())
@@ -88,6 +97,39 @@ try
     throw std::runtime_error(e);
   }
 
+  if ( client_mode != "instance" && client_mode != "shared" && client_mode != "thread" )
+  {
+    auto e = "unknown --client_mode '" + client_mode + "'";
+    throw std::runtime_error(e);
+  }
+
+  if ( ! key_distribution.empty() && key_distribution != "uniform" && key_distribution != "zipfian" && key_distribution != "latest" && key_distribution != "hotspot" )
+  {
+    auto e = "unknown --key_distribution '" + key_distribution + "'";
+    throw std::runtime_error(e);
+  }
+
+  if ( value_length_distribution != "constant" && value_length_distribution != "uniform" && value_length_distribution != "zipfian" )
+  {
+    auto e = "unknown --value_length_distribution '" + value_length_distribution + "'";
+    throw std::runtime_error(e);
+  }
+
+  if ( value_length_min == 0 || value_length < value_length_min )
+  {
+    throw std::runtime_error("--value_length_min must be in [1, value_length]");
+  }
+
+  if ( ! ( 0.0 < rate ) )
+  {
+    throw std::runtime_error("--rate must be positive");
+  }
+
+  if ( outstanding == 0 )
+  {
+    throw std::runtime_error("--outstanding must be at least 1");
+  }
+
   if ( component_is( "nvmestore" ) && ! pci_addr )
   {
     auto e = "component '" + component + "' requires --pci_addr argument";
@@ -137,10 +179,19 @@ void ProgramOptions::add_program_options(
     ("debug_level", po::value<int>()->default_value(0), "Debug level. Default: 0.")
     ("read_pct", po::value<unsigned>()->default_value(0) , "Read percentage in throughput test. Default: 0.")
     ("insert_erase_pct", po::value<unsigned>()->default_value(0) , "Insert/erase percentage in throughput test. Default: 0.")
+    ("key_distribution", po::value<std::string>(), "Key popularity in ycsb and open_loop tests <uniform|zipfian|latest|hotspot>. Default: uniform for open_loop, latest for ycsb_d, zipfian otherwise.")
+    ("zipf_theta", po::value<double>()->default_value(0.99), "Skew of the zipfian and latest distributions, in (0, 1). Default: 0.99.")
+    ("hotspot_fraction", po::value<double>()->default_value(0.2), "Fraction of keys in the hot set of the hotspot distribution. Default: 0.2.")
+    ("hotspot_op_fraction", po::value<double>()->default_value(0.8), "Fraction of operations directed to the hot set of the hotspot distribution. Default: 0.8.")
+    ("value_length_distribution", po::value<std::string>()->default_value("constant"), "Length of values written in ycsb tests <constant|uniform|zipfian>, between value_length_min and value_length. Default: constant.")
+    ("value_length_min", po::value<unsigned>(), "Shortest value written in ycsb tests. Default: value_length.")
+    ("rate", po::value<double>()->default_value(10000.0), "Mean request arrival rate per core in open_loop test, in operations per second. Default: 10000.")
+    ("outstanding", po::value<unsigned>()->default_value(16), "Maximum requests in flight per core in open_loop test (mcas only; capped by MCAS_ASYNC_WINDOW). Default: 16.")
     ("owner", po::value<std::string>()->default_value("owner"), "Owner name for component registration")
     ("server", po::value<std::string>()->default_value("127.0.0.1"), "MCAS server IP address. Default: 127.0.0.1")
     ("port", po::value<unsigned>()->default_value(11911), "MCAS server port. Default 11911")
     ("port_increment", po::value<unsigned>(), "Port increment every N instances.")
+    ("client_mode", po::value<std::string>()->default_value("instance"), "MCAS client per worker thread <instance|shared|thread>. instance: one client per thread; shared: one client shared by all threads; thread: one shared client with an endpoint per thread. Default: instance.")
     ("device_name", po::value<std::string>()->default_value("unused"), "Device name.")
     ("pci_addr", po::value<std::string>(), "Storage device PCI address (e.g. 0b:00.0).")
     ("nopin", "Do not pin down worker threads to cores.")
@@ -27,6 +27,14 @@ public:
   bool summary;
   unsigned read_pct;
   unsigned insert_erase_pct;
+  std::string key_distribution; /* empty: the workload's default */
+  double zipf_theta;
+  double hotspot_fraction;
+  double hotspot_op_fraction;
+  std::string value_length_distribution;
+  unsigned value_length_min;
+  double rate; /* open_loop arrivals per second per core */
+  unsigned outstanding;
   /* finalized later */
   std::string devices;
   unsigned time_secs;
@@ -44,6 +52,7 @@ public:
   unsigned report_interval;
   std::string owner;
   std::string server_address;
+  std::string client_mode;
   unsigned port;
   boost::optional<unsigned> port_increment;
   boost::optional<std::string> device_name;
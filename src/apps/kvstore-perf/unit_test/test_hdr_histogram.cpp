@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include "../hdr_histogram.h"
+
+#include <cstdint>
+
+TEST(HdrHistogramTest, Empty)
+{
+  Hdr_histogram h(3600000000000ULL, 3);
+  ASSERT_EQ(h.count(), 0U);
+  ASSERT_EQ(h.percentile(99.0), 0U);
+  ASSERT_EQ(h.min(), 0U);
+  ASSERT_EQ(h.max(), 0U);
+}
+
+TEST(HdrHistogramTest, SmallValuesExact)
+{
+  Hdr_histogram h(3600000000000ULL, 3);
+  for ( std::uint64_t v = 1; v <= 1000; ++v )
+  {
+    h.record(v);
+  }
+  ASSERT_EQ(h.count(), 1000U);
+  ASSERT_EQ(h.percentile(50.0), 500U);
+  ASSERT_EQ(h.percentile(99.0), 990U);
+  ASSERT_EQ(h.percentile(100.0), 1000U);
+  ASSERT_EQ(h.min(), 1U);
+  ASSERT_NEAR(h.mean(), 500.5, 0.5);
+}
+
+TEST(HdrHistogramTest, Precision)
+{
+  /* three significant digits: relative error below 0.1% over the range */
+  for ( std::uint64_t v = 1; v < 3600000000000ULL; v = v * 3 + 7 )
+  {
+    Hdr_histogram one(3600000000000ULL, 3);
+    one.record(v);
+    const auto p = one.percentile(50.0);
+    ASSERT_GE(p, v);
+    ASSERT_LE(double(p - v), double(v) / 1000.0);
+  }
+}
+
+TEST(HdrHistogramTest, Tail)
+{
+  /* the case coordinated omission hides: a few very slow requests */
+  Hdr_histogram h(3600000000000ULL, 3);
+  for ( unsigned i = 0; i != 9900; ++i )
+  {
+    h.record(10000);
+  }
+  for ( unsigned i = 0; i != 100; ++i )
+  {
+    h.record(1000000000);
+  }
+  ASSERT_NEAR(double(h.percentile(99.0)), 10000.0, 10.0);
+  ASSERT_NEAR(double(h.percentile(99.9)), 1000000000.0, 1000000.0);
+  ASSERT_EQ(h.max(), 1000000000U);
+}
+
+TEST(HdrHistogramTest, Merge)
+{
+  Hdr_histogram a(3600000000000ULL, 3);
+  Hdr_histogram b(3600000000000ULL, 3);
+  a.record(100);
+  b.record(5000000);
+  a.merge(b);
+  ASSERT_EQ(a.count(), 2U);
+  ASSERT_EQ(a.min(), 100U);
+  ASSERT_EQ(a.max(), 5000000U);
+  ASSERT_THROW(a.merge(Hdr_histogram(1000, 2)), std::domain_error);
+}
+
+TEST(HdrHistogramTest, Clamp)
+{
+  Hdr_histogram h(1000000, 3);
+  h.record(UINT64_MAX);
+  ASSERT_EQ(h.max(), 1000000U);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "../key_distribution.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+  std::vector<unsigned> histogram(Key_chooser &c, std::size_t n, unsigned samples)
+  {
+    std::mt19937_64 rnd(1);
+    std::vector<unsigned> h(n);
+    for ( unsigned i = 0; i != samples; ++i )
+    {
+      auto k = c.next(rnd, n);
+      EXPECT_LT(k, n);
+      ++h[k];
+    }
+    return h;
+  }
+}
+
+TEST(KeyDistributionTest, Uniform)
+{
+  Key_chooser_uniform c;
+  auto h = histogram(c, 10, 100000);
+  for ( auto v : h )
+  {
+    ASSERT_GT(v, 9000U);
+    ASSERT_LT(v, 11000U);
+  }
+}
+
+TEST(KeyDistributionTest, ZipfianIsSkewed)
+{
+  Key_chooser_zipfian c(0.99);
+  auto h = histogram(c, 1000, 100000);
+  std::sort(h.begin(), h.end(), std::greater<unsigned>());
+  /* with theta 0.99 over 1000 items the most popular item takes ~13% */
+  ASSERT_GT(h[0], 10000U);
+  ASSERT_GT(h[0], 10 * h[100]);
+}
+
+TEST(KeyDistributionTest, LatestFavorsNewest)
+{
+  Key_chooser_latest c(0.99);
+  auto h = histogram(c, 1000, 100000);
+  ASSERT_EQ(std::max_element(h.begin(), h.end()) - h.begin(), 999);
+}
+
+TEST(KeyDistributionTest, LatestGrows)
+{
+  Key_chooser_latest c(0.99);
+  std::mt19937_64 rnd(1);
+  for ( std::size_t n = 1; n != 2000; ++n )
+  {
+    ASSERT_LT(c.next(rnd, n), n);
+  }
+}
+
+TEST(KeyDistributionTest, Hotspot)
+{
+  Key_chooser_hotspot c(0.2, 0.8);
+  auto h = histogram(c, 100, 100000);
+  unsigned hot = 0;
+  for ( unsigned i = 0; i != 20; ++i )
+  {
+    hot += h[i];
+  }
+  ASSERT_GT(hot, 78000U);
+  ASSERT_LT(hot, 82000U);
+}
+
+TEST(KeyDistributionTest, ValueLength)
+{
+  std::mt19937_64 rnd(1);
+  Value_length_chooser constant("constant", 8, 64, 0.99);
+  Value_length_chooser uniform("uniform", 8, 64, 0.99);
+  Value_length_chooser zipfian("zipfian", 8, 64, 0.99);
+  for ( unsigned i = 0; i != 10000; ++i )
+  {
+    ASSERT_EQ(constant.next(rnd), 64U);
+    auto u = uniform.next(rnd);
+    ASSERT_GE(u, 8U);
+    ASSERT_LE(u, 64U);
+    auto z = zipfian.next(rnd);
+    ASSERT_GE(z, 8U);
+    ASSERT_LE(z, 64U);
+  }
+}
+
+TEST(KeyDistributionTest, BadName)
+{
+  ASSERT_THROW(make_key_chooser("pareto", 0.99, 0.2, 0.8), std::domain_error);
+  ASSERT_THROW(Value_length_chooser("pareto", 1, 2, 0.99), std::domain_error);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
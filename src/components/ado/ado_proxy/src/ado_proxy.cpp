@@ -169,6 +169,21 @@ status_t ADO_proxy::send_work_request(const uint64_t work_request_key,
   return S_OK;
 }
 
+status_t ADO_proxy::send_work_batch_request(const std::vector<work_item_t>& items) {
+  _outstanding_wr += static_cast<unsigned>(items.size());
+
+  _ipc->send_work_batch_request(items);
+  return S_OK;
+}
+
+size_t ADO_proxy::work_batch_item_space(const size_t invocation_len) const {
+  return ADO_protocol_builder::work_batch_item_space(invocation_len);
+}
+
+size_t ADO_proxy::work_batch_capacity() const {
+  return ADO_protocol_builder::work_batch_capacity();
+}
+
 void ADO_proxy::send_table_op_response(const status_t s,
                                        const void *value_addr,
                                        size_t value_len,
@@ -95,6 +95,11 @@ public:
                              const size_t invocation_data_len,
                              const bool new_root) override;
 
+  status_t send_work_batch_request(const std::vector<work_item_t>& items) override;
+
+  size_t work_batch_item_space(const size_t invocation_len) const override;
+
+  size_t work_batch_capacity() const override;
 
   bool check_work_completions(uint64_t& request_key,
                               status_t& out_status,
@@ -82,6 +82,8 @@ public:
 
   status_t shutdown() override;
 
+  bool thread_safe() const override { return true; }
+
 };
 
 
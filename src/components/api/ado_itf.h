@@ -196,6 +196,16 @@ class IADO_plugin : public Component::IBase {
    */
   virtual void notify_op_event(ADO_op op) {} /* see ADO::OP_XXX */
 
+  /**
+   * Declare that do_work may be called concurrently from several threads.
+   * The ADO process then runs work requests on a thread pool (one thread
+   * per core it was given); requests for the same key still run one at a
+   * time, in order.  Callbacks are safe to use from any thread.
+   *
+   * @return True if do_work is thread safe
+   */
+  virtual bool thread_safe() const { return false; }
+
   /* note:     FLAGS_CREATE_ONLY = 0x4, */
   enum {
     FLAGS_ADO_LIFETIME_UNLOCK = 0x21,
@@ -597,6 +607,40 @@ class IADO_proxy : public Component::IBase {
                                      const size_t   invocation_len,
                                      const bool     new_root) = 0;
 
+  /* one request in a work batch; fields as send_work_request */
+  struct work_item_t {
+    uint64_t    work_request_key;
+    const char* key;
+    size_t      key_len;
+    const void* value_addr;
+    size_t      value_len;
+    const void* invocation_data;
+    size_t      invocation_len;
+    bool        new_root;
+  };
+
+  /**
+   * Send several work requests to the ADO in one message.  Each item
+   * completes individually through check_work_completions.
+   *
+   * @param items Work items; must fit in one message (see
+   * work_batch_item_space)
+   *
+   * @return S_OK on success
+   */
+  virtual status_t send_work_batch_request(const std::vector<work_item_t>& items) = 0;
+
+  /**
+   * Space taken by one item in a work batch
+   *
+   * @param invocation_len Length of the item's invocation data
+   *
+   * @return Bytes; the items of one batch may total work_batch_capacity()
+   */
+  virtual size_t work_batch_item_space(const size_t invocation_len) const = 0;
+
+  virtual size_t work_batch_capacity() const = 0;
+
   /**
    * Check for completion of work
    *
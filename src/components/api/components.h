@@ -43,6 +43,14 @@ DECLARE_STATIC_COMPONENT_UUID(mapstore_factory, 0xfac20985, 0x1253, 0x404d, 0x94
 DECLARE_STATIC_COMPONENT_UUID(rbtreeindex, 0x8a120985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x29);
 DECLARE_STATIC_COMPONENT_UUID(rbtreeindex_factory, 0xfac20985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x29);
 
+/*< concurrent B+-tree index */
+DECLARE_STATIC_COMPONENT_UUID(btreeindex, 0x8a120985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2a);
+DECLARE_STATIC_COMPONENT_UUID(btreeindex_factory, 0xfac20985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2a);
+
+/*< persistent B+-tree index */
+DECLARE_STATIC_COMPONENT_UUID(pmtreeindex, 0x8a120985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2b);
+DECLARE_STATIC_COMPONENT_UUID(pmtreeindex_factory, 0xfac20985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2b);
+
 /*< mcas client */
 DECLARE_STATIC_COMPONENT_UUID(mcas_client, 0x2f666078, 0xcb8a, 0x4724, 0xa454, 0xd1, 0xd8, 0x8d, 0xe2, 0xdb, 0x87);
 DECLARE_STATIC_COMPONENT_UUID(mcas_client_factory, 0xfac66078, 0xcb8a, 0x4724, 0xa454, 0xd1, 0xd8, 0x8d, 0xe2, 0xdb, 0x87);
@@ -211,6 +211,22 @@ class IFabric_op_completer {
    */
   virtual void wait_for_next_completion(std::chrono::milliseconds timeout) = 0;
 
+  /**
+   * Prepare to wait for completions together with other endpoints, e.g. by
+   * poll(2) over the descriptors of many connections.  Unlike
+   * wait_for_next_completion, the wait cannot be ended by
+   * unblock_completions.
+   *
+   * @param fds [out] Descriptors which signal a completion (as readable,
+   * writable or exceptional) are appended
+   *
+   * @return true if the caller may block; false if completions may already
+   * be queued (or the endpoint is shut down), in which case poll instead
+   *
+   * @throw IFabric_runtime_error - ::fi_control fail
+   */
+  virtual bool prepare_wait(std::vector<int> &fds) = 0;
+
   /**
    * Unblock any threads waiting on completions
    *
@@ -337,7 +353,9 @@ class IFabric_connection {
    *            expose these attributes, the only safe strategy is to assume
    * that the key must be unique among registered memory regsions.
    * @param flags Flags e.g., FI_REMOTE_READ|FI_REMOTE_WRITE. Flag definitions
-   * are in <rdma/fabric.h>
+   * are in <rdma/fabric.h>. Access flags (FI_SEND, FI_RECV, FI_READ,
+   * FI_WRITE, FI_REMOTE_READ, FI_REMOTE_WRITE), if any are given, limit the
+   * access granted; with none, all of them are granted.
    *
    * @return Memory region handle
    *
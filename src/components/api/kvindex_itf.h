@@ -110,6 +110,63 @@ class IKVIndex : public Component::IBase {
                         offset_t&          out_matched_position,
                         std::string&       out_matched_key,
                         unsigned           max_comparisons = 0) = 0;
+
+  /**
+   * Ordered iteration over a key range
+   *
+   * @param start_key First key (inclusive); empty for start of index
+   * @param end_key End key (exclusive); empty for end of index
+   * @param callback Called for each key in order; return false to stop
+   *
+   * @return S_OK or E_NOT_IMPL
+   */
+  virtual status_t scan(const std::string&                            start_key,
+                        const std::string&                            end_key,
+                        std::function<bool(const std::string& key)> callback)
+  {
+    return E_NOT_IMPL;
+  }
+
+  /**
+   * Replace the index contents with a set of keys, e.g. when rebuilding
+   * the index for an existing pool.  Faster than repeated insert.
+   *
+   * @param keys Keys in any order; duplicates are ignored.  Contents are
+   * consumed.
+   *
+   * @return S_OK or E_NOT_IMPL
+   */
+  virtual status_t bulk_load(std::vector<std::string>&& keys)
+  {
+    return E_NOT_IMPL;
+  }
+
+  /**
+   * Whether a persistent index was opened from a file which was closed
+   * cleanly, i.e. it holds every insert and erase made while it was last
+   * open.  It may still lack keys changed while it was closed.
+   *
+   * @return True if reopened after a clean close
+   */
+  virtual bool reopened_clean() const { return false; }
+
+  /**
+   * Record a generation number with a persistent index, durably, e.g. to
+   * match it with the pool it indexes at the next open.
+   *
+   * @param generation Non-zero generation number
+   *
+   * @return S_OK or E_NOT_IMPL
+   */
+  virtual status_t set_generation(uint64_t generation) { return E_NOT_IMPL; }
+
+  /**
+   * Generation number recorded by set_generation before the index was
+   * last closed
+   *
+   * @return Generation number, or 0 if none
+   */
+  virtual uint64_t generation() const { return 0; }
 };
 
 class IKVIndex_factory : public Component::IBase {
@@ -31,6 +31,15 @@ namespace Component
 {
 /**
  * mcas client interface (this will include both KV and AS capabilities)
+ *
+ * Ordering: the server processes the requests of one client instance (one
+ * connection) in the order they were issued, whether synchronous or
+ * asynchronous, and IO responses return in that order.  A synchronous call
+ * may be made while asynchronous requests are outstanding; it runs after
+ * them, and their completions are collected by a later
+ * check_async_completion or poll_completions.  There is no ordering between
+ * separate client instances.  A get served from a lease (see configure_pool)
+ * is a one-sided read and is not ordered with respect to requests.
  */
 class IMCAS : public Component::IBase {
  public:
@@ -62,6 +71,34 @@ class IMCAS : public Component::IBase {
     FLAGS_MAX_VALUE   = IKVStore::FLAGS_MAX_VALUE,
   };
 
+  /* operation classes for per-shard latency statistics */
+  enum {
+    STATS_OP_PUT   = 0,
+    STATS_OP_GET   = 1,
+    STATS_OP_ERASE = 2,
+    STATS_OP_BATCH = 3,
+    STATS_OP_ADO   = 4,
+    STATS_OP_OTHER = 5,
+    STATS_OP_COUNT = 6,
+  };
+
+  /* latency components for per-shard latency statistics */
+  enum {
+    STATS_LATENCY_QUEUE   = 0, /*< receive completion to start of processing */
+    STATS_LATENCY_SERVICE = 1, /*< start of processing to response posted */
+    STATS_LATENCY_STORE   = 2, /*< time in the key-value store */
+    STATS_LATENCY_ADO     = 3, /*< ADO work request round trip */
+    STATS_LATENCY_COUNT   = 4,
+  };
+
+  struct Latency_summary {
+    uint64_t count;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+  } __attribute__((packed));
+
   /* per-shard statistics */
   struct alignas(8) Shard_stats {
     uint64_t op_request_count;
@@ -72,13 +109,20 @@ class IMCAS : public Component::IBase {
     uint64_t op_ado_count;
     uint64_t op_erase_count;
     uint64_t op_failed_request_count;
+    uint64_t op_batch_count;
+    uint64_t busy_cycles; /*< shard loop cycles spent doing work */
+    uint64_t idle_cycles; /*< shard loop cycles spent polling or blocked */
     uint64_t last_op_count_snapshot;
     uint16_t client_count;
+    Latency_summary latency[STATS_OP_COUNT][STATS_LATENCY_COUNT];
 
    public:
     Shard_stats()
         : op_request_count(0), op_put_count(0), op_get_count(0), op_put_direct_count(0), op_get_twostage_count(0),
-          op_ado_count(0), op_erase_count(0), op_failed_request_count(0), last_op_count_snapshot(0), client_count(0)
+          op_ado_count(0), op_erase_count(0), op_failed_request_count(0), op_batch_count(0), busy_cycles(0), idle_cycles(0),
+          last_op_count_snapshot(0),
+          client_count(0),
+          latency()
     {
     }
   } __attribute__((packed));
@@ -159,8 +203,25 @@ class IMCAS : public Component::IBase {
   /**
    * Configure a pool
    *
-   * @param setting Configuration request (e.g., AddIndex::VolatileTree)
-
+   * @param setting Configuration request (e.g., AddIndex::VolatileTree).
+   * VolatileTree (alias BTree) selects the B+-tree index; RBTree the
+   * older red-black tree.  PersistentTree keeps the index in a per-pool
+   * file under the shard's index_dir, so adding it again after the pool
+   * is reopened (or the server restarts) needs no rebuild, provided the
+   * pool was closed cleanly with the index and no key has changed since
+   * the pool was reopened; otherwise the index is rebuilt.  An index is
+   * released when the pool is closed.  RemoveIndex:: drops the pool's
+   * index (and its file).  Lease::on lets clients read values of the
+   * pool with one-sided RDMA reads; the pool stays writable.  The server
+   * moves a version word on before each put, erase or ADO invocation
+   * changes a value, and a read is used only if that word is unchanged
+   * since the lease and the bytes read match the lease's checksum.
+   * Limits: keys share version words, so a write may send another key's
+   * reader back to a two-sided get; a write by an ADO to a value other
+   * than the one it was invoked on or has locked is caught only by the
+   * checksum; a read validated a moment before a write returns the value
+   * before it.  A lease lasts at most one second, or less
+   * (MCAS_LEASE_MSEC); Lease::off stops new leases.
    *
    * @return S_OK on success
    */
@@ -169,7 +230,9 @@ class IMCAS : public Component::IBase {
   /**
    * Write or overwrite an object value. If there already exists a
    * object with matching key, then it should be replaced
-   * (i.e. reallocated) or overwritten.
+   * (i.e. reallocated) or overwritten.  Values too large for one
+   * message are streamed in segments, so they need not be registered
+   * (compare put_direct).
    *
    * @param pool Pool handle
    * @param key Object key
@@ -290,6 +353,68 @@ class IMCAS : public Component::IBase {
                               size_t&                      out_value_len,
                               const IMCAS::memory_handle_t handle = IMCAS::MEMORY_HANDLE_NONE) = 0;
 
+  /**
+   * Read part of an object value into client memory, which need not be
+   * registered.  Large ranges are fetched as a pipeline of segments.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param offset Offset within the value
+   * @param out_value Client provided buffer
+   * @param inout_len [in] bytes wanted [out] bytes read; fewer than wanted
+   * if the value ends within the range
+   *
+   * @return S_OK, E_INVAL if offset is beyond the end of the value, E_BUSY
+   * if the async window is full, or other error code
+   */
+  virtual status_t get_range(const IMCAS::pool_t pool,
+                             const std::string&  key,
+                             size_t              offset,
+                             void*               out_value,
+                             size_t&             inout_len) = 0;
+
+  /**
+   * Asynchronous get operation.  The value must fit in a single IO
+   * buffer; larger values are rejected with E_TOO_LARGE on completion.
+   * Several asynchronous operations may be in flight on one connection
+   * (see MCAS_ASYNC_WINDOW).  Use check_async_completion to check for
+   * completion; out_value and out_value_len are set when it returns S_OK
+   * and must remain valid until then.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param out_value [out] Value data (release with free_memory() API)
+   * @param out_value_len [out] Size of value in bytes
+   * @param out_handle Async work handle
+   *
+   * @return S_OK, E_BUSY if the request window is full, or other error code
+   */
+  virtual status_t async_get(const IMCAS::pool_t pool,
+                             const std::string&  key,
+                             void*&              out_value,
+                             size_t&             out_value_len,
+                             async_handle_t&     out_handle) = 0;
+
+  /**
+   * Asynchronous get into client-provided memory.  Constraints are as
+   * for async_get.
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param out_value Client provided buffer for value
+   * @param out_value_len [in] size of value memory in bytes [out] size of value
+   * @param handle Memory registration handle
+   * @param out_handle Async work handle
+   *
+   * @return S_OK, E_BUSY if the request window is full, or other error code
+   */
+  virtual status_t async_get_direct(const IMCAS::pool_t          pool,
+                                    const std::string&           key,
+                                    void*                        out_value,
+                                    size_t&                      out_value_len,
+                                    const IMCAS::memory_handle_t handle,
+                                    async_handle_t&              out_handle) = 0;
+
   /**
    * Check for completion from asynchronous invocation
    *
@@ -299,6 +424,101 @@ class IMCAS : public Component::IBase {
    */
   virtual status_t check_async_completion(async_handle_t& handle) = 0;
 
+  /**
+   * Retire every finished asynchronous operation, up to max, with a
+   * single completion queue poll.  Each returned handle is released as
+   * if by check_async_completion and must not be checked again; handles
+   * are only meaningful for matching against those returned at
+   * submission.
+   *
+   * @param out_handles [out] Handles of completed operations
+   * @param out_status [out] Status of each completed operation
+   * @param max Capacity of out_handles and out_status
+   *
+   * @return Number of completed operations returned
+   */
+  virtual size_t poll_completions(async_handle_t out_handles[], status_t out_status[], size_t max) = 0;
+
+  /**
+   * Write or overwrite a batch of objects in a single round trip. The
+   * batch may be split across several messages if it does not fit in
+   * one IO buffer.
+   *
+   * @param pool Pool handle
+   * @param keys Object keys
+   * @param values Value data (one per key)
+   * @param out_status Per-key status (S_OK or error code)
+   * @param flags Additional flags (applied to every key)
+   *
+   * @return S_OK if all requests were serviced (see out_status), or error code
+   */
+  virtual status_t put_batch(const IMCAS::pool_t             pool,
+                             const std::vector<std::string>& keys,
+                             const std::vector<std::string>& values,
+                             std::vector<status_t>&          out_status,
+                             const unsigned int              flags = IMCAS::FLAGS_NONE) = 0;
+
+  /**
+   * Read a batch of object values in a single round trip. Values that
+   * are too large to fit in an IO buffer return E_INSUFFICIENT_SPACE and
+   * should be read with get or get_direct.
+   *
+   * @param pool Pool handle
+   * @param keys Object keys
+   * @param out_values Value data (one per key)
+   * @param out_status Per-key status (S_OK or error code)
+   *
+   * @return S_OK if all requests were serviced (see out_status), or error code
+   */
+  virtual status_t get_batch(const IMCAS::pool_t             pool,
+                             const std::vector<std::string>& keys,
+                             std::vector<std::string>&       out_values,
+                             std::vector<status_t>&          out_status) = 0;
+
+  /**
+   * Erase a batch of objects in a single round trip
+   *
+   * @param pool Pool handle
+   * @param keys Object keys
+   * @param out_status Per-key status (S_OK or error code)
+   *
+   * @return S_OK if all requests were serviced (see out_status), or error code
+   */
+  virtual status_t erase_batch(const IMCAS::pool_t             pool,
+                               const std::vector<std::string>& keys,
+                               std::vector<status_t>&          out_status) = 0;
+
+  /**
+   * Ordered range scan over the pool's index (see configure_pool
+   * "AddIndex::VolatileTree").  Results are streamed back in pages,
+   * each filling one IO buffer, so large ranges take few round trips.
+   * Every key in the range is returned; a key whose value cannot be read
+   * is returned with an empty value and a status other than S_OK.
+   *
+   * @param pool Pool handle
+   * @param start_key First key (inclusive); empty to start at the beginning
+   * @param end_key End key (exclusive); empty to scan to the end
+   * @param limit Maximum number of keys to return; 0 for no limit
+   * @param with_values If true, values are returned in out_values
+   * @param out_keys [out] Keys in index order
+   * @param out_values [out] Values matching out_keys (with_values only)
+   * @param out_status [out] Status of each value (with_values only): S_OK,
+   * E_LOCKED if a writer held the value, or E_KEY_NOT_FOUND if the key was
+   * erased during the scan
+   *
+   * @return S_OK if the range was scanned to its end, S_MORE if limit cut
+   * it short (resume from out_keys.back(), which is returned again),
+   * E_INVAL if the pool has no index, or other error code
+   */
+  virtual status_t scan(const IMCAS::pool_t       pool,
+                        const std::string&        start_key,
+                        const std::string&        end_key,
+                        const size_t              limit,
+                        const bool                with_values,
+                        std::vector<std::string>& out_keys,
+                        std::vector<std::string>& out_values,
+                        std::vector<status_t>&    out_status) = 0;
+
   /**
    * Perform key search based on regex or prefix
    *
@@ -505,6 +725,34 @@ class IMCAS : public Component::IBase {
                           out_response);
   }
 
+  /**
+   * Invoke the ADO on a batch of keys in a single round trip.  Each key
+   * is a separate invocation with its own request; invocations on the
+   * same key run in batch order.  The batch may be split across several
+   * messages if it does not fit in one IO buffer.  A key whose responses
+   * do not fit in the reply gets E_INSUFFICIENT_SPACE (the invocation
+   * itself has run).
+   *
+   * @param pool Pool handle
+   * @param keys Keys
+   * @param requests Request data (one per key)
+   * @param flags Flags for invocation (ADO_FLAG_ASYNC, ADO_FLAG_DETACHED
+   * and ADO_FLAG_CREATE_ONLY are not supported)
+   * @param out_status Per-key invocation status
+   * @param out_responses Per-key responses from invocation
+   * @param value_size Optional parameter to define value size to create for
+   * on-demand
+   *
+   * @return S_OK if all requests were serviced (see out_status), or error code
+   */
+  virtual status_t invoke_ado_batch(const IMCAS::pool_t                     pool,
+                                    const std::vector<std::string>&         keys,
+                                    const std::vector<std::string>&         requests,
+                                    const ado_flags_t                       flags,
+                                    std::vector<status_t>&                  out_status,
+                                    std::vector<std::vector<ADO_response>>& out_responses,
+                                    const size_t                            value_size = 0) = 0;
+
   /**
    * Debug routine
    *
@@ -19,6 +19,7 @@
 #include <common/utils.h>
 
 #include "mcas_client_config.h"
+#include "protocol.h"
 
 namespace mcas
 {
@@ -115,6 +116,11 @@ class Fabric_transport {
 
   inline void *get_memory_descriptor(memory_region_t region) { return _transport->get_memory_descriptor(region); }
 
+  inline uint64_t get_memory_remote_key(memory_region_t region) const
+  {
+    return _transport->get_memory_remote_key(region);
+  }
+
   inline void deregister_memory(memory_region_t region) { _transport->deregister_memory(region); }
 
   inline void post_send(const ::iovec *first, const ::iovec *last, void **descriptors, void *context)
@@ -127,8 +133,49 @@ class Fabric_transport {
     _transport->post_recv(first, last, descriptors, context);
   }
 
+  inline void post_read(const ::iovec *first,
+                        const ::iovec *last,
+                        void **        descriptors,
+                        uint64_t       remote_addr,
+                        uint64_t       key,
+                        void *         context)
+  {
+    _transport->post_read(first, last, descriptors, remote_addr, key, context);
+  }
+
   inline size_t max_message_size() const { return _transport->max_message_size(); }
 
+  /**
+   * Set the largest message which the server receives directly; longer
+   * messages are sent as a Message_indirect
+   *
+   * @param len Message length (0 = no limit)
+   */
+  inline void set_indirect_len(size_t len) { _indirect_len = len; }
+
+  inline bool is_indirect(size_t msg_len) const { return _indirect_len != 0 && _indirect_len < msg_len; }
+
+  /**
+   * Build a Message_indirect for a message held in one or two buffers. The
+   * server reads the buffers until it responds to the message.
+   *
+   * @param iob First IO buffer
+   * @param iob_extra Second IO buffer
+   *
+   * @return Buffer holding the Message_indirect (caller frees)
+   */
+  buffer_t *allocate_indirect(buffer_t *iob, buffer_t *iob_extra = nullptr)
+  {
+    const auto msg = static_cast<const Protocol::Message *>(iob->base());
+    auto       iobi = _bm.allocate();
+    auto       indirect = new (iobi->base()) Protocol::Message_indirect(msg->auth_id);
+
+    indirect->add_segment(iob->base(), get_memory_remote_key(iob->region), iob->length());
+    if (iob_extra) indirect->add_segment(iob_extra->base(), get_memory_remote_key(iob_extra->region), iob_extra->length());
+    iobi->set_length(indirect->msg_len);
+    return iobi;
+  }
+
   /**
    * Post send (one or two buffers) and wait for completion.
    *
@@ -137,6 +184,11 @@ class Fabric_transport {
    */
   void sync_send(buffer_t *iob, buffer_t *iob_extra = nullptr)
   {
+    if (is_indirect(iob->length() + (iob_extra ? iob_extra->length() : 0))) {
+      sync_send_indirect(iob, iob_extra);
+      return;
+    }
+
     if (iob_extra) {
       iovec v[2]   = {*iob->iov, *iob_extra->iov};
       void *desc[] = {iob->desc, iob_extra->desc};
@@ -164,9 +216,29 @@ class Fabric_transport {
     }
     else {
       /* too big for inject, do plain send */
-      post_send(iob->iov, iob->iov + 1, &iob->desc, iob);
-      wait_for_completion(iob);
+      sync_send(iob);
+    }
+  }
+
+  /**
+   * Send a message too large for the server's receive buffers. The buffers
+   * must stay unchanged until the message's response arrives.
+   *
+   * @param iob First IO buffer
+   * @param iob_extra Second IO buffer
+   */
+  void sync_send_indirect(buffer_t *iob, buffer_t *iob_extra = nullptr)
+  {
+    const auto iobi = allocate_indirect(iob, iob_extra);
+    try {
+      post_send(iobi->iov, iobi->iov + 1, &iobi->desc, iobi);
+      wait_for_completion(iobi);
+    }
+    catch (...) {
+      free_buffer(iobi);
+      throw;
     }
+    free_buffer(iobi);
   }
 
   /**
@@ -240,6 +312,7 @@ class Fabric_transport {
  protected:
   Transport *               _transport;
   size_t                    _max_inject_size;
+  size_t                    _indirect_len = 0; /*< longer messages are sent as Message_indirect (0 = never) */
   Buffer_manager<Transport> _bm; /*< IO buffer manager */
 };                               // namespace Client
 
@@ -14,10 +14,12 @@
 #include "connection.h"
 
 #include <city.h>
+#include <common/chksum.h>
 #include <common/cycles.h>
 #include <common/utils.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <memory>
 
 #include "protocol.h"
@@ -44,25 +46,57 @@ namespace mcas
 {
 namespace Client
 {
+/* asynchronous request, drawn from the connection's pool; iobs is
+   released when the send completes and iobr is attached when the
+   response carrying request_id arrives */
 struct buffer_pair_t {
-  buffer_pair_t(Client::Fabric_transport::buffer_t *_iobs, Client::Fabric_transport::buffer_t *_iobr)
-      : iobs(_iobs), iobr(_iobr)
+  buffer_pair_t()
+      : iobs(nullptr), iobr(nullptr), iobm(nullptr), request_id(0), out_value(nullptr), out_direct(nullptr),
+        out_value_len(nullptr), in_use(false)
   {
   }
+  buffer_pair_t(const buffer_pair_t &) = delete;
+  buffer_pair_t &operator=(const buffer_pair_t &) = delete;
+
+  bool complete() const { return iobs == nullptr && iobr != nullptr; }
+
   Client::Fabric_transport::buffer_t *iobs;
   Client::Fabric_transport::buffer_t *iobr;
+  Client::Fabric_transport::buffer_t *iobm; /*< message sent indirectly; the server reads it until it responds */
+  uint64_t                            request_id;
+  void **                             out_value;     /*< async_get result (allocated) */
+  void *                              out_direct;    /*< async_get_direct result (client memory) */
+  size_t *                            out_value_len; /*< non-null for OP_GET */
+  bool                                in_use;
 };
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++" // missing initializers
 Connection_handler::Connection_handler(Connection_base::Transport *connection)
   : Connection_base(connection),
-  _max_inject_size(connection->max_inject_size())
+  _max_inject_size(connection->max_inject_size()),
+  _async_ops(new buffer_pair_t[MAX_ASYNC_WINDOW])
 {
+  for (unsigned i = 0; i < MAX_ASYNC_WINDOW; i++) _async_free.push_back(&_async_ops[i]);
+
   char *env = getenv("SHORT_CIRCUIT_BACKEND");
   if (env && env[0] == '1') {
     _options.short_circuit_backend = true;
   }
+
+  env = getenv("MCAS_SEGMENT_ORDER");
+  if (env && std::string(env) == "reverse") {
+    _options.segments_out_of_order = true;
+  }
+
+  env = getenv("MCAS_ASYNC_WINDOW");
+  if (env) {
+    set_async_window(static_cast<unsigned>(std::strtoul(env, nullptr, 10)));
+  }
+
+  env                   = getenv("MCAS_LEASE_MSEC");
+  const auto lease_msec = env ? std::strtoul(env, nullptr, 10) : DEFAULT_LEASE_MSEC;
+  _lease_cycles         = static_cast<cpu_time_t>(cycles_per_second * double(lease_msec) / 1000.0);
 }
 #pragma GCC diagnostic pop
 
@@ -190,6 +224,7 @@ Connection_handler::pool_t Connection_handler::create_pool(const std::string  na
 status_t Connection_handler::close_pool(const pool_t pool)
 {
   API_LOCK();
+  drop_leases(pool);
   /* send pool request message */
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -249,6 +284,7 @@ status_t Connection_handler::delete_pool(const IMCAS::pool_t pool)
   if (!pool) return E_INVAL;
 
   API_LOCK();
+  drop_leases(pool);
 
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -302,6 +338,13 @@ status_t Connection_handler::configure_pool(const IMCAS::pool_t pool, const std:
     PLOG("got response from CONFIGURE operation: status=%d request_id=%lu", response_msg->get_status(),
          response_msg->request_id);
 
+  if (response_msg->get_status() == S_OK) {
+    if (json == "Lease::on")
+      _lease_pools.insert(pool);
+    else if (json == "Lease::off")
+      drop_leases(pool);
+  }
+
   return response_msg->get_status();
 }
 
@@ -331,11 +374,11 @@ status_t Connection_handler::put(const pool_t       pool,
   if (option_DEBUG)
     PINF("put: %.*s (key_len=%lu) (value_len=%lu)", int(key_len), static_cast<const char *>(key), key_len, value_len);
 
-  /* check key length */
-  if ((key_len + value_len + sizeof(mcas::Protocol::Message_IO_request)) > Buffer_manager<IFabric_client>::BUFFER_LEN) {
-    PWRN("mcas_client::put value length (%lu) too long. Use put_direct.", value_len);
-    return IKVStore::E_TOO_LARGE;
-  }
+  drop_lease(pool, std::string(static_cast<const char *>(key), key_len));
+
+  /* values too large for one message are streamed in segments */
+  if ((key_len + value_len + sizeof(mcas::Protocol::Message_IO_request)) > Buffer_manager<IFabric_client>::BUFFER_LEN)
+    return put_segmented(pool, key, key_len, value, value_len, flags);
 
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -371,6 +414,66 @@ status_t Connection_handler::put(const pool_t       pool,
   return status;
 }
 
+status_t Connection_handler::put_segmented(const pool_t       pool,
+                                           const void *       key,
+                                           const size_t       key_len,
+                                           const void *       value,
+                                           const size_t       value_len,
+                                           const unsigned int flags)
+{
+  /* each segment shares its buffer with the header, key and segment trailer */
+  const size_t overhead = sizeof(mcas::Protocol::Message_IO_request) + key_len + 1 + 2 * sizeof(uint64_t);
+  if (overhead >= Buffer_manager<IFabric_client>::BUFFER_LEN) return IKVStore::E_TOO_LARGE;
+  const size_t segment_len = Buffer_manager<IFabric_client>::BUFFER_LEN - overhead;
+
+  std::vector<size_t> offsets;
+  for (size_t offset = 0; offset < value_len; offset += segment_len) offsets.push_back(offset);
+  if (_options.segments_out_of_order) {
+    /* exercise the server's reassembly: last segment first, and one sent twice */
+    std::reverse(offsets.begin(), offsets.end());
+    if (offsets.size() > 2) offsets.insert(offsets.begin() + 1, offsets[1]);
+  }
+
+  std::deque<buffer_pair_t *> inflight;
+  status_t                    status = S_OK;
+  size_t                      next   = 0;
+
+  try {
+    while (next < offsets.size() || !inflight.empty()) {
+      if (status == S_OK && next < offsets.size() && _async_count < _async_window) {
+        const auto offset = offsets[next];
+        const auto len    = std::min(segment_len, value_len - offset);
+        buffer_t * iobs = allocate();
+        const auto msg  = new (iobs->base()) mcas::Protocol::Message_IO_request(
+            iobs->length(), auth_id(), ++_request_id, pool, mcas::Protocol::OP_PUT_SEGMENT, key, key_len,
+            static_cast<const char *>(value) + offset, len, flags);
+        msg->set_segment(iobs->length(), offset, value_len);
+        iobs->set_length(msg->msg_len);
+
+        auto op = acquire_async_op(iobs, msg->request_id);
+        post_async_request(op);
+        inflight.push_back(op);
+        next++;
+      }
+      else if (inflight.empty()) {
+        /* window full of the caller's own requests, or failed */
+        return status == S_OK ? E_BUSY : status;
+      }
+      else {
+        const auto s = wait_async_op(inflight.front());
+        inflight.pop_front();
+        if (status == S_OK) status = s;
+        if (status != S_OK) next = offsets.size(); /* issue no more */
+      }
+    }
+  }
+  catch (...) {
+    return E_FAIL;
+  }
+
+  return status;
+}
+
 status_t Connection_handler::two_stage_put_direct(const pool_t                 pool,
                                                   const void *                 key,
                                                   const size_t                 key_len,
@@ -431,7 +534,9 @@ status_t Connection_handler::two_stage_put_direct(const pool_t                 p
          static_cast<const void *>(value_buffer->region), value_buffer->desc);
 
 
-  sync_send(value_buffer);  /* caller owns buffer */
+  /* the value lands in the posted value buffer, not a message receive */
+  post_send(value_buffer->iov, value_buffer->iov + 1, &value_buffer->desc, value_buffer); /* caller owns buffer */
+  wait_for_completion(value_buffer);
 
   if (option_DEBUG) {
     PINF("two_stage_put_direct: complete");
@@ -461,6 +566,8 @@ status_t Connection_handler::put_direct(const pool_t                 pool,
     return E_INVAL;
   }
 
+  drop_lease(pool, key);
+
   buffer_t *value_buffer = reinterpret_cast<buffer_t *>(handle);
   value_buffer->set_length(value_len);
 
@@ -544,8 +651,11 @@ status_t Connection_handler::async_put(const IMCAS::pool_t    pool,
     return IKVStore::E_TOO_LARGE;
   }
 
+  if (_async_count >= _async_window) return E_BUSY;
+
+  drop_lease(pool, std::string(static_cast<const char *>(key), key_len));
+
   buffer_t *iobs = allocate();
-  buffer_t *iobr = allocate();
 
   try {
     const auto msg =
@@ -555,11 +665,9 @@ status_t Connection_handler::async_put(const IMCAS::pool_t    pool,
 
     iobs->set_length(msg->msg_len);
 
-    /* post both send and receive */
-    post_recv(&*iobr);
-    post_send(iobs->iov, iobs->iov + 1, &iobs->desc, iobs);
-
-    out_handle = reinterpret_cast<IMCAS::async_handle_t>(new buffer_pair_t(iobs, iobr));
+    auto op = acquire_async_op(iobs, msg->request_id);
+    post_async_request(op);
+    out_handle = reinterpret_cast<IMCAS::async_handle_t>(op);
 
     return S_OK;
   }
@@ -572,38 +680,377 @@ status_t Connection_handler::async_put(const IMCAS::pool_t    pool,
 
 status_t Connection_handler::check_async_completion(IMCAS::async_handle_t &handle)
 {
-  auto bptrs = reinterpret_cast<buffer_pair_t *>(handle);
-  assert(bptrs->iobs || bptrs->iobr);
+  API_LOCK();
+
+  auto op = reinterpret_cast<buffer_pair_t *>(handle);
+  assert(op && op->in_use);
+
+  if (!op->complete()) {
+    progress_async();
+    if (!op->complete()) return E_BUSY;
+  }
+
+  _async_done.erase(std::find(_async_done.begin(), _async_done.end(), op));
+  return retire_async_op(op);
+}
+
+status_t Connection_handler::wait_async_op(buffer_pair_t *op)
+{
+  while (!op->complete()) progress_async();
+
+  _async_done.erase(std::find(_async_done.begin(), _async_done.end(), op));
+  return retire_async_op(op);
+}
+
+size_t Connection_handler::poll_completions(IMCAS::async_handle_t *out_handles, status_t *out_status, size_t max)
+{
+  API_LOCK();
+
+  progress_async();
+
+  size_t count = 0;
+  while (count < max && !_async_done.empty()) {
+    auto op = _async_done.front();
+    _async_done.pop_front();
+    out_handles[count] = reinterpret_cast<IMCAS::async_handle_t>(op);
+    out_status[count]  = retire_async_op(op);
+    count++;
+  }
+  return count;
+}
+
+buffer_pair_t *Connection_handler::acquire_async_op(buffer_t *iobs, uint64_t request_id)
+{
+  assert(!_async_free.empty());
+  auto op = _async_free.back();
+  _async_free.pop_back();
+
+  op->iobs          = iobs;
+  op->iobr          = nullptr;
+  op->iobm          = nullptr;
+  op->request_id    = request_id;
+  op->out_value     = nullptr;
+  op->out_direct    = nullptr;
+  op->out_value_len = nullptr;
+  op->in_use        = true;
+  _async_count++;
+  return op;
+}
+
+status_t Connection_handler::retire_async_op(buffer_pair_t *op)
+{
+  const auto response_msg = response_ptr<const mcas::Protocol::Message_IO_response>(op->iobr->base());
 
-  if (bptrs->iobs) {
-    if (test_completion(bptrs->iobs) == false)
-      return E_BUSY;
+  if (option_DEBUG)
+    PLOG("got response from ASYNC operation: status=%d request_id=%lu", response_msg->get_status(),
+         response_msg->request_id);
+
+  status_t status = response_msg->get_status();
+
+  if (status == S_OK && op->out_value_len) {
+    const auto data_len = response_msg->data_length();
+    if (response_msg->is_set_written_bit()) {
+      /* value already written into op->out_direct by the server */
+    }
+    else if (op->out_direct) {
+      memcpy(op->out_direct, response_msg->data, data_len);
+    }
     else {
-      free_buffer(bptrs->iobs);
-      bptrs->iobs = nullptr;
+      auto value = ::malloc(data_len + 1);
+      memcpy(value, response_msg->data, data_len);
+      static_cast<char *>(value)[data_len] = '\0';
+      *op->out_value                        = value;
     }
+    *op->out_value_len = data_len;
   }
 
-  if (bptrs->iobr) {
-    if (test_completion(bptrs->iobr) == false)
-      return E_BUSY;
-    else {
-      assert(bptrs->iobs == nullptr);
+  free_buffer(op->iobr);
+  op->iobr = nullptr;
+  if (op->iobm) {
+    free_buffer(op->iobm);
+    op->iobm = nullptr;
+  }
+  op->in_use = false;
+  _async_free.push_back(op);
+  _async_count--;
+  return status;
+}
 
-      const auto response_msg = response_ptr<const mcas::Protocol::Message_IO_response>(bptrs->iobr->base());
+bool Connection_handler::read_leased(const pool_t       pool,
+                                     const std::string &key,
+                                     void *             target,
+                                     size_t             target_len,
+                                     memory_region_t    region,
+                                     size_t &           out_value_len)
+{
+  auto l = _leases.find(std::make_pair(pool, key));
+  if (l == _leases.end() || l->second.expiry < rdtsc()) {
+    const auto rc = acquire_lease(pool, key);
+    if (rc == E_NOT_SUPPORTED) _lease_pools.erase(pool); /* stop asking */
+    if (rc != S_OK) return false;
+    l = _leases.find(std::make_pair(pool, key));
+    assert(l != _leases.end());
+  }
 
-      if (option_DEBUG)
-        PLOG("got response from ASYNC PUT/ERASE operation: status=%d request_id=%lu", response_msg->get_status(),
-             response_msg->request_id);
+  const auto &lease = l->second;
+  if (lease.len > target_len) return false;
+
+  /* the value, then its version word: the server moves the word on before
+     it changes the value, so the value read is the one leased if the word
+     read after it is still the one leased */
+  const auto iobv = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  uint64_t   version;
+  iovec      v{target, lease.len};
+  iovec      w{iobv->base(), sizeof version};
+  void *     desc  = get_memory_descriptor(region);
+  void *     descv = get_memory_descriptor(iobv->region);
+  try {
+    post_read(&v, &v + 1, &desc, lease.addr, lease.key, &v);
+    wait_for_completion(&v);
+    post_read(&w, &w + 1, &descv, lease.version_addr, lease.version_key, &w);
+    wait_for_completion(&w);
+  }
+  catch (...) {
+    _leases.erase(l);
+    return false;
+  }
+  memcpy(&version, iobv->base(), sizeof version);
 
-      status_t status = response_msg->get_status();
-      free_buffer(bptrs->iobr);
-      delete bptrs;
-      return status;
+  /* the value has moved, changed, or was read mid-update */
+  if (version != lease.version || Common::chksum32(target, lease.len) != lease.chksum) {
+    if (option_DEBUG) PLOG("lease on (%s) failed validation", key.c_str());
+    _leases.erase(l);
+    return false;
+  }
+
+  out_value_len = lease.len;
+  return true;
+}
+
+status_t Connection_handler::acquire_lease(const pool_t pool, const std::string &key)
+{
+  const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+  const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+
+  try {
+    const auto msg = new (iobs->base()) mcas::Protocol::Message_IO_request(
+        iobs->length(), auth_id(), ++_request_id, pool, mcas::Protocol::OP_GET, key.c_str(), key.length(), 0);
+    msg->resvd = Protocol::MSG_RESVD_LEASE;
+    iobs->set_length(msg->msg_len);
+
+    post_recv(&*iobr);
+    sync_inject_send(&*iobs);
+    wait_for_completion(&*iobr);
+  }
+  catch (...) {
+    return E_FAIL;
+  }
+
+  const auto response_msg = response_ptr<const mcas::Protocol::Message_IO_response>(iobr->base());
+  const auto status       = response_msg->get_status();
+  if (status != S_OK) return status;
+
+  mcas::Protocol::Value_lease lease;
+  assert(response_msg->data_length() == sizeof lease);
+  memcpy(&lease, response_msg->data, sizeof lease);
+
+  if (_leases.size() >= MAX_LEASES) _leases.erase(_leases.begin());
+
+  /* leases expire, so that a pool which stops granting them (Lease::off)
+     is soon read only by messages */
+  const auto cycles =
+      std::min(_lease_cycles, static_cast<cpu_time_t>(cycles_per_second * double(lease.msec) / 1000.0));
+  _leases[std::make_pair(pool, key)] = lease_t{lease.addr,    lease.key, lease.len,    lease.version_addr,
+                                               lease.version_key, lease.version, lease.chksum, rdtsc() + cycles};
+  return S_OK;
+}
+
+void Connection_handler::drop_leases(const pool_t pool)
+{
+  _lease_pools.erase(pool);
+  auto it = _leases.lower_bound(std::make_pair(pool, std::string()));
+  while (it != _leases.end() && it->first.first == pool) it = _leases.erase(it);
+}
+
+void Connection_handler::offer_landing(mcas::Protocol::Message_IO_request *msg,
+                                       buffer_t *                          iobs,
+                                       buffer_t *                          value_iob,
+                                       const void *                        value,
+                                       size_t                              value_len)
+{
+  const auto base = static_cast<const char *>(value_iob->base());
+  const auto p    = static_cast<const char *>(value);
+  if (p < base || base + value_iob->original_length < p + value_len) return;
+
+  msg->set_landing(iobs->length(), value, get_memory_remote_key(value_iob->region));
+}
+
+void Connection_handler::post_async_request(buffer_pair_t *op)
+{
+  buffer_t *iobr = allocate();
+
+  /* a message too large for the server's receives goes as a
+     Message_indirect, which completes as the send */
+  if (is_indirect(op->iobs->length())) {
+    op->iobm = op->iobs;
+    op->iobs = allocate_indirect(op->iobm);
+  }
+
+  /* post both send and receive; a response may complete any of the
+     posted receives.  The send is posted with the op as its context */
+  post_recv(iobr);
+  post_send(op->iobs->iov, op->iobs->iov + 1, &op->iobs->desc, op);
+
+  _async_posted.push_back(iobr);
+}
+
+void Connection_handler::progress_async()
+{
+  /* a single poll services every completed async send and receive;
+     completions for synchronous calls are deferred back to them */
+  _transport->poll_completions_tentative(async_completion_callback, this);
+}
+
+Component::IFabric_op_completer::cb_acceptance Connection_handler::async_completion_callback(void *        context,
+                                                                                             status_t      st,
+                                                                                             std::uint64_t completion_flags,
+                                                                                             std::size_t,  // len
+                                                                                             void *,       // error_data
+                                                                                             void *param)
+{
+  if (UNLIKELY(st != S_OK))
+    throw Program_exception("poll_completions failed unexpectedly (st=%d) (cf=%lx)", st, completion_flags);
+
+  return static_cast<Connection_handler *>(param)->async_completion(context)
+             ? Component::IFabric_op_completer::cb_acceptance::ACCEPT
+             : Component::IFabric_op_completer::cb_acceptance::DEFER;
+}
+
+bool Connection_handler::async_completion(void *context)
+{
+  /* send completion; the context is a pool entry */
+  const auto ctx  = reinterpret_cast<uintptr_t>(context);
+  const auto pool = reinterpret_cast<uintptr_t>(&_async_ops[0]);
+  if (ctx >= pool && ctx < pool + sizeof(buffer_pair_t) * MAX_ASYNC_WINDOW) {
+    auto op = static_cast<buffer_pair_t *>(context);
+    free_buffer(op->iobs);
+    op->iobs = nullptr;
+    if (op->complete()) _async_done.push_back(op);
+    return true;
+  }
+
+  /* receives complete in posting order; anything else belongs to a
+     synchronous call */
+  if (_async_posted.empty() || context != _async_posted.front()) return false;
+
+  auto iobr = _async_posted.front();
+  _async_posted.pop_front();
+
+  const auto response_msg = response_ptr<const mcas::Protocol::Message_IO_response>(iobr->base());
+  for (unsigned i = 0; i < MAX_ASYNC_WINDOW; i++) {
+    auto op = &_async_ops[i];
+    if (op->in_use && op->iobr == nullptr && op->request_id == response_msg->request_id) {
+      op->iobr = iobr;
+      if (op->complete()) _async_done.push_back(op);
+      return true;
     }
   }
-  throw Logic_exception("unexpected control flow");
-  return E_FAIL;
+  throw Protocol_exception("async response for unknown request (%lu)", response_msg->request_id);
+}
+
+void Connection_handler::set_async_window(unsigned window)
+{
+  if (window == 0 || window > MAX_ASYNC_WINDOW) throw API_exception("async window out of range (1-%u)", MAX_ASYNC_WINDOW);
+  _async_window = window;
+}
+
+status_t Connection_handler::async_get(const pool_t           pool,
+                                       const std::string &    key,
+                                       void *&                out_value,
+                                       size_t &               out_value_len,
+                                       IMCAS::async_handle_t &out_handle)
+{
+  API_LOCK();
+
+  if (_async_count >= _async_window) return E_BUSY;
+
+  buffer_t *iobs = allocate();
+
+  try {
+    const auto msg =
+        new (iobs->base()) mcas::Protocol::Message_IO_request(iobs->length(), auth_id(), ++_request_id, pool,
+                                                              mcas::Protocol::OP_GET,  // op
+                                                              key.c_str(), key.length(), 0);
+
+    /* the value must arrive in the response message since other
+       receives may be posted behind it */
+    msg->resvd   = Protocol::MSG_RESVD_INLINE;
+    msg->val_len = iobs->original_length - sizeof(mcas::Protocol::Message_IO_response);
+
+    if (_options.short_circuit_backend) msg->resvd |= mcas::Protocol::MSG_RESVD_SCBE;
+
+    iobs->set_length(msg->msg_len);
+
+    auto op           = acquire_async_op(iobs, msg->request_id);
+    op->out_value     = &out_value;
+    op->out_value_len = &out_value_len;
+    post_async_request(op);
+    out_handle = reinterpret_cast<IMCAS::async_handle_t>(op);
+  }
+  catch (...) {
+    throw Logic_exception("async_get: network posting failed unexpectedly.");
+  }
+
+  return S_OK;
+}
+
+status_t Connection_handler::async_get_direct(const pool_t                 pool,
+                                              const std::string &          key,
+                                              void *                       value,
+                                              size_t &                     out_value_len,
+                                              const IMCAS::memory_handle_t handle,
+                                              IMCAS::async_handle_t &      out_handle)
+{
+  API_LOCK();
+
+  if (!value || out_value_len == 0 || handle == 0) {
+    PWRN("bad parameter value=%p out_value_len=%lu handle=%p", value, out_value_len, static_cast<const void *>(handle));
+    return E_BAD_PARAM;
+  }
+
+  buffer_t *value_iob = reinterpret_cast<buffer_t *>(handle);
+  if (!value_iob->check_magic()) {
+    PWRN("bad handle parameter to async_get_direct");
+    return E_BAD_PARAM;
+  }
+
+  if (_async_count >= _async_window) return E_BUSY;
+
+  buffer_t *iobs = allocate();
+
+  try {
+    const auto msg = new (iobs->base()) mcas::Protocol::Message_IO_request(
+        iobs->length(), auth_id(), ++_request_id, pool, mcas::Protocol::OP_GET, key.c_str(), key.length(), 0);
+
+    /* space allocated by the client; the value is returned in the
+       response message and copied out on completion */
+    msg->resvd   = Protocol::MSG_RESVD_DIRECT | Protocol::MSG_RESVD_INLINE;
+    msg->val_len = out_value_len;
+    offer_landing(msg, iobs, value_iob, value, out_value_len);
+
+    iobs->set_length(msg->msg_len);
+
+    auto op           = acquire_async_op(iobs, msg->request_id);
+    op->out_direct    = value;
+    op->out_value_len = &out_value_len;
+    post_async_request(op);
+    out_handle = reinterpret_cast<IMCAS::async_handle_t>(op);
+  }
+  catch (...) {
+    throw Logic_exception("async_get_direct: network posting failed unexpectedly.");
+  }
+
+  return S_OK;
 }
 
 status_t Connection_handler::get(const pool_t pool, const std::string &key, std::string &value)
@@ -650,12 +1097,23 @@ status_t Connection_handler::get(const pool_t pool, const std::string &key, std:
 status_t Connection_handler::get(const pool_t pool, const std::string &key, void *&value, size_t &value_len)
 {
   API_LOCK();
+  return get_value(pool, key, value, value_len);
+}
 
+status_t Connection_handler::get_value(const pool_t pool, const std::string &key, void *&value, size_t &value_len)
+{
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   assert(iobs);
   assert(iobr);
 
+  if (_lease_pools.count(pool) && read_leased(pool, key, iobr->base(), iobr->original_length, iobr->region, value_len)) {
+    value = ::malloc(value_len + 1);
+    memcpy(value, iobr->base(), value_len);
+    static_cast<char *>(value)[value_len] = '\0';
+    return S_OK;
+  }
+
   status_t status;
 
   try {
@@ -692,6 +1150,7 @@ status_t Connection_handler::get(const pool_t pool, const std::string &key, void
       /* two-stage get */
       const auto data_len = response_msg->data_length() + 1;
       value               = ::aligned_alloc(MiB(2), data_len);
+      value_len           = data_len - 1;
       madvise(value, data_len, MADV_HUGEPAGE);
 
       auto region = register_memory(value, data_len); /* we could have some pre-registered? */
@@ -744,6 +1203,17 @@ status_t Connection_handler::get_direct(const pool_t                 pool,
   /* check value is not too large for underlying transport */
   if (out_value_len > _max_message_size) return IKVStore::E_TOO_LARGE;
 
+  if (_lease_pools.count(pool)) {
+    const auto base = static_cast<const char *>(value_iob->base());
+    const auto p    = static_cast<const char *>(value);
+    size_t     len;
+    if (base <= p && p + out_value_len <= base + value_iob->original_length &&
+        read_leased(pool, key, value, out_value_len, value_iob->region, len)) {
+      out_value_len = len;
+      return S_OK;
+    }
+  }
+
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   assert(iobs);
@@ -759,6 +1229,7 @@ status_t Connection_handler::get_direct(const pool_t                 pool,
        get_direct this is allocated by the client */
     msg->resvd   = Protocol::MSG_RESVD_DIRECT;
     msg->val_len = out_value_len;
+    offer_landing(msg, &*iobs, value_iob, value, out_value_len);
 
     iobs->set_length(msg->msg_len);
 
@@ -784,7 +1255,10 @@ status_t Connection_handler::get_direct(const pool_t                 pool,
     /* set out_value_len to receiving length */
     out_value_len = response_msg->data_length();
 
-    if (response_msg->is_set_twostage_bit()) {
+    if (response_msg->is_set_written_bit()) {
+      /* value already written into place by the server */
+    }
+    else if (response_msg->is_set_twostage_bit()) {
       /* two-stage get */
       post_recv(value_iob);
 
@@ -804,9 +1278,76 @@ status_t Connection_handler::get_direct(const pool_t                 pool,
   return status;
 }
 
+status_t Connection_handler::get_range(const pool_t       pool,
+                                       const std::string &key,
+                                       size_t             offset,
+                                       void *             value,
+                                       size_t &           inout_len)
+{
+  API_LOCK();
+
+  if (!value || inout_len == 0) return E_BAD_PARAM;
+
+  /* each chunk is returned inline in one response */
+  const size_t chunk_len = Buffer_manager<IFabric_client>::BUFFER_LEN - sizeof(mcas::Protocol::Message_IO_response);
+  const size_t count     = (inout_len + chunk_len - 1) / chunk_len;
+
+  std::vector<size_t>         got(count, 0);
+  std::deque<buffer_pair_t *> inflight;
+  size_t                      next   = 0; /* chunks issued */
+  size_t                      done   = 0; /* chunks retired */
+  size_t                      total  = 0;
+  bool                        end    = false; /* a chunk came back short */
+  status_t                    status = S_OK;
+
+  try {
+    while (done < next || (next < count && !end && status == S_OK)) {
+      if (next < count && !end && status == S_OK && _async_count < _async_window) {
+        const size_t at   = next * chunk_len;
+        const size_t len  = std::min(chunk_len, inout_len - at);
+        buffer_t *   iobs = allocate();
+        const auto   msg  = new (iobs->base()) mcas::Protocol::Message_IO_request(
+            iobs->length(), auth_id(), ++_request_id, pool, mcas::Protocol::OP_GET, key.c_str(), key.length(), 0);
+        msg->resvd   = Protocol::MSG_RESVD_INLINE;
+        msg->val_len = len;
+        msg->set_range(iobs->length(), offset + at, len);
+        iobs->set_length(msg->msg_len);
+
+        auto op           = acquire_async_op(iobs, msg->request_id);
+        op->out_direct    = static_cast<char *>(value) + at;
+        op->out_value_len = &got[next];
+        post_async_request(op);
+        inflight.push_back(op);
+        next++;
+      }
+      else if (inflight.empty()) {
+        return E_BUSY; /* window full of the caller's own requests */
+      }
+      else {
+        const auto s = wait_async_op(inflight.front());
+        inflight.pop_front();
+        /* requests past a short chunk start beyond the value; ignore them */
+        if (!end) {
+          if (s != S_OK && status == S_OK) status = s;
+          total += got[done];
+          if (got[done] < std::min(chunk_len, inout_len - done * chunk_len)) end = true;
+        }
+        done++;
+      }
+    }
+  }
+  catch (...) {
+    return E_FAIL;
+  }
+
+  if (status == S_OK) inout_len = total;
+  return status;
+}
+
 status_t Connection_handler::erase(const pool_t pool, const std::string &key)
 {
   API_LOCK();
+  drop_lease(pool, key);
 
   const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
   const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -846,11 +1387,12 @@ status_t Connection_handler::async_erase(const IMCAS::pool_t    pool,
 {
   API_LOCK();
 
-  buffer_t *iobs = allocate();
-  buffer_t *iobr = allocate();
+  if (_async_count >= _async_window) return E_BUSY;
+
+  drop_lease(pool, key);
 
+  buffer_t *iobs = allocate();
   assert(iobs);
-  assert(iobr);
 
   try {
     const auto msg = new (iobs->base()) mcas::Protocol::Message_IO_request(
@@ -858,11 +1400,9 @@ status_t Connection_handler::async_erase(const IMCAS::pool_t    pool,
 
     iobs->set_length(msg->msg_len);
 
-    /* post both send and receive */
-    post_recv(&*iobr);
-    post_send(iobs->iov, iobs->iov + 1, &iobs->desc, iobs);
-
-    out_handle = reinterpret_cast<IMCAS::async_handle_t>(new buffer_pair_t(iobs, iobr));
+    auto op = acquire_async_op(iobs, msg->request_id);
+    post_async_request(op);
+    out_handle = reinterpret_cast<IMCAS::async_handle_t>(op);
   }
   catch (...) {
     throw Logic_exception("async_erase: network posting failed unexpectedly.");
@@ -871,6 +1411,110 @@ status_t Connection_handler::async_erase(const IMCAS::pool_t    pool,
   return S_OK;
 }
 
+status_t Connection_handler::batch_io(const pool_t                    pool,
+                                      const uint8_t                   op,
+                                      const std::vector<std::string> &keys,
+                                      const std::vector<std::string> *values,
+                                      std::vector<std::string> *      out_values,
+                                      std::vector<status_t> &         out_status,
+                                      const unsigned int              flags)
+{
+  using namespace mcas::Protocol;
+
+  if (values && values->size() != keys.size()) return E_INVAL;
+
+  out_status.assign(keys.size(), E_FAIL);
+  if (op != OP_GET) {
+    for (auto &k : keys) drop_lease(pool, k);
+  }
+  if (out_values) {
+    out_values->clear();
+    out_values->resize(keys.size());
+  }
+
+  size_t next = 0;
+  while (next < keys.size()) {
+    const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    assert(iobs);
+    assert(iobr);
+
+    try {
+      const auto msg =
+          new (iobs->base()) Message_IO_batch_request(iobs->length(), auth_id(), ++_request_id, pool, op, flags);
+
+      /* pack as many records as will fit */
+      size_t end = next;
+      while (end < keys.size()) {
+        const auto &key = keys[end];
+        if (!msg->append(iobs->length(), key.data(), key.length(), values ? (*values)[end].data() : nullptr,
+                         values ? (*values)[end].length() : 0))
+          break;
+        end++;
+      }
+
+      if (end == next) {
+        PWRN("%s: record (%lu) too large for batch. Use put_direct.", __func__, next);
+        return IKVStore::E_TOO_LARGE;
+      }
+
+      iobs->set_length(msg->msg_len);
+
+      post_recv(&*iobr);
+      sync_inject_send(&*iobs);
+      wait_for_completion(&*iobr);
+
+      const auto response_msg = response_ptr<const Message_IO_batch_response>(iobr->base());
+
+      if (option_DEBUG)
+        PLOG("got response from IO_BATCH operation: status=%d request_id=%lu count=%u", response_msg->get_status(),
+             response_msg->request_id, response_msg->count);
+
+      if (response_msg->get_status() != S_OK) return response_msg->get_status();
+      if (response_msg->count == 0 || response_msg->count > (end - next)) return E_FAIL;
+
+      auto rec = response_msg->first_record();
+      for (uint32_t i = 0; i < response_msg->count; i++, rec = Message_IO_batch_response::next_record(rec)) {
+        out_status[next + i] = rec->status;
+        if (out_values && rec->status == S_OK) (*out_values)[next + i].assign(rec->value(), rec->value_len);
+      }
+      next += response_msg->count;
+    }
+    catch (...) {
+      return E_FAIL;
+    }
+  }
+
+  return S_OK;
+}
+
+status_t Connection_handler::put_batch(const pool_t                    pool,
+                                       const std::vector<std::string> &keys,
+                                       const std::vector<std::string> &values,
+                                       std::vector<status_t> &         out_status,
+                                       const unsigned int              flags)
+{
+  API_LOCK();
+  return batch_io(pool, mcas::Protocol::OP_PUT, keys, &values, nullptr, out_status, flags);
+}
+
+status_t Connection_handler::get_batch(const pool_t                    pool,
+                                       const std::vector<std::string> &keys,
+                                       std::vector<std::string> &      out_values,
+                                       std::vector<status_t> &         out_status)
+{
+  API_LOCK();
+  return batch_io(pool, mcas::Protocol::OP_GET, keys, nullptr, &out_values, out_status, 0);
+}
+
+status_t Connection_handler::erase_batch(const pool_t                    pool,
+                                         const std::vector<std::string> &keys,
+                                         std::vector<status_t> &         out_status)
+{
+  API_LOCK();
+  return batch_io(pool, mcas::Protocol::OP_ERASE, keys, nullptr, nullptr, out_status, 0);
+}
+
 size_t Connection_handler::count(const pool_t pool)
 {
   API_LOCK();
@@ -976,6 +1620,93 @@ status_t Connection_handler::get_statistics(IMCAS::Shard_stats &out_stats)
   return status;
 }
 
+status_t Connection_handler::scan(const IMCAS::pool_t        pool,
+                                  const std::string &        start_key,
+                                  const std::string &        end_key,
+                                  const size_t               limit,
+                                  const bool                 with_values,
+                                  std::vector<std::string> & out_keys,
+                                  std::vector<std::string> & out_values,
+                                  std::vector<status_t> &    out_status)
+{
+  using namespace mcas::Protocol;
+
+  API_LOCK();
+
+  out_keys.clear();
+  out_values.clear();
+  out_status.clear();
+
+  std::string         from  = start_key;
+  uint32_t            flags = with_values ? Message_scan_request::FLAG_WITH_VALUES : 0;
+  std::vector<size_t> deferred; /* values too large to come inline */
+  bool                more = true;
+
+  while (more && (limit == 0 || out_keys.size() < limit)) {
+    const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    assert(iobs);
+    assert(iobr);
+
+    try {
+      const uint32_t page_limit =
+          limit ? boost::numeric_cast<uint32_t>(std::min<size_t>(limit - out_keys.size(), UINT32_MAX)) : 0;
+      const auto msg = new (iobs->base())
+          Message_scan_request(iobs->length(), auth_id(), ++_request_id, pool, from, end_key, page_limit, flags);
+      iobs->set_length(msg->msg_len);
+
+      post_recv(&*iobr);
+      sync_inject_send(&*iobs);
+      wait_for_completion(&*iobr);
+
+      const auto response_msg = response_ptr<const Message_scan_response>(iobr->base());
+
+      if (option_DEBUG)
+        PLOG("got response from SCAN operation: status=%d count=%u more=%u", response_msg->get_status(),
+             response_msg->count, response_msg->more);
+
+      if (response_msg->get_status() != S_OK) return response_msg->get_status();
+
+      auto rec = response_msg->first_record();
+      for (uint32_t i = 0; i < response_msg->count; i++, rec = Message_scan_response::next_record(rec)) {
+        out_keys.emplace_back(rec->key(), rec->key_len);
+        if (with_values) {
+          out_values.emplace_back(rec->value(), rec->value_len);
+          out_status.push_back(rec->status);
+          if (rec->status == E_INSUFFICIENT_SPACE) deferred.push_back(out_keys.size() - 1);
+        }
+      }
+
+      /* an empty page which continues would never progress */
+      if (response_msg->more && response_msg->count == 0) return E_FAIL;
+
+      more = response_msg->more;
+      if (more) {
+        /* continue after the last key returned */
+        from = out_keys.back();
+        flags |= Message_scan_request::FLAG_EXCLUSIVE_START;
+      }
+    }
+    catch (...) {
+      return E_FAIL;
+    }
+  }
+
+  /* fetch large values individually */
+  for (auto i : deferred) {
+    void * value     = nullptr;
+    size_t value_len = 0;
+    auto   rc        = get_value(pool, out_keys[i], value, value_len);
+    out_status[i]    = rc;
+    if (rc != S_OK) continue; /* e.g. erased meanwhile */
+    out_values[i].assign(static_cast<const char *>(value), value_len);
+    ::free(value);
+  }
+
+  /* stopped by limit, not by the end of the range */
+  return more ? S_MORE : S_OK;
+}
+
 status_t Connection_handler::find(const IMCAS::pool_t pool,
                                   const std::string & key_expression,
                                   const offset_t      offset,
@@ -1040,9 +1771,14 @@ status_t Connection_handler::invoke_ado(const IKVStore::pool_t            pool,
     iobs->set_length(msg->message_size());
 
     if (flags & IMCAS::ADO_FLAG_ASYNC) {
-      sync_send(&*iobs);
-      /* do not wait for response */
-      return S_OK;
+      if (!is_indirect(iobs->length())) {
+        sync_send(&*iobs);
+        /* do not wait for response */
+        return S_OK;
+      }
+      /* the server reads an indirect message until it responds, so a large
+         invocation runs synchronously */
+      msg->flags &= ~uint32_t(IMCAS::ADO_FLAG_ASYNC);
     }
 
     const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -1081,6 +1817,86 @@ status_t Connection_handler::invoke_ado(const IKVStore::pool_t            pool,
   return status;
 }
 
+status_t Connection_handler::invoke_ado_batch(const IKVStore::pool_t                         pool,
+                                              const std::vector<std::string> &               keys,
+                                              const std::vector<std::string> &               requests,
+                                              const unsigned int                             flags,
+                                              std::vector<status_t> &                        out_status,
+                                              std::vector<std::vector<IMCAS::ADO_response>> &out_responses,
+                                              const size_t                                   value_size)
+{
+  using namespace mcas::Protocol;
+
+  API_LOCK();
+
+  if (requests.size() != keys.size()) return E_INVAL;
+  if (flags & (IMCAS::ADO_FLAG_ASYNC | IMCAS::ADO_FLAG_DETACHED | IMCAS::ADO_FLAG_CREATE_ONLY)) return E_INVAL;
+
+  out_status.assign(keys.size(), E_FAIL);
+  out_responses.clear();
+  out_responses.resize(keys.size());
+
+  size_t next = 0;
+  while (next < keys.size()) {
+    const auto iobs = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
+    assert(iobs);
+    assert(iobr);
+
+    try {
+      const auto msg = new (iobs->base())
+          Message_ado_batch_request(iobs->length(), auth_id(), ++_request_id, pool, flags, value_size);
+
+      /* pack as many records as will fit */
+      size_t end = next;
+      while (end < keys.size()) {
+        if (!msg->append(iobs->length(), keys[end].data(), keys[end].length(), requests[end].data(),
+                         requests[end].length()))
+          break;
+        end++;
+      }
+
+      if (end == next) {
+        PWRN("%s: record (%lu) too large for batch. Use invoke_ado.", __func__, next);
+        return IKVStore::E_TOO_LARGE;
+      }
+
+      iobs->set_length(msg->msg_len);
+
+      post_recv(&*iobr);
+      sync_send(&*iobs);
+      wait_for_completion(&*iobr);
+
+      const auto response_msg = response_ptr<const Message_ado_batch_response>(iobr->base());
+
+      if (option_DEBUG)
+        PLOG("got response from ADO_BATCH operation: status=%d request_id=%lu count=%u", response_msg->get_status(),
+             response_msg->request_id, response_msg->count);
+
+      if (response_msg->get_status() != S_OK) return response_msg->get_status();
+      if (response_msg->count != (end - next)) return E_FAIL;
+
+      /* unmarshal responses */
+      auto rec = response_msg->first_record();
+      for (uint32_t i = 0; i < response_msg->count; i++, rec = Message_ado_batch_response::next_record(rec)) {
+        out_status[next + i] = rec->status;
+        auto &out            = out_responses[next + i];
+        rec->for_each_response([&out](const void *data, size_t data_len, uint32_t layer_id) {
+          void *p = ::malloc(data_len);
+          ::memcpy(p, data, data_len);
+          out.emplace_back(p, data_len, layer_id);
+        });
+      }
+      next = end;
+    }
+    catch (...) {
+      return E_FAIL;
+    }
+  }
+
+  return S_OK;
+}
+
 status_t Connection_handler::invoke_put_ado(const IKVStore::pool_t            pool,
                                             const std::string &               key,
                                             const void *                      request,
@@ -1109,9 +1925,14 @@ status_t Connection_handler::invoke_put_ado(const IKVStore::pool_t            po
     iobs->set_length(msg->message_size());
 
     if (flags & IMCAS::ADO_FLAG_ASYNC) {
-      sync_send(&*iobs);
-      /* do not wait for response */
-      return S_OK;
+      if (!is_indirect(iobs->length())) {
+        sync_send(&*iobs);
+        /* do not wait for response */
+        return S_OK;
+      }
+      /* the server reads an indirect message until it responds, so a large
+         invocation runs synchronously */
+      msg->flags &= ~uint32_t(IMCAS::ADO_FLAG_ASYNC);
     }
 
     const auto iobr = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
@@ -1164,6 +1985,7 @@ int Connection_handler::tick()
       const auto iob = std::unique_ptr<buffer_t, iob_free>(allocate(), this);
       auto       msg = new (iob->base()) mcas::Protocol::Message_handshake(auth_id(), 1);
       msg->set_status(S_OK);
+      msg->resvd = mcas::Protocol::HANDSHAKE_FLAG_INDIRECT; /* large messages need no large receives */
       iob->set_length(msg->msg_len);
       post_send(iob->iov, iob->iov + 1, &iob->desc, &*iob);
 
@@ -1183,6 +2005,10 @@ int Connection_handler::tick()
 
       try {
         wait_for_completion(&*iob);
+
+        /* a server which does not know the flag receives any message directly */
+        const auto reply = response_ptr<const mcas::Protocol::Message_handshake_reply>(iob->base());
+        if (reply->resvd & mcas::Protocol::HANDSHAKE_FLAG_INDIRECT) set_indirect_len(reply->max_message_size);
       }
       catch (...) {
         set_state(STOPPED);
@@ -22,8 +22,11 @@
 #include <unistd.h>
 
 #include <boost/numeric/conversion/cast.hpp>
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
+#include <vector>
 
 #include "buffer_manager.h"
 #include "client_fabric_transport.h"
@@ -43,11 +46,18 @@
 
 namespace mcas
 {
+namespace Protocol
+{
+struct Message_IO_request;
+}
+
 namespace Client
 {
 /* Adaptor point for other transports */
 using Connection_base = mcas::Client::Fabric_transport;
 
+struct buffer_pair_t;
+
 /**
  * Client side connection handler
  *
@@ -143,6 +153,29 @@ class Connection_handler : public Connection_base {
 
   status_t check_async_completion(Component::IMCAS::async_handle_t &handle);
 
+  size_t poll_completions(Component::IMCAS::async_handle_t *out_handles, status_t *out_status, size_t max);
+
+  status_t async_get(const pool_t                      pool,
+                     const std::string &               key,
+                     void *&                           out_value,
+                     size_t &                          out_value_len,
+                     Component::IMCAS::async_handle_t &out_handle);
+
+  status_t async_get_direct(const pool_t                         pool,
+                            const std::string &                  key,
+                            void *                               value,
+                            size_t &                             out_value_len,
+                            Component::IKVStore::memory_handle_t handle,
+                            Component::IMCAS::async_handle_t &   out_handle);
+
+  /**
+   * Set the maximum number of asynchronous requests that may be issued
+   * and not yet retired by check_async_completion
+   *
+   * @param window Window size (1 to MAX_ASYNC_WINDOW)
+   */
+  void set_async_window(unsigned window);
+
   status_t get(const pool_t pool, const std::string &key, std::string &value);
 
   status_t get(const pool_t pool, const std::string &key, void *&value, size_t &value_len);
@@ -153,12 +186,27 @@ class Connection_handler : public Connection_base {
                       size_t &                             out_value_len,
                       Component::IKVStore::memory_handle_t handle = Component::IKVStore::HANDLE_NONE);
 
+  status_t get_range(const pool_t pool, const std::string &key, size_t offset, void *value, size_t &inout_len);
+
   status_t erase(const pool_t pool, const std::string &key);
 
   status_t async_erase(const Component::IMCAS::pool_t    pool,
                        const std::string &               key,
                        Component::IMCAS::async_handle_t &out_handle);
 
+  status_t put_batch(const pool_t                    pool,
+                     const std::vector<std::string> &keys,
+                     const std::vector<std::string> &values,
+                     std::vector<status_t> &         out_status,
+                     const unsigned int              flags);
+
+  status_t get_batch(const pool_t                    pool,
+                     const std::vector<std::string> &keys,
+                     std::vector<std::string> &      out_values,
+                     std::vector<status_t> &         out_status);
+
+  status_t erase_batch(const pool_t pool, const std::vector<std::string> &keys, std::vector<status_t> &out_status);
+
   uint64_t key_hash(const void *key, const size_t key_len);
 
   uint64_t auth_id() const
@@ -186,6 +234,15 @@ class Connection_handler : public Connection_base {
 
   status_t get_statistics(Component::IMCAS::Shard_stats &out_stats);
 
+  status_t scan(const Component::IKVStore::pool_t pool,
+                const std::string &               start_key,
+                const std::string &               end_key,
+                const size_t                      limit,
+                const bool                        with_values,
+                std::vector<std::string> &        out_keys,
+                std::vector<std::string> &        out_values,
+                std::vector<status_t> &           out_status);
+
   status_t find(const Component::IKVStore::pool_t pool,
                 const std::string &               key_expression,
                 const offset_t                    offset,
@@ -210,6 +267,14 @@ class Connection_handler : public Connection_base {
                           const unsigned int                           flags,
                           std::vector<Component::IMCAS::ADO_response> &out_response);
 
+  status_t invoke_ado_batch(const Component::IKVStore::pool_t                         pool,
+                            const std::vector<std::string> &                          keys,
+                            const std::vector<std::string> &                          requests,
+                            const unsigned int                                        flags,
+                            std::vector<status_t> &                                   out_status,
+                            std::vector<std::vector<Component::IMCAS::ADO_response>> &out_responses,
+                            const size_t                                              value_size);
+
   bool check_message_size(size_t size) const { return size > _max_message_size; }
 
  private:
@@ -247,6 +312,177 @@ class Connection_handler : public Connection_base {
                                 Component::IKVStore::memory_handle_t handle,
                                 unsigned int                         flags);
 
+  /**
+   * Put a value too large for one IO buffer as a pipeline of
+   * OP_PUT_SEGMENT messages, at most one async window in flight
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param key_len Key length
+   * @param value Value (need not be registered)
+   * @param value_len Value length
+   * @param flags Flags
+   *
+   * @return S_OK, E_BUSY if the async window is taken by other requests, or other error code
+   */
+  status_t put_segmented(const pool_t       pool,
+                         const void *       key,
+                         const size_t       key_len,
+                         const void *       value,
+                         const size_t       value_len,
+                         const unsigned int flags);
+
+  /**
+   * Vectored IO exchange used by put_batch, get_batch and erase_batch.
+   * Records are packed into as few IO buffers as possible; the shard
+   * may answer a prefix of each message, in which case the remainder
+   * is re-sent.
+   *
+   * @param pool Pool identifier
+   * @param op Operation (OP_PUT, OP_GET or OP_ERASE)
+   * @param keys Keys
+   * @param values Values for OP_PUT (otherwise nullptr)
+   * @param out_values Values for OP_GET (otherwise nullptr)
+   * @param out_status Per-key status
+   * @param flags Flags
+   *
+   * @return S_OK or error code
+   */
+  status_t batch_io(const pool_t                    pool,
+                    const uint8_t                   op,
+                    const std::vector<std::string> &keys,
+                    const std::vector<std::string> *values,
+                    std::vector<std::string> *      out_values,
+                    std::vector<status_t> &         out_status,
+                    unsigned int                    flags);
+
+  /**
+   * GET without taking the API lock; supports two-stage responses
+   *
+   * @param pool Pool identifier
+   * @param key Key
+   * @param value [out] Value allocated with malloc/aligned_alloc
+   * @param value_len [out] Value length
+   *
+   * @return S_OK or error code
+   */
+  status_t get_value(const pool_t pool, const std::string &key, void *&value, size_t &value_len);
+
+  /**
+   * Post the request held in op->iobs together with a receive buffer.
+   * Responses are matched to requests by request_id, because the shard
+   * does not necessarily answer pipelined requests in order.
+   *
+   * @param op Asynchronous request
+   */
+  void post_async_request(buffer_pair_t *op);
+
+  /**
+   * Take a request record from the pool
+   *
+   * @param iobs Send buffer holding the request
+   * @param request_id Request identifier
+   *
+   * @return Request record
+   */
+  buffer_pair_t *acquire_async_op(buffer_t *iobs, uint64_t request_id);
+
+  /**
+   * Deliver the response of a completed request and return its record
+   * to the pool
+   *
+   * @param op Completed request
+   *
+   * @return Response status
+   */
+  status_t retire_async_op(buffer_pair_t *op);
+
+  /**
+   * Wait for a request to complete and retire it
+   *
+   * @param op Request
+   *
+   * @return Response status
+   */
+  status_t wait_async_op(buffer_pair_t *op);
+
+  /**
+   * Offer the server a landing buffer for an RDMA write of a GET value,
+   * if the destination lies within registered direct memory
+   *
+   * @param msg GET request
+   * @param iobs Send buffer holding the request
+   * @param value_iob Direct memory handle
+   * @param value Destination of the value
+   * @param value_len Space at the destination
+   */
+  void offer_landing(mcas::Protocol::Message_IO_request *msg,
+                     buffer_t *                          iobs,
+                     buffer_t *                          value_iob,
+                     const void *                        value,
+                     size_t                              value_len);
+
+  /**
+   * Read a value of a pool configured with Lease::on by one-sided RDMA
+   * read, taking a lease from the server first if there is none
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   * @param target Registered memory to read into
+   * @param target_len Space at target
+   * @param region Memory region covering target
+   * @param out_value_len [out] Value length
+   *
+   * @return True iff the value was read and matched the lease's version and checksum;
+   * otherwise the caller falls back to a two-sided get
+   */
+  bool read_leased(const pool_t       pool,
+                   const std::string &key,
+                   void *             target,
+                   size_t             target_len,
+                   memory_region_t    region,
+                   size_t &           out_value_len);
+
+  /**
+   * Take a lease on a value
+   *
+   * @param pool Pool handle
+   * @param key Object key
+   *
+   * @return S_OK, E_NOT_SUPPORTED if the pool does not grant leases, or
+   * other error code
+   */
+  status_t acquire_lease(const pool_t pool, const std::string &key);
+
+  inline void drop_lease(const pool_t pool, const std::string &key)
+  {
+    if (!_leases.empty()) _leases.erase(std::make_pair(pool, key));
+  }
+
+  void drop_leases(const pool_t pool);
+
+  /**
+   * Poll the completion queue once, moving requests whose send and
+   * response have both completed onto the done queue
+   *
+   */
+  void progress_async();
+
+  static Component::IFabric_op_completer::cb_acceptance async_completion_callback(void *        context,
+                                                                                  status_t      st,
+                                                                                  std::uint64_t completion_flags,
+                                                                                  std::size_t   len,
+                                                                                  void *        error_data,
+                                                                                  void *        param);
+
+  bool async_completion(void *context);
+
+ public:
+  static constexpr unsigned DEFAULT_ASYNC_WINDOW = 16;
+  static constexpr unsigned MAX_ASYNC_WINDOW     = (NUM_BUFFERS / 2) - 4; /* leave buffers for sync calls */
+  static constexpr unsigned DEFAULT_LEASE_MSEC   = 1000;
+  static constexpr size_t   MAX_LEASES           = 4096;
+
  private:
 #ifdef THREAD_SAFE_CLIENT
   std::mutex _api_lock;
@@ -257,9 +493,33 @@ class Connection_handler : public Connection_base {
   size_t   _max_message_size = 0;
   size_t   _max_inject_size  = 0;
 
+  unsigned                         _async_window = DEFAULT_ASYNC_WINDOW;
+  unsigned                         _async_count  = 0; /*< issued but not retired */
+  std::unique_ptr<buffer_pair_t[]> _async_ops;        /*< request records */
+  std::vector<buffer_pair_t *>     _async_free;
+  std::deque<buffer_t *>           _async_posted; /*< receive buffers in posting order */
+  std::deque<buffer_pair_t *>      _async_done;   /*< complete, not yet retired */
+
   struct {
     bool short_circuit_backend = false;
+    bool segments_out_of_order = false; /*< test aid: reverse segments, resending one */
   } _options;
+
+  /* one-sided reads (configure_pool Lease::on) */
+  struct lease_t {
+    uint64_t   addr;
+    uint64_t   key;
+    size_t     len;
+    uint64_t   version_addr;
+    uint64_t   version_key;
+    uint64_t   version;
+    uint32_t   chksum;
+    cpu_time_t expiry;
+  };
+
+  std::set<pool_t>                                  _lease_pools;
+  std::map<std::pair<pool_t, std::string>, lease_t> _leases;
+  cpu_time_t                                        _lease_cycles;
 };
 
 }  // namespace Client
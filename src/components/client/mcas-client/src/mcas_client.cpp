@@ -15,6 +15,7 @@
 #include <api/fabric_itf.h>
 #include <city.h>
 
+#include <atomic>
 #include <regex>
 
 #include "connection.h"
@@ -43,6 +44,12 @@ MCAS_client::MCAS_client(const unsigned     debug_level,
 
   mcas::Global::debug_level = debug_level;
 
+  static std::atomic<uint64_t> instance_count{0};
+  _instance = ++instance_count;
+
+  char *env           = getenv("MCAS_THREAD_CONNECTIONS");
+  _thread_connections = env && env[0] == '1';
+
   smatch m;
 
   try {
@@ -107,6 +114,9 @@ void MCAS_client::open_transport(const std::string &device,
     assert(_transport);
   }
 
+  _ip_addr = ip_addr;
+  _port    = port;
+
   assert(_transport);
   _connection = new mcas::Client::Connection_handler(_transport);
   _connection->bootstrap();
@@ -116,6 +126,13 @@ void MCAS_client::close_transport()
 {
   PLOG("MCAS_client: closing fabric transport (%p)", static_cast<const void *>(this));
 
+  for (auto &c : _thread_connection_map) {
+    c.second.second->shutdown();
+    delete c.second.second;
+    delete c.second.first;
+  }
+  _thread_connection_map.clear();
+
   if (_connection) {
     _connection->shutdown();
   }
@@ -127,7 +144,36 @@ void MCAS_client::close_transport()
   PLOG("MCAS_client: closed fabric transport.");
 }
 
-int MCAS_client::thread_safety() const { return IKVStore::THREAD_MODEL_SINGLE_PER_POOL; }
+mcas::Client::Connection_handler *MCAS_client::connection()
+{
+  if (!_thread_connections) return _connection;
+
+  /* one-entry cache keeps the map lookup off the fast path */
+  static thread_local struct {
+    uint64_t                          instance;
+    mcas::Client::Connection_handler *connection;
+  } cached = {0, nullptr};
+
+  if (cached.instance == _instance) return cached.connection;
+
+  std::lock_guard<std::mutex> g(_thread_connections_lock);
+  auto &c = _thread_connection_map[std::this_thread::get_id()];
+  if (!c.second) {
+    c.first = _fabric->open_client("{}", _ip_addr, _port);
+    assert(c.first);
+    c.second = new mcas::Client::Connection_handler(c.first);
+    c.second->bootstrap();
+    PLOG("MCAS_client: opened connection (%p) for thread", static_cast<const void *>(c.second));
+  }
+  cached.instance   = _instance;
+  cached.connection = c.second;
+  return c.second;
+}
+
+int MCAS_client::thread_safety() const
+{
+  return _thread_connections ? IKVStore::THREAD_MODEL_MULTI_PER_POOL : IKVStore::THREAD_MODEL_SINGLE_PER_POOL;
+}
 
 int MCAS_client::get_capability(Capability cap) const
 {
@@ -178,7 +224,7 @@ status_t MCAS_client::put(const IKVStore::pool_t pool,
                           uint32_t               flags)
 {
   assert(flags <= IMCAS::FLAGS_MAX_VALUE);
-  return _connection->put(pool, key, value, value_len, flags);
+  return connection()->put(pool, key, value, value_len, flags);
 }
 
 status_t MCAS_client::put_direct(const pool_t           pool,
@@ -188,7 +234,7 @@ status_t MCAS_client::put_direct(const pool_t           pool,
                                  IMCAS::memory_handle_t handle,
                                  uint32_t               flags)
 {
-  return _connection->put_direct(pool, key, value, value_len, handle, flags);
+  return connection()->put_direct(pool, key, value, value_len, handle, flags);
 }
 
 status_t MCAS_client::async_put(IKVStore::pool_t   pool,
@@ -198,12 +244,17 @@ status_t MCAS_client::async_put(IKVStore::pool_t   pool,
                                 async_handle_t &   out_handle,
                                 unsigned int       flags)
 {
-  return _connection->async_put(pool, key.data(), key.size(), value, value_len, out_handle, flags);
+  return connection()->async_put(pool, key.data(), key.size(), value, value_len, out_handle, flags);
 }
 
 status_t MCAS_client::check_async_completion(async_handle_t &handle)
 {
-  return _connection->check_async_completion(handle);
+  return connection()->check_async_completion(handle);
+}
+
+size_t MCAS_client::poll_completions(async_handle_t out_handles[], status_t out_status[], size_t max)
+{
+  return connection()->poll_completions(out_handles, out_status, max);
 }
 
 status_t MCAS_client::get(const IKVStore::pool_t pool,
@@ -211,7 +262,7 @@ status_t MCAS_client::get(const IKVStore::pool_t pool,
                           void *&                out_value, /* release with free() */
                           size_t &               out_value_len)
 {
-  return _connection->get(pool, key, out_value, out_value_len);
+  return connection()->get(pool, key, out_value, out_value_len);
 }
 
 status_t MCAS_client::get_direct(const pool_t           pool,
@@ -220,7 +271,35 @@ status_t MCAS_client::get_direct(const pool_t           pool,
                                  size_t &               out_value_len,
                                  IMCAS::memory_handle_t handle)
 {
-  return _connection->get_direct(pool, key, out_value, out_value_len, handle);
+  return connection()->get_direct(pool, key, out_value, out_value_len, handle);
+}
+
+status_t MCAS_client::get_range(const pool_t       pool,
+                                const std::string &key,
+                                size_t             offset,
+                                void *             out_value,
+                                size_t &           inout_len)
+{
+  return connection()->get_range(pool, key, offset, out_value, inout_len);
+}
+
+status_t MCAS_client::async_get(const IMCAS::pool_t pool,
+                                const std::string & key,
+                                void *&             out_value,
+                                size_t &            out_value_len,
+                                async_handle_t &    out_handle)
+{
+  return connection()->async_get(pool, key, out_value, out_value_len, out_handle);
+}
+
+status_t MCAS_client::async_get_direct(const IMCAS::pool_t    pool,
+                                       const std::string &    key,
+                                       void *                 out_value,
+                                       size_t &               out_value_len,
+                                       IMCAS::memory_handle_t handle,
+                                       async_handle_t &       out_handle)
+{
+  return connection()->async_get_direct(pool, key, out_value, out_value_len, handle, out_handle);
 }
 
 Component::IKVStore::memory_handle_t MCAS_client::register_direct_memory(void *vaddr, const size_t len)
@@ -230,35 +309,59 @@ Component::IKVStore::memory_handle_t MCAS_client::register_direct_memory(void *v
          strerror(errno));
   }
 
-  return _connection->register_direct_memory(vaddr, len);
+  return connection()->register_direct_memory(vaddr, len);
 }
 
 status_t MCAS_client::unregister_direct_memory(IKVStore::memory_handle_t handle)
 {
-  return _connection->unregister_direct_memory(handle);
+  return connection()->unregister_direct_memory(handle);
 }
 
 status_t MCAS_client::erase(const IKVStore::pool_t pool, const std::string &key)
 {
-  return _connection->erase(pool, key);
+  return connection()->erase(pool, key);
 }
 
 status_t MCAS_client::async_erase(const IMCAS::pool_t pool, const std::string &key, async_handle_t &out_handle)
 {
-  return _connection->async_erase(pool, key, out_handle);
+  return connection()->async_erase(pool, key, out_handle);
+}
+
+status_t MCAS_client::put_batch(const IMCAS::pool_t             pool,
+                                const std::vector<std::string> &keys,
+                                const std::vector<std::string> &values,
+                                std::vector<status_t> &         out_status,
+                                const unsigned int              flags)
+{
+  return connection()->put_batch(pool, keys, values, out_status, flags);
 }
 
-size_t MCAS_client::count(const IKVStore::pool_t pool) { return _connection->count(pool); }
+status_t MCAS_client::get_batch(const IMCAS::pool_t             pool,
+                                const std::vector<std::string> &keys,
+                                std::vector<std::string> &      out_values,
+                                std::vector<status_t> &         out_status)
+{
+  return connection()->get_batch(pool, keys, out_values, out_status);
+}
+
+status_t MCAS_client::erase_batch(const IMCAS::pool_t             pool,
+                                  const std::vector<std::string> &keys,
+                                  std::vector<status_t> &         out_status)
+{
+  return connection()->erase_batch(pool, keys, out_status);
+}
+
+size_t MCAS_client::count(const IKVStore::pool_t pool) { return connection()->count(pool); }
 
 status_t MCAS_client::get_attribute(const IKVStore::pool_t    pool,
                                     const IKVStore::Attribute attr,
                                     std::vector<uint64_t> &   out_attr,
                                     const std::string *       key)
 {
-  return _connection->get_attribute(pool, attr, out_attr, key);
+  return connection()->get_attribute(pool, attr, out_attr, key);
 }
 
-status_t MCAS_client::get_statistics(Shard_stats &out_stats) { return _connection->get_statistics(out_stats); }
+status_t MCAS_client::get_statistics(Shard_stats &out_stats) { return connection()->get_statistics(out_stats); }
 
 status_t MCAS_client::free_memory(void *p)
 {
@@ -268,13 +371,25 @@ status_t MCAS_client::free_memory(void *p)
 
 void MCAS_client::debug(const IKVStore::pool_t pool, unsigned cmd, uint64_t arg) {}
 
+status_t MCAS_client::scan(const IMCAS::pool_t        pool,
+                           const std::string &        start_key,
+                           const std::string &        end_key,
+                           const size_t               limit,
+                           const bool                 with_values,
+                           std::vector<std::string> & out_keys,
+                           std::vector<std::string> & out_values,
+                           std::vector<status_t> &    out_status)
+{
+  return connection()->scan(pool, start_key, end_key, limit, with_values, out_keys, out_values, out_status);
+}
+
 status_t MCAS_client::find(const IKVStore::pool_t pool,
                            const std::string &    key_expression,
                            const offset_t         offset,
                            offset_t &             out_matched_offset,
                            std::string &          out_matched_key)
 {
-  return _connection->find(pool, key_expression, offset, out_matched_offset, out_matched_key);
+  return connection()->find(pool, key_expression, offset, out_matched_offset, out_matched_key);
 }
 
 status_t MCAS_client::invoke_ado(const IKVStore::pool_t            pool,
@@ -285,7 +400,7 @@ status_t MCAS_client::invoke_ado(const IKVStore::pool_t            pool,
                                  std::vector<IMCAS::ADO_response> &out_response,
                                  const size_t                      value_size)
 {
-  return _connection->invoke_ado(pool, key, request, request_len, flags, out_response, value_size);
+  return connection()->invoke_ado(pool, key, request, request_len, flags, out_response, value_size);
 }
 
 status_t MCAS_client::invoke_put_ado(const IKVStore::pool_t            pool,
@@ -298,7 +413,18 @@ status_t MCAS_client::invoke_put_ado(const IKVStore::pool_t            pool,
                                      ado_flags_t                       flags,
                                      std::vector<IMCAS::ADO_response> &out_response)
 {
-  return _connection->invoke_put_ado(pool, key, request, request_len, value, value_len, root_len, flags, out_response);
+  return connection()->invoke_put_ado(pool, key, request, request_len, value, value_len, root_len, flags, out_response);
+}
+
+status_t MCAS_client::invoke_ado_batch(const IKVStore::pool_t                         pool,
+                                       const std::vector<std::string> &               keys,
+                                       const std::vector<std::string> &               requests,
+                                       const ado_flags_t                              flags,
+                                       std::vector<status_t> &                        out_status,
+                                       std::vector<std::vector<IMCAS::ADO_response>> &out_responses,
+                                       const size_t                                   value_size)
+{
+  return connection()->invoke_ado_batch(pool, keys, requests, flags, out_status, out_responses, value_size);
 }
 
 /**
@@ -27,6 +27,11 @@
 #include <api/kvstore_itf.h>
 #include <api/mcas_itf.h>
 
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
 #include "connection.h"
 #include "mcas_client_config.h"
 
@@ -138,6 +143,8 @@ class MCAS_client
 
   virtual status_t check_async_completion(async_handle_t &handle) override;
 
+  virtual size_t poll_completions(async_handle_t out_handles[], status_t out_status[], size_t max) override;
+
   virtual status_t get(const pool_t       pool,
                        const std::string &key,
                        void *&            out_value, /* release with free() */
@@ -149,10 +156,44 @@ class MCAS_client
                               size_t &                     out_value_len,
                               const IMCAS::memory_handle_t handle = IMCAS::MEMORY_HANDLE_NONE) override;
 
+  virtual status_t get_range(const pool_t       pool,
+                             const std::string &key,
+                             size_t             offset,
+                             void *             out_value,
+                             size_t &           inout_len) override;
+
+  virtual status_t async_get(const IMCAS::pool_t pool,
+                             const std::string & key,
+                             void *&             out_value,
+                             size_t &            out_value_len,
+                             async_handle_t &    out_handle) override;
+
+  virtual status_t async_get_direct(const IMCAS::pool_t          pool,
+                                    const std::string &          key,
+                                    void *                       out_value,
+                                    size_t &                     out_value_len,
+                                    const IMCAS::memory_handle_t handle,
+                                    async_handle_t &             out_handle) override;
+
   virtual status_t erase(const pool_t pool, const std::string &key) override;
 
   virtual status_t async_erase(const IMCAS::pool_t pool, const std::string &key, async_handle_t &out_handle) override;
 
+  virtual status_t put_batch(const IMCAS::pool_t             pool,
+                             const std::vector<std::string> &keys,
+                             const std::vector<std::string> &values,
+                             std::vector<status_t> &         out_status,
+                             const unsigned int              flags = IMCAS::FLAGS_NONE) override;
+
+  virtual status_t get_batch(const IMCAS::pool_t             pool,
+                             const std::vector<std::string> &keys,
+                             std::vector<std::string> &      out_values,
+                             std::vector<status_t> &         out_status) override;
+
+  virtual status_t erase_batch(const IMCAS::pool_t             pool,
+                               const std::vector<std::string> &keys,
+                               std::vector<status_t> &         out_status) override;
+
   virtual size_t count(const pool_t pool) override;
 
   virtual status_t get_attribute(const IKVStore::pool_t    pool,
@@ -171,6 +212,15 @@ class MCAS_client
   virtual status_t free_memory(void *p) override;
 
   /* IMCAS specific methods */
+  virtual status_t scan(const IMCAS::pool_t        pool,
+                        const std::string &        start_key,
+                        const std::string &        end_key,
+                        const size_t               limit,
+                        const bool                 with_values,
+                        std::vector<std::string> & out_keys,
+                        std::vector<std::string> & out_values,
+                        std::vector<status_t> &    out_status) override;
+
   virtual status_t find(const IKVStore::pool_t pool,
                         const std::string &    key_expression,
                         const offset_t         offset,
@@ -195,6 +245,14 @@ class MCAS_client
                                   const ado_flags_t                 flags,
                                   std::vector<IMCAS::ADO_response> &out_response) override;
 
+  virtual status_t invoke_ado_batch(const IKVStore::pool_t                         pool,
+                                    const std::vector<std::string> &               keys,
+                                    const std::vector<std::string> &               requests,
+                                    const ado_flags_t                              flags,
+                                    std::vector<status_t> &                        out_status,
+                                    std::vector<std::vector<IMCAS::ADO_response>> &out_responses,
+                                    const size_t                                   value_size = 0) override;
+
  private:
   Component::IFabric_factory *_factory;
   Component::IFabric *        _fabric;
@@ -202,7 +260,28 @@ class MCAS_client
 
   mcas::Client::Connection_handler *_connection;
 
+  /* With MCAS_THREAD_CONNECTIONS=1 each application thread is given its
+     own endpoint and IO buffers, so threads do not contend on one
+     connection lock.  Pool create/open/close/delete stay on the primary
+     connection so that pool references belong to one session. Memory
+     and async handles are only valid on the thread that obtained them. */
+  using thread_connection_t = std::pair<Component::IFabric_client *, mcas::Client::Connection_handler *>;
+
+  bool                                           _thread_connections;
+  uint64_t                                       _instance;
+  std::string                                    _ip_addr;
+  int                                            _port;
+  std::mutex                                     _thread_connections_lock;
+  std::map<std::thread::id, thread_connection_t> _thread_connection_map;
+
  private:
+  /**
+   * Connection used by the calling thread
+   *
+   * @return Primary connection, or the thread's own connection
+   */
+  mcas::Client::Connection_handler *connection();
+
   void open_transport(const std::string &device,
                       const std::string &ip_addr,
                       const int          port,
@@ -16,6 +16,7 @@
 
 #include <api/components.h>
 #include <api/kvstore_itf.h>
+#include <api/mcas_itf.h>
 #include <common/cpu.h>
 #include <common/str_utils.h>
 #include <core/task.h>
@@ -253,6 +254,368 @@ TEST_F(mcas_client_test, BasicPutAndGet)
   PLOG("BasicPutAndGet OK!");
 }
 
+TEST_F(mcas_client_test, BatchPutGetErase)
+{
+  PMAJOR("Running BatchPutGetErase...");
+  ASSERT_TRUE(_mcas);
+
+  auto mcas = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(mcas);
+
+  const std::string poolname = Options.pool + "/BatchPutGetErase";
+  auto              pool     = mcas->create_pool(poolname, MB(32));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+
+  static constexpr unsigned COUNT = 1000;
+  std::vector<std::string>  keys, values;
+  for (unsigned i = 0; i < COUNT; i++) {
+    keys.push_back("batch-" + std::to_string(i));
+    values.push_back(Common::random_string(16 + (i % 64)));
+  }
+
+  std::vector<status_t> status;
+  ASSERT_TRUE(mcas->put_batch(pool, keys, values, status) == S_OK);
+  ASSERT_TRUE(status.size() == COUNT);
+  for (auto s : status) ASSERT_TRUE(s == S_OK);
+
+  std::vector<std::string> out_values;
+  ASSERT_TRUE(mcas->get_batch(pool, keys, out_values, status) == S_OK);
+  for (unsigned i = 0; i < COUNT; i++) {
+    ASSERT_TRUE(status[i] == S_OK);
+    ASSERT_TRUE(out_values[i] == values[i]);
+  }
+
+  ASSERT_TRUE(mcas->erase_batch(pool, keys, status) == S_OK);
+  for (auto s : status) ASSERT_TRUE(s == S_OK);
+
+  ASSERT_TRUE(mcas->get_batch(pool, keys, out_values, status) == S_OK);
+  for (auto s : status) ASSERT_TRUE(s == Component::IKVStore::E_KEY_NOT_FOUND);
+
+  mcas->close_pool(pool);
+  mcas->delete_pool(poolname);
+  PLOG("BatchPutGetErase OK!");
+}
+
+TEST_F(mcas_client_test, SegmentedPutAndGetRange)
+{
+  PMAJOR("Running SegmentedPutAndGetRange...");
+  ASSERT_TRUE(_mcas);
+
+  auto mcas = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(mcas);
+
+  const std::string poolname = Options.pool + "/SegmentedPutAndGetRange";
+  auto              pool     = mcas->create_pool(poolname, MB(64));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+
+  /* larger than an IO buffer, and not a multiple of one */
+  const std::string value = Common::random_string(MB(8) + 12345);
+  ASSERT_TRUE(mcas->put(pool, "big", value.data(), value.length()) == S_OK);
+
+  /* read back in slices which straddle segment boundaries */
+  const size_t            SLICE = MB(3) + 7;
+  std::string             out(SLICE, '\0');
+  size_t                  offset = 0;
+  while (offset < value.length()) {
+    size_t len = SLICE;
+    ASSERT_TRUE(mcas->get_range(pool, "big", offset, &out[0], len) == S_OK);
+    ASSERT_TRUE(len == std::min(SLICE, value.length() - offset));
+    ASSERT_TRUE(out.compare(0, len, value, offset, len) == 0);
+    offset += len;
+  }
+
+  size_t len = SLICE;
+  ASSERT_TRUE(mcas->get_range(pool, "big", value.length(), &out[0], len) == S_OK);
+  ASSERT_TRUE(len == 0);
+  len = SLICE;
+  ASSERT_TRUE(mcas->get_range(pool, "big", value.length() + 1, &out[0], len) == E_INVAL);
+
+  mcas->close_pool(pool);
+  mcas->delete_pool(poolname);
+  PLOG("SegmentedPutAndGetRange OK!");
+}
+
+TEST_F(mcas_client_test, SegmentedPutOutOfOrder)
+{
+  PMAJOR("Running SegmentedPutOutOfOrder...");
+  Component::IBase *comp = Component::load_component("libcomponent-mcasclient.so", mcas_client_factory);
+  ASSERT_TRUE(comp);
+  auto f = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
+
+  /* a second session which sends segments last-first, one of them twice */
+  setenv("MCAS_SEGMENT_ORDER", "reverse", 1);
+  auto kv = f->create(Options.debug_level, "dwaddington", Options.addr, Options.device);
+  unsetenv("MCAS_SEGMENT_ORDER");
+  f->release_ref();
+  ASSERT_TRUE(kv);
+
+  const std::string poolname = Options.pool + "/SegmentedPutOutOfOrder";
+  auto              pool     = kv->create_pool(poolname, MB(64));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+
+  const std::string value = Common::random_string(MB(8) + 12345);
+  ASSERT_TRUE(kv->put(pool, "big", value.data(), value.length()) == S_OK);
+
+  void * pv     = nullptr;
+  size_t pv_len = 0;
+  ASSERT_TRUE(kv->get(pool, "big", pv, pv_len) == S_OK);
+  ASSERT_TRUE(pv_len == value.length());
+  ASSERT_TRUE(memcmp(pv, value.data(), pv_len) == 0);
+  kv->free_memory(pv);
+
+  /* no partial put is left behind to block the key */
+  const std::string value2 = Common::random_string(MB(5));
+  ASSERT_TRUE(kv->put(pool, "big", value2.data(), value2.length()) == S_OK);
+
+  kv->close_pool(pool);
+  kv->delete_pool(poolname);
+  kv->release_ref();
+  PLOG("SegmentedPutOutOfOrder OK!");
+}
+
+TEST_F(mcas_client_test, AsyncPipelinedGet)
+{
+  PMAJOR("Running AsyncPipelinedGet...");
+  ASSERT_TRUE(_mcas);
+
+  auto mcas = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(mcas);
+
+  const std::string poolname = Options.pool + "/AsyncPipelinedGet";
+  auto              pool     = mcas->create_pool(poolname, MB(32));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+
+  static constexpr unsigned COUNT  = 10000;
+  static constexpr unsigned WINDOW = 16;
+  std::vector<std::string>  keys, values;
+  for (unsigned i = 0; i < COUNT; i++) {
+    keys.push_back("async-" + std::to_string(i));
+    values.push_back(Common::random_string(16 + (i % 1024)));
+  }
+
+  std::vector<status_t> status;
+  ASSERT_TRUE(mcas->put_batch(pool, keys, values, status) == S_OK);
+
+  /* keep WINDOW gets in flight; each slot is retired before reuse */
+  struct slot_t {
+    Component::IMCAS::async_handle_t handle = Component::IMCAS::ASYNC_HANDLE_INIT;
+    void *                           value  = nullptr;
+    size_t                           len    = 0;
+    unsigned                         index  = 0;
+  } slots[WINDOW];
+
+  unsigned issued = 0, retired = 0;
+  auto     start  = std::chrono::high_resolution_clock::now();
+  while (retired < COUNT) {
+    for (auto &slot : slots) {
+      if (slot.handle) {
+        auto rc = mcas->check_async_completion(slot.handle);
+        if (rc == E_BUSY) continue;
+        ASSERT_TRUE(rc == S_OK);
+        ASSERT_TRUE(std::string(static_cast<char *>(slot.value), slot.len) == values[slot.index]);
+        mcas->free_memory(slot.value);
+        slot.handle = nullptr;
+        retired++;
+      }
+      if (issued < COUNT) {
+        slot.index = issued;
+        ASSERT_TRUE(mcas->async_get(pool, keys[issued], slot.value, slot.len, slot.handle) == S_OK);
+        issued++;
+      }
+    }
+  }
+  auto secs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+  PINF("AsyncPipelinedGet: %.0f gets/sec (window %u)", double(COUNT) / secs, WINDOW);
+
+  /* missing key completes with an error rather than a value */
+  Component::IMCAS::async_handle_t handle = Component::IMCAS::ASYNC_HANDLE_INIT;
+  void *                           value  = nullptr;
+  size_t                           len    = 0;
+  ASSERT_TRUE(mcas->async_get(pool, "no-such-key", value, len, handle) == S_OK);
+  status_t rc;
+  while ((rc = mcas->check_async_completion(handle)) == E_BUSY)
+    ;
+  ASSERT_TRUE(rc == Component::IKVStore::E_KEY_NOT_FOUND);
+
+  mcas->close_pool(pool);
+  mcas->delete_pool(poolname);
+  PLOG("AsyncPipelinedGet OK!");
+}
+
+TEST_F(mcas_client_test, AsyncPollCompletions)
+{
+  PMAJOR("Running AsyncPollCompletions...");
+  ASSERT_TRUE(_mcas);
+
+  auto mcas = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(mcas);
+
+  const std::string poolname = Options.pool + "/AsyncPollCompletions";
+  auto              pool     = mcas->create_pool(poolname, MB(32));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+
+  static constexpr unsigned COUNT = 10000;
+  static constexpr size_t   BATCH = 16;
+  std::vector<std::string>  keys, values;
+  for (unsigned i = 0; i < COUNT; i++) {
+    keys.push_back("poll-" + std::to_string(i));
+    values.push_back(Common::random_string(32));
+  }
+
+  /* submit until the window is full, then drain whatever has finished */
+  Component::IMCAS::async_handle_t handles[BATCH];
+  status_t                         status[BATCH];
+  unsigned                         issued = 0, retired = 0;
+  auto                             start  = std::chrono::high_resolution_clock::now();
+  while (retired < COUNT) {
+    while (issued < COUNT) {
+      Component::IMCAS::async_handle_t handle;
+      auto rc = mcas->async_put(pool, keys[issued], values[issued].data(), values[issued].length(), handle);
+      if (rc == E_BUSY) break;
+      ASSERT_TRUE(rc == S_OK);
+      issued++;
+    }
+    auto n = mcas->poll_completions(handles, status, BATCH);
+    for (size_t i = 0; i < n; i++) ASSERT_TRUE(status[i] == S_OK);
+    retired += unsigned(n);
+  }
+  auto secs = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+  PINF("AsyncPollCompletions: %.0f puts/sec", double(COUNT) / secs);
+  ASSERT_TRUE(mcas->poll_completions(handles, status, BATCH) == 0);
+
+  std::vector<std::string> out_values;
+  std::vector<status_t>    out_status;
+  ASSERT_TRUE(mcas->get_batch(pool, keys, out_values, out_status) == S_OK);
+  for (unsigned i = 0; i < COUNT; i++) ASSERT_TRUE(out_values[i] == values[i]);
+
+  mcas->close_pool(pool);
+  mcas->delete_pool(poolname);
+  PLOG("AsyncPollCompletions OK!");
+}
+
+TEST_F(mcas_client_test, RangeScan)
+{
+  PMAJOR("Running RangeScan...");
+  ASSERT_TRUE(_mcas);
+
+  auto mcas = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(mcas);
+
+  const std::string poolname = Options.pool + "/RangeScan";
+  auto              pool     = mcas->create_pool(poolname, MB(64));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+  ASSERT_TRUE(mcas->configure_pool(pool, "AddIndex::VolatileTree") == S_OK);
+
+  /* enough keys to need several response pages */
+  static constexpr unsigned COUNT = 20000;
+  std::vector<std::string>  keys, values;
+  for (unsigned i = 0; i < COUNT; i++) {
+    char key[32];
+    snprintf(key, sizeof key, "scan-%06u", i);
+    keys.push_back(key);
+    values.push_back(Common::random_string(32));
+  }
+  std::vector<status_t> status;
+  ASSERT_TRUE(mcas->put_batch(pool, keys, values, status) == S_OK);
+
+  std::vector<std::string> out_keys, out_values;
+  std::vector<status_t>    out_status;
+  ASSERT_TRUE(mcas->scan(pool, "", "", 0, false, out_keys, out_values, out_status) == S_OK);
+  ASSERT_TRUE(out_keys == keys);
+  ASSERT_TRUE(out_values.empty());
+  ASSERT_TRUE(out_status.empty());
+
+  ASSERT_TRUE(mcas->scan(pool, keys[100], keys[200], 0, true, out_keys, out_values, out_status) == S_OK);
+  ASSERT_TRUE(out_keys.size() == 100);
+  ASSERT_TRUE(out_status.size() == 100);
+  for (unsigned i = 0; i < 100; i++) {
+    ASSERT_TRUE(out_keys[i] == keys[100 + i]);
+    ASSERT_TRUE(out_values[i] == values[100 + i]);
+    ASSERT_TRUE(out_status[i] == S_OK);
+  }
+
+  /* a scan cut short by its limit says so, and resumes from its last key */
+  ASSERT_TRUE(mcas->scan(pool, keys[COUNT - 10], "", 5, false, out_keys, out_values, out_status) == S_MORE);
+  ASSERT_TRUE(out_keys.size() == 5);
+  ASSERT_TRUE(out_keys.back() == keys[COUNT - 6]);
+  ASSERT_TRUE(mcas->scan(pool, out_keys.back(), "", 0, false, out_keys, out_values, out_status) == S_OK);
+  ASSERT_TRUE(out_keys.size() == 6);
+  ASSERT_TRUE(out_keys.front() == keys[COUNT - 6]);
+
+  /* a limit which ends with the range does not */
+  ASSERT_TRUE(mcas->scan(pool, keys[COUNT - 10], "", 10, false, out_keys, out_values, out_status) == S_OK);
+  ASSERT_TRUE(out_keys.size() == 10);
+
+  /* erased keys leave the range */
+  std::vector<std::string> erase_keys(keys.begin() + 100, keys.begin() + 150);
+  ASSERT_TRUE(mcas->erase_batch(pool, erase_keys, out_status) == S_OK);
+  ASSERT_TRUE(mcas->scan(pool, keys[100], keys[200], 0, true, out_keys, out_values, out_status) == S_OK);
+  ASSERT_TRUE(out_keys.size() == 50);
+  ASSERT_TRUE(out_keys.front() == keys[150]);
+
+  mcas->close_pool(pool);
+  mcas->delete_pool(poolname);
+  PLOG("RangeScan OK!");
+}
+
+TEST_F(mcas_client_test, LeasedPoolWrites)
+{
+  PMAJOR("Running LeasedPoolWrites...");
+  ASSERT_TRUE(_mcas);
+
+  auto writer = static_cast<Component::IMCAS *>(_mcas->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(writer);
+
+  const std::string poolname = Options.pool + "/LeasedPoolWrites";
+  auto              pool     = writer->create_pool(poolname, MB(8));
+  ASSERT_FALSE(pool == Component::IKVStore::POOL_ERROR);
+  const std::string value = Common::random_string(64);
+  ASSERT_TRUE(writer->put(pool, "leased", value.data(), value.length()) == S_OK);
+
+  /* a second session, reading by lease, sees the first session's writes */
+  Component::IBase *comp = Component::load_component("libcomponent-mcasclient.so", mcas_client_factory);
+  ASSERT_TRUE(comp);
+  auto f  = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
+  auto kv = f->create(Options.debug_level, "dwaddington", Options.addr, Options.device);
+  f->release_ref();
+  ASSERT_TRUE(kv);
+  auto reader = static_cast<Component::IMCAS *>(kv->query_interface(Component::IMCAS::iid()));
+  ASSERT_TRUE(reader);
+  auto rpool = reader->open_pool(poolname);
+  ASSERT_FALSE(rpool == Component::IKVStore::POOL_ERROR);
+  ASSERT_TRUE(reader->configure_pool(rpool, "Lease::on") == S_OK);
+
+  auto check = [&](const std::string &expected) {
+    void * pv     = nullptr;
+    size_t pv_len = 0;
+    ASSERT_TRUE(reader->get(rpool, "leased", pv, pv_len) == S_OK);
+    ASSERT_TRUE(pv_len == expected.length());
+    ASSERT_TRUE(memcmp(pv, expected.data(), pv_len) == 0);
+    reader->free_memory(pv);
+  };
+  check(value);
+
+  /* overwritten in place, then replaced by a longer value */
+  const std::string value2 = Common::random_string(64);
+  ASSERT_TRUE(writer->put(pool, "leased", value2.data(), value2.length()) == S_OK);
+  check(value2);
+  const std::string value3 = Common::random_string(KiB(2));
+  ASSERT_TRUE(writer->put(pool, "leased", value3.data(), value3.length()) == S_OK);
+  check(value3);
+
+  ASSERT_TRUE(writer->erase(pool, "leased") == S_OK);
+  void * pv     = nullptr;
+  size_t pv_len = 0;
+  ASSERT_FALSE(reader->get(rpool, "leased", pv, pv_len) == S_OK);
+
+  ASSERT_TRUE(reader->configure_pool(rpool, "Lease::off") == S_OK);
+  reader->close_pool(rpool);
+  kv->release_ref();
+  writer->close_pool(pool);
+  writer->delete_pool(poolname);
+  PLOG("LeasedPoolWrites OK!");
+}
+
 #ifdef TEST_SCALE_IOPS
 
 struct record_t {
@@ -0,0 +1,434 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#include "btree_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Component;
+using namespace std;
+using Common::RWLock_guard;
+
+BTree_index::inner_t::~inner_t()
+{
+  for (auto c : children) delete c;
+}
+
+void BTree_index::cursor_t::settle()
+{
+  while (leaf && slot >= leaf->keys.size()) {
+    leaf = leaf->next;
+    slot = 0;
+  }
+}
+
+BTree_index::BTree_index(const std::string& owner, const std::string& name) : BTree_index{}
+{
+  (void) owner;  // unused
+  (void) name;   // unused
+}
+
+BTree_index::BTree_index() : _lock{}, _root(nullptr), _head(nullptr), _regex_cache{} { reset_tree(); }
+
+BTree_index::~BTree_index() { delete _root; }
+
+void BTree_index::reset_tree()
+{
+  delete _root;
+  auto leaf = new leaf_t();
+  leaf->keys.reserve(LEAF_CAPACITY + 1);
+  _root = _head = leaf;
+}
+
+size_t BTree_index::child_slot(const inner_t* inner, const std::string& key)
+{
+  return static_cast<size_t>(upper_bound(inner->seps.begin(), inner->seps.end(), key) - inner->seps.begin());
+}
+
+/* Returns true if the key was added.  On overflow the node is split and
+   the new right sibling returned for the parent to adopt. */
+bool BTree_index::insert(node_t* node, const std::string& key, split_t& split)
+{
+  if (node->leaf) {
+    auto leaf = static_cast<leaf_t*>(node);
+    auto it   = std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
+    if (it != leaf->keys.end() && *it == key) return false;
+
+    leaf->keys.insert(it, key);
+    leaf->count++;
+
+    if (leaf->keys.size() > LEAF_CAPACITY) {
+      auto right = new leaf_t();
+      auto mid   = leaf->keys.begin() + static_cast<ptrdiff_t>(leaf->keys.size() / 2);
+      right->keys.reserve(LEAF_CAPACITY + 1);
+      right->keys.assign(make_move_iterator(mid), make_move_iterator(leaf->keys.end()));
+      leaf->keys.erase(mid, leaf->keys.end());
+      leaf->count  = leaf->keys.size();
+      right->count = right->keys.size();
+
+      right->prev = leaf;
+      right->next = leaf->next;
+      if (leaf->next) leaf->next->prev = right;
+      leaf->next = right;
+
+      split.sep   = right->keys.front();
+      split.right = right;
+    }
+    return true;
+  }
+
+  auto    inner = static_cast<inner_t*>(node);
+  auto    slot  = child_slot(inner, key);
+  split_t child_split;
+  if (!insert(inner->children[slot], key, child_split)) return false;
+  inner->count++;
+
+  if (child_split.right) {
+    inner->seps.insert(inner->seps.begin() + static_cast<ptrdiff_t>(slot), std::move(child_split.sep));
+    inner->children.insert(inner->children.begin() + static_cast<ptrdiff_t>(slot) + 1, child_split.right);
+
+    if (inner->children.size() > INNER_CAPACITY) {
+      auto right = new inner_t();
+      auto mid   = static_cast<ptrdiff_t>(inner->children.size() / 2);
+
+      right->children.assign(inner->children.begin() + mid, inner->children.end());
+      inner->children.erase(inner->children.begin() + mid, inner->children.end());
+
+      split.sep = std::move(inner->seps[static_cast<size_t>(mid - 1)]);
+      right->seps.assign(make_move_iterator(inner->seps.begin() + mid), make_move_iterator(inner->seps.end()));
+      inner->seps.erase(inner->seps.begin() + mid - 1, inner->seps.end());
+
+      for (auto c : right->children) right->count += c->count;
+      inner->count -= right->count;
+      split.right = right;
+    }
+  }
+  return true;
+}
+
+void BTree_index::insert(const string& key)
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+
+  split_t split;
+  insert(_root, key, split);
+
+  if (split.right) {
+    auto root   = new inner_t();
+    root->count = _root->count + split.right->count;
+    root->seps.push_back(std::move(split.sep));
+    root->children.push_back(_root);
+    root->children.push_back(split.right);
+    _root = root;
+  }
+}
+
+void BTree_index::unlink(leaf_t* leaf)
+{
+  if (leaf->prev)
+    leaf->prev->next = leaf->next;
+  else
+    _head = leaf->next;
+  if (leaf->next) leaf->next->prev = leaf->prev;
+}
+
+/* Returns true if the key was removed.  Nodes are not merged; a node
+   left empty is dropped by its parent, which keeps erase cheap and is
+   enough to bound the tree by the live key count. */
+bool BTree_index::erase(node_t* node, const std::string& key, bool& out_empty)
+{
+  if (node->leaf) {
+    auto leaf = static_cast<leaf_t*>(node);
+    auto it   = std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key);
+    if (it == leaf->keys.end() || *it != key) return false;
+
+    leaf->keys.erase(it);
+    leaf->count--;
+    out_empty = leaf->keys.empty();
+    return true;
+  }
+
+  auto inner = static_cast<inner_t*>(node);
+  auto slot  = child_slot(inner, key);
+  auto child = inner->children[slot];
+  bool child_empty = false;
+  if (!erase(child, key, child_empty)) return false;
+  inner->count--;
+
+  if (child_empty) {
+    if (child->leaf) unlink(static_cast<leaf_t*>(child));
+    delete child;
+
+    inner->children.erase(inner->children.begin() + static_cast<ptrdiff_t>(slot));
+    if (!inner->seps.empty()) inner->seps.erase(inner->seps.begin() + static_cast<ptrdiff_t>(slot > 0 ? slot - 1 : 0));
+  }
+  out_empty = inner->children.empty();
+  return true;
+}
+
+void BTree_index::erase(const std::string& key)
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+
+  bool empty = false;
+  erase(_root, key, empty);
+
+  if (_root->count == 0) {
+    if (!_root->leaf) reset_tree();
+    return;
+  }
+
+  /* collapse single-child roots */
+  while (!_root->leaf && static_cast<inner_t*>(_root)->children.size() == 1) {
+    auto old = static_cast<inner_t*>(_root);
+    _root    = old->children.front();
+    old->children.clear();
+    delete old;
+  }
+}
+
+void BTree_index::clear()
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  reset_tree();
+}
+
+status_t BTree_index::bulk_load(std::vector<std::string>&& keys)
+{
+  sort(keys.begin(), keys.end());
+  keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  if (keys.empty()) {
+    reset_tree();
+    return S_OK;
+  }
+
+  delete _root;
+  _root = _head = nullptr;
+
+  /* build the leaf chain, then each inner level bottom up */
+  vector<node_t*>     level;
+  vector<std::string> firsts;
+  leaf_t*             prev = nullptr;
+
+  for (size_t i = 0; i < keys.size(); i += LEAF_FILL) {
+    auto leaf = new leaf_t();
+    auto end  = std::min(keys.size(), i + LEAF_FILL);
+    leaf->keys.reserve(LEAF_CAPACITY + 1);
+    leaf->keys.assign(make_move_iterator(keys.begin() + static_cast<ptrdiff_t>(i)),
+                      make_move_iterator(keys.begin() + static_cast<ptrdiff_t>(end)));
+    leaf->count = leaf->keys.size();
+    leaf->prev  = prev;
+    if (prev)
+      prev->next = leaf;
+    else
+      _head = leaf;
+    prev = leaf;
+
+    level.push_back(leaf);
+    firsts.push_back(leaf->keys.front());
+  }
+
+  while (level.size() > 1) {
+    vector<node_t*>     up;
+    vector<std::string> up_firsts;
+
+    for (size_t i = 0; i < level.size(); i += INNER_FILL) {
+      auto inner = new inner_t();
+      auto end   = std::min(level.size(), i + INNER_FILL);
+      for (size_t j = i; j < end; j++) {
+        if (j > i) inner->seps.push_back(std::move(firsts[j]));
+        inner->children.push_back(level[j]);
+        inner->count += level[j]->count;
+      }
+      up.push_back(inner);
+      up_firsts.push_back(std::move(firsts[i]));
+    }
+    level.swap(up);
+    firsts.swap(up_firsts);
+  }
+
+  _root = level.front();
+  keys.clear();
+  return S_OK;
+}
+
+BTree_index::cursor_t BTree_index::seek(offset_t position) const
+{
+  if (position >= _root->count) return cursor_t{nullptr, 0};
+
+  const node_t* node = _root;
+  while (!node->leaf) {
+    auto inner = static_cast<const inner_t*>(node);
+    for (auto c : inner->children) {
+      if (position < c->count) {
+        node = c;
+        break;
+      }
+      position -= c->count;
+    }
+  }
+  return cursor_t{static_cast<const leaf_t*>(node), position};
+}
+
+BTree_index::cursor_t BTree_index::lower_bound(const std::string& key) const
+{
+  const node_t* node = _root;
+  while (!node->leaf) {
+    auto inner = static_cast<const inner_t*>(node);
+    node       = inner->children[child_slot(inner, key)];
+  }
+
+  auto     leaf = static_cast<const leaf_t*>(node);
+  cursor_t c{leaf, static_cast<size_t>(std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key) - leaf->keys.begin())};
+  c.settle();
+  return c;
+}
+
+/* number of keys less than 'key' */
+BTree_index::offset_t BTree_index::order_of_key(const std::string& key) const
+{
+  offset_t      pos  = 0;
+  const node_t* node = _root;
+  while (!node->leaf) {
+    auto inner = static_cast<const inner_t*>(node);
+    auto slot  = child_slot(inner, key);
+    for (size_t i = 0; i < slot; i++) pos += inner->children[i]->count;
+    node = inner->children[slot];
+  }
+
+  auto leaf = static_cast<const leaf_t*>(node);
+  return pos + static_cast<offset_t>(std::lower_bound(leaf->keys.begin(), leaf->keys.end(), key) - leaf->keys.begin());
+}
+
+string BTree_index::get(offset_t position) const
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  auto c = seek(position);
+  if (!c.valid()) {
+    throw out_of_range("Position out of range");
+  }
+  return c.key();
+}
+
+size_t BTree_index::count() const
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+  return _root->count;
+}
+
+status_t BTree_index::find(const std::string& key_expression,
+                           offset_t           begin_position,
+                           find_t             find_type,
+                           offset_t&          out_matched_pos,
+                           std::string&       out_matched_key,
+                           unsigned           max_comparisons)
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  if (begin_position >= _root->count) {
+    return E_FAIL;
+  }
+
+  unsigned attempts = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wswitch"  // enumeration value ‘FIND_TYPE_NONE’ not handled in switch
+  switch (find_type) {
+    case FIND_TYPE_REGEX: {
+      const auto expr = _regex_cache.get(key_expression);
+
+      /* all matches lie in the range of keys starting with the prefix */
+      offset_t pos = begin_position;
+      if (!expr->prefix.empty()) pos = std::max<offset_t>(pos, order_of_key(expr->prefix));
+
+      for (auto c = seek(pos); c.valid(); c.next(), ++pos) {
+        const string& key = c.key();
+        if (!expr->in_prefix_range(key)) break;
+
+        if (expr->match(key)) {
+          out_matched_pos = pos;
+          out_matched_key = key;
+          return S_OK;
+        }
+        else if (++attempts > max_comparisons) {
+          out_matched_pos = pos;
+          return E_MAX_REACHED;
+        }
+      }
+    } break;
+    case FIND_TYPE_EXACT: {
+      offset_t pos = order_of_key(key_expression);
+      auto     c   = seek(pos);
+      if (!c.valid() || c.key() != key_expression || pos < begin_position) break;
+      out_matched_pos = pos;
+      out_matched_key = c.key();
+      return S_OK;
+    }
+    case FIND_TYPE_PREFIX: {
+      offset_t pos = begin_position;
+      for (auto c = seek(pos); c.valid(); c.next(), ++pos) {
+        if (c.key().find(key_expression) != string::npos) {
+          out_matched_pos = pos;
+          out_matched_key = c.key();
+          return S_OK;
+        }
+        else if (++attempts > max_comparisons) {
+          out_matched_pos = pos;
+          return E_MAX_REACHED;
+        }
+      }
+    } break;
+    case FIND_TYPE_NEXT:
+      out_matched_key = seek(begin_position).key();
+      out_matched_pos = begin_position;
+      return S_OK;
+      break;
+  }
+#pragma GCC diagnostic pop
+
+  return E_FAIL;
+}
+
+status_t BTree_index::scan(const std::string&                          start_key,
+                           const std::string&                          end_key,
+                           std::function<bool(const std::string& key)> callback)
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  cursor_t c{_head, 0};
+  if (start_key.empty())
+    c.settle();
+  else
+    c = lower_bound(start_key);
+
+  for (; c.valid(); c.next()) {
+    if (!end_key.empty() && c.key() >= end_key) break;
+    if (!callback(c.key())) break;
+  }
+  return S_OK;
+}
+
+/**
+ * Factory entry point
+ *
+ */
+extern "C" void* factory_createInstance(Component::uuid_t component_id)
+{
+  if (component_id == BTree_index_factory::component_id()) {
+    return static_cast<void*>(new BTree_index_factory());
+  }
+  else
+    return NULL;
+}
@@ -0,0 +1,174 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __BTREE_INDEX_COMPONENT_H__
+#define __BTREE_INDEX_COMPONENT_H__
+
+#include <api/kvindex_itf.h>
+#include <common/rwlock.h>
+#include <index/common/find_expression.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Volatile B+-tree index.  Keys live in sorted leaf arrays chained in
+ * order, so range scans and position walks touch contiguous memory and
+ * inserts shift within one small node rather than rebalancing a tree of
+ * single-key nodes.  Inner nodes carry subtree counts so positions
+ * resolve in O(log n).  Readers (get, find, scan, count) run
+ * concurrently; insert, erase and bulk_load are exclusive.
+ */
+class BTree_index : public Component::IKVIndex {
+ private:
+  static constexpr size_t LEAF_CAPACITY  = 64;
+  static constexpr size_t INNER_CAPACITY = 64;
+
+  /* bulk load leaves room for later inserts */
+  static constexpr size_t LEAF_FILL  = (LEAF_CAPACITY * 3) / 4;
+  static constexpr size_t INNER_FILL = (INNER_CAPACITY * 3) / 4;
+
+  struct node_t {
+    explicit node_t(bool is_leaf) : leaf(is_leaf), count(0) {}
+    virtual ~node_t() {}
+
+    const bool leaf;
+    size_t     count; /*< keys in subtree */
+  };
+
+  struct leaf_t : public node_t {
+    leaf_t() : node_t(true), keys{}, prev(nullptr), next(nullptr) {}
+    leaf_t(const leaf_t&) = delete;
+    leaf_t& operator=(const leaf_t&) = delete;
+
+    std::vector<std::string> keys;
+    leaf_t*                  prev;
+    leaf_t*                  next;
+  };
+
+  /* seps[i] divides children[i] (keys < seps[i]) from children[i+1] */
+  struct inner_t : public node_t {
+    inner_t() : node_t(false), seps{}, children{} {}
+    ~inner_t() override;
+    inner_t(const inner_t&) = delete;
+    inner_t& operator=(const inner_t&) = delete;
+
+    std::vector<std::string> seps;
+    std::vector<node_t*>     children;
+  };
+
+  struct split_t {
+    split_t() : sep{}, right(nullptr) {}
+    split_t(const split_t&) = delete;
+    split_t& operator=(const split_t&) = delete;
+
+    std::string sep;
+    node_t*     right;
+  };
+
+  /* position of a key in the leaf chain */
+  struct cursor_t {
+    const leaf_t* leaf;
+    size_t        slot;
+
+    bool               valid() const { return leaf != nullptr; }
+    const std::string& key() const { return leaf->keys[slot]; }
+    void               next()
+    {
+      slot++;
+      settle();
+    }
+    void settle(); /*< move past the end of a leaf */
+  };
+
+ public:
+  BTree_index(const std::string& owner, const std::string& name);
+  BTree_index();
+  BTree_index(const BTree_index&) = delete;
+  BTree_index& operator=(const BTree_index&) = delete;
+  virtual ~BTree_index();
+
+  DECLARE_VERSION(0.1f);
+  DECLARE_COMPONENT_UUID(0x8a120985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2a);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex::iid()) {
+      return static_cast<Component::IKVIndex*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+ public:
+  virtual void        insert(const std::string& key) override;
+  virtual void        erase(const std::string& key) override;
+  virtual void        clear() override;
+  virtual std::string get(offset_t position) const override;
+  virtual size_t      count() const override;
+  virtual status_t    find(const std::string& key_expression,
+                           offset_t           begin_position,
+                           find_t             find_type,
+                           offset_t&          out_end_position,
+                           std::string&       out_matched_key,
+                           unsigned           max_comparisons = 0) override;
+  virtual status_t    scan(const std::string&                          start_key,
+                           const std::string&                          end_key,
+                           std::function<bool(const std::string& key)> callback) override;
+  virtual status_t    bulk_load(std::vector<std::string>&& keys) override;
+
+ private:
+  bool insert(node_t* node, const std::string& key, split_t& split);
+  bool erase(node_t* node, const std::string& key, bool& out_empty);
+  void unlink(leaf_t* leaf);
+  void reset_tree();
+
+  cursor_t seek(offset_t position) const;
+  cursor_t lower_bound(const std::string& key) const;
+  offset_t order_of_key(const std::string& key) const;
+
+  static size_t child_slot(const inner_t* inner, const std::string& key);
+
+  mutable Common::RWLock       _lock;
+  node_t*                      _root;
+  leaf_t*                      _head; /*< first leaf in key order */
+  Index::Find_expression_cache _regex_cache;
+};
+
+class BTree_index_factory : public Component::IKVIndex_factory {
+ public:
+  DECLARE_VERSION(0.1f);
+  DECLARE_COMPONENT_UUID(0xfac20985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2a);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex_factory::iid()) {
+      return static_cast<Component::IKVIndex_factory*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+  virtual Component::IKVIndex* create(const std::string& owner, const std::string& name) override
+  {
+    Component::IKVIndex* obj = static_cast<Component::IKVIndex*>(new BTree_index(owner, name));
+    assert(obj);
+    obj->add_ref();
+    return obj;
+  }
+};
+#endif
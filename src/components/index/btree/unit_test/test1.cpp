@@ -0,0 +1,210 @@
+/* note: we do not include component source, only the API definition */
+#include <api/components.h>
+#include <api/kvindex_itf.h>
+#include <common/str_utils.h>
+#include <common/utils.h>
+#include <gtest/gtest.h>
+#include <ctime>
+#include <set>
+#include <thread>
+
+#define COUNT 1000000
+#define LENGTH 16
+
+using namespace Component;
+using namespace Common;
+using namespace std;
+
+namespace
+{
+// The fixture for testing class Foo.
+class KVIndex_test : public ::testing::Test {
+ protected:
+  // Objects declared here can be used by all tests in the test case
+  static Component::IKVIndex *_kvindex;
+};
+
+Component::IKVIndex *KVIndex_test::_kvindex;
+
+TEST_F(KVIndex_test, Instantiate)
+{
+  /* create object instance through factory */
+  Component::IBase *comp = Component::load_component("libcomponent-indexbtree.so", Component::btreeindex_factory);
+
+  ASSERT_TRUE(comp);
+  auto fact = static_cast<IKVIndex_factory *>(comp->query_interface(IKVIndex_factory::iid()));
+
+  _kvindex = fact->create("owner", "name");
+
+  fact->release_ref();
+}
+
+TEST_F(KVIndex_test, InsertPerf)
+{
+  string *keys = new string[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    keys[i] = random_string(LENGTH);
+  }
+  clock_t start = clock();
+  for (int i = 0; i < COUNT; i++) {
+    _kvindex->insert(keys[i]);
+  }
+  delete[] keys;
+  double duration = double(clock() - start) / double(CLOCKS_PER_SEC);
+  PINF("Time sec: %lf", duration);
+  PINF("Size: %ld", _kvindex->count());
+}
+
+TEST_F(KVIndex_test, BulkLoadPerf)
+{
+  vector<string> keys;
+  for (int i = 0; i < COUNT; i++) {
+    keys.push_back(random_string(LENGTH));
+  }
+  clock_t start = clock();
+  ASSERT_EQ(S_OK, _kvindex->bulk_load(std::move(keys)));
+  double duration = double(clock() - start) / double(CLOCKS_PER_SEC);
+  PINF("Time sec: %lf", duration);
+  PINF("Size: %ld", _kvindex->count());
+}
+
+/* random inserts and erases checked against std::set */
+TEST_F(KVIndex_test, Consistency)
+{
+  _kvindex->clear();
+  set<string> model;
+  srand(1);
+  for (int i = 0; i < 200000; i++) {
+    char key[16];
+    snprintf(key, sizeof key, "k%06d", rand() % 20000);
+    if (rand() % 3) {
+      _kvindex->insert(key);
+      model.insert(key);
+    }
+    else {
+      _kvindex->erase(key);
+      model.erase(key);
+    }
+  }
+  ASSERT_EQ(model.size(), _kvindex->count());
+
+  IKVIndex::offset_t pos = 0;
+  for (auto &k : model) {
+    ASSERT_EQ(k, _kvindex->get(pos++));
+  }
+  ASSERT_THROW(_kvindex->get(pos), std::out_of_range);
+
+  /* erase everything */
+  for (auto &k : model) _kvindex->erase(k);
+  ASSERT_EQ(0UL, _kvindex->count());
+  _kvindex->insert("again");
+  ASSERT_EQ("again", _kvindex->get(0));
+}
+
+TEST_F(KVIndex_test, BulkLoad)
+{
+  vector<string> keys;
+  for (int i = 999; i >= 0; i--) {
+    char key[16];
+    snprintf(key, sizeof key, "key%03d", i);
+    keys.push_back(key);
+    keys.push_back(key); /* duplicates are dropped */
+  }
+  ASSERT_EQ(S_OK, _kvindex->bulk_load(std::move(keys)));
+  ASSERT_EQ(1000UL, _kvindex->count());
+  ASSERT_EQ("key000", _kvindex->get(0));
+  ASSERT_EQ("key500", _kvindex->get(500));
+  ASSERT_EQ("key999", _kvindex->get(999));
+
+  /* tree stays usable for inserts after a bulk load */
+  _kvindex->insert("key5000");
+  ASSERT_EQ("key5000", _kvindex->get(501));
+  _kvindex->erase("key5000");
+  ASSERT_EQ("key501", _kvindex->get(501));
+}
+
+TEST_F(KVIndex_test, Scan)
+{
+  _kvindex->clear();
+  for (int i = 0; i < 100; i++) {
+    char key[16];
+    snprintf(key, sizeof key, "key%03d", i);
+    _kvindex->insert(key);
+  }
+
+  vector<string> keys;
+  ASSERT_EQ(S_OK, _kvindex->scan("key010", "key020", [&keys](const string &k) {
+    keys.push_back(k);
+    return true;
+  }));
+  ASSERT_EQ(10UL, keys.size());
+  ASSERT_EQ("key010", keys.front());
+  ASSERT_EQ("key019", keys.back());
+
+  /* open ended range with early stop */
+  keys.clear();
+  ASSERT_EQ(S_OK, _kvindex->scan("key095", "", [&keys](const string &k) {
+    keys.push_back(k);
+    return keys.size() < 3;
+  }));
+  ASSERT_EQ(3UL, keys.size());
+  ASSERT_EQ("key097", keys.back());
+}
+
+TEST_F(KVIndex_test, Find)
+{
+  /* reuses the key000..key099 set from Scan */
+  _kvindex->insert("apple");
+  _kvindex->insert("zebra");
+
+  IKVIndex::offset_t pos;
+  string             key;
+
+  ASSERT_EQ(S_OK, _kvindex->find("key050", 0, IKVIndex::FIND_TYPE_EXACT, pos, key));
+  ASSERT_EQ(key, _kvindex->get(pos));
+  ASSERT_EQ(E_FAIL, _kvindex->find("key050", pos + 1, IKVIndex::FIND_TYPE_EXACT, pos, key));
+
+  ASSERT_EQ(S_OK, _kvindex->find("key0[5-9]7", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key057", key);
+  ASSERT_EQ(S_OK, _kvindex->find("key0[5-9]7", pos + 1, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key067", key);
+
+  ASSERT_EQ(S_OK, _kvindex->find("ebr", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key));
+  ASSERT_EQ("zebra", key);
+
+  ASSERT_EQ(S_OK, _kvindex->find("", 1, IKVIndex::FIND_TYPE_NEXT, pos, key));
+  ASSERT_EQ("key000", key);
+}
+
+TEST_F(KVIndex_test, ConcurrentReaders)
+{
+  const auto         n = _kvindex->count();
+  vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([n]() {
+      for (unsigned i = 0; i < 100000; i++) {
+        auto k = _kvindex->get(i % n);
+        ASSERT_FALSE(k.empty());
+      }
+    });
+  }
+  /* writer churns keys outside the readers' position range */
+  for (int i = 0; i < 10000; i++) {
+    _kvindex->insert("zz" + std::to_string(i));
+    _kvindex->erase("zz" + std::to_string(i));
+  }
+  for (auto &r : readers) r.join();
+  ASSERT_EQ(n, _kvindex->count());
+}
+
+TEST_F(KVIndex_test, Release) { _kvindex->release_ref(); }
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
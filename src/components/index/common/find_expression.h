@@ -0,0 +1,144 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#ifndef __INDEX_FIND_EXPRESSION_H__
+#define __INDEX_FIND_EXPRESSION_H__
+
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_map>
+
+namespace Index
+{
+/**
+ * Compiled FIND_TYPE_REGEX expression, shared by the ordered index
+ * components.  The literal prefix every match must start with lets an
+ * ordered index seek rather than scan; pure literal and "literal.*"
+ * patterns are matched without the regex engine.
+ */
+struct Find_expression {
+  Find_expression(const std::string& pattern) : re{}, prefix{}, literal(false), prefix_only(false)
+  {
+    analyze(pattern);
+    if (!literal && !prefix_only) re.assign(pattern, std::regex::ECMAScript | std::regex::optimize);
+  }
+
+  /* caller guarantees key is within the prefix range */
+  bool match(const std::string& key) const
+  {
+    return literal ? key.size() == prefix.size() : (prefix_only || std::regex_match(key, re));
+  }
+
+  bool in_prefix_range(const std::string& key) const { return key.compare(0, prefix.size(), prefix) == 0; }
+
+  std::regex  re;
+  std::string prefix;      /*< every match starts with this */
+  bool        literal;     /*< pattern is exactly 'prefix' */
+  bool        prefix_only; /*< pattern is 'prefix' followed by .* */
+
+ private:
+  /* Conservative: anything not understood ends the prefix */
+  void analyze(const std::string& pattern)
+  {
+    static const std::string meta = "\\^$.|?*+()[]{}";
+
+    /* top-level alternation defeats any common prefix */
+    int  depth    = 0;
+    bool in_class = false;
+    for (size_t i = 0; i < pattern.size(); i++) {
+      const char c = pattern[i];
+      if (c == '\\') {
+        i++;
+        continue;
+      }
+      if (in_class) {
+        if (c == ']') in_class = false;
+        continue;
+      }
+      if (c == '[')
+        in_class = true;
+      else if (c == '(')
+        depth++;
+      else if (c == ')')
+        depth--;
+      else if (c == '|' && depth == 0)
+        return;
+    }
+
+    size_t i = (!pattern.empty() && pattern[0] == '^') ? 1 : 0;
+    while (i < pattern.size()) {
+      char   c    = pattern[i];
+      size_t next = i + 1;
+
+      if (c == '\\') {
+        /* escaped punctuation is literal; \d, \w etc. are classes */
+        if (next >= pattern.size() || isalnum(static_cast<unsigned char>(pattern[next]))) break;
+        c = pattern[next++];
+      }
+      else if (meta.find(c) != std::string::npos) {
+        break;
+      }
+
+      /* a quantifier makes the character optional or repeated */
+      if (next < pattern.size()) {
+        const char q = pattern[next];
+        if (q == '?' || q == '*' || q == '{') break;
+        if (q == '+') {
+          prefix += c;
+          return;
+        }
+      }
+
+      prefix += c;
+      i = next;
+    }
+
+    literal     = (i == pattern.size());
+    prefix_only = !literal && pattern.compare(i, std::string::npos, ".*") == 0;
+  }
+};
+
+/**
+ * Bounded per-index cache of compiled expressions.  Entries are shared
+ * so a caller keeps its expression alive across a cache reset.
+ */
+class Find_expression_cache {
+  static constexpr size_t CACHE_SIZE = 64;
+
+ public:
+  Find_expression_cache() : _lock{}, _cache{} {}
+
+  std::shared_ptr<const Find_expression> get(const std::string& pattern)
+  {
+    std::lock_guard<std::mutex> g(_lock);
+
+    auto i = _cache.find(pattern);
+    if (i != _cache.end()) return i->second;
+
+    if (_cache.size() >= CACHE_SIZE) _cache.clear();
+
+    auto expr = std::make_shared<const Find_expression>(pattern);
+    _cache.emplace(pattern, expr);
+    return expr;
+  }
+
+ private:
+  std::mutex                                                              _lock;
+  std::unordered_map<std::string, std::shared_ptr<const Find_expression>> _cache;
+};
+
+}  // namespace Index
+
+#endif
@@ -0,0 +1,981 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#include "pmtree_index.h"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#include <libpmem.h>
+#pragma GCC diagnostic pop
+
+#include <common/logging.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Component;
+using namespace std;
+using Common::RWLock_guard;
+
+namespace
+{
+constexpr size_t round_up8(size_t n) { return (n + 7) & ~size_t(7); }
+}  // namespace
+
+PMTree_index::PMTree_index(const std::string& owner, const std::string& name, const std::string& path)
+    : _lock{},
+      _fd(-1),
+      _base(nullptr),
+      _file_pages(0),
+      _is_pmem(false),
+      _reopened_clean(false),
+      _tx{},
+      _tx_pages{},
+      _tx_freed{},
+      _regex_cache{}
+{
+  (void) owner;  // unused
+  (void) name;   // unused
+
+  try {
+    open_file(path);
+  }
+  catch (...) {
+    if (_base) ::munmap(_base, MAP_RESERVE);
+    if (_fd >= 0) ::close(_fd);
+    throw;
+  }
+}
+
+PMTree_index::~PMTree_index()
+{
+  hdr()->clean = 1;
+  persist(&hdr()->clean, sizeof(uint64_t));
+  ::munmap(_base, MAP_RESERVE);
+  ::close(_fd);
+}
+
+/* ----- file and mapping ----- */
+
+void PMTree_index::open_file(const std::string& path)
+{
+  _fd = ::open(path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if (_fd < 0) throw General_exception("unable to open index file (%s): %s", path.c_str(), strerror(errno));
+
+  struct stat st;
+  if (::fstat(_fd, &st)) throw General_exception("unable to stat index file (%s)", path.c_str());
+  _file_pages = static_cast<uint64_t>(st.st_size) / PAGE_SIZE;
+
+  /* reserve the whole range up front so page pointers stay valid as
+     the file grows; MAP_SYNC succeeds only on a DAX filesystem */
+  void* p = MAP_FAILED;
+#ifdef MAP_SYNC
+  p        = ::mmap(nullptr, MAP_RESERVE, PROT_READ | PROT_WRITE, MAP_SHARED_VALIDATE | MAP_SYNC, _fd, 0);
+  _is_pmem = (p != MAP_FAILED);
+#endif
+  if (p == MAP_FAILED) p = ::mmap(nullptr, MAP_RESERVE, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (p == MAP_FAILED) throw General_exception("unable to map index file (%s): %s", path.c_str(), strerror(errno));
+  _base = static_cast<char*>(p);
+
+  if (_file_pages <= FIRST_NODE || hdr()->magic == 0) {
+    format();
+  }
+  else {
+    if (hdr()->magic != MAGIC || hdr()->version != VERSION || hdr()->page_size != PAGE_SIZE)
+      throw General_exception("index file (%s) has bad header", path.c_str());
+
+    if (undo()->used) PLOG("PMTree_index: rolling back incomplete update in (%s)", path.c_str());
+    tx_rollback();
+    _reopened_clean = (hdr()->clean == 1);
+  }
+
+  hdr()->clean = 0;
+  persist(&hdr()->clean, sizeof(uint64_t));
+}
+
+/* magic is written last; a crash mid-format leaves a file that is
+   formatted again on next open */
+void PMTree_index::format()
+{
+  ensure_pages(FIRST_NODE + 1);
+
+  auto h = hdr();
+  memset(h, 0, PAGE_SIZE);
+  memset(undo(), 0, sizeof(undo_t));
+
+  auto n = node(FIRST_NODE);
+  memset(n, 0, sizeof(node_t));
+  n->leaf = 1;
+  n->heap = PAGE_SIZE;
+
+  h->version    = VERSION;
+  h->page_size  = PAGE_SIZE;
+  h->page_count = FIRST_NODE + 1;
+  h->root       = FIRST_NODE;
+  h->head       = FIRST_NODE;
+  persist(h, PAGE_SIZE);
+  persist(undo(), sizeof(undo_t));
+  persist(n, sizeof(node_t));
+
+  h->magic = MAGIC;
+  persist(&h->magic, sizeof(uint64_t));
+}
+
+void PMTree_index::ensure_pages(uint64_t pages)
+{
+  if (pages <= _file_pages) return;
+
+  auto target = std::max(pages, _file_pages + GROW_PAGES);
+  if (target * PAGE_SIZE > MAP_RESERVE) throw General_exception("index file exceeds mapping reservation");
+
+  auto rc = ::posix_fallocate(_fd, static_cast<off_t>(_file_pages * PAGE_SIZE),
+                              static_cast<off_t>((target - _file_pages) * PAGE_SIZE));
+  if (rc) throw General_exception("unable to extend index file: %s", strerror(rc));
+  _file_pages = target;
+}
+
+void PMTree_index::persist(const void* p, size_t len) const
+{
+  if (_is_pmem)
+    pmem_persist(p, len);
+  else if (pmem_msync(p, len))
+    throw General_exception("index msync failed: %s", strerror(errno));
+}
+
+/* ----- undo log ----- */
+
+void PMTree_index::tx_log(const void* p, size_t len)
+{
+  if (len == 0) return;
+
+  const auto offset = static_cast<uint64_t>(static_cast<const char*>(p) - _base);
+  for (auto& e : _tx) {
+    if (e.offset == offset && e.len >= len) return; /* oldest contents already saved */
+  }
+
+  auto         u    = undo();
+  const size_t rec  = sizeof(undo_entry_t) + round_up8(len);
+  const size_t room = UNDO_PAGES * PAGE_SIZE - sizeof(undo_t);
+  if (u->used + rec > room) throw Logic_exception("index undo log overflow");
+
+  undo_entry_t e{offset, len};
+  char*        dst = reinterpret_cast<char*>(u + 1) + u->used;
+  memcpy(dst, &e, sizeof e);
+  memcpy(dst + sizeof e, p, len);
+  persist(dst, rec);
+
+  /* entry becomes live only once 'used' covers it */
+  u->used += rec;
+  persist(&u->used, sizeof(uint64_t));
+  _tx.push_back(e);
+}
+
+void PMTree_index::tx_commit()
+{
+  for (auto& e : _tx) persist(_base + e.offset, e.len);
+  for (auto p : _tx_pages) persist(node(p), PAGE_SIZE);
+
+  if (!_tx.empty()) {
+    undo()->used = 0;
+    persist(&undo()->used, sizeof(uint64_t));
+  }
+  _tx.clear();
+  _tx_pages.clear();
+  _tx_freed.clear();
+}
+
+void PMTree_index::tx_rollback()
+{
+  auto u = undo();
+  if (u->used) {
+    std::vector<const char*> entries;
+    const char*              base = reinterpret_cast<const char*>(u + 1);
+    for (uint64_t pos = 0; pos < u->used;) {
+      undo_entry_t e;
+      memcpy(&e, base + pos, sizeof e);
+      if (e.offset + e.len > _file_pages * PAGE_SIZE) throw General_exception("index undo log corrupt");
+      entries.push_back(base + pos);
+      pos += sizeof e + round_up8(e.len);
+    }
+
+    /* newest first, so a range logged twice ends with its oldest contents */
+    for (auto i = entries.rbegin(); i != entries.rend(); ++i) {
+      undo_entry_t e;
+      memcpy(&e, *i, sizeof e);
+      memcpy(_base + e.offset, *i + sizeof e, e.len);
+      persist(_base + e.offset, e.len);
+    }
+
+    u->used = 0;
+    persist(&u->used, sizeof(uint64_t));
+  }
+  _tx.clear();
+  _tx_pages.clear();
+  _tx_freed.clear();
+}
+
+/* ----- page layout ----- */
+
+PMTree_index::slot_t* PMTree_index::slots(node_t* n)
+{
+  return n->leaf ? reinterpret_cast<slot_t*>(n + 1) : reinterpret_cast<slot_t*>(children(n) + INNER_MAX);
+}
+
+size_t PMTree_index::free_space(node_t* n)
+{
+  auto end = reinterpret_cast<char*>(slots(n) + n->nkeys) - reinterpret_cast<char*>(n);
+  return n->heap - static_cast<size_t>(end);
+}
+
+std::string PMTree_index::key(node_t* n, size_t slot)
+{
+  auto& s = slots(n)[slot];
+  return std::string(reinterpret_cast<const char*>(n) + s.off, s.len);
+}
+
+int PMTree_index::compare(node_t* n, size_t slot, const std::string& key)
+{
+  auto&  s = slots(n)[slot];
+  size_t l = std::min<size_t>(s.len, key.size());
+  int    r = memcmp(reinterpret_cast<const char*>(n) + s.off, key.data(), l);
+  if (r) return r;
+  return s.len < key.size() ? -1 : (s.len > key.size() ? 1 : 0);
+}
+
+/* first key >= 'key' */
+size_t PMTree_index::lower_slot(node_t* n, const std::string& key)
+{
+  size_t lo = 0, hi = n->nkeys;
+  while (lo < hi) {
+    auto mid = (lo + hi) / 2;
+    if (compare(n, mid, key) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* child holding 'key': count of separators <= key */
+size_t PMTree_index::child_slot(node_t* n, const std::string& key)
+{
+  size_t lo = 0, hi = n->nkeys;
+  while (lo < hi) {
+    auto mid = (lo + hi) / 2;
+    if (compare(n, mid, key) <= 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+void PMTree_index::pack_leaf(node_t* n, const std::vector<std::string>& keys)
+{
+  n->leaf    = 1;
+  n->nkeys   = 0;
+  n->heap    = PAGE_SIZE;
+  n->garbage = 0;
+  n->count   = keys.size();
+
+  auto s = slots(n);
+  for (auto& k : keys) {
+    n->heap = static_cast<uint16_t>(n->heap - k.size());
+    memcpy(reinterpret_cast<char*>(n) + n->heap, k.data(), k.size());
+    s[n->nkeys++] = slot_t{n->heap, static_cast<uint16_t>(k.size())};
+  }
+  assert(reinterpret_cast<char*>(s + n->nkeys) <= reinterpret_cast<char*>(n) + n->heap);
+}
+
+void PMTree_index::pack_inner(node_t* n, const std::vector<std::string>& seps, const std::vector<child_t>& kids)
+{
+  assert(kids.size() == seps.size() + 1 && kids.size() <= INNER_MAX);
+  n->leaf    = 0;
+  n->nkeys   = 0;
+  n->heap    = PAGE_SIZE;
+  n->garbage = 0;
+  n->count   = 0;
+
+  auto c = children(n);
+  for (size_t i = 0; i < kids.size(); i++) {
+    c[i] = kids[i];
+    n->count += kids[i].count;
+  }
+
+  auto s = slots(n);
+  for (auto& k : seps) {
+    n->heap = static_cast<uint16_t>(n->heap - k.size());
+    memcpy(reinterpret_cast<char*>(n) + n->heap, k.data(), k.size());
+    s[n->nkeys++] = slot_t{n->heap, static_cast<uint16_t>(k.size())};
+  }
+  assert(reinterpret_cast<char*>(s + n->nkeys) <= reinterpret_cast<char*>(n) + n->heap);
+}
+
+void PMTree_index::unpack_leaf(node_t* n, std::vector<std::string>& keys)
+{
+  for (size_t i = 0; i < n->nkeys; i++) keys.push_back(key(n, i));
+}
+
+void PMTree_index::unpack_inner(node_t* n, std::vector<std::string>& seps, std::vector<child_t>& kids)
+{
+  for (size_t i = 0; i < n->nkeys; i++) seps.push_back(key(n, i));
+  kids.assign(children(n), children(n) + n->nkeys + 1);
+}
+
+/* ----- page allocation ----- */
+
+uint64_t PMTree_index::alloc_page(bool leaf)
+{
+  auto     h = hdr();
+  uint64_t page;
+
+  /* a page freed by this transaction still belongs to the old tree
+     until commit, so it may not be overwritten yet */
+  if (h->free_list && std::find(_tx_freed.begin(), _tx_freed.end(), h->free_list) == _tx_freed.end()) {
+    page = h->free_list;
+    tx_log(&node(page)->link, sizeof(uint64_t));
+    tx_log(&h->free_list, sizeof(uint64_t));
+    h->free_list = node(page)->link;
+  }
+  else {
+    ensure_pages(h->page_count + 1);
+    tx_log(&h->page_count, sizeof(uint64_t));
+    page = h->page_count++;
+  }
+  _tx_pages.push_back(page);
+
+  auto n = node(page);
+  memset(n, 0, sizeof(node_t));
+  n->leaf = leaf ? 1 : 0;
+  n->heap = PAGE_SIZE;
+  return page;
+}
+
+void PMTree_index::free_page(uint64_t page)
+{
+  auto h = hdr();
+  auto n = node(page);
+  tx_log(&n->link, sizeof(uint64_t));
+  tx_log(&h->free_list, sizeof(uint64_t));
+  n->link      = h->free_list;
+  h->free_list = page;
+  _tx_freed.push_back(page);
+}
+
+void PMTree_index::unlink_leaf(uint64_t page)
+{
+  auto n = node(page);
+  if (n->prev) {
+    tx_log(&node(n->prev)->next, sizeof(uint64_t));
+    node(n->prev)->next = n->next;
+  }
+  else {
+    tx_log(&hdr()->head, sizeof(uint64_t));
+    hdr()->head = n->next;
+  }
+  if (n->next) {
+    tx_log(&node(n->next)->prev, sizeof(uint64_t));
+    node(n->next)->prev = n->prev;
+  }
+}
+
+/* ----- update ----- */
+
+/* Returns true if the key was added.  On overflow the page is split and
+   the new right sibling returned for the parent to adopt. */
+bool PMTree_index::insert(uint64_t page, const std::string& key, split_t& split)
+{
+  auto n = node(page);
+
+  if (!n->leaf) {
+    auto    slot = child_slot(n, key);
+    split_t child_split;
+    if (!insert(children(n)[slot].page, key, child_split)) return false;
+
+    if (child_split.right) {
+      insert_child(page, slot, child_split, split);
+    }
+    else {
+      tx_log(n, sizeof(node_t));
+      tx_log(&children(n)[slot].count, sizeof(uint64_t));
+      children(n)[slot].count++;
+      n->count++;
+    }
+    return true;
+  }
+
+  auto slot = lower_slot(n, key);
+  if (slot < n->nkeys && compare(n, slot, key) == 0) return false;
+
+  const size_t need = key.size() + sizeof(slot_t);
+  if (free_space(n) < need && free_space(n) + n->garbage >= need) {
+    std::vector<std::string> keys;
+    unpack_leaf(n, keys);
+    tx_log(n, PAGE_SIZE);
+    pack_leaf(n, keys);
+  }
+
+  if (free_space(n) >= need) {
+    auto s   = slots(n);
+    auto off = static_cast<uint16_t>(n->heap - key.size());
+    tx_log(n, sizeof(node_t));
+    tx_log(&s[slot], (n->nkeys - slot + 1) * sizeof(slot_t));
+    tx_log(reinterpret_cast<char*>(n) + off, key.size());
+
+    memcpy(reinterpret_cast<char*>(n) + off, key.data(), key.size());
+    memmove(&s[slot + 1], &s[slot], (n->nkeys - slot) * sizeof(slot_t));
+    s[slot] = slot_t{off, static_cast<uint16_t>(key.size())};
+    n->heap = off;
+    n->nkeys++;
+    n->count++;
+    return true;
+  }
+
+  /* split by bytes so both halves fit whatever the key sizes */
+  std::vector<std::string> keys;
+  unpack_leaf(n, keys);
+  keys.insert(keys.begin() + static_cast<ptrdiff_t>(slot), key);
+
+  size_t total = 0;
+  for (auto& k : keys) total += k.size() + sizeof(slot_t);
+  size_t mid = 1, acc = keys[0].size() + sizeof(slot_t);
+  while (mid < keys.size() - 1 && acc < total / 2) acc += keys[mid++].size() + sizeof(slot_t);
+
+  std::vector<std::string> right_keys(make_move_iterator(keys.begin() + static_cast<ptrdiff_t>(mid)),
+                                      make_move_iterator(keys.end()));
+  keys.resize(mid);
+
+  auto right = alloc_page(true);
+  auto rn    = node(right);
+  pack_leaf(rn, right_keys);
+  rn->prev = page;
+  rn->next = n->next;
+  if (n->next) {
+    tx_log(&node(n->next)->prev, sizeof(uint64_t));
+    node(n->next)->prev = right;
+  }
+
+  tx_log(n, PAGE_SIZE);
+  pack_leaf(n, keys);
+  n->next = right;
+
+  split.sep         = right_keys.front();
+  split.right       = right;
+  split.right_count = rn->count;
+  return true;
+}
+
+/* adopt the right sibling of children[slot] after it split */
+void PMTree_index::insert_child(uint64_t page, size_t slot, split_t& child_split, split_t& split)
+{
+  auto         n          = node(page);
+  const auto   left_count = node(children(n)[slot].page)->count;
+  const size_t need       = child_split.sep.size() + sizeof(slot_t);
+  const size_t kids       = n->nkeys + 1u;
+
+  if (kids < INNER_MAX && free_space(n) < need && free_space(n) + n->garbage >= need) {
+    std::vector<std::string> seps;
+    std::vector<child_t>     c;
+    unpack_inner(n, seps, c);
+    tx_log(n, PAGE_SIZE);
+    pack_inner(n, seps, c);
+  }
+
+  if (kids < INNER_MAX && free_space(n) >= need) {
+    auto c   = children(n);
+    auto s   = slots(n);
+    auto off = static_cast<uint16_t>(n->heap - child_split.sep.size());
+    tx_log(n, sizeof(node_t));
+    tx_log(&c[slot], (kids - slot + 1) * sizeof(child_t));
+    tx_log(&s[slot], (n->nkeys - slot + 1) * sizeof(slot_t));
+    tx_log(reinterpret_cast<char*>(n) + off, child_split.sep.size());
+
+    memmove(&c[slot + 2], &c[slot + 1], (kids - slot - 1) * sizeof(child_t));
+    c[slot].count = left_count;
+    c[slot + 1]   = child_t{child_split.right, child_split.right_count};
+
+    memcpy(reinterpret_cast<char*>(n) + off, child_split.sep.data(), child_split.sep.size());
+    memmove(&s[slot + 1], &s[slot], (n->nkeys - slot) * sizeof(slot_t));
+    s[slot] = slot_t{off, static_cast<uint16_t>(child_split.sep.size())};
+    n->heap = off;
+    n->nkeys++;
+    n->count++;
+    return;
+  }
+
+  std::vector<std::string> seps;
+  std::vector<child_t>     c;
+  unpack_inner(n, seps, c);
+  seps.insert(seps.begin() + static_cast<ptrdiff_t>(slot), std::move(child_split.sep));
+  c[slot].count = left_count;
+  c.insert(c.begin() + static_cast<ptrdiff_t>(slot) + 1, child_t{child_split.right, child_split.right_count});
+
+  /* seps[mid] moves up; left keeps seps[0,mid), right seps(mid,end) */
+  size_t total = 0;
+  for (auto& k : seps) total += k.size() + sizeof(slot_t);
+  size_t mid = 0, acc = 0;
+  while (mid < seps.size() - 1 && acc < total / 2) acc += seps[mid++].size() + sizeof(slot_t);
+
+  std::vector<std::string> right_seps(make_move_iterator(seps.begin() + static_cast<ptrdiff_t>(mid) + 1),
+                                      make_move_iterator(seps.end()));
+  std::vector<child_t> right_kids(c.begin() + static_cast<ptrdiff_t>(mid) + 1, c.end());
+  split.sep = std::move(seps[mid]);
+  seps.resize(mid);
+  c.resize(mid + 1);
+
+  auto right = alloc_page(false);
+  pack_inner(node(right), right_seps, right_kids);
+
+  tx_log(n, PAGE_SIZE);
+  pack_inner(n, seps, c);
+
+  split.right       = right;
+  split.right_count = node(right)->count;
+}
+
+void PMTree_index::insert(const string& key)
+{
+  if (key.size() > MAX_KEY_LEN) throw API_exception("PMTree_index: key exceeds %lu bytes", MAX_KEY_LEN);
+
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  try {
+    auto    h = hdr();
+    split_t split;
+    if (!insert(h->root, key, split)) return;
+
+    if (split.right) {
+      auto root = alloc_page(false);
+      pack_inner(node(root), std::vector<std::string>{split.sep},
+                 std::vector<child_t>{child_t{h->root, node(h->root)->count}, child_t{split.right, split.right_count}});
+      tx_log(&h->root, sizeof(uint64_t));
+      h->root = root;
+    }
+
+    tx_log(&h->count, sizeof(uint64_t));
+    h->count++;
+    tx_commit();
+  }
+  catch (...) {
+    tx_rollback();
+    throw;
+  }
+}
+
+/* Returns true if the key was removed.  Pages are not merged; a page
+   left empty is freed by its parent. */
+bool PMTree_index::erase(uint64_t page, const std::string& key, bool& out_empty)
+{
+  auto n = node(page);
+
+  if (n->leaf) {
+    auto slot = lower_slot(n, key);
+    if (slot >= n->nkeys || compare(n, slot, key) != 0) return false;
+
+    auto s = slots(n);
+    tx_log(n, sizeof(node_t));
+    tx_log(&s[slot], (n->nkeys - slot) * sizeof(slot_t));
+    n->garbage = static_cast<uint16_t>(n->garbage + s[slot].len);
+    memmove(&s[slot], &s[slot + 1], (n->nkeys - slot - 1u) * sizeof(slot_t));
+    n->nkeys--;
+    n->count--;
+    out_empty = (n->nkeys == 0);
+    return true;
+  }
+
+  auto slot        = child_slot(n, key);
+  auto child       = children(n)[slot].page;
+  bool child_empty = false;
+  if (!erase(child, key, child_empty)) return false;
+
+  tx_log(n, sizeof(node_t));
+  n->count--;
+  out_empty = false;
+
+  if (!child_empty) {
+    tx_log(&children(n)[slot].count, sizeof(uint64_t));
+    children(n)[slot].count--;
+    return true;
+  }
+
+  if (node(child)->leaf) unlink_leaf(child);
+  free_page(child);
+
+  if (n->nkeys == 0) { /* that was the only child */
+    out_empty = true;
+    return true;
+  }
+
+  const size_t kids = n->nkeys + 1u;
+  auto         c    = children(n);
+  tx_log(&c[slot], (kids - slot) * sizeof(child_t));
+  memmove(&c[slot], &c[slot + 1], (kids - slot - 1) * sizeof(child_t));
+
+  auto s  = slots(n);
+  auto si = slot > 0 ? slot - 1 : 0;
+  tx_log(&s[si], (n->nkeys - si) * sizeof(slot_t));
+  n->garbage = static_cast<uint16_t>(n->garbage + s[si].len);
+  memmove(&s[si], &s[si + 1], (n->nkeys - si - 1u) * sizeof(slot_t));
+  n->nkeys--;
+  return true;
+}
+
+void PMTree_index::erase(const std::string& key)
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  try {
+    auto h     = hdr();
+    bool empty = false;
+    if (!erase(h->root, key, empty)) return;
+
+    tx_log(&h->count, sizeof(uint64_t));
+    h->count--;
+
+    if (empty && !node(h->root)->leaf) {
+      free_page(h->root);
+      auto leaf = alloc_page(true);
+      tx_log(&h->root, sizeof(uint64_t));
+      tx_log(&h->head, sizeof(uint64_t));
+      h->root = h->head = leaf;
+    }
+
+    /* collapse single-child roots */
+    while (!node(h->root)->leaf && node(h->root)->nkeys == 0) {
+      auto old = h->root;
+      tx_log(&h->root, sizeof(uint64_t));
+      h->root = children(node(old))[0].page;
+      free_page(old);
+    }
+    tx_commit();
+  }
+  catch (...) {
+    tx_rollback();
+    throw;
+  }
+}
+
+/* Discard the tree; pages beyond the first node become unreachable so
+   only the header and the new root need logging */
+void PMTree_index::reset_tree()
+{
+  auto h = hdr();
+  auto n = node(FIRST_NODE);
+  tx_log(h, sizeof(header_t));
+  tx_log(n, sizeof(node_t));
+
+  memset(n, 0, sizeof(node_t));
+  n->leaf       = 1;
+  n->heap       = PAGE_SIZE;
+  h->root       = FIRST_NODE;
+  h->head       = FIRST_NODE;
+  h->page_count = FIRST_NODE + 1;
+  h->free_list  = 0;
+  h->count      = 0;
+}
+
+void PMTree_index::clear()
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  try {
+    reset_tree();
+    tx_commit();
+  }
+  catch (...) {
+    tx_rollback();
+    throw;
+  }
+}
+
+status_t PMTree_index::bulk_load(std::vector<std::string>&& keys)
+{
+  for (auto& k : keys) {
+    if (k.size() > MAX_KEY_LEN) throw API_exception("PMTree_index: key exceeds %lu bytes", MAX_KEY_LEN);
+  }
+  sort(keys.begin(), keys.end());
+  keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  try {
+    reset_tree();
+    tx_commit();
+    if (keys.empty()) return S_OK;
+
+    /* Build above page_count without logging; none of it is reachable
+       until the header switch at the end, so a crash leaves the empty
+       tree.  Pages are filled to 3/4 to leave room for inserts. */
+    const size_t leaf_budget  = (PAGE_SIZE - sizeof(node_t)) * 3 / 4;
+    const size_t inner_budget = (PAGE_SIZE - sizeof(node_t) - INNER_MAX * sizeof(child_t)) * 3 / 4;
+    const size_t inner_fill   = (INNER_MAX * 3) / 4;
+
+    const uint64_t           first = hdr()->page_count;
+    uint64_t                 next  = first;
+    uint64_t                 prev  = 0;
+    std::vector<child_t>     level;
+    std::vector<std::string> firsts;
+
+    for (size_t i = 0; i < keys.size();) {
+      std::vector<std::string> chunk;
+      size_t                   used = 0;
+      while (i < keys.size() && (chunk.empty() || used + keys[i].size() + sizeof(slot_t) <= leaf_budget)) {
+        used += keys[i].size() + sizeof(slot_t);
+        chunk.push_back(std::move(keys[i++]));
+      }
+
+      ensure_pages(next + 1);
+      auto page = next++;
+      auto n    = node(page);
+      memset(n, 0, sizeof(node_t));
+      pack_leaf(n, chunk);
+      n->prev = prev;
+      if (prev) node(prev)->next = page;
+      prev = page;
+
+      level.push_back(child_t{page, n->count});
+      firsts.push_back(std::move(chunk.front()));
+    }
+
+    while (level.size() > 1) {
+      std::vector<child_t>     up;
+      std::vector<std::string> up_firsts;
+
+      for (size_t i = 0; i < level.size();) {
+        std::vector<std::string> seps;
+        std::vector<child_t>     kids{level[i]};
+        std::string              first_key = std::move(firsts[i++]);
+        size_t                   used      = 0;
+        while (i < level.size() && kids.size() < inner_fill && used + firsts[i].size() + sizeof(slot_t) <= inner_budget) {
+          used += firsts[i].size() + sizeof(slot_t);
+          seps.push_back(std::move(firsts[i]));
+          kids.push_back(level[i++]);
+        }
+
+        ensure_pages(next + 1);
+        auto page = next++;
+        auto n    = node(page);
+        memset(n, 0, sizeof(node_t));
+        pack_inner(n, seps, kids);
+
+        up.push_back(child_t{page, n->count});
+        up_firsts.push_back(std::move(first_key));
+      }
+      level.swap(up);
+      firsts.swap(up_firsts);
+    }
+
+    persist(node(first), (next - first) * PAGE_SIZE);
+
+    auto h = hdr();
+    tx_log(h, sizeof(header_t));
+    h->root       = level.front().page;
+    h->head       = first;
+    h->count      = level.front().count;
+    h->page_count = next;
+    free_page(FIRST_NODE); /* empty root from the reset */
+    tx_commit();
+  }
+  catch (...) {
+    tx_rollback();
+    throw;
+  }
+
+  keys.clear();
+  return S_OK;
+}
+
+/* ----- lookup ----- */
+
+void PMTree_index::settle(cursor_t& c) const
+{
+  while (c.page && c.slot >= node(c.page)->nkeys) {
+    c.page = node(c.page)->next;
+    c.slot = 0;
+  }
+}
+
+PMTree_index::cursor_t PMTree_index::seek(offset_t position) const
+{
+  if (position >= hdr()->count) return cursor_t{0, 0};
+
+  auto page = hdr()->root;
+  while (!node(page)->leaf) {
+    auto n = node(page);
+    auto c = children(n);
+    for (size_t i = 0; i <= n->nkeys; i++) {
+      if (position < c[i].count) {
+        page = c[i].page;
+        break;
+      }
+      position -= c[i].count;
+    }
+  }
+  return cursor_t{page, position};
+}
+
+PMTree_index::cursor_t PMTree_index::lower_bound(const std::string& key) const
+{
+  auto page = hdr()->root;
+  while (!node(page)->leaf) page = children(node(page))[child_slot(node(page), key)].page;
+
+  cursor_t c{page, lower_slot(node(page), key)};
+  settle(c);
+  return c;
+}
+
+/* number of keys less than 'key' */
+PMTree_index::offset_t PMTree_index::order_of_key(const std::string& key) const
+{
+  offset_t pos  = 0;
+  auto     page = hdr()->root;
+  while (!node(page)->leaf) {
+    auto n    = node(page);
+    auto slot = child_slot(n, key);
+    for (size_t i = 0; i < slot; i++) pos += children(n)[i].count;
+    page = children(n)[slot].page;
+  }
+  return pos + lower_slot(node(page), key);
+}
+
+string PMTree_index::get(offset_t position) const
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  auto c = seek(position);
+  if (!valid(c)) {
+    throw out_of_range("Position out of range");
+  }
+  return key(c);
+}
+
+status_t PMTree_index::set_generation(uint64_t generation)
+{
+  RWLock_guard g(_lock, RWLock_guard::WRITE);
+  hdr()->generation = generation;
+  persist(&hdr()->generation, sizeof(uint64_t));
+  return S_OK;
+}
+
+size_t PMTree_index::count() const
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+  return hdr()->count;
+}
+
+status_t PMTree_index::find(const std::string& key_expression,
+                            offset_t           begin_position,
+                            find_t             find_type,
+                            offset_t&          out_matched_pos,
+                            std::string&       out_matched_key,
+                            unsigned           max_comparisons)
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  if (begin_position >= hdr()->count) {
+    return E_FAIL;
+  }
+
+  unsigned attempts = 0;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wswitch"  // enumeration value ‘FIND_TYPE_NONE’ not handled in switch
+  switch (find_type) {
+    case FIND_TYPE_REGEX: {
+      const auto expr = _regex_cache.get(key_expression);
+
+      /* all matches lie in the range of keys starting with the prefix */
+      offset_t pos = begin_position;
+      if (!expr->prefix.empty()) pos = std::max<offset_t>(pos, order_of_key(expr->prefix));
+
+      for (auto c = seek(pos); valid(c); c.slot++, settle(c), ++pos) {
+        const string k = key(c);
+        if (!expr->in_prefix_range(k)) break;
+
+        if (expr->match(k)) {
+          out_matched_pos = pos;
+          out_matched_key = k;
+          return S_OK;
+        }
+        else if (++attempts > max_comparisons) {
+          out_matched_pos = pos;
+          return E_MAX_REACHED;
+        }
+      }
+    } break;
+    case FIND_TYPE_EXACT: {
+      offset_t pos = order_of_key(key_expression);
+      auto     c   = seek(pos);
+      if (!valid(c) || compare(node(c.page), c.slot, key_expression) != 0 || pos < begin_position) break;
+      out_matched_pos = pos;
+      out_matched_key = key_expression;
+      return S_OK;
+    }
+    case FIND_TYPE_PREFIX: {
+      offset_t pos = begin_position;
+      for (auto c = seek(pos); valid(c); c.slot++, settle(c), ++pos) {
+        const string k = key(c);
+        if (k.find(key_expression) != string::npos) {
+          out_matched_pos = pos;
+          out_matched_key = k;
+          return S_OK;
+        }
+        else if (++attempts > max_comparisons) {
+          out_matched_pos = pos;
+          return E_MAX_REACHED;
+        }
+      }
+    } break;
+    case FIND_TYPE_NEXT:
+      out_matched_key = key(seek(begin_position));
+      out_matched_pos = begin_position;
+      return S_OK;
+      break;
+  }
+#pragma GCC diagnostic pop
+
+  return E_FAIL;
+}
+
+status_t PMTree_index::scan(const std::string&                          start_key,
+                            const std::string&                          end_key,
+                            std::function<bool(const std::string& key)> callback)
+{
+  RWLock_guard g(_lock, RWLock_guard::READ);
+
+  cursor_t c{hdr()->head, 0};
+  if (start_key.empty())
+    settle(c);
+  else
+    c = lower_bound(start_key);
+
+  for (; valid(c); c.slot++, settle(c)) {
+    const string k = key(c);
+    if (!end_key.empty() && k >= end_key) break;
+    if (!callback(k)) break;
+  }
+  return S_OK;
+}
+
+/**
+ * Factory entry point
+ *
+ */
+extern "C" void* factory_createInstance(Component::uuid_t component_id)
+{
+  if (component_id == PMTree_index_factory::component_id()) {
+    return static_cast<void*>(new PMTree_index_factory());
+  }
+  else
+    return NULL;
+}
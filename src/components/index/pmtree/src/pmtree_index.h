@@ -0,0 +1,246 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __PMTREE_INDEX_COMPONENT_H__
+#define __PMTREE_INDEX_COMPONENT_H__
+
+#include <api/kvindex_itf.h>
+#include <common/rwlock.h>
+#include <index/common/find_expression.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Persistent B+-tree index held in a memory-mapped file, normally a
+ * sidecar file on a DAX filesystem next to the pool.  Nodes are 4KiB
+ * slotted pages addressed by page number; the tree is used in place, so
+ * reopening an existing index costs a map and a header check.
+ *
+ * Every update is a small transaction: the old contents of each range
+ * are copied to an undo log in the file (and persisted) before the range
+ * is modified.  Commit persists the modified ranges and truncates the
+ * log; open rolls back any log left by a crash.  The index therefore
+ * reflects every insert/erase that returned before the crash.
+ *
+ * Keys are limited to MAX_KEY_LEN bytes.  Concurrency is as BTree_index:
+ * readers share, writers are exclusive.
+ */
+class PMTree_index : public Component::IKVIndex {
+ public:
+  static constexpr size_t PAGE_SIZE   = 4096;
+  static constexpr size_t MAX_KEY_LEN = 512;
+
+ private:
+  static constexpr uint64_t MAGIC       = 0x31787464696d7470ULL; /* "ptmidtx1" */
+  static constexpr uint32_t VERSION     = 1;
+  static constexpr uint64_t UNDO_PAGES  = 32;
+  static constexpr uint64_t FIRST_NODE  = 1 + UNDO_PAGES;
+  static constexpr size_t   INNER_MAX   = 64;         /*< children per inner node */
+  static constexpr uint64_t GROW_PAGES  = 4096;       /*< file growth increment */
+  static constexpr size_t   MAP_RESERVE = 1ULL << 40; /*< virtual reservation; file grows within it */
+
+  /* page 0 */
+  struct header_t {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t page_count; /*< pages allocated, including header and log */
+    uint64_t root;
+    uint64_t head; /*< first leaf */
+    uint64_t free_list;
+    uint64_t count;
+    uint64_t clean;      /*< closed without crash */
+    uint64_t generation; /*< see set_generation; 0 if none */
+  };
+
+  /* pages 1..UNDO_PAGES; entries follow the used counter */
+  struct undo_t {
+    uint64_t used;
+    uint64_t pad[7];
+  };
+
+  struct undo_entry_t {
+    uint64_t offset;
+    uint64_t len;
+  };
+
+  /* Slotted page: slot array grows up after the header (and, for inner
+     nodes, the child array); key bytes grow down from the page end */
+  struct node_t {
+    uint64_t link; /*< free list link while free */
+    uint64_t prev; /*< leaf chain; 0 is none */
+    uint64_t next;
+    uint64_t count; /*< keys in subtree */
+    uint16_t leaf;
+    uint16_t nkeys; /*< keys (leaf) or separators (inner) */
+    uint16_t heap;  /*< offset of lowest key byte */
+    uint16_t garbage;
+    uint64_t pad;
+  };
+
+  struct slot_t {
+    uint16_t off;
+    uint16_t len;
+  };
+
+  /* children[i] holds keys in [seps[i-1], seps[i]) */
+  struct child_t {
+    uint64_t page;
+    uint64_t count;
+  };
+
+  struct split_t {
+    split_t() : sep{}, right(0), right_count(0) {}
+    std::string sep;
+    uint64_t    right;
+    uint64_t    right_count;
+  };
+
+  struct cursor_t {
+    uint64_t page;
+    size_t   slot;
+  };
+
+ public:
+  PMTree_index(const std::string& owner, const std::string& name, const std::string& path);
+  PMTree_index(const PMTree_index&) = delete;
+  PMTree_index& operator=(const PMTree_index&) = delete;
+  virtual ~PMTree_index();
+
+  DECLARE_VERSION(0.1f);
+  DECLARE_COMPONENT_UUID(0x8a120985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2b);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex::iid()) {
+      return static_cast<Component::IKVIndex*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+ public:
+  virtual void        insert(const std::string& key) override;
+  virtual void        erase(const std::string& key) override;
+  virtual void        clear() override;
+  virtual std::string get(offset_t position) const override;
+  virtual size_t      count() const override;
+  virtual status_t    find(const std::string& key_expression,
+                           offset_t           begin_position,
+                           find_t             find_type,
+                           offset_t&          out_end_position,
+                           std::string&       out_matched_key,
+                           unsigned           max_comparisons = 0) override;
+  virtual status_t    scan(const std::string&                          start_key,
+                           const std::string&                          end_key,
+                           std::function<bool(const std::string& key)> callback) override;
+  virtual status_t    bulk_load(std::vector<std::string>&& keys) override;
+  virtual bool        reopened_clean() const override { return _reopened_clean; }
+  virtual status_t    set_generation(uint64_t generation) override;
+  virtual uint64_t    generation() const override { return hdr()->generation; }
+
+ private:
+  /* file and mapping */
+  void open_file(const std::string& path);
+  void format();
+  void ensure_pages(uint64_t pages);
+  void persist(const void* p, size_t len) const;
+
+  /* undo log */
+  void tx_log(const void* p, size_t len);
+  void tx_commit();
+  void tx_rollback();
+
+  /* page access */
+  header_t* hdr() const { return reinterpret_cast<header_t*>(_base); }
+  undo_t*   undo() const { return reinterpret_cast<undo_t*>(_base + PAGE_SIZE); }
+  node_t*   node(uint64_t page) const { return reinterpret_cast<node_t*>(_base + page * PAGE_SIZE); }
+
+  static child_t* children(node_t* n) { return reinterpret_cast<child_t*>(n + 1); }
+  static slot_t*  slots(node_t* n);
+  static size_t   free_space(node_t* n);
+  static std::string key(node_t* n, size_t slot);
+  static int         compare(node_t* n, size_t slot, const std::string& key);
+  static size_t      lower_slot(node_t* n, const std::string& key);
+  static size_t      child_slot(node_t* n, const std::string& key);
+
+  uint64_t alloc_page(bool leaf);
+  void     free_page(uint64_t page);
+  void     unlink_leaf(uint64_t page);
+
+  static void pack_leaf(node_t* n, const std::vector<std::string>& keys);
+  static void pack_inner(node_t* n, const std::vector<std::string>& seps, const std::vector<child_t>& kids);
+  static void unpack_leaf(node_t* n, std::vector<std::string>& keys);
+  static void unpack_inner(node_t* n, std::vector<std::string>& seps, std::vector<child_t>& kids);
+
+  bool insert(uint64_t page, const std::string& key, split_t& split);
+  void insert_child(uint64_t page, size_t slot, split_t& child_split, split_t& split);
+  bool erase(uint64_t page, const std::string& key, bool& out_empty);
+  void reset_tree();
+
+  cursor_t seek(offset_t position) const;
+  cursor_t lower_bound(const std::string& key) const;
+  offset_t order_of_key(const std::string& key) const;
+  void     settle(cursor_t& c) const;
+  bool     valid(const cursor_t& c) const { return c.page != 0; }
+  std::string key(const cursor_t& c) const { return key(node(c.page), c.slot); }
+
+  mutable Common::RWLock       _lock;
+  int                          _fd;
+  char*                        _base;
+  uint64_t                     _file_pages;
+  bool                         _is_pmem;
+  bool                         _reopened_clean;
+  std::vector<undo_entry_t>    _tx;        /*< ranges logged by the current transaction */
+  std::vector<uint64_t>        _tx_pages;  /*< pages allocated by it; persisted whole at commit */
+  std::vector<uint64_t>        _tx_freed;  /*< pages freed by it; not reused until commit */
+  Index::Find_expression_cache _regex_cache;
+};
+
+class PMTree_index_factory : public Component::IKVIndex_factory {
+ public:
+  DECLARE_VERSION(0.1f);
+  DECLARE_COMPONENT_UUID(0xfac20985, 0x1253, 0x404d, 0x94d7, 0x77, 0x92, 0x75, 0x21, 0xa1, 0x2b);
+
+  void* query_interface(Component::uuid_t& itf_uuid) override
+  {
+    if (itf_uuid == Component::IKVIndex_factory::iid()) {
+      return static_cast<Component::IKVIndex_factory*>(this);
+    }
+    else
+      return NULL;  // we don't support this interface
+  }
+
+  void unload() override { delete this; }
+
+  /**
+   * Open or create an index
+   *
+   * @param owner Owner
+   * @param name Name
+   * @param path Index file path
+   */
+  virtual Component::IKVIndex* create(const std::string& owner,
+                                      const std::string& name,
+                                      const std::string& path) override
+  {
+    Component::IKVIndex* obj = static_cast<Component::IKVIndex*>(new PMTree_index(owner, name, path));
+    assert(obj);
+    obj->add_ref();
+    return obj;
+  }
+};
+#endif
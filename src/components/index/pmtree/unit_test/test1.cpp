@@ -0,0 +1,251 @@
+/* note: we do not include component source, only the API definition */
+#include <api/components.h>
+#include <api/kvindex_itf.h>
+#include <common/str_utils.h>
+#include <common/utils.h>
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <set>
+
+#define COUNT 1000000
+#define LENGTH 16
+
+using namespace Component;
+using namespace Common;
+using namespace std;
+
+namespace
+{
+const std::string index_path = "/tmp/pmtree-index-test1.idx";
+
+// The fixture for testing class Foo.
+class KVIndex_test : public ::testing::Test {
+ protected:
+  static IKVIndex *open_index()
+  {
+    Component::IBase *comp = Component::load_component("libcomponent-indexpmtree.so", Component::pmtreeindex_factory);
+    assert(comp);
+    auto fact  = static_cast<IKVIndex_factory *>(comp->query_interface(IKVIndex_factory::iid()));
+    auto index = fact->create("owner", "name", index_path);
+    fact->release_ref();
+    return index;
+  }
+
+  static void reopen()
+  {
+    _kvindex->release_ref();
+    _kvindex = open_index();
+  }
+
+  /* full ordered walk agrees with count() and get() */
+  static void check_order()
+  {
+    size_t n = 0;
+    string last;
+    _kvindex->scan("", "", [&](const string &k) {
+      if (n) {
+        EXPECT_LT(last, k);
+      }
+      last = k;
+      n++;
+      return true;
+    });
+    ASSERT_EQ(n, _kvindex->count());
+    if (n) {
+      ASSERT_EQ(last, _kvindex->get(n - 1));
+    }
+  }
+
+  // Objects declared here can be used by all tests in the test case
+  static Component::IKVIndex *_kvindex;
+};
+
+Component::IKVIndex *KVIndex_test::_kvindex;
+
+TEST_F(KVIndex_test, Instantiate)
+{
+  ::unlink(index_path.c_str());
+  _kvindex = open_index();
+  ASSERT_TRUE(_kvindex);
+  ASSERT_EQ(0UL, _kvindex->count());
+}
+
+/* random inserts and erases of mixed length keys checked against std::set */
+TEST_F(KVIndex_test, Consistency)
+{
+  set<string> model;
+  srand(1);
+  for (int i = 0; i < 50000; i++) {
+    char key[16];
+    snprintf(key, sizeof key, "k%06d", rand() % 10000);
+    string k = string(key) + string(size_t(rand() % 3) * 40, 'x');
+    if (rand() % 3) {
+      _kvindex->insert(k);
+      model.insert(k);
+    }
+    else {
+      _kvindex->erase(k);
+      model.erase(k);
+    }
+  }
+  ASSERT_EQ(model.size(), _kvindex->count());
+
+  IKVIndex::offset_t pos = 0;
+  for (auto &k : model) {
+    ASSERT_EQ(k, _kvindex->get(pos++));
+  }
+  ASSERT_THROW(_kvindex->get(pos), std::out_of_range);
+  ASSERT_THROW(_kvindex->insert(string(1024, 'x')), API_exception);
+
+  /* contents survive close and reopen */
+  reopen();
+  ASSERT_EQ(model.size(), _kvindex->count());
+  pos = 0;
+  for (auto &k : model) {
+    ASSERT_EQ(k, _kvindex->get(pos++));
+  }
+
+  /* erase everything */
+  for (auto &k : model) _kvindex->erase(k);
+  ASSERT_EQ(0UL, _kvindex->count());
+  _kvindex->insert("again");
+  ASSERT_EQ("again", _kvindex->get(0));
+}
+
+TEST_F(KVIndex_test, BulkLoad)
+{
+  vector<string> keys;
+  for (int i = 99999; i >= 0; i--) {
+    char key[16];
+    snprintf(key, sizeof key, "key%05d", i);
+    keys.push_back(key);
+    keys.push_back(key); /* duplicates are dropped */
+  }
+  ASSERT_EQ(S_OK, _kvindex->bulk_load(std::move(keys)));
+  ASSERT_EQ(100000UL, _kvindex->count());
+  ASSERT_EQ("key00000", _kvindex->get(0));
+  ASSERT_EQ("key50000", _kvindex->get(50000));
+  ASSERT_EQ("key99999", _kvindex->get(99999));
+
+  /* tree stays usable for inserts after a bulk load */
+  _kvindex->insert("key500000");
+  ASSERT_EQ("key500000", _kvindex->get(50001));
+  _kvindex->erase("key500000");
+  ASSERT_EQ("key50001", _kvindex->get(50001));
+  check_order();
+}
+
+TEST_F(KVIndex_test, ScanAndFind)
+{
+  vector<string> keys;
+  ASSERT_EQ(S_OK, _kvindex->scan("key00010", "key00020", [&keys](const string &k) {
+    keys.push_back(k);
+    return true;
+  }));
+  ASSERT_EQ(10UL, keys.size());
+  ASSERT_EQ("key00010", keys.front());
+  ASSERT_EQ("key00019", keys.back());
+
+  IKVIndex::offset_t pos;
+  string             key;
+  ASSERT_EQ(S_OK, _kvindex->find("key12345", 0, IKVIndex::FIND_TYPE_EXACT, pos, key));
+  ASSERT_EQ(12345UL, pos);
+  ASSERT_EQ(S_OK, _kvindex->find("key0[5-9]007", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100000));
+  ASSERT_EQ("key05007", key);
+  ASSERT_EQ(S_OK, _kvindex->find("9998", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key));
+  ASSERT_EQ("key09998", key);
+}
+
+/* kill a writer mid-stream; the reopened index must hold a prefix of
+   the inserted sequence and be internally consistent */
+TEST_F(KVIndex_test, CrashRecovery)
+{
+  _kvindex->clear();
+  _kvindex->release_ref();
+  _kvindex = nullptr;
+
+  for (int round = 0; round < 5; round++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      auto index = open_index();
+      for (int i = 0;; i++) {
+        char key[32];
+        snprintf(key, sizeof key, "crash%08d", i);
+        index->insert(key);
+      }
+    }
+    usleep(100000 + static_cast<useconds_t>(round) * 50000);
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+
+    _kvindex   = open_index();
+    auto count = _kvindex->count();
+    PINF("Round %d: %lu keys survived", round, count);
+    ASSERT_FALSE(_kvindex->reopened_clean());
+    ASSERT_GT(count, 0UL);
+    check_order();
+    char key[32];
+    snprintf(key, sizeof key, "crash%08lu", count - 1);
+    ASSERT_EQ(string(key), _kvindex->get(count - 1));
+    _kvindex->clear();
+    _kvindex->release_ref();
+  }
+  _kvindex = open_index();
+}
+
+TEST_F(KVIndex_test, RebuildVsReopen)
+{
+  vector<string> keys;
+  for (int i = 0; i < COUNT; i++) {
+    keys.push_back(random_string(LENGTH));
+  }
+
+  /* rebuild: what AddIndex does for a pool without a usable index */
+  auto start = std::chrono::high_resolution_clock::now();
+  ASSERT_EQ(S_OK, _kvindex->bulk_load(std::move(keys)));
+  auto   end     = std::chrono::high_resolution_clock::now();
+  double rebuild = std::chrono::duration<double>(end - start).count();
+  auto   count   = _kvindex->count();
+
+  _kvindex->release_ref();
+  start     = std::chrono::high_resolution_clock::now();
+  _kvindex  = open_index();
+  auto n    = _kvindex->count();
+  auto k    = _kvindex->get(n / 2);
+  end       = std::chrono::high_resolution_clock::now();
+  double reopen_time = std::chrono::duration<double>(end - start).count();
+
+  ASSERT_EQ(count, n);
+  ASSERT_FALSE(k.empty());
+  ASSERT_TRUE(_kvindex->reopened_clean());
+  PINF("Keys: %lu rebuild (bulk load) sec: %lf reopen sec: %lf", n, rebuild, reopen_time);
+}
+
+TEST_F(KVIndex_test, Generation)
+{
+  ASSERT_EQ(S_OK, _kvindex->set_generation(42));
+  _kvindex->release_ref();
+
+  _kvindex = open_index();
+  ASSERT_TRUE(_kvindex->reopened_clean());
+  ASSERT_EQ(42UL, _kvindex->generation());
+}
+
+TEST_F(KVIndex_test, Release)
+{
+  _kvindex->release_ref();
+  ::unlink(index_path.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
@@ -1,7 +1,7 @@
 #include "ramrbtree.h"
 #include <stdlib.h>
+#include <algorithm>
 #include <regex>
-#include <set>
 
 #define SINGLE_THREADED
 
@@ -15,7 +15,7 @@ RamRBTree::RamRBTree(const std::string& owner, const std::string& name)
 	(void)name; // unused;
 }
 
-RamRBTree::RamRBTree() : _index{} {}
+RamRBTree::RamRBTree() : _index{}, _regex_cache{} {}
 
 RamRBTree::~RamRBTree() {}
 
@@ -37,9 +37,7 @@ string RamRBTree::get(offset_t position) const
     throw out_of_range("Position out of range");
   }
 
-  auto it = _index.begin();
-  advance(it, position);
-  return *it;
+  return *_index.find_by_order(position);
 }
 
 size_t RamRBTree::count() const { return _index.size(); }
@@ -55,52 +53,61 @@ status_t RamRBTree::find(const std::string& key_expression,
     return E_FAIL;
   }
 
-  offset_t end_position = _index.size();
-  unsigned attempts =0;
+  unsigned attempts = 0;
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wswitch" // enumeration value ‘FIND_TYPE_NONE’ not handled in switch
   switch (find_type) {
     case FIND_TYPE_REGEX:
       {
-        std::regex r(key_expression);
-        for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-          string key = RamRBTree::get(out_matched_pos);
-          if (regex_match(key, r)) {
+        const auto expr = _regex_cache.get(key_expression);
+
+        /* all matches lie in the range of keys starting with the prefix */
+        offset_t pos = begin_position;
+        if (!expr->prefix.empty()) pos = std::max<offset_t>(pos, _index.order_of_key(expr->prefix));
+
+        for (auto it = _index.find_by_order(pos); it != _index.end(); ++it, ++pos) {
+          const string& key = *it;
+          if (!expr->in_prefix_range(key)) break;
+
+          if (expr->match(key)) {
+            out_matched_pos = pos;
             out_matched_key = key;
             return S_OK;
           }
-          else {
-            if(++attempts > max_comparisons)
-              return E_MAX_REACHED;
+          else if (++attempts > max_comparisons) {
+            out_matched_pos = pos;
+            return E_MAX_REACHED;
           }
         }
       }
       break;
     case FIND_TYPE_EXACT:
-      for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-        string key = RamRBTree::get(out_matched_pos);
-        if (key.compare(key_expression) == 0) {
-          out_matched_key = key;
-          return S_OK;
-        }
-        else {
-          if(++attempts > max_comparisons)
-            return E_MAX_REACHED;
-        }
+      {
+        auto it = _index.find(key_expression);
+        if (it == _index.end()) break;
+        offset_t pos = _index.order_of_key(key_expression);
+        if (pos < begin_position) break;
+        out_matched_pos = pos;
+        out_matched_key = *it;
+        return S_OK;
       }
-      break;
     case FIND_TYPE_PREFIX:
-      for (out_matched_pos = begin_position; out_matched_pos <= end_position; out_matched_pos++) {
-        string key = RamRBTree::get(out_matched_pos);
-        if (key.find(key_expression) != string::npos) {
-          out_matched_key = key;
-          return S_OK;
+      {
+        offset_t pos = begin_position;
+        for (auto it = _index.find_by_order(pos); it != _index.end(); ++it, ++pos) {
+          if (it->find(key_expression) != string::npos) {
+            out_matched_pos = pos;
+            out_matched_key = *it;
+            return S_OK;
+          }
+          else if (++attempts > max_comparisons) {
+            out_matched_pos = pos;
+            return E_MAX_REACHED;
+          }
         }
       }
       break;
     case FIND_TYPE_NEXT:
-      if(begin_position >= end_position)
-        return E_FAIL;
       out_matched_key = get(begin_position);
       out_matched_pos = begin_position;
       return S_OK;
@@ -111,6 +118,20 @@ status_t RamRBTree::find(const std::string& key_expression,
   return E_FAIL;
 }
 
+status_t RamRBTree::scan(const std::string&                            start_key,
+                         const std::string&                            end_key,
+                         std::function<bool(const std::string& key)> callback)
+{
+  auto it = start_key.empty() ? _index.begin() : _index.lower_bound(start_key);
+
+  /* compare each key, since end_key may precede start_key */
+  for (; it != _index.end(); ++it) {
+    if (!end_key.empty() && *it >= end_key) break;
+    if (!callback(*it)) break;
+  }
+  return S_OK;
+}
+
 /**
  * Factory entry point
  *
@@ -13,8 +13,10 @@
 #ifndef __RAMRBTREE_COMPONENT_H__
 #define __RAMRBTREE_COMPONENT_H__
 
-#include <set>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
 #include <api/kvindex_itf.h>
+#include <index/common/find_expression.h>
 
 class RamRBTree : public Component::IKVIndex {
  public:
@@ -48,8 +50,19 @@ class RamRBTree : public Component::IKVIndex {
                            offset_t&          out_end_position,
                            std::string&       out_matched_key,
                            unsigned           max_comparisons = 0) override;
+  virtual status_t    scan(const std::string&                            start_key,
+                           const std::string&                            end_key,
+                           std::function<bool(const std::string& key)> callback) override;
 private:
-  std::set<std::string> _index;
+  /* order-statistics red-black tree: positions resolve in O(log n) */
+  using index_t = __gnu_pbds::tree<std::string,
+                                   __gnu_pbds::null_type,
+                                   std::less<std::string>,
+                                   __gnu_pbds::rb_tree_tag,
+                                   __gnu_pbds::tree_order_statistics_node_update>;
+
+  index_t                      _index;
+  Index::Find_expression_cache _regex_cache;
 };
 
 class RamRBTree_factory : public Component::IKVIndex_factory {
@@ -102,6 +102,67 @@ TEST_F(KVIndex_test, FIND)
   PINF("Key= %s", key.c_str());
 }
 
+TEST_F(KVIndex_test, Scan)
+{
+  _kvindex->clear();
+  for (int i = 0; i < 100; i++) {
+    char key[16];
+    snprintf(key, sizeof key, "key%03d", i);
+    _kvindex->insert(key);
+  }
+
+  vector<string> keys;
+  ASSERT_EQ(S_OK, _kvindex->scan("key010", "key020", [&keys](const string &k) {
+    keys.push_back(k);
+    return true;
+  }));
+  ASSERT_EQ(10UL, keys.size());
+  ASSERT_EQ("key010", keys.front());
+  ASSERT_EQ("key019", keys.back());
+
+  /* open ended range with early stop */
+  keys.clear();
+  ASSERT_EQ(S_OK, _kvindex->scan("key095", "", [&keys](const string &k) {
+    keys.push_back(k);
+    return keys.size() < 3;
+  }));
+  ASSERT_EQ(3UL, keys.size());
+  ASSERT_EQ("key097", keys.back());
+}
+
+TEST_F(KVIndex_test, RegexFind)
+{
+  /* reuses the key000..key099 set from Scan */
+  _kvindex->insert("apple");
+  _kvindex->insert("apricot");
+  _kvindex->insert("zebra");
+
+  IKVIndex::offset_t pos;
+  string             key;
+
+  /* literal prefix: seeks straight to the range */
+  ASSERT_EQ(S_OK, _kvindex->find("key05.*", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 1));
+  ASSERT_EQ("key050", key);
+  ASSERT_EQ(key, _kvindex->get(pos));
+
+  /* prefix plus general pattern; continue from after the first match */
+  ASSERT_EQ(S_OK, _kvindex->find("key0[5-9]7", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key057", key);
+  ASSERT_EQ(S_OK, _kvindex->find("key0[5-9]7", pos + 1, IKVIndex::FIND_TYPE_REGEX, pos, key, 100));
+  ASSERT_EQ("key067", key);
+
+  /* alternation has no common prefix */
+  ASSERT_EQ(S_OK, _kvindex->find("apple|zebra", 1, IKVIndex::FIND_TYPE_REGEX, pos, key, 1000));
+  ASSERT_EQ("zebra", key);
+
+  /* no key in the prefix range */
+  ASSERT_EQ(E_FAIL, _kvindex->find("nomatch.*", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 1000));
+
+  /* comparison budget is still honoured */
+  ASSERT_EQ(E_MAX_REACHED, _kvindex->find("ap.*z", 0, IKVIndex::FIND_TYPE_REGEX, pos, key, 0));
+  ASSERT_EQ(E_MAX_REACHED, _kvindex->find("nomatch", 0, IKVIndex::FIND_TYPE_PREFIX, pos, key, 0));
+}
+
 TEST_F(KVIndex_test, Erase) { _kvindex->erase("MyKey"); }
 
 TEST_F(KVIndex_test, Count) { PINF("Size: %lu", _kvindex->count()); }
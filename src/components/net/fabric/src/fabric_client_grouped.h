@@ -196,6 +196,7 @@ public:
    * @throw std::system_error : pselect fail
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override { return Fabric_connection_client::wait_for_next_completion(timeout); }
+  bool prepare_wait(std::vector<int> &fds) override { return Fabric_connection_client::prepare_wait(fds); }
   void unblock_completions() override { return Fabric_connection_client::unblock_completions(); }
   /* END IFabric_client_grouped (IFabric_op_completer) */
 
@@ -254,6 +254,11 @@ void Fabric_comm_grouped::wait_for_next_completion(unsigned polls_limit)
   return _conn.wait_for_next_completion(polls_limit);
 }
 
+bool Fabric_comm_grouped::prepare_wait(std::vector<int> &fds_)
+{
+  return _conn.prepare_wait(fds_);
+}
+
 /**
  * Unblock any threads waiting on completions
  *
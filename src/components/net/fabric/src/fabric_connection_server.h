@@ -114,6 +114,7 @@ public:
    * @throw std::system_error : pselect fail
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override { return Fabric_op_control::wait_for_next_completion(timeout); };
+  bool prepare_wait(std::vector<int> &fds) override { return Fabric_op_control::prepare_wait(fds); }
   void unblock_completions() override { return Fabric_op_control::unblock_completions(); };
   /* END IFabric_op_control */
   /**
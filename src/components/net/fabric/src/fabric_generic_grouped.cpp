@@ -140,6 +140,12 @@ void Fabric_generic_grouped::wait_for_next_completion(std::chrono::milliseconds
   return _cnxn.wait_for_next_completion(timeout);
 }
 
+bool Fabric_generic_grouped::prepare_wait(std::vector<int> &fds_)
+{
+  std::lock_guard<std::mutex> k{_m_cnxn};
+  return _cnxn.prepare_wait(fds_);
+}
+
 void Fabric_generic_grouped::unblock_completions()
 {
   std::lock_guard<std::mutex> k{_m_cnxn};
@@ -145,6 +145,7 @@ public:
    * @throw std::system_error : pselect fail
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override;
+  bool prepare_wait(std::vector<int> &fds) override;
   void unblock_completions() override;
   /* END IFabric_active_endpoint_grouped (IFabric_op_completer) */
 
@@ -91,13 +91,16 @@ struct mr_and_address
 
 auto Fabric_memory_control::register_memory(const void * addr_, std::size_t size_, std::uint64_t key_, std::uint64_t flags_) -> Component::IFabric_connection::memory_region_t
 {
+  /* access flags in flags_ restrict the registration; the rest go to fi_mr_reg */
+  const auto access_all = std::uint64_t(FI_SEND|FI_RECV|FI_READ|FI_WRITE|FI_REMOTE_READ|FI_REMOTE_WRITE);
+  const auto access = flags_ & access_all;
   auto mra =
     std::make_unique<mr_and_address>(
       make_fid_mr_reg_ptr(addr_,
                                 size_,
-                                std::uint64_t(FI_SEND|FI_RECV|FI_READ|FI_WRITE|FI_REMOTE_READ|FI_REMOTE_WRITE),
+                                access ? access : access_all,
                                 key_,
-                                flags_)
+                                flags_ & ~access_all)
       , addr_
       , size_
     );
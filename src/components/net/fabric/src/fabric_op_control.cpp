@@ -529,6 +529,42 @@ void Fabric_op_control::wait_for_next_completion(unsigned polls_limit)
   }
 }
 
+/**
+ * Collect the completion queue descriptors for a wait on many endpoints.
+ *
+ * @param fds_ Descriptors to wait on are appended
+ *
+ * @return true if no completion was queued at the time of the call
+ */
+bool Fabric_op_control::prepare_wait(std::vector<int> &fds_)
+{
+  if ( _shut_down )
+  {
+    return false;
+  }
+#if USE_WAIT_SETS
+  int fd;
+  CHECK_FI_ERR(::fi_control(&_wait_set->fid, FI_GETWAIT, &fd));
+  fds_.push_back(fd);
+  return true;
+#else
+  static constexpr unsigned cq_count = 2;
+  ::fid_t f[cq_count] = { _rxcq.fid(), _txcq.fid() };
+  /* as in wait_for_next_completion, blocking is safe only if trywait succeeds */
+  if ( fabric().trywait(f, cq_count) != FI_SUCCESS )
+  {
+    return false;
+  }
+  for ( unsigned i = 0; i != cq_count; ++i )
+  {
+    int fd;
+    CHECK_FI_ERR(::fi_control(f[i], FI_GETWAIT, &fd));
+    fds_.push_back(fd);
+  }
+  return true;
+#endif
+}
+
 /**
  * Unblock any threads waiting on completions
  *
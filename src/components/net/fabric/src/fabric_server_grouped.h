@@ -176,6 +176,7 @@ public:
    * @throw std::system_error : pselect fail
    */
   void wait_for_next_completion(std::chrono::milliseconds timeout) override { return Fabric_connection_server::wait_for_next_completion(timeout); }
+  bool prepare_wait(std::vector<int> &fds) override { return Fabric_connection_server::prepare_wait(fds); }
   void unblock_completions() override { return Fabric_connection_server::unblock_completions(); }
   /* END IFabric_server_grouped (IFabric_op_completer) */
 
@@ -129,48 +129,48 @@ template <typename T>
 		}
 		unsigned ref_count() noexcept { return _ref_count; }
 
+		/* The lock word is updated atomically: with THREAD_SAFE_HASH, readers
+		 * sharing a pool lock may take and release read locks concurrently. */
 		bool try_lock_shared()
 		{
-			const bool ok = 0 <= _lock;
-			if ( ok )
+			auto v = __atomic_load_n(&_lock, __ATOMIC_RELAXED);
+			while ( 0 <= v )
 			{
-				++_lock;
+				if ( __atomic_compare_exchange_n(&_lock, &v, v + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+				{
+					return true;
+				}
 			}
-			return ok;
+			return false;
 		}
 
 		bool try_lock_exclusive()
 		{
-			bool ok = 0 == _lock;
-			if ( ok )
-			{
-				_lock = -1;
-			}
-			return ok;
+			signed v = 0;
+			return __atomic_compare_exchange_n(&_lock, &v, -1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
 		}
 
 		void unlock()
 		{
-			switch ( _lock )
+			auto v = __atomic_load_n(&_lock, __ATOMIC_RELAXED);
+			while ( v != 0 )
 			{
-			case 0:
-				break;
-			case -1:
-				_lock = 0;
-				break;
-			default:
-				--_lock;
+				const signed n = v == -1 ? 0 : v - 1;
+				if ( __atomic_compare_exchange_n(&_lock, &v, n, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED) )
+				{
+					break;
+				}
 			}
 		}
 
 		bool is_locked() const
 		{
-			return _lock != 0;
+			return __atomic_load_n(&_lock, __ATOMIC_RELAXED) != 0;
 		}
 
 		void reset_lock()
 		{
-			_lock = 0;
+			__atomic_store_n(&_lock, 0, __ATOMIC_RELAXED);
 		}
 
 		T *data()
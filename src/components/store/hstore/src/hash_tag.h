@@ -0,0 +1,76 @@
+/*
+   Copyright [2017-2020] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#ifndef MCAS_HSTORE_HASH_TAG_H_
+#define MCAS_HSTORE_HASH_TAG_H_
+
+#if defined __AVX2__ || defined __SSE2__
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <limits>
+
+/*
+ * Hash tags: the high byte of each element's hash, kept in a byte array
+ * parallel to the buckets. A lookup compares the tag of its key against the
+ * tags of an entire hop neighborhood at once, and compares keys only where
+ * the tags match.
+ */
+
+namespace impl
+{
+	using hash_tag_t = std::uint8_t;
+
+	/* Bytes past the last bucket of a tag array, so that a neighborhood
+	 * read which starts at any bucket stays within the array.
+	 */
+	static constexpr unsigned hash_tag_span = 64U;
+
+	template <typename H>
+		hash_tag_t hash_tag(H h_)
+		{
+			/* The low bits choose the bucket; the high bits are independent of them. */
+			return hash_tag_t(h_ >> (std::numeric_limits<H>::digits - std::numeric_limits<hash_tag_t>::digits));
+		}
+
+	/* Bit i of the result is set if p_[i] == t_, for i in [0, hash_tag_span) */
+	inline std::uint64_t hash_tag_match(const hash_tag_t *p_, hash_tag_t t_)
+	{
+#if defined __AVX2__
+		const auto t = _mm256_set1_epi8(char(t_));
+		const auto lo = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p_)), t)));
+		const auto hi = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p_ + 32)), t)));
+		return std::uint64_t(hi) << 32U | lo;
+#elif defined __SSE2__
+		const auto t = _mm_set1_epi8(char(t_));
+		std::uint64_t m = 0;
+		for ( unsigned i = 0; i != hash_tag_span; i += 16U )
+		{
+			const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p_ + i));
+			m |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, t)))) << i;
+		}
+		return m;
+#else
+		std::uint64_t m = 0;
+		for ( unsigned i = 0; i != hash_tag_span; ++i )
+		{
+			m |= std::uint64_t(p_[i] == t_) << i;
+		}
+		return m;
+#endif
+	}
+}
+
+#endif
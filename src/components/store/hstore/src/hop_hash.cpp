@@ -41,3 +41,12 @@ impl::move_stuck::move_stuck(bix_t bi_, std::size_t size_)
 impl::hop_hash_full::hop_hash_full(bix_t bi_, std::size_t size_)
 	: no_near_empty_bucket{bi_, size_, __func__}
 {}
+
+impl::resize_migration_pending::resize_migration_pending(bix_t bi_)
+	: std::runtime_error{
+		"resize_migration_pending (index "
+		+ std::to_string(bi_)
+		+ ")"
+	}
+	, _bi(bi_)
+{}
@@ -20,10 +20,12 @@
 #include "bucket_control_unlocked.h"
 #include "construction_mode.h"
 #include "hash_bucket.h"
+#include "hash_tag.h"
 #include "hop_hash_log.h"
 #include "trace_flags.h"
 #include "persist_controller.h"
 #include "segment_and_bucket.h"
+#include "versioned_shared_mutex.h"
 
 #include <boost/iterator/transform_iterator.hpp>
 
@@ -33,10 +35,12 @@
 #include <functional> /* equal_to */
 #include <limits>
 #include <new> /* allocator */
+#include <mutex> /* unique_lock */
 #include <shared_mutex> /* shared_timed_mutex */
 #include <stdexcept>
 #include <string>
 #include <utility> /* hash, pair */
+#include <vector>
 
 /* Inteded to implement Hopscotch hashing
  * http://mcg.cs.tau.ac.il/papers/disc2008-hopscotch.pdf
@@ -84,6 +88,19 @@ namespace impl
 		hop_hash_full(bix_t bi, std::size_t size);
 	};
 
+	/* An insert reached buckets which an incremental resize has not yet migrated */
+	class resize_migration_pending
+		: public std::runtime_error
+	{
+	public:
+		using bix_t = std::size_t;
+	private:
+		bix_t _bi;
+	public:
+		explicit resize_migration_pending(bix_t bi);
+		bix_t bi() const { return _bi; }
+	};
+
 	template <typename HopHash>
 		class hop_hash_iterator;
 
@@ -212,6 +229,8 @@ namespace impl
 			: public bucket_control_unlocked<Bucket>
 		{
 			std::unique_ptr<bucket_mutexes<Mutex>[]> _bucket_mutexes;
+			/* hash tags of the segment's content, rebuilt when the table is opened */
+			std::unique_ptr<hash_tag_t[]> _bucket_tags;
 		public:
 			using base = bucket_control_unlocked<Bucket>;
 			using typename base::bucket_aligned_t;
@@ -222,6 +241,7 @@ namespace impl
 			)
 				: bucket_control_unlocked<Bucket>(index_, buckets_)
 				, _bucket_mutexes(nullptr)
+				, _bucket_tags(nullptr)
 			{
 			}
 			explicit bucket_control()
@@ -231,6 +251,12 @@ namespace impl
 			~bucket_control()
 			{
 			}
+			/* DRAM-only state for a segment of segment_size_ buckets */
+			void allocate_volatile(std::size_t segment_size_)
+			{
+				_bucket_mutexes.reset(new bucket_mutexes<Mutex>[segment_size_]);
+				_bucket_tags.reset(new hash_tag_t[segment_size_ + hash_tag_span]());
+			}
 		};
 
 	template <typename Allocator>
@@ -353,11 +379,44 @@ namespace impl
 
 			bool _auto_resize;
 
+			/* Incremental resize: once the table is 3/4 full, later inserts
+			 * construct the junior segment a piece at a time. The table is then
+			 * addressed at its new size while senior buckets are migrated a few
+			 * at a time by still later inserts. The resize state is in DRAM
+			 * only; after a crash the persistent "unstable" segment count
+			 * causes the constructor to complete the migration.
+			 */
+			bool _incremental_resize;
+			/* junior segment allocated and partly constructed, not yet linked in */
+			bool _junior_preparing;
+			bix_t _junior_constructed;
+			/* junior buckets constructed by every insert while the junior is prepared */
+			static constexpr unsigned resize_prepare_per_insert = 128U;
+			/* pre-resize bucket count, or 0 if no migration is in progress */
+			bix_t _migrate_bucket_count;
+			/* senior buckets before _migrate_cursor have been visited by resize_migrate_some */
+			bix_t _migrate_cursor;
+			bix_t _migrate_remaining;
+			std::vector<bool> _migrated;
+			/* senior buckets migrated by every insert while a migration is in progress */
+			static constexpr unsigned resize_migrate_per_insert = 4U;
+			/* Held while the addressing (bucket count, segment list, migration
+			 * state) changes. Optimistic readers retry across such a change.
+			 */
+			versioned_shared_mutex _addressing_mutex;
+
 			bucket_control_t _bc[_segment_capacity];
 
+			bool is_migrating() const { return _migrate_bucket_count != 0U; }
+
 			six_t segment_count() const override
 			{
-				return persist_controller_t::segment_count_actual().value();
+				/* the junior segment is addressable during a migration */
+				return
+					is_migrating()
+					? segment_count_not_stable() + 1U
+					: persist_controller_t::segment_count_actual().value()
+					;
 			}
 
 			six_t segment_count_not_stable() const
@@ -379,15 +438,53 @@ namespace impl
 				auto content_index_of_key(
 					Lock &bi
 					, const K &k
+					, hash_result_t hash
 				) const -> owner::index_type;
 
+			/* hash tags */
+			hash_tag_t get_tag(const segment_and_bucket_t &sb) const
+			{
+				return _bc[sb.si()]._bucket_tags[sb.bi()];
+			}
+			void set_tag(const segment_and_bucket_t &sb, hash_tag_t tag)
+			{
+				_bc[sb.si()]._bucket_tags[sb.bi()] = tag;
+			}
+			/* bit i set if the tag of bucket sb+i is tag */
+			auto tag_match(const segment_and_bucket_t &sb, hash_tag_t tag) const -> owner::value_type;
+			void tags_rebuild();
+
 			template <typename Lock, typename K>
 				auto locate_key(
 					Lock &bi
 					, const K &k
 				) const -> std::tuple<bucket_t *, segment_and_bucket_t>;
 
+			/* owner of the key (or, if not found, of its bucket) and the content index */
+			template <typename K>
+				auto locate_key_owner(
+					const K &k
+				) const -> std::tuple<owner_shared_lock_t, owner::index_type>;
+
+			enum class optimistic_result { absent, found, retry };
+			template <typename K, typename F>
+				auto find_optimistic_at(
+					bix_t ix
+					, const K &k
+					, hash_result_t hash
+					, F f
+				) const -> optimistic_result;
+
 			void resize();
+			void resize_junior_setup(bucket_aligned_t *junior_buckets);
+			void resize_incremental_step();
+			void resize_prepare_start();
+			void resize_prepare_some(bix_t n);
+			void resize_incremental_start();
+			void resize_migrate_bucket(bix_t ix_senior);
+			void resize_migrate_some(bix_t n);
+			void resize_migrate_near(bix_t ix);
+			void resize_migrate_check(bix_t ix) const;
 			void resize_pass1();
 			void resize_pass2();
 			bool resize_pass2_adjust_owner(
@@ -500,6 +597,19 @@ namespace impl
 
 			template <typename K>
 				auto count(const K &k) const -> size_type;
+
+			/* Lookup without locks, for readers concurrent with a writer.
+			 * Requires a SharedMutex with versions (versioned_shared_mutex).
+			 */
+			template <typename K, typename F>
+				bool find_optimistic(const K &key, F f) const;
+
+			/* Exclusive access to the content of an element, for a change made in
+			 * place through an iterator or mapped_type reference. Does not wait:
+			 * the lock does not own the mutex if the content is already locked.
+			 */
+			using content_lock_t = std::unique_lock<SharedMutex>;
+			auto lock_content(iterator it) const -> content_lock_t;
 			auto begin() -> iterator
 			{
 				return iterator(make_segment_and_bucket_at_begin(), 0U);
@@ -562,6 +672,8 @@ namespace impl
 
 			bool set_auto_resize(bool v1) { auto v0 = _auto_resize; _auto_resize = v1; return v0; }
 			bool get_auto_resize() const { return _auto_resize; }
+			bool set_incremental_resize(bool v1) { auto v0 = _incremental_resize; _incremental_resize = v1; return v0; }
+			bool get_incremental_resize() const { return _incremental_resize; }
 
 #if TRACED_TABLE
 			friend
@@ -681,6 +793,8 @@ template <
 		using base::size;
 		using base::get_auto_resize;
 		using base::set_auto_resize;
+		using base::get_incremental_resize;
+		using base::set_incremental_resize;
 		using base::bucket_count;
 		auto max_size() const noexcept -> size_type
 		{
@@ -706,6 +820,11 @@ template <
 		/* lookup */
 		using base::find;
 		using base::at;
+		using base::find_optimistic;
+
+		/* in-place change */
+		using typename base::content_lock_t;
+		using base::lock_content;
 
 		template <typename HopHash>
 			friend class impl::hop_hash_local_iterator_impl;
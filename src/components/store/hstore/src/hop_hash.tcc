@@ -17,6 +17,7 @@
 
 #include "bits_to_ints.h"
 #include "hop_hash_log.h"
+#include "hstore_config.h" /* HSTORE_INCREMENTAL_RESIZE */
 #include "key_not_found.h"
 #include "perishable.h"
 #include "perishable_expiry.h"
@@ -26,8 +27,11 @@
 #include <boost/iterator/transform_iterator.hpp>
 
 #include <algorithm>
+#include <atomic> /* atomic_thread_fence */
 #include <cassert>
+#include <cstring> /* memcpy */
 #include <exception>
+#include <type_traits> /* aligned_storage */
 #include <utility> /* move */
 
 
@@ -48,6 +52,14 @@ template <
 		, persist_controller_t(av_, pc_, mode_)
 		, _hasher{}
 		, _auto_resize{true}
+		, _incremental_resize{HSTORE_INCREMENTAL_RESIZE}
+		, _junior_preparing(false)
+		, _junior_constructed(0)
+		, _migrate_bucket_count(0)
+		, _migrate_cursor(0)
+		, _migrate_remaining(0)
+		, _migrated()
+		, _addressing_mutex()
 		, _locate_key_call(0)
 		, _locate_key_owned(0)
 		, _locate_key_unowned(0)
@@ -75,7 +87,7 @@ template <
 			_bc[ix]._next = &_bc[0];
 			_bc[ix]._prev = &_bc[0];
 			const auto segment_size = base_segment_size;
-			_bc[ix]._bucket_mutexes.reset(new bucket_mutexes_t[segment_size]);
+			_bc[ix].allocate_volatile(segment_size);
 			_bc[ix]._buckets_end = _bc[ix]._buckets + segment_size;
 			if ( mode_ == construction_mode::reconstitute )
 			{
@@ -91,7 +103,7 @@ template <
 			_bc[ix]._next = &_bc[0];
 			_bc[0]._prev = &_bc[ix];
 			const auto segment_size = base_segment_size << (ix-1U);
-			_bc[ix]._bucket_mutexes.reset(new bucket_mutexes_t[segment_size]);
+			_bc[ix].allocate_volatile(segment_size);
 			_bc[ix]._buckets_end = _bc[ix]._buckets + segment_size;
 			if ( mode_ == construction_mode::reconstitute )
 			{
@@ -116,7 +128,7 @@ template <
 			junior_bucket_control._prev = &_bc[ix-1];
 			junior_bucket_control._index = ix;
 			const auto segment_size = base_segment_size << (ix-1U);
-			junior_bucket_control._bucket_mutexes.reset(new bucket_mutexes_t[segment_size]);
+			junior_bucket_control.allocate_volatile(segment_size);
 			junior_bucket_control._buckets_end = junior_bucket_control._buckets + segment_size;
 
 			junior_bucket_control.reconstitute(av_);
@@ -124,8 +136,16 @@ template <
 			hop_hash_log<HSTORE_TRACE_RESIZE>::write(LOG_LOCATION
 				, " finishing resize in constructor"
 			);
-			resize_pass2();
-			this->persist_controller_t::resize_epilog();
+			/* The crash may have interrupted either resize, blocking (in pass 2)
+			 * or incremental. Migration of every senior bucket completes both.
+			 */
+			_bc[ix-1]._next = &junior_bucket_control;
+			_bc[0]._prev = &junior_bucket_control;
+			_migrate_bucket_count = this->persist_controller_t::bucket_count();
+			_migrate_remaining = _migrate_bucket_count;
+			_migrated.assign(_migrate_bucket_count, false);
+			this->persist_controller_t::resize_expose();
+			resize_migrate_some(_migrate_remaining);
 		}
 
 		hop_hash_log<TEST_HSTORE_PERISHABLE>::write(LOG_LOCATION, "HopHash base constructor: "
@@ -174,6 +194,8 @@ template <
 			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, "Restored size ", size());
 
 		}
+
+		tags_rebuild();
 	}
 
 template <
@@ -339,6 +361,7 @@ template <
 		hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION
 			, "(", start.index(), ") => ", content_lk.index());
 
+		resize_migrate_check(content_lk.index());
 		content_lk.assert_clear(true, *this);
 		return content_lk;
 	}
@@ -386,6 +409,8 @@ template <
 		auto free_distance = distance_wrapped(bi_, b_dst_lock_.index());
 		while ( owner::size <= free_distance )
 		{
+			/* the owners which may be asked to give up content near b_dst_lock_ */
+			resize_migrate_check(b_dst_lock_.index());
 			hop_hash_log<HSTORE_TRACE_LOCK>::write(LOG_LOCATION
 				, "owner ", bi_
 				, " nearest free location ", b_dst_lock_.index()
@@ -523,6 +548,7 @@ template <
 				assert(is_free(b_dst_lock_.sb()));
 
 				b_dst_lock_.ref().content_share(b_src_lock.ref());
+				set_tag(b_dst_lock_.sb(), get_tag(b_src_lock.sb()));
 				b_dst_lock_.owner_ref().set_adjacent_content_in_use(true);
 
 				this->persist_controller_t::persist_content(b_src_lock.ref(), "content free");
@@ -638,22 +664,43 @@ template <
 		RETRY:
 			/* convert the args to a value_type */
 			value_type v(std::forward<Args>(args)...);
+			const auto hash = _hasher.hf(v.first);
+
+			resize_incremental_step();
+
+		RELOCATE:
+			if ( is_migrating() )
+			{
+				resize_migrate_near(bucket_ix(hash));
+			}
 
 			/* The bucket in which to place the new entry */
-			auto sbw = make_segment_and_bucket(bucket(v.first));
+			auto sbw = make_segment_and_bucket(bucket_ix(hash));
 			auto owner_lk = make_owner_unique_lock(sbw);
 
 			/* If the key already exists, refuse to emplace */
-			if ( auto cv = owner_lk.ref().ownership_bits(owner_lk) )
 			{
-				auto sbc = sbw;
-				owner::index_type i = 0;
-				for ( ; cv ; cv >>= 1U, sbc.incr_with_wrap(), ++i )
+				const auto i = content_index_of_key(owner_lk, v.first, hash);
+				if ( i != owner::size )
+				{
+					hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " (already present)");
+					return {iterator{sbw, i}, false};
+				}
+			}
+
+			if ( is_migrating() )
+			{
+				/* The key may also be present, not yet migrated, at its senior owner */
+				const auto ix_senior_owner = hash & (_migrate_bucket_count - 1U);
+				if ( ix_senior_owner != sbw.index() )
 				{
-					if ( (cv & 1U) && key_equal()(sbc.deref().key(), v.first) )
+					auto senior_owner_sb = make_segment_and_bucket(ix_senior_owner);
+					auto senior_owner_lk = make_owner_shared_lock(senior_owner_sb);
+					const auto i = content_index_of_key(senior_owner_lk, v.first, hash);
+					if ( i != owner::size )
 					{
-						hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " (already present)");
-						return {iterator{sbw, i}, false};
+						hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " (already present, senior)");
+						return {iterator{senior_owner_sb, i}, false};
 					}
 				}
 			}
@@ -682,6 +729,7 @@ template <
 				{
 					persist_size_change<Allocator, size_incr> s(*this);
 					b_dst.ref().content_construct(owner_lk.index(), std::move(v));
+					set_tag(b_dst.sb(), hash_tag(hash));
 					if ( owner_lk.index() == b_dst.index() )
 					{
 						owner_lk.ref().set_adjacent_content_in_use();
@@ -711,16 +759,44 @@ template <
 				perishable::test();
 				return {iterator{sbw, content_index}, true};
 			}
+			catch ( const resize_migration_pending &e )
+			{
+				owner_lk.unlock();
+				resize_migrate_near(e.bi());
+				goto RELOCATE;
+			}
 			catch ( const no_near_empty_bucket &e )
 			{
 				if ( _auto_resize )
 				{
 					owner_lk.unlock();
 
+					if ( is_migrating() )
+					{
+						/* The table is full again before the last resize finished:
+						 * complete that resize before considering another.
+						 */
+						resize_migrate_some(_migrate_remaining);
+						goto RELOCATE;
+					}
+
 					hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, "1. before resize\n", dump<HSTORE_TRACE_MANY>::make_hop_hash_dump(*this));
 
+					if ( _junior_preparing )
+					{
+						/* full before the junior segment was ready: finish it now */
+						resize_prepare_some(bucket_count());
+						goto RELOCATE;
+					}
+
 					if ( segment_count() < _segment_capacity )
 					{
+						if ( _incremental_resize )
+						{
+							resize_prepare_start();
+							resize_prepare_some(bucket_count());
+							goto RELOCATE;
+						}
 						resize();
 						hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, "2. after resize\n", dump<HSTORE_TRACE_MANY>::make_hop_hash_dump(*this));
 						goto RETRY;
@@ -760,18 +836,8 @@ template <
 			, " capacity ", bucket_count()
 			, " size ", size()
 		);
-		{
-#if 0
-			monitor_extend<Allocator> m{bucket_allocator_t(av)};
-#endif
-			_bc[segment_count()]._buckets = this->persist_controller_t::resize_prolog();
-		}
-		_bc[segment_count()]._next = &_bc[0];
-		_bc[segment_count()]._prev = &_bc[segment_count()-1];
-		_bc[segment_count()]._index = segment_count();
-		auto segment_size = bucket_count();
-		_bc[segment_count()]._bucket_mutexes.reset(new bucket_mutexes_t[segment_size]);
-		_bc[segment_count()]._buckets_end = _bc[segment_count()]._buckets + segment_size;
+		std::lock_guard<versioned_shared_mutex> g{_addressing_mutex};
+		resize_junior_setup(this->persist_controller_t::resize_prolog());
 
 		/* adjust count and everything which depends on it (size, mask) */
 
@@ -814,6 +880,336 @@ template <
 		this->persist_controller_t::resize_epilog();
 	}
 
+/* Set up the (DRAM) bucket control for a newly allocated junior segment.
+ * The junior segment is not yet linked into the list of segments.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_junior_setup(
+		bucket_aligned_t *junior_buckets_
+	)
+	{
+		_bc[segment_count()]._buckets = junior_buckets_;
+		_bc[segment_count()]._next = &_bc[0];
+		_bc[segment_count()]._prev = &_bc[segment_count()-1];
+		_bc[segment_count()]._index = segment_count();
+		auto segment_size = bucket_count();
+		_bc[segment_count()].allocate_volatile(segment_size);
+		_bc[segment_count()]._buckets_end = _bc[segment_count()]._buckets + segment_size;
+	}
+
+/*
+ * Incremental resize.
+ *
+ * Instead of copying all senior content (pass 1) and then fixing owners
+ * (pass 2), the junior segment is linked in at once and the table is
+ * addressed at twice its size. Each senior bucket is then migrated on its
+ * own (resize_migrate_bucket) in a single step which moves the content, if
+ * necessary, and updates its owners.
+ *
+ * Until a senior bucket is migrated, its content is at the position given by
+ * the old addressing and is owned by its senior owner. Lookups which miss at
+ * the new owner therefore also check the senior owner. Inserts first migrate
+ * the buckets around the new owner, so that new content is placed, and
+ * existing content displaced, only among migrated buckets.
+ *
+ * Content whose senior owner wrapped around the end of the table would be at
+ * a different position under the new addressing, so the buckets at the start
+ * of the table are migrated first.
+ *
+ * Before all that, the junior segment is allocated and then constructed in
+ * pieces (resize_prepare_some), so that no one insert pays for a whole
+ * segment. Until it is linked in, the junior segment is not referenced by
+ * the persistent segment count, and a crash (or close) abandons it; the
+ * next resize finds it in the segment table and reuses it.
+ */
+
+/* The resize work done by every insert */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_incremental_step()
+	{
+		if ( is_migrating() )
+		{
+			resize_migrate_some(resize_migrate_per_insert);
+		}
+		else if ( _junior_preparing )
+		{
+			resize_prepare_some(resize_prepare_per_insert);
+		}
+		else if (
+			_incremental_resize
+			&& _auto_resize
+			&& segment_count() < _segment_capacity
+			&& bucket_count() / 4U * 3U <= size()
+		)
+		{
+			resize_prepare_start();
+		}
+	}
+
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_prepare_start()
+	{
+		hop_hash_log<HSTORE_TRACE_RESIZE>::write(LOG_LOCATION
+			, " incremental, capacity ", bucket_count()
+			, " size ", size()
+		);
+		resize_junior_setup(this->persist_controller_t::resize_prolog_unconstructed());
+		_junior_preparing = true;
+		_junior_constructed = 0U;
+	}
+
+/* Construct (and persist) the next n junior buckets, and start the
+ * migration once all are constructed.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_prepare_some(
+		bix_t n_
+	)
+	{
+		const auto first = _junior_constructed;
+		_junior_constructed = std::min(first + n_, bucket_count());
+		this->persist_controller_t::resize_construct(first, _junior_constructed);
+		if ( _junior_constructed == bucket_count() )
+		{
+			_junior_preparing = false;
+			resize_incremental_start();
+		}
+	}
+
+/* Link in the (constructed) junior segment and begin the migration */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_incremental_start()
+	{
+		{
+			std::lock_guard<versioned_shared_mutex> g{_addressing_mutex};
+			const auto old_segment_count = segment_count();
+			this->persist_controller_t::resize_interlog();
+
+			/* link in new segment in non-persistent circular list of segments */
+			_bc[old_segment_count-1]._next = &_bc[old_segment_count];
+			_bc[0]._prev = &_bc[old_segment_count];
+
+			_migrate_bucket_count = this->persist_controller_t::bucket_count();
+			_migrate_cursor = 0U;
+			_migrate_remaining = _migrate_bucket_count;
+			_migrated.assign(_migrate_bucket_count, false);
+			this->persist_controller_t::resize_expose();
+		}
+
+		resize_migrate_some(owner::size);
+	}
+
+/* Migrate a senior bucket. Idempotent, so that a restart can apply it to
+ * every senior bucket whether or not it was migrated before the crash.
+ *
+ * Let s be the senior bucket and j (s + old bucket count) its junior partner.
+ *  - s free: nothing to migrate.
+ *  - s and j in use with the same key: a move was interrupted after the copy
+ *    to j. Complete it.
+ *  - s and j in use with different keys: s was migrated.
+ *  - s in use, j free: the content is owned under the old addressing iff its
+ *    senior owner claims it. If so, move it to its new position (s or j) and
+ *    transfer ownership to the new owner.
+ *
+ * Order of persisted changes: junior content, new owner, senior owner, senior
+ * content (free). Each state in between is recognized by the cases above.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_migrate_bucket(
+		bix_t ix_senior_
+	)
+	{
+		const auto senior_count = _migrate_bucket_count;
+		auto senior_content_lk = make_content_unique_lock(make_segment_and_bucket(ix_senior_));
+		if ( is_free(senior_content_lk.sb()) )
+		{
+			return;
+		}
+
+		auto junior_content_lk = make_content_unique_lock(make_segment_and_bucket(ix_senior_ + senior_count));
+		const auto hash = _hasher.hf(senior_content_lk.ref().key());
+		const auto ix_senior_owner = hash & (senior_count - 1U);
+		const auto ix_junior_owner = bucket_ix(hash);
+		const auto owner_pos = unsigned((ix_senior_ + senior_count - ix_senior_owner) & (senior_count - 1U));
+		const bool moves = ( ( ix_junior_owner + owner_pos ) & mask() ) != ix_senior_;
+
+		if ( ! is_free(junior_content_lk.sb()) )
+		{
+			if ( ! key_equal()(junior_content_lk.ref().key(), senior_content_lk.ref().key()) )
+			{
+				return;
+			}
+			assert(moves);
+		}
+		else
+		{
+			if ( owner::size <= owner_pos )
+			{
+				return;
+			}
+			auto senior_owner_lk = make_owner_unique_lock(make_segment_and_bucket(ix_senior_owner));
+			if ( ( ( senior_owner_lk.ref().ownership_bits(senior_owner_lk) >> owner_pos ) & 1U ) == 0U )
+			{
+				return;
+			}
+
+			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION
+				, " migrate ", ix_senior_, " owner ", ix_senior_owner, " -> ", ix_junior_owner
+				, ( moves ? " content moves" : "" )
+			);
+
+			if ( moves )
+			{
+				junior_content_lk.ref().content_share(senior_content_lk.ref(), ix_junior_owner);
+				set_tag(junior_content_lk.sb(), hash_tag(hash));
+				junior_content_lk.owner_ref().set_adjacent_content_in_use();
+				this->persist_controller_t::persist_content(junior_content_lk.ref(), "migrate junior content");
+			}
+		}
+
+		if ( ix_senior_owner != ix_junior_owner )
+		{
+			auto senior_owner_lk = make_owner_unique_lock(make_segment_and_bucket(ix_senior_owner));
+			auto junior_owner_lk = make_owner_unique_lock(make_segment_and_bucket(ix_junior_owner));
+			junior_owner_lk.ref().insert(
+				ix_junior_owner
+				, owner_pos
+				, junior_owner_lk
+				, static_cast<persist_controller_t *>(this)
+			);
+			this->persist_controller_t::persist_owner(junior_owner_lk.ref(), "migrate junior owner");
+			senior_owner_lk.ref().erase(
+				owner_pos
+				, senior_owner_lk
+				, static_cast<persist_controller_t *>(this)
+			);
+			this->persist_controller_t::persist_owner(senior_owner_lk.ref(), "migrate senior owner");
+		}
+
+		if ( moves )
+		{
+			senior_content_lk.ref().content_erase();
+			senior_content_lk.owner_ref().set_adjacent_content_in_use(false);
+			this->persist_controller_t::persist_content(senior_content_lk.ref(), "migrate senior content");
+		}
+#if TRACK_OWNER
+		else if ( ix_senior_ < ix_junior_owner )
+		{
+			senior_content_lk.ref().owner_update(senior_count);
+		}
+#endif
+	}
+
+/* Migrate the next n unmigrated senior buckets, and finish the resize
+ * if none remain.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_migrate_some(
+		bix_t n_
+	)
+	{
+		for ( ; n_ != 0U && _migrate_cursor != _migrate_bucket_count; ++_migrate_cursor )
+		{
+			if ( ! _migrated[_migrate_cursor] )
+			{
+				resize_migrate_bucket(_migrate_cursor);
+				_migrated[_migrate_cursor] = true;
+				--_migrate_remaining;
+				--n_;
+			}
+		}
+
+		if ( _migrate_remaining == 0U )
+		{
+			std::lock_guard<versioned_shared_mutex> g{_addressing_mutex};
+			this->persist_controller_t::resize_epilog();
+			_migrate_bucket_count = 0U;
+			_migrate_cursor = 0U;
+			std::vector<bool>().swap(_migrated);
+
+			hop_hash_log<HSTORE_TRACE_RESIZE>::write(LOG_LOCATION
+				, " incremental resize complete, capacity ", bucket_count()
+			);
+		}
+	}
+
+/* Migrate the senior buckets which an insert owned at ix may examine:
+ * those within owner::size of ix (see resize_migrate_check), and beyond
+ * that the likely location of free content.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_migrate_near(
+		bix_t ix_
+	)
+	{
+		const auto senior_mask = _migrate_bucket_count - 1U;
+		const auto first = ix_ + _migrate_bucket_count - (owner::size - 1U);
+		for ( bix_t i = 0U; i != 3U * owner::size - 1U && is_migrating(); ++i )
+		{
+			const auto ix_senior = ( first + i ) & senior_mask;
+			if ( ! _migrated[ix_senior] )
+			{
+				resize_migrate_bucket(ix_senior);
+				_migrated[ix_senior] = true;
+				if ( --_migrate_remaining == 0U )
+				{
+					/* let resize_migrate_some finish the resize */
+					resize_migrate_some(0U);
+				}
+			}
+		}
+	}
+
+/* An insert may use content at ix, and may move content to ix from the
+ * owners which precede it, only if every bucket which those owners may own
+ * has been migrated.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::resize_migrate_check(
+		bix_t ix_
+	) const
+	{
+		if ( is_migrating() )
+		{
+			const auto senior_mask = _migrate_bucket_count - 1U;
+			const auto first = ix_ + _migrate_bucket_count - (owner::size - 1U);
+			for ( bix_t i = 0U; i != 2U * owner::size - 1U; ++i )
+			{
+				if ( ! _migrated[( first + i ) & senior_mask] )
+				{
+					throw resize_migration_pending(ix_);
+				}
+			}
+		}
+	}
+
 template <
 	typename Key, typename T, typename Hash, typename Pred
 	, typename Allocator, typename SharedMutex
@@ -882,6 +1278,7 @@ template <
 				{
 					/* content must move */
 					junior_content.content_share(senior_content_lk.ref(), ix_owner);
+					_bc[segment_count()]._bucket_tags[ix_senior] = hash_tag(hash);
 					junior_owner.set_adjacent_content_in_use();
 
 					hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION
@@ -1349,12 +1746,13 @@ template <
 		auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::content_index_of_key(
 			Lock &bi_
 			, const K &k_
+			, const hash_result_t hash_
 		) const -> owner::index_type
 		{
-			/* Use the owner to filter key checks, a performance aid
-			 * to reduce the number of key compares.
+			/* Use the owner, and then the hash tags, to filter key checks,
+			 * a performance aid to reduce the number of key compares.
 			 */
-			auto wv = bi_.ref().ownership_bits(bi_);
+			const auto wv = bi_.ref().ownership_bits(bi_);
 
 			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION
 				, " owner "
@@ -1362,43 +1760,83 @@ template <
 				, " value ", wv
 			);
 
-			auto bfp = bi_.sb();
 			auto &t =
 				*const_cast<hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex> *>(this);
 			++t._locate_key_call;
+			const auto owned = unsigned(__builtin_popcountll(wv));
+			t._locate_key_owned += owned;
+			t._locate_key_unowned += owner::size - owned;
 
-			typename owner::index_type content_index = 0U;
 			for (
-				; content_index != owner::size
-				; ++content_index
+				auto cv = wv & tag_match(bi_.sb(), hash_tag(hash_))
+				; cv != 0U
+				; cv &= cv - 1U
 			)
 			{
-				if ( ( wv & 1 ) == 1 )
+				const auto content_index = owner::index_type(__builtin_ctzll(cv));
+				auto bfp = bi_.sb();
+				bfp.add_small(content_index);
+				if ( key_equal()(bfp.deref().key(), k_) )
 				{
-					++t._locate_key_owned;
-					auto c = &bfp.deref();
-					if ( key_equal()(c->key(), k_) )
-					{
-						++t._locate_key_match;
-						hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " returns (success) ", bfp.index());
-						return content_index;
-					}
-					else
-					{
-						++t._locate_key_mismatch;
-					}
+					++t._locate_key_match;
+					hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " returns (success) ", bfp.index());
+					return content_index;
 				}
+				else
 				{
-					++t._locate_key_unowned;
+					++t._locate_key_mismatch;
 				}
-				bfp.incr_with_wrap();
-				wv >>= 1U;
 			}
 
-			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " returns (failure) ", bfp.index());
+			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION, " returns (failure) ", bi_.index());
 
-			return content_index;
+			return owner::size;
+		}
+
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::tag_match(
+		const segment_and_bucket_t &sb_
+		, const hash_tag_t tag_
+	) const -> owner::value_type
+	{
+		const auto &bc = _bc[sb_.si()];
+		const auto m = hash_tag_match(&bc._bucket_tags[sb_.bi()], tag_);
+		/* buckets remaining in the segment */
+		const auto n = bc.segment_size() - sb_.bi();
+		if ( n < owner::size )
+		{
+			/* The neighborhood continues into the next segment or, at the end
+			 * of the table, wraps to the first segment.
+			 */
+			const auto &bc_next = _bc[bc._next->index()];
+			return
+				( m & ( ( owner::value_type(1U) << n ) - 1U ) )
+				| hash_tag_match(&bc_next._bucket_tags[0], tag_) << n
+				;
+		}
+		return m;
+	}
+
+/* Tags are not persisted: derive them from the keys in use */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	void impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::tags_rebuild()
+	{
+		const auto sb_end = make_segment_and_bucket_at_end();
+		for ( auto sb = make_segment_and_bucket_for_iterator(0); sb != sb_end; sb.incr_without_wrap() )
+		{
+			const bucket_t &b = sb.deref();
+			if ( b.is_adjacent_content_in_use() )
+			{
+				set_tag(sb, hash_tag(_hasher.hf(b.key())));
+			}
 		}
+	}
 
 template <
 	typename Key, typename T, typename Hash, typename Pred
@@ -1465,6 +1903,174 @@ template <
 				);
 		}
 
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	template <typename K>
+		auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::locate_key_owner(
+			const K &k_
+		) const -> std::tuple<owner_shared_lock_t, owner::index_type>
+		{
+			const auto hash = _hasher.hf(k_);
+			auto bi_lk = make_owner_shared_lock(make_segment_and_bucket(bucket_ix(hash)));
+			auto content_ix = content_index_of_key(bi_lk, k_, hash);
+			if ( content_ix == owner::size && is_migrating() )
+			{
+				/* Content which an incremental resize has not yet migrated is
+				 * owned by its senior owner. (It is at the same position under
+				 * either addressing, as content which wrapped is migrated first.)
+				 */
+				const auto ix_senior_owner = hash & (_migrate_bucket_count - 1U);
+				if ( ix_senior_owner != bi_lk.index() )
+				{
+					auto senior_lk = make_owner_shared_lock(make_segment_and_bucket(ix_senior_owner));
+					const auto senior_content_ix = content_index_of_key(senior_lk, k_, hash);
+					if ( senior_content_ix != owner::size )
+					{
+						return std::tuple<owner_shared_lock_t, owner::index_type>(std::move(senior_lk), senior_content_ix);
+					}
+				}
+			}
+			return std::tuple<owner_shared_lock_t, owner::index_type>(std::move(bi_lk), content_ix);
+		}
+
+/*
+ * Lookup without locks, for readers concurrent with a writer (THREAD_SAFE_HASH).
+ *
+ * The reader copies each candidate content bucket, and trusts a copy only if
+ * neither the content nor its owner has been locked since the reader first
+ * read the owner. After f_ has run on the copy of the matching element the
+ * check is repeated and, if it fails, the whole lookup is retried. So f_ may
+ * run more than once, and must not rely on anything from an earlier run.
+ *
+ * f_ receives the mapped value (of the copy) and a predicate which tells
+ * whether the copy is still current. Out-of-line data may be freed at any
+ * time; f_ can use the predicate to check that a length or pointer read from
+ * that data is genuine before it relies on it.
+ */
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	template <typename K, typename F>
+		bool impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::find_optimistic(
+			const K &k_
+			, F f_
+		) const
+		{
+			const auto hash = _hasher.hf(k_);
+			for ( ;; )
+			{
+				const auto av = _addressing_mutex.version();
+				if ( ! versioned_shared_mutex::is_stable(av) )
+				{
+					cpu_relax();
+					continue;
+				}
+				const auto ix = bucket_ix(hash);
+				auto r = find_optimistic_at(ix, k_, hash, f_);
+				if ( r == optimistic_result::absent && is_migrating() )
+				{
+					/* see locate_key_owner */
+					const auto ix_senior_owner = hash & (_migrate_bucket_count - 1U);
+					if ( ix_senior_owner != ix )
+					{
+						r = find_optimistic_at(ix_senior_owner, k_, hash, f_);
+					}
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if ( r != optimistic_result::retry && _addressing_mutex.version() == av )
+				{
+					return r == optimistic_result::found;
+				}
+			}
+		}
+
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	template <typename K, typename F>
+		auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::find_optimistic_at(
+			const bix_t ix_
+			, const K &k_
+			, const hash_result_t hash_
+			, F f_
+		) const -> optimistic_result
+		{
+			const auto sbw = make_segment_and_bucket(ix_);
+			const auto &owner_mutex = locate_bucket_mutexes(sbw)._m_owner;
+			const auto ov = owner_mutex.version();
+			if ( ! versioned_shared_mutex::is_stable(ov) )
+			{
+				return optimistic_result::retry;
+			}
+
+			int lock = 0;
+			/* a tag is written before its content is owned, so a stale tag is caught by the owner version */
+			for (
+				auto candidates = sbw.deref().ownership_bits(lock) & tag_match(sbw, hash_tag(hash_))
+				; candidates != 0U
+				; candidates &= candidates - 1U
+			)
+			{
+				auto sb = sbw;
+				sb.add_small(unsigned(__builtin_ctzll(candidates)));
+				const auto &content_mutex = locate_bucket_mutexes(sb)._m_content;
+				const auto cv = content_mutex.version();
+				const auto is_current =
+					[&owner_mutex, ov, &content_mutex, cv] ()
+					{
+						std::atomic_thread_fence(std::memory_order_acquire);
+						return owner_mutex.version() == ov && content_mutex.version() == cv;
+					};
+				/* The copy is never constructed or destroyed: it is only read */
+				typename std::aligned_storage<sizeof(content_t), alignof(content_t)>::type copy;
+				std::memcpy(&copy, static_cast<const void *>(&static_cast<const content_t &>(sb.deref())), sizeof copy);
+				const auto &c = *static_cast<const content_t *>(static_cast<const void *>(&copy));
+				/* An inline key is compared within the copy. An out-of-line key
+				 * may be freed by a writer at any time, so it is dereferenced only
+				 * once the copy has been validated, and the comparison is validated
+				 * again. Pool memory stays mapped, and the key size is compared
+				 * before any key bytes, so a late free costs a retry, not a fault.
+				 */
+				const bool inline_key = c.key().is_inline();
+				bool match = inline_key && key_equal()(c.key(), k_);
+				if ( ! versioned_shared_mutex::is_stable(cv) || ! is_current() )
+				{
+					return optimistic_result::retry;
+				}
+				if ( ! inline_key )
+				{
+					match = key_equal()(c.key(), k_);
+					if ( ! is_current() )
+					{
+						return optimistic_result::retry;
+					}
+				}
+				if ( match )
+				{
+					f_(c.mapped(), is_current);
+					return is_current() ? optimistic_result::found : optimistic_result::retry;
+				}
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return owner_mutex.version() == ov ? optimistic_result::absent : optimistic_result::retry;
+		}
+
+template <
+	typename Key, typename T, typename Hash, typename Pred
+	, typename Allocator, typename SharedMutex
+>
+	auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::lock_content(
+		iterator it_
+	) const -> content_lock_t
+	{
+		return content_lock_t(locate_bucket_mutexes(it_.sb_content())._m_content, std::try_to_lock);
+	}
+
 template <
 	typename Key, typename T, typename Hash, typename Pred
 	, typename Allocator, typename SharedMutex
@@ -1472,9 +2078,9 @@ template <
 	template <typename K>
 		auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::find(const K &k_) -> iterator
 		{
-			auto bi_lk = make_owner_shared_lock(k_);
-			const auto content_ix = content_index_of_key(bi_lk, k_);
-			return content_ix == owner::size ? end() : iterator{bi_lk.sb(), content_ix};
+			const auto bf = locate_key_owner(k_);
+			const auto content_ix = std::get<1>(bf);
+			return content_ix == owner::size ? end() : iterator{std::get<0>(bf).sb(), content_ix};
 		}
 
 template <
@@ -1484,9 +2090,9 @@ template <
 	template <typename K>
 		auto impl::hop_hash_base<Key, T, Hash, Pred, Allocator, SharedMutex>::find(const K &k_) const -> const_iterator
 		{
-			auto bi_lk = make_owner_shared_lock(k_);
-			const auto bf = locate_key(bi_lk, k_);
-			return std::get<0>(bf) ? std::get<1>(bf) : end();
+			const auto bf = locate_key_owner(k_);
+			const auto content_ix = std::get<1>(bf);
+			return content_ix == owner::size ? end() : const_iterator{std::get<0>(bf).sb(), content_ix};
 		}
 
 template <
@@ -1574,18 +2180,17 @@ template <
 			const K &k_
 		) const -> size_type
 		{
-			auto bi_lk = make_owner_shared_lock(k_);
-			const auto bf = locate_key(bi_lk, k_);
+			auto bf = locate_key_owner(k_);
 
 			hop_hash_log<HSTORE_TRACE_MANY>::write(LOG_LOCATION
 				, " ", k_
-				, " starting at ", bi_lk.index()
+				, " owner ", std::get<0>(bf).index()
 				, " "
-				, dump<HSTORE_TRACE_MANY>::make_owner_print(this->bucket_count(), bi_lk)
+				, dump<HSTORE_TRACE_MANY>::make_owner_print(this->bucket_count(), std::get<0>(bf))
 				, " found "
-				, *bf);
+				, std::get<1>(bf) != owner::size);
 
-			return std::get<0>(bf) ? 1U : 0U;
+			return std::get<1>(bf) == owner::size ? 0U : 1U;
 		}
 
 template <
@@ -1598,15 +2203,16 @@ template <
 		) const -> const mapped_type &
 		{
 			/* The bucket which owns the entry */
-			auto bi_lk = make_owner_shared_lock(k_);
-			const auto bf = std::get<0>(locate_key(bi_lk, k_));
-			if ( ! bf )
+			const auto bf = locate_key_owner(k_);
+			if ( std::get<1>(bf) == owner::size )
 			{
 				/* no such element */
 				throw impl::key_not_found{};
 			}
 			/* element found at bf */
-			return bf->mapped();
+			auto sbc = std::get<0>(bf).sb();
+			sbc.add_small(std::get<1>(bf));
+			return sbc.deref().mapped();
 		}
 
 template <
@@ -1619,15 +2225,16 @@ template <
 		) -> mapped_type &
 		{
 			/* Lock the entry owner */
-			auto bi_lk = make_owner_shared_lock(k_);
-			const auto bf = std::get<0>(locate_key(bi_lk, k_));
-			if ( ! bf )
+			const auto bf = locate_key_owner(k_);
+			if ( std::get<1>(bf) == owner::size )
 			{
 				/* no such element */
 				throw impl::key_not_found{};
 			}
 			/* element found at bf */
-			return bf->mapped();
+			auto sbc = std::get<0>(bf).sb();
+			sbc.add_small(std::get<1>(bf));
+			return sbc.deref().mapped();
 		}
 
 template <
@@ -132,7 +132,7 @@ int hstore::get_capability(const Capability cap) const
   case Capability::POOL_DELETE_CHECK: /*< checks if pool is open before allowing delete */
     return false;
   case Capability::RWLOCK_PER_POOL:   /*< pools are locked with RW-lock */
-    return false;
+    return is_thread_safe;
   case Capability::POOL_THREAD_SAFE:  /*< pools can be shared across multiple client threads */
     return is_thread_safe;
   default:
@@ -245,6 +245,7 @@ auto hstore::grow_pool(
   {
     return Component::IKVStore::E_POOL_NOT_FOUND;
   }
+  auto lk = session->writer_lock();
   try
   {
     reconfigured_size = session->pool_grow(_pool_manager->devdax_manager(), increment_size);
@@ -286,6 +287,8 @@ auto hstore::put(const pool_t pool,
 
   if ( session )
   {
+    /* insert and any update are one write */
+    auto lk = session->writer_lock();
     try
     {
       auto i = session->insert(key, value, value_len);
@@ -437,6 +440,7 @@ auto hstore::get_attribute(
     return Component::IKVStore::E_POOL_NOT_FOUND;
   }
 
+  auto lk = session->reader_lock();
   switch ( attr )
   {
   case VALUE_LEN:
@@ -517,7 +521,10 @@ auto hstore::set_attribute(
     {
       return E_BAD_PARAM;
     }
-    session->set_auto_resize(bool(value[0]));
+    {
+      auto lk = session->writer_lock();
+      session->set_auto_resize(bool(value[0]));
+    }
     return S_OK;
   default:
     return E_NOT_SUPPORTED;
@@ -533,13 +540,15 @@ auto hstore::resize_value(
 ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
+  if ( ! session )
+  {
+    return E_FAIL;
+  }
+  auto lk = session->writer_lock();
   try
   {
-    return
-      session
-      ? ( session->resize_mapped(key, new_value_len, alignment), S_OK )
-      : E_FAIL
-      ;
+    session->resize_mapped(key, new_value_len, alignment);
+    return S_OK;
   }
   /* how might this fail? Out of memory, key not found, not locked, read locked */
   catch ( const std::invalid_argument & )
@@ -573,7 +582,18 @@ auto hstore::lock(
   const auto session = static_cast<session_t *>(locate_session(pool));
   if(!session) return E_FAIL;
 
-  auto r = session->lock(key, type, out_value, out_value_len);
+  lock_result r;
+  bool shared_path = false;
+  if ( is_thread_safe && type == IKVStore::STORE_LOCK_READ )
+  {
+    auto lk = session->reader_lock();
+    shared_path = session->lock_read_extant(key, r);
+  }
+  if ( ! shared_path )
+  {
+    auto lk = session->writer_lock();
+    r = session->lock(key, type, out_value, out_value_len);
+  }
 
   out_key = r.key;
   if ( out_key_ptr )
@@ -609,11 +629,13 @@ auto hstore::unlock(const pool_t pool,
                     Component::IKVStore::key_t key_) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? session->unlock(key_)
-    : Component::IKVStore::E_POOL_NOT_FOUND
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  /* releases only the value's lock word */
+  auto lk = session->reader_lock();
+  return session->unlock(key_);
 }
 
 auto hstore::erase(const pool_t pool,
@@ -621,10 +643,12 @@ auto hstore::erase(const pool_t pool,
                    ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return session
-    ? session->erase(key)
-    : Component::IKVStore::E_POOL_NOT_FOUND
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  auto lk = session->writer_lock();
+  return session->erase(key);
 }
 
 std::size_t hstore::count(const pool_t pool)
@@ -635,6 +659,7 @@ std::size_t hstore::count(const pool_t pool)
     return Component::IKVStore::E_POOL_NOT_FOUND;
   }
 
+  auto lk = session->reader_lock();
   return session->count();
 }
 
@@ -667,11 +692,14 @@ auto hstore::map(
                  ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
 
-  return session
-    ? ( session->map(f_), S_OK )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  auto lk = session->reader_lock();
+  session->map(f_);
+  return S_OK;
 }
 
 auto hstore::map(
@@ -690,11 +718,13 @@ auto hstore::map(
 ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool_));
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
 
-  return session
-    ? ( session->map(f_, t_begin_, t_end_) ? S_OK : E_NOT_SUPPORTED )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  auto lk = session->reader_lock();
+  return session->map(f_, t_begin_, t_end_) ? S_OK : E_NOT_SUPPORTED;
 }
 
 auto hstore::map_keys(
@@ -706,16 +736,19 @@ auto hstore::map_keys(
                  ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
 
-  return session
-    ? ( session->map([&f_] (const void * key, std::size_t key_len,
-                            const void *, std::size_t) -> int
-                     {
-                       f_(std::string(static_cast<const char*>(key), key_len));
-                       return 0;
-                     }), S_OK )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  auto lk = session->reader_lock();
+  session->map([&f_] (const void * key, std::size_t key_len,
+                      const void *, std::size_t) -> int
+               {
+                 f_(std::string(static_cast<const char*>(key), key_len));
+                 return 0;
+               });
+  return S_OK;
 }
 
 auto hstore::free_memory(void * p) -> status_t
@@ -733,11 +766,13 @@ try
 {
   const auto update_method = take_lock ? &session_t::lock_and_atomic_update : &session_t::atomic_update;
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? ( (session->*update_method)(key, op_vector), S_OK )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  auto lk = session->writer_lock();
+  (session->*update_method)(key, op_vector);
+  return S_OK;
 }
 catch ( const std::bad_alloc & )
 {
@@ -767,11 +802,12 @@ auto hstore::swap_keys(
 ) -> status_t
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? session->swap_keys(key0, key1)
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  auto lk = session->writer_lock();
+  return session->swap_keys(key0, key1);
 }
 
 auto hstore::allocate_pool_memory(
@@ -783,11 +819,13 @@ auto hstore::allocate_pool_memory(
 try
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? ( out_addr = session->allocate_memory(size, alignment), S_OK )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  auto lk = session->writer_lock();
+  out_addr = session->allocate_memory(size, alignment);
+  return S_OK;
 }
 catch ( const std::invalid_argument & )
 {
@@ -806,11 +844,13 @@ auto hstore::free_pool_memory(
 try
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? ( session->free_memory(addr, size), S_OK )
-    : int(Component::IKVStore::E_POOL_NOT_FOUND)
-    ;
+  if ( ! session )
+  {
+    return Component::IKVStore::E_POOL_NOT_FOUND;
+  }
+  auto lk = session->writer_lock();
+  session->free_memory(addr, size);
+  return S_OK;
 }
 catch ( const API_exception & ) /* bad pointer */
 {
@@ -824,11 +864,12 @@ catch ( const std::exception & )
 auto hstore::open_pool_iterator(pool_t pool) -> pool_iterator_t
 {
   auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? session->open_iterator()
-    : nullptr
-    ;
+  if ( ! session )
+  {
+    return nullptr;
+  }
+  auto lk = session->writer_lock();
+  return session->open_iterator();
 }
 
 status_t hstore::deref_pool_iterator(
@@ -842,18 +883,21 @@ status_t hstore::deref_pool_iterator(
 )
 {
   const auto session = static_cast<session_t *>(locate_session(pool));
+  if ( ! session )
+  {
+    return E_INVAL;
+  }
+  /* writer: an iterator is modified by increment */
+  auto lk = session->writer_lock();
   return
-    session
-    ? session->deref_iterator(
-        iter
-        , t_begin
-        , t_end
-        , ref
-        , time_match
-        , increment
-      )
-    : E_INVAL
-    ;
+    session->deref_iterator(
+      iter
+      , t_begin
+      , t_end
+      , ref
+      , time_match
+      , increment
+    );
 }
 
 status_t  hstore::close_pool_iterator(
@@ -862,10 +906,11 @@ status_t  hstore::close_pool_iterator(
 )
 {
   auto session = static_cast<session_t *>(locate_session(pool));
-  return
-    session
-    ? session->close_iterator(iter)
-    : E_INVAL
-    ;
+  if ( ! session )
+  {
+    return E_INVAL;
+  }
+  auto lk = session->writer_lock();
+  return session->close_iterator(iter);
 }
 
@@ -19,6 +19,7 @@
 
 #if THREAD_SAFE_HASH == 1
 /* thread-safe hash */
+#include "versioned_shared_mutex.h"
 #include <mutex>
 #else
 /* not a thread-safe hash */
@@ -61,8 +62,8 @@ class hstore
   using mapped_t = typename hstore_kv_types<dealloc_t>::mapped_t;
   using allocator_segment_t = std::allocator_traits<alloc_t>::rebind_alloc<std::pair<const key_t, mapped_t>>;
 #if THREAD_SAFE_HASH == 1
-  /* thread-safe hash */
-  using hstore_shared_mutex = std::shared_timed_mutex;
+  /* thread-safe hash: bucket versions let get run without locks */
+  using hstore_shared_mutex = impl::versioned_shared_mutex;
   static constexpr auto thread_model = Component::IKVStore::THREAD_MODEL_MULTI_PER_POOL;
   static constexpr auto is_thread_safe = true;
 #else
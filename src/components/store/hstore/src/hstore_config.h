@@ -28,7 +28,14 @@
 #define USE_CC_HEAP 3
 #endif
 
+/* THREAD_SAFE_HASH 1: concurrent readers, writers serialized per pool.
+ * Compile with -DMCAS_HSTORE_THREAD_SAFE_HASH=1 */
+#if defined MCAS_HSTORE_THREAD_SAFE_HASH
+#define THREAD_SAFE_HASH MCAS_HSTORE_THREAD_SAFE_HASH
+#else
 #define THREAD_SAFE_HASH 0
+#endif
+
 #define PREFIX_STATIC "HSTORE %s %s:%d "
 #define LOCATION_STATIC __func__, __FILE__, __LINE__
 #define PREFIX PREFIX_STATIC "%p "
@@ -39,6 +46,14 @@
 #define HSTORE_GRAIN_SIZE (std::size_t(1)<<25)
 #endif
 
+/* The hash table grows all at once, inside the insert which finds it full.
+ * To grow it instead by migrating a few buckets per insert, which bounds
+ * insert latency during growth but is not yet measured against the blocking
+ * resize, compile with -DHSTORE_INCREMENTAL_RESIZE=1 */
+#if ! defined HSTORE_INCREMENTAL_RESIZE
+#define HSTORE_INCREMENTAL_RESIZE 0
+#endif
+
 /* timestamps are enabled to match mapstore. To disable, compile with -DENABLE_TIMESTAMPS=0 */
 #if ! defined ENABLE_TIMESTAMPS
 #define ENABLE_TIMESTAMPS 1
@@ -103,8 +103,14 @@ namespace impl
 			) -> persist_controller & = delete;
 
 			auto resize_prolog() -> bucket_aligned_t *;
+			/* incremental resize: allocate the junior segment, and later
+			 * construct and persist it in pieces */
+			auto resize_prolog_unconstructed() -> bucket_aligned_t *;
+			void resize_construct(bix_t first, bix_t last);
 			auto resize_restart_prolog() -> bucket_aligned_t *;
 			void resize_interlog();
+			/* address the junior segment before the epilog (incremental resize) */
+			void resize_expose() { _bucket_count_cached = bucket_count_uncached() * 2U; }
 			void resize_epilog();
 
 			void size_stabilize();
@@ -192,23 +192,48 @@ template <typename Allocator>
 	auto impl::persist_controller<Allocator>::resize_prolog(
 	) -> bucket_aligned_t *
 	{
-		persistent_t<typename std::allocator_traits<bucket_allocator_t>::pointer> ptr = nullptr;
+		auto bp = resize_prolog_unconstructed();
+		new (bp) typename persist_data_t::bucket_aligned_t[bucket_count()];
+		return bp;
+	}
+
+template <typename Allocator>
+	auto impl::persist_controller<Allocator>::resize_prolog_unconstructed(
+	) -> bucket_aligned_t *
+	{
+		auto &bp = _persist->_sc[segment_count_actual().value()].bp;
 
+		/* The segment is allocated straight into the segment table, so that a
+		 * junior segment abandoned before it was linked in (the pool closed or
+		 * crashed while it was being prepared) is found, and reused, here
+		 * rather than leaked.
+		 */
+		if ( ! persistent_load(bp) )
 		{
 #if USE_CC_HEAP == 4
 			monitor_extend<Allocator> m(bucket_allocator_t{*this});
 #endif
 			bucket_allocator_t(*this).allocate(
-				ptr
+				bp
 				, bucket_count()
 				, alignof(bucket_aligned_t)
 			);
+			persist_internal(&bp, &bp + 1U, "segment allocated");
 		}
 
-		new (&*ptr) typename persist_data_t::bucket_aligned_t[bucket_count()];
-		_persist->_sc[_persist->_segment_count.actual().value()].bp = ptr;
+		return &*bp;
+	}
+
+template <typename Allocator>
+	void impl::persist_controller<Allocator>::resize_construct(
+		bix_t first_
+		, bix_t last_
+	)
+	{
 		auto sc = &*_persist->_sc;
-		return &*(sc[segment_count_actual().value()].bp);
+		auto bp = &*sc[segment_count_actual().value()].bp;
+		new (&bp[first_]) typename persist_data_t::bucket_aligned_t[last_ - first_];
+		persist_internal(&bp[first_], &bp[last_], "segment new (part)");
 	}
 
 template <typename Allocator>
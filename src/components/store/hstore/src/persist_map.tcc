@@ -160,9 +160,11 @@ template <typename Allocator>
 				auto segment_size = base_segment_size<<(ix-1U);
 				av.reconstitute(segment_size, _sc[ix].bp);
 			}
-			if ( ! _segment_count.actual().is_stable() )
+			if ( ! _segment_count.actual().is_stable() || ( ix != _segment_capacity && _sc[ix].bp ) )
 			{
-				/* restore the last, "junior" segment */
+				/* restore the last, "junior" segment, which may also be one
+				 * abandoned before it was linked in (to be reused)
+				 */
 				auto segment_size = base_segment_size<<(ix-1U);
 				av.reconstitute(segment_size, _sc[ix].bp);
 			}
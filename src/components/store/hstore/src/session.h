@@ -25,14 +25,21 @@
 #include "is_locked.h"
 #include "monitor_emplace.h"
 #include "monitor_pin.h"
+#if THREAD_SAFE_HASH == 1
+#include <shared_mutex>
+#else
+#include "dummy_shared_mutex.h"
+#endif
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 #include <tbb/scalable_allocator.h>
 #pragma GCC diagnostic pop
+#include <cassert>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex> /* unique_lock */
 #include <utility> /* move */
 #include <vector>
 
@@ -65,6 +72,16 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 		using mapped_t = typename table_t::mapped_type;
 		using data_t = typename std::tuple_element<0, mapped_t>::type;
 		using allocator_type = Allocator;
+#if THREAD_SAFE_HASH == 1
+		/* Writers to a pool are serialized: the persistent size and allocation
+		 * protocols admit one writer at a time. get and get_direct take no
+		 * pool lock; they read optimistically (hop_hash_base::find_optimistic).
+		 */
+		using pool_mutex_t = std::shared_timed_mutex;
+#else
+		using pool_mutex_t = dummy::shared_mutex;
+#endif
+		mutable pool_mutex_t _pool_mutex;
 		allocator_type _heap;
 		bool _pin_seq; /* used only for force undo_redo call */
 		table_t _map;
@@ -128,16 +145,25 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 		class definite_lock
 		{
 			typename table_t::iterator _it;
+			/* excludes optimistic readers while the value changes */
+			typename table_t::content_lock_t _content_lk;
 		public:
 			template <typename K>
 				definite_lock(table_t &map_, const K &key_, allocator_type al_)
 					: _it(map_.find(key_))
+					, _content_lk()
 				{
 					if ( _it == map_.end() )
 					{
 						throw impl::key_not_found{};
 					}
 
+					_content_lk = map_.lock_content(_it);
+					if ( ! _content_lk.owns_lock() )
+					{
+						throw impl::is_locked{};
+					}
+
 					auto &d = data();
 
 					if ( ! d.lockable() )
@@ -192,6 +218,21 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			{}
 		};
 
+		auto content_guard(const std::string &key) -> typename table_t::content_lock_t
+		{
+			auto it = map().find(key);
+			if ( it == map().end() )
+			{
+				throw impl::key_not_found{};
+			}
+			auto lk = map().lock_content(it);
+			if ( ! lk.owns_lock() )
+			{
+				throw impl::is_locked{};
+			}
+			return lk;
+		}
+
 		auto allocator() const { return _heap; }
 		table_t &map() noexcept { return _map; }
 		const table_t &map() const noexcept { return _map; }
@@ -211,6 +252,7 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 				, bool debug_ = false
 			)
 			: Handle(std::move(pop_))
+			, _pool_mutex{}
 			, _heap(
 				Allocator(
 #if USE_CC_HEAP == 2
@@ -232,6 +274,12 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 
 		auto writes() const { return _writes; }
 
+		/* Callers (hstore) hold writer_lock for operations which modify the pool,
+		 * and reader_lock for other operations except get.
+		 */
+		auto writer_lock() const { return std::unique_lock<pool_mutex_t>(_pool_mutex); }
+		auto reader_lock() const { return std::shared_lock<pool_mutex_t>(_pool_mutex); }
+
 		explicit session(
 			const pool_path &
 			, Handle &&pop_
@@ -239,6 +287,7 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			, bool debug_ = false
 		)
 			: Handle(std::move(pop_))
+			, _pool_mutex{}
 			, _heap(
 				Allocator(
 					this->pool()->locate_heap()
@@ -424,10 +473,77 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 				v.emplace_back(std::make_unique<Component::IKVStore::Operation_write>(0, value_len, value));
 				std::vector<Component::IKVStore::Operation *> v2;
 				std::transform(v.begin(), v.end(), std::back_inserter(v2), [] (const auto &i) { return i.get(); });
-				this->atomic_update(key, v2);
+				this->atomic_update_inner(key, v2);
 			}
 		}
 
+#if THREAD_SAFE_HASH == 1
+		/* Lock-free reads. The value is copied from a snapshot of its bucket,
+		 * and the copy is kept only if the bucket did not change meanwhile.
+		 */
+		auto get(
+			const std::string &key,
+			void* buffer,
+			std::size_t buffer_size
+		) const -> std::size_t
+		{
+			std::size_t value_len = 0;
+			const bool found =
+				map().find_optimistic(
+					key
+					, [buffer, buffer_size, &value_len] (const mapped_t &m, const auto &is_current)
+					{
+						const auto &d = std::get<0>(m);
+						value_len = d.size();
+						if ( value_len <= buffer_size && is_current() )
+						{
+							std::memcpy(buffer, d.data(), value_len);
+						}
+					}
+				);
+			if ( ! found )
+			{
+				throw impl::key_not_found{};
+			}
+			return value_len;
+		}
+
+		auto get_alloc(
+			const std::string &key
+		) const -> std::tuple<void *, std::size_t>
+		{
+			void *value = nullptr;
+			std::size_t value_len = 0;
+			const bool found =
+				map().find_optimistic(
+					key
+					, [&value, &value_len] (const mapped_t &m, const auto &is_current)
+					{
+						/* a retry may follow: release any earlier copy */
+						::scalable_free(value);
+						value = nullptr;
+						const auto &d = std::get<0>(m);
+						value_len = d.size();
+						if ( ! is_current() )
+						{
+							return;
+						}
+						value = ::scalable_malloc(value_len);
+						if ( ! value )
+						{
+							throw std::bad_alloc();
+						}
+						std::memcpy(value, d.data(), value_len);
+					}
+				);
+			if ( ! found )
+			{
+				::scalable_free(value);
+				throw impl::key_not_found{};
+			}
+			return std::pair<void *, std::size_t>(value, value_len);
+		}
+#else
 		auto get(
 			const std::string &key,
 			void* buffer,
@@ -460,6 +576,7 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			std::memcpy(value, std::get<0>(v).data(), value_len);
 			return std::pair<void *, std::size_t>(value, value_len);
 		}
+#endif
 
 		auto get_value_len(
 			const std::string & key
@@ -584,6 +701,9 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			}
 			else
 			{
+				/* pinning and the timestamp change the bucket in place */
+				auto content_lk = this->map().lock_content(it);
+				assert(content_lk.owns_lock());
 				auto &v = *it;
 				const key_t &k = v.first;
 				if ( ! k.is_fixed() )
@@ -626,6 +746,39 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			}
 		}
 
+		/* A read lock on a key whose key and value are already pinned changes
+		 * only the value's lock word, so it needs only reader_lock.
+		 * Returns false if lock must be used instead.
+		 */
+		bool lock_read_extant(
+			const std::string &key
+			, lock_result &r
+		)
+		{
+			auto it = this->map().find(key);
+			if ( it == this->map().end() )
+			{
+				return false;
+			}
+			auto &v = *it;
+			const key_t &k = v.first;
+			auto &d = std::get<0>(v.second);
+			if ( ! k.is_fixed() || ! d.is_fixed() )
+			{
+				return false;
+			}
+			r = {
+				lock_result::e_state::extant
+				, d.try_lock_shared()
+					? new lock_impl(key)
+					: Component::IKVStore::KEY_NONE
+				, d.data_fixed()
+				, d.size()
+				, k.data_fixed()
+			};
+			return true;
+		}
+
 		auto unlock(Component::IKVStore::key_t key_) -> status_t
 		{
 			if ( key_ )
@@ -804,6 +957,7 @@ template <typename Handle, typename Allocator, typename Table, typename LockType
 			, const std::vector<Component::IKVStore::Operation *> &op_vector
 		)
 		{
+			auto content_lk = content_guard(key);
 			this->atomic_update_inner(key, op_vector);
 		}
 
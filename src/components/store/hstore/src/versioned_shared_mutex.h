@@ -0,0 +1,98 @@
+/*
+   Copyright [2017-2020] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#ifndef MCAS_HSTORE_VERSIONED_SHARED_MUTEX_H_
+#define MCAS_HSTORE_VERSIONED_SHARED_MUTEX_H_
+
+#include <common/utils.h> /* cpu_relax */
+
+#include <atomic>
+#include <cstdint>
+
+namespace impl
+{
+	/*
+	 * A bucket mutex for the concurrent (THREAD_SAFE_HASH) table.
+	 *
+	 * Each exclusive lock and each unlock advances a version, which is odd
+	 * while the mutex is held. Readers which take no lock at all
+	 * (hop_hash_base::find_optimistic) note the version of each bucket they
+	 * read and retry if any version has changed.
+	 *
+	 * Writers are expected to be serialized by a coarser lock (in hstore, the
+	 * pool lock), so exclusive lock spins rather than blocks, and shared lock
+	 * only waits out an exclusive holder: it does not exclude a later one.
+	 */
+	class versioned_shared_mutex
+	{
+		std::atomic<std::uint64_t> _version;
+	public:
+		using version_type = std::uint64_t;
+		versioned_shared_mutex()
+			: _version(0)
+		{}
+		versioned_shared_mutex(const versioned_shared_mutex &) = delete;
+		versioned_shared_mutex &operator=(const versioned_shared_mutex &) = delete;
+		/* BasicLockable */
+		void lock()
+		{
+			while ( ! try_lock() )
+			{
+				cpu_relax();
+			}
+		}
+		void unlock()
+		{
+			_version.fetch_add(1U, std::memory_order_release);
+		}
+		/* Lockable */
+		bool try_lock()
+		{
+			auto v = _version.load(std::memory_order_relaxed);
+			if (
+				( v & 1U ) != 0U
+				|| ! _version.compare_exchange_strong(v, v + 1U, std::memory_order_acquire, std::memory_order_relaxed)
+			)
+			{
+				return false;
+			}
+			/* a reader which sees any write to the bucket also sees the odd version */
+			std::atomic_thread_fence(std::memory_order_release);
+			return true;
+		}
+		/* SharedMutex */
+		void lock_shared()
+		{
+			while ( ! try_lock_shared() )
+			{
+				cpu_relax();
+			}
+		}
+		bool try_lock_shared()
+		{
+			return ( version() & 1U ) == 0U;
+		}
+		void unlock_shared()
+		{
+		}
+		/* optimistic reader */
+		version_type version() const
+		{
+			return _version.load(std::memory_order_acquire);
+		}
+		static bool is_stable(version_type v) { return ( v & 1U ) == 0U; }
+	};
+}
+
+#endif
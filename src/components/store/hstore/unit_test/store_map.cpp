@@ -16,6 +16,7 @@ const std::string store_map::impl_default = "hstore-cc";
 const store_map::impl_map_t store_map::impl_map = {
   { "hstore-cc", { "hstore-cc", Component::hstore_factory } }
   , { "hstore", { "hstore", Component::hstore_factory } }
+  , { "hstore-mt", { "hstore-mt", Component::hstore_factory } }
 };
 
 namespace
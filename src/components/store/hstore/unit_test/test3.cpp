@@ -108,6 +108,7 @@ class KVStore_test
   static void populate_many(kvv_t &kvv, char tag, std::size_t key_length, std::size_t value_length);
   static long unsigned put_many(const kvv_t &kvv, const std::string &descr);
   static void get_many(const kvv_t &kvv, const std::string &descr);
+  static void lookup_many(const kvv_t &kvv, const std::string &descr, char miss_tag);
 
   std::string pool_name() const
   {
@@ -338,6 +339,62 @@ TEST_F(KVStore_test, GetManyLongLong)
   get_many(kvv_long_long, "long_long");
 }
 
+/*
+ * Lookup cost, hit and miss. get_direct into a local buffer, so that the
+ * time is mostly the hash table probe and key compare. A miss uses a key of
+ * the same length with a different first character, so it probes a
+ * neighborhood as full as that of a hit, and each compare would touch the
+ * stored key (out of line, for long keys) but for the hash tag filter.
+ */
+void KVStore_test::lookup_many(const kvv_t &kvv, const std::string &descr, const char miss_tag)
+{
+  std::vector<char> buffer(many_value_length_long);
+  for ( const bool hit : { true, false } )
+  {
+    const auto count = get_expand * kvv.size();
+    long unsigned found = 0;
+    {
+      const auto label = descr + ( hit ? " hit" : " miss" );
+      timer t(
+        [&label,count] (timer::duration_t d) {
+          auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+          std::cout << "lookup " << label << " " << count << " -> " << double(nanoseconds) / double(count) << " ns per lookup\n";
+        }
+      );
+      for ( auto i = 0; i != get_expand; ++i )
+      {
+        for ( auto &kv : kvv )
+        {
+          auto key = std::get<0>(kv);
+          if ( ! hit )
+          {
+            key[0] = miss_tag;
+          }
+          auto value_len = buffer.size();
+          found += ( _kvstore->get_direct(pool, key, buffer.data(), value_len) == S_OK );
+        }
+      }
+    }
+    EXPECT_EQ(hit ? count : 0U, found);
+  }
+}
+
+TEST_F(KVStore_test, LookupShortShort)
+{
+  ASSERT_NE(_kvstore, nullptr);
+  ASSERT_LT(0, int64_t(pool));
+
+  lookup_many(kvv_short_short, "short_short", 'a');
+}
+
+TEST_F(KVStore_test, LookupLongLong)
+{
+  ASSERT_NE(_kvstore, nullptr);
+  ASSERT_LT(0, int64_t(pool));
+
+  lookup_many(kvv_long_long, "long_long", 'c');
+}
+
 TEST_F(KVStore_test, ClosePool)
 {
   if ( _kvstore && 0 < int64_t(pool) )
@@ -0,0 +1,278 @@
+/*
+   Copyright [2017-2020] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "store_map.h"
+
+#include <gtest/gtest.h>
+#include <api/components.h>
+/* note: we do not include component source, only the API definition */
+#include <api/kvstore_itf.h>
+#include <common/logging.h>
+
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Component;
+
+/*
+ * Concurrent use of one pool by the thread-safe hstore (libcomponent-hstore-mt).
+ * One thread writes while others read; a reader must never see a value
+ * which is part one version and part another.
+ */
+
+namespace {
+
+class KVStore_test : public ::testing::Test {
+ protected:
+  static Component::IKVStore * _kvstore;
+  static Component::IKVStore::pool_t pool;
+
+  static constexpr unsigned reader_count = 4;
+  static constexpr unsigned stable_count = 2000;
+  static constexpr unsigned churn_count = 20000;
+  static constexpr unsigned write_count = 200000;
+
+  std::string pool_name() const
+  {
+    return "/mnt/pmem0/pool/0/test-hstore-mt" + store_map::numa_zone() + ".pool";
+  }
+
+  static std::string key(unsigned i)
+  {
+    return "key" + std::to_string(i);
+  }
+
+  /* A value is one character repeated; its length depends on the character.
+   * Lengths span both inline and out-of-line storage.
+   */
+  static std::string value(unsigned generation)
+  {
+    const auto c = char('a' + generation % 26U);
+    return std::string(8U + unsigned(c - 'a') * 12U, c);
+  }
+
+  static bool is_whole_value(const void *v, std::size_t len)
+  {
+    const auto p = static_cast<const char *>(v);
+    return
+      0 < len
+      && value(unsigned(p[0] - 'a')) == std::string(p, len)
+      ;
+  }
+};
+
+Component::IKVStore * KVStore_test::_kvstore;
+Component::IKVStore::pool_t KVStore_test::pool;
+constexpr unsigned KVStore_test::reader_count;
+constexpr unsigned KVStore_test::stable_count;
+constexpr unsigned KVStore_test::churn_count;
+constexpr unsigned KVStore_test::write_count;
+
+TEST_F(KVStore_test, Instantiate)
+{
+  /* create object instance through factory */
+  Component::IBase * comp = Component::load_component("libcomponent-hstore-mt.so",
+                                                      Component::hstore_factory);
+
+  ASSERT_TRUE(comp);
+  auto fact = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
+  _kvstore = fact->create("owner", "numa0", store_map::location);
+
+  fact->release_ref();
+}
+
+TEST_F(KVStore_test, ThreadModel)
+{
+  ASSERT_TRUE(_kvstore);
+  EXPECT_EQ(IKVStore::THREAD_MODEL_MULTI_PER_POOL, _kvstore->thread_safety());
+  EXPECT_EQ(1, _kvstore->get_capability(IKVStore::Capability::POOL_THREAD_SAFE));
+}
+
+TEST_F(KVStore_test, RemoveOldPool)
+{
+  if ( _kvstore )
+  {
+    try
+    {
+      _kvstore->delete_pool(pool_name());
+    }
+    catch ( Exception & )
+    {
+    }
+  }
+}
+
+TEST_F(KVStore_test, CreatePool)
+{
+  ASSERT_TRUE(_kvstore);
+  pool = _kvstore->create_pool(pool_name(), std::size_t(1) << 30, 0, 0 /* test resize */);
+  ASSERT_LT(0, int64_t(pool));
+}
+
+TEST_F(KVStore_test, PopulateStable)
+{
+  ASSERT_TRUE(_kvstore);
+  for ( unsigned i = 0; i != stable_count; ++i )
+  {
+    const auto v = value(i);
+    ASSERT_EQ(S_OK, _kvstore->put(pool, key(i), v.data(), v.size()));
+  }
+}
+
+TEST_F(KVStore_test, ConcurrentGetDuringWrites)
+{
+  ASSERT_TRUE(_kvstore);
+  std::atomic<bool> done{false};
+  std::atomic<unsigned long> torn{0};
+  std::atomic<unsigned long> missing{0};
+  std::atomic<unsigned long> reads{0};
+
+  std::vector<std::thread> readers;
+  for ( unsigned r = 0; r != reader_count; ++r )
+  {
+    readers.emplace_back(
+      [this, r, &done, &torn, &missing, &reads] ()
+      {
+        std::mt19937 rnd(r);
+        std::vector<char> buffer(1024);
+        unsigned long n = 0;
+        while ( ! done )
+        {
+          const bool stable = rnd() % 2U == 0U;
+          const auto i = unsigned(stable ? rnd() % stable_count : stable_count + rnd() % churn_count);
+          std::size_t len = buffer.size();
+          const auto rc = _kvstore->get_direct(pool, key(i), buffer.data(), len);
+          if ( rc == S_OK )
+          {
+            if ( ! is_whole_value(buffer.data(), len) ) { ++torn; }
+          }
+          else if ( stable || rc != IKVStore::E_KEY_NOT_FOUND )
+          {
+            ++missing;
+          }
+
+          void *v = nullptr;
+          len = 0;
+          if ( _kvstore->get(pool, key(i), v, len) == S_OK )
+          {
+            if ( ! is_whole_value(v, len) ) { ++torn; }
+            _kvstore->free_memory(v);
+          }
+          ++n;
+        }
+        reads += n;
+      }
+    );
+  }
+
+  /* the writer inserts, replaces (in place and resized), and erases,
+   * enough to resize the table several times */
+  std::mt19937 rnd(reader_count);
+  for ( unsigned w = 0; w != write_count; ++w )
+  {
+    const auto i = unsigned(stable_count + rnd() % churn_count);
+    if ( rnd() % 4U == 0U )
+    {
+      _kvstore->erase(pool, key(i));
+    }
+    else
+    {
+      const auto v = value(unsigned(rnd()));
+      ASSERT_EQ(S_OK, _kvstore->put(pool, key(i), v.data(), v.size()));
+    }
+  }
+
+  done = true;
+  for ( auto &t : readers )
+  {
+    t.join();
+  }
+  PINF("%lu reads concurrent with %u writes", reads.load(), write_count);
+  EXPECT_EQ(0U, torn);
+  EXPECT_EQ(0U, missing);
+}
+
+TEST_F(KVStore_test, ConcurrentReadLocks)
+{
+  ASSERT_TRUE(_kvstore);
+  const auto k = key(0);
+  {
+    /* pin the value, so that later read locks take the shared path */
+    void *v = nullptr;
+    std::size_t len = 0;
+    IKVStore::key_t lk = IKVStore::KEY_NONE;
+    ASSERT_EQ(S_OK, _kvstore->lock(pool, k, IKVStore::STORE_LOCK_READ, v, len, lk));
+    ASSERT_EQ(S_OK, _kvstore->unlock(pool, lk));
+  }
+
+  std::atomic<unsigned long> failures{0};
+  std::vector<std::thread> lockers;
+  for ( unsigned r = 0; r != reader_count; ++r )
+  {
+    lockers.emplace_back(
+      [this, &k, &failures] ()
+      {
+        for ( unsigned n = 0; n != 10000; ++n )
+        {
+          void *v = nullptr;
+          std::size_t len = 0;
+          IKVStore::key_t lk = IKVStore::KEY_NONE;
+          if (
+            _kvstore->lock(pool, k, IKVStore::STORE_LOCK_READ, v, len, lk) != S_OK
+            || ! is_whole_value(v, len)
+            || _kvstore->unlock(pool, lk) != S_OK
+          )
+          {
+            ++failures;
+          }
+        }
+      }
+    );
+  }
+  for ( auto &t : lockers )
+  {
+    t.join();
+  }
+  EXPECT_EQ(0U, failures);
+
+  /* all read locks released: a write lock succeeds */
+  void *v = nullptr;
+  std::size_t len = 0;
+  IKVStore::key_t lk = IKVStore::KEY_NONE;
+  EXPECT_EQ(S_OK, _kvstore->lock(pool, k, IKVStore::STORE_LOCK_WRITE, v, len, lk));
+  EXPECT_EQ(S_OK, _kvstore->unlock(pool, lk));
+}
+
+TEST_F(KVStore_test, ClosePool)
+{
+  ASSERT_TRUE(_kvstore);
+  ASSERT_EQ(S_OK, _kvstore->close_pool(pool));
+}
+
+TEST_F(KVStore_test, DeletePool)
+{
+  ASSERT_TRUE(_kvstore);
+  _kvstore->delete_pool(pool_name());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
@@ -0,0 +1,300 @@
+/*
+   Copyright [2017-2020] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#include "store_map.h"
+
+#include <gtest/gtest.h>
+#include <common/utils.h>
+#include <api/components.h>
+/* note: we do not include component source, only the API definition */
+#include <api/kvstore_itf.h>
+
+#include <algorithm> /* min */
+#include <cstring> /* memcmp */
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+/*
+ * Table growth, interleaved with finds and erases, across pool reopens.
+ *
+ * The pool is created with no expected objects, so that every insert pass
+ * grows the table through several segments. Each pass is cut short: by a
+ * pool close every few inserts (ReopenWhileGrowing), or by the perishable
+ * timer (CrashWhileGrowing), which leaves the table mid-preparation or
+ * mid-migration of a junior segment. The next pass reopens the pool, which
+ * recovers the table, and replays the steps, all of which are idempotent.
+ *
+ * Step i: insert key i if absent; for even i, find key i/2, and erase it
+ * if it is a multiple of 5.
+ *
+ * The perishable library (hstore-cc-pe) is built with the incremental
+ * resize, which is otherwise opt-in (HSTORE_INCREMENTAL_RESIZE).
+ */
+
+using namespace Component;
+
+namespace {
+
+class KVStore_test : public ::testing::Test {
+
+  static constexpr std::size_t count_large = 200000;
+  /* Shorter test: use when PMEM_IS_PMEM_FORCE=0 */
+  static constexpr std::size_t count_small = 2000;
+
+ protected:
+  static bool pmem_simulated;
+  static Component::IKVStore * _kvstore;
+
+  static const std::size_t count;
+
+  /* inserts between pool closes in ReopenWhileGrowing */
+  static constexpr std::size_t reopen_interval = 37;
+
+  std::string pool_name() const
+  {
+    return "/mnt/pmem0/pool/0/test-resize-" + store_map::impl->name + store_map::numa_zone() + ".pool";
+  }
+
+  static std::string key(std::size_t i) { return "key" + std::to_string(i); }
+  static std::string value(std::size_t i) { return "value." + std::to_string(i) + "........"; }
+  static bool is_erased(std::size_t i) { return i % 5 == 0; }
+
+  /* run steps [first, last); throws on perishable expiry if crashes are enabled */
+  static void grow(IKVStore::pool_t pool, std::size_t first, std::size_t last);
+  static void verify(IKVStore::pool_t pool);
+};
+
+constexpr std::size_t KVStore_test::count_large;
+constexpr std::size_t KVStore_test::count_small;
+constexpr std::size_t KVStore_test::reopen_interval;
+
+bool KVStore_test::pmem_simulated = getenv("PMEM_IS_PMEM_FORCE");
+Component::IKVStore * KVStore_test::_kvstore;
+
+const std::size_t KVStore_test::count = pmem_simulated ? count_small : count_large;
+
+class pool_open
+{
+  Component::IKVStore *_kvstore;
+  Component::IKVStore::pool_t _pool;
+public:
+  explicit pool_open(
+    Component::IKVStore *kvstore_
+    , const std::string& name_
+    , unsigned int flags = 0
+  )
+    : _kvstore(kvstore_)
+    , _pool(_kvstore->open_pool(name_, flags))
+  {
+    if ( int64_t(_pool) < 0 )
+    {
+      throw std::runtime_error("Failed to open pool code " + std::to_string(-_pool));
+    }
+  }
+
+  explicit pool_open(
+    Component::IKVStore *kvstore_
+    , const std::string& name_
+    , const size_t size
+    , unsigned int flags = 0
+    , uint64_t expected_obj_count = 0
+  )
+    : _kvstore(kvstore_)
+    , _pool(_kvstore->create_pool(name_, size, flags, expected_obj_count))
+  {}
+  pool_open(const pool_open &) = delete;
+  pool_open& operator=(const pool_open &) = delete;
+
+  ~pool_open()
+  {
+    _kvstore->close_pool(_pool);
+  }
+
+  Component::IKVStore::pool_t pool() const noexcept { return _pool; }
+};
+
+void KVStore_test::grow(IKVStore::pool_t pool, std::size_t first, std::size_t last)
+{
+  for ( auto i = first; i != last; ++i )
+  {
+    void * v = nullptr;
+    size_t v_len = 0;
+    if ( S_OK == _kvstore->get(pool, key(i), v, v_len) )
+    {
+      _kvstore->free_memory(v);
+    }
+    else
+    {
+      const auto vi = value(i);
+      ASSERT_EQ(S_OK, _kvstore->put(pool, key(i), vi.c_str(), vi.length()));
+    }
+
+    if ( i % 2 == 0 )
+    {
+      const auto j = i / 2;
+      /* inserted at step j (of this pass, if not before), erased only now */
+      auto r = _kvstore->get(pool, key(j), v, v_len);
+      EXPECT_EQ(S_OK, r);
+      if ( r == S_OK )
+      {
+        const auto vj = value(j);
+        EXPECT_EQ(vj.size(), v_len);
+        EXPECT_EQ(0, memcmp(vj.data(), v, std::min(vj.size(), v_len)));
+        _kvstore->free_memory(v);
+      }
+      if ( is_erased(j) )
+      {
+        EXPECT_EQ(S_OK, _kvstore->erase(pool, key(j)));
+      }
+    }
+  }
+}
+
+void KVStore_test::verify(IKVStore::pool_t pool)
+{
+  std::size_t expected = 0;
+  for ( auto i = 0UL; i != count; ++i )
+  {
+    /* erased iff erased at step 2i */
+    const bool present = ! ( is_erased(i) && 2 * i < count );
+    expected += present;
+    void * v = nullptr;
+    size_t v_len = 0;
+    auto r = _kvstore->get(pool, key(i), v, v_len);
+    if ( present )
+    {
+      EXPECT_EQ(S_OK, r) << "key " << key(i);
+      if ( r == S_OK )
+      {
+        const auto vi = value(i);
+        EXPECT_EQ(vi.size(), v_len);
+        EXPECT_EQ(0, memcmp(vi.data(), v, std::min(vi.size(), v_len)));
+        _kvstore->free_memory(v);
+      }
+    }
+    else
+    {
+      EXPECT_NE(S_OK, r) << "key " << key(i);
+    }
+  }
+  EXPECT_EQ(expected, _kvstore->count(pool));
+}
+
+TEST_F(KVStore_test, Instantiate)
+{
+  /* the version compiled with simulated crashes (perishable) */
+  auto link_library = "libcomponent-" + store_map::impl->name + "-pe.so";
+  Component::IBase * comp = Component::load_component(link_library,
+                                                      store_map::impl->factory_id);
+
+  ASSERT_TRUE(comp);
+  auto fact = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
+
+  _kvstore = fact->create("owner", "name", store_map::location);
+
+  fact->release_ref();
+}
+
+TEST_F(KVStore_test, RemoveOldPool)
+{
+  if ( _kvstore )
+  {
+    try
+    {
+      _kvstore->delete_pool(pool_name());
+    }
+    catch ( Exception & )
+    {
+    }
+  }
+}
+
+TEST_F(KVStore_test, ReopenWhileGrowing)
+{
+  ASSERT_TRUE(_kvstore);
+  _kvstore->debug(0, 0 /* enable */, false);
+  {
+    /* no expected objects: start small, and grow */
+    pool_open p(_kvstore, pool_name(), MB(512UL), 0, 0);
+    ASSERT_LT(0, int64_t(p.pool()));
+  }
+
+  /* a close every few inserts leaves some junior segment partly prepared or
+   * partly migrated, to be picked up by the next open */
+  for ( auto i = 0UL; i < count; i += reopen_interval )
+  {
+    pool_open p(_kvstore, pool_name());
+    grow(p.pool(), i, std::min(i + reopen_interval, count));
+    if ( ::testing::Test::HasFatalFailure() ) { return; }
+  }
+
+  pool_open p(_kvstore, pool_name());
+  verify(p.pool());
+}
+
+TEST_F(KVStore_test, CrashWhileGrowing)
+{
+  ASSERT_TRUE(_kvstore);
+  _kvstore->delete_pool(pool_name());
+  {
+    pool_open p(_kvstore, pool_name(), MB(512UL), 0, 0);
+    ASSERT_LT(0, int64_t(p.pool()));
+  }
+
+  /* crashes at decreasingly frequent intervals (a Fibonacci series), as in
+   * hstore-test2, until a pass completes */
+  bool finished = false;
+  unsigned p0 = 0;
+  unsigned p1 = 1;
+  for (
+    unsigned perishable_count = p0 + p1
+    ; ! finished
+    ; perishable_count = p0 + p1, p0 = p1, p1 = perishable_count
+    )
+  {
+    _kvstore->debug(0, 1 /* reset */, perishable_count);
+    _kvstore->debug(0, 0 /* enable */, true);
+    try
+    {
+      pool_open p(_kvstore, pool_name());
+      grow(p.pool(), 0, count);
+      if ( ::testing::Test::HasFatalFailure() ) { return; }
+      finished = true;
+      _kvstore->debug(0, 0 /* enable */, false);
+      std::cerr << __func__ << " Final pass " << perishable_count << "\n";
+    }
+    catch ( const std::runtime_error &e )
+    {
+      if ( e.what() != std::string("perishable timer expired") ) { throw; }
+    }
+  }
+
+  pool_open p(_kvstore, pool_name());
+  verify(p.pool());
+}
+
+TEST_F(KVStore_test, DeletePool)
+{
+  ASSERT_TRUE(_kvstore);
+  _kvstore->delete_pool(pool_name());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  auto r = RUN_ALL_TESTS();
+
+  return r;
+}
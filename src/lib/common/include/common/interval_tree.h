@@ -48,7 +48,7 @@ class Interval {
   K stop;
   T value;
   Interval(K s, K e, const T &v) : start(s), stop(e), value(v) {}
-  Interval() : start(0), stop(0) {}
+  Interval() : start(0), stop(0), value() {}
 };
 
 template <class T, typename K = std::size_t>
@@ -92,11 +92,10 @@ class Interval_tree {
   interval_tree_t *right;
   K center;
 
-  Interval_tree<T, K>(void) : left(NULL), right(NULL), center(0) {}
+  Interval_tree<T, K>(void) : intervals(), left(NULL), right(NULL), center(0) {}
 
-  Interval_tree<T, K>(const interval_tree_t &other) : left(NULL), right(NULL) {
-    center = other.center;
-    intervals = other.intervals;
+  Interval_tree<T, K>(const interval_tree_t &other)
+      : intervals(other.intervals), left(NULL), right(NULL), center(other.center) {
     if (other.left) left = new interval_tree_t(*other.left);
 
     if (other.right) right = new interval_tree_t(*other.right);
@@ -126,7 +125,7 @@ class Interval_tree {
   Interval_tree<T, K>(interval_vector_t &ivals, std::size_t depth = 16,
                       std::size_t minbucket = 64, K leftextent = 0,
                       K rightextent = 0, std::size_t maxbucket = 512)
-      : left(NULL), right(NULL) {
+      : intervals(), left(NULL), right(NULL), center(0) {
     --depth;
     IntervalStartSorter<T, K> intervalStartSorter;
     if (depth == 0 || (ivals.size() < minbucket && ivals.size() < maxbucket)) {
@@ -215,6 +214,29 @@ class Interval_tree {
     return false;
   }
 
+  /* find an interval which contains all of [start, stop] and satisfies accept */
+  template <typename P>
+  bool find_covering(K start, K stop, interval_t &ret_val, P accept) const {
+    if (!intervals.empty() && !(start < intervals.front().start)) {
+      for (auto &interval : intervals) {
+        if (interval.start <= start && stop <= interval.stop && accept(interval)) {
+          ret_val = interval;
+          return true;
+        }
+      }
+    }
+
+    if (left && start <= center && left->find_covering(start, stop, ret_val, accept)) return true;
+
+    if (right && start >= center) return right->find_covering(start, stop, ret_val, accept);
+
+    return false;
+  }
+
+  bool find_covering(K start, K stop, interval_t &ret_val) const {
+    return find_covering(start, stop, ret_val, [](const interval_t &) { return true; });
+  }
+
   K earliest_time() const { return intervals.front().start; }
 
   K latest_time() const { return intervals.back().stop; }
@@ -2,6 +2,7 @@
 #include <thread>
 #include <gtest/gtest.h>
 #include <common/cycles.h>
+#include <common/interval_tree.h>
 #include <common/rand.h>
 #include <common/utils.h>
 #include <common/mpmc_bounded_queue.h>
@@ -128,6 +129,27 @@ TEST_F(Libcommon_test, spsc_queue_test_fast)
 }
 #endif
 
+TEST_F(Libcommon_test, interval_tree_find_covering)
+{
+  using tree_t = Common::Interval_tree<int>;
+  tree_t::interval_vector_t v;
+  for(int i=0;i<200;i++)
+    v.emplace_back(std::size_t(i)*100, std::size_t(i)*100+99, i); /* [100i, 100i+99] */
+  v.emplace_back(1000, 5999, -1);
+  tree_t tree(v);
+
+  tree_t::interval_t found;
+  ASSERT_TRUE(tree.find_covering(1210, 1290, found));
+  ASSERT_TRUE(found.start <= 1210 && 1290 <= found.stop);
+  /* spans two small intervals; only the large one covers it */
+  ASSERT_TRUE(tree.find_covering(1250, 1350, found));
+  ASSERT_EQ(-1, found.value);
+  ASSERT_FALSE(tree.find_covering(5950, 6050, found));
+  /* rejected candidates are skipped */
+  ASSERT_TRUE(tree.find_covering(1210, 1290, found, [](const tree_t::interval_t &i) { return i.value != -1; }));
+  ASSERT_EQ(12, found.value);
+  ASSERT_FALSE(tree.find_covering(1250, 1350, found, [](const tree_t::interval_t &i) { return i.value != -1; }));
+}
 
 //-------------------------------
 
@@ -16,6 +16,7 @@
 #include <api/ado_itf.h>
 #include <common/exceptions.h>
 #include <common/dump_utils.h>
+#include <common/utils.h>
 #include <vector>
 #include <string.h>
 #include <stdexcept>
@@ -50,6 +51,8 @@ enum {
   MSG_TYPE_ITERATE_REQUEST = 15,
   MSG_TYPE_ITERATE_RESPONSE = 16,
   MSG_TYPE_UNLOCK_REQUEST = 17,
+  MSG_TYPE_WORK_BATCH_REQUEST = 18,
+  MSG_TYPE_WORK_BATCH_RESPONSE = 19,
 };
 
 typedef enum {
@@ -353,6 +356,211 @@ struct Work_response : public Message {
 } __attribute__((packed));
 
 
+//-------------
+
+/**
+ * Several work requests in one IPC message.  Records are packed; each
+ * carries the same fields as a Work_request (no detached value).  The
+ * ADO answers with a single Work_batch_response.
+ */
+struct Work_batch_request : public Message {
+  static constexpr uint8_t id = MSG_TYPE_WORK_BATCH_REQUEST;
+  static constexpr const char *description = "mcas::ipc::Work_batch_request";
+
+  struct record_t {
+    uint64_t work_key;
+    uint64_t key_addr;
+    uint64_t key_len;
+    uint64_t value_addr;
+    uint64_t value_len;
+    uint32_t invocation_data_len;
+    uint32_t new_root;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // zero-size array
+    char     data[]; /* invocation data, padded to 8 bytes */
+#pragma GCC diagnostic pop
+
+    static inline size_t space(size_t invocation_data_len) { return sizeof(record_t) + round_up(invocation_data_len, 8); }
+    inline size_t record_size() const { return space(invocation_data_len); }
+    inline const char * get_key() const { return reinterpret_cast<const char*>(key_addr); }
+    inline void * get_value_addr() const { return reinterpret_cast<void *>(value_addr); }
+    inline const char * get_invocation_data() const { return data; }
+  } __attribute__((packed));
+
+  explicit Work_batch_request(size_t buffer_size)
+    : Message(id), count(0), data_len(0)
+  {
+    if(buffer_size < sizeof(Work_batch_request))
+      throw std::length_error(description);
+  }
+
+  bool append(size_t buffer_size,
+              const uint64_t work_key,
+              const char * key,
+              const size_t key_len,
+              const void * value,
+              const size_t value_len,
+              const void * invocation_data,
+              const size_t invocation_data_len,
+              const bool new_root)
+  {
+    const size_t len = record_t::space(invocation_data_len);
+    if(get_message_size() + len > buffer_size) return false;
+
+    auto rec = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->work_key = work_key;
+    rec->key_addr = reinterpret_cast<uint64_t>(key);
+    rec->key_len = key_len;
+    rec->value_addr = reinterpret_cast<uint64_t>(value);
+    rec->value_len = value_len;
+    rec->invocation_data_len = boost::numeric_cast<uint32_t>(invocation_data_len);
+    rec->new_root = new_root;
+    if(invocation_data_len > 0)
+      ::memcpy(rec->data, invocation_data, invocation_data_len);
+
+    data_len += len;
+    count++;
+    return true;
+  }
+
+  size_t get_message_size() const { return sizeof(Work_batch_request) + data_len; }
+
+  inline const record_t * first_record() const { return reinterpret_cast<const record_t*>(data); }
+
+  static inline const record_t * next_record(const record_t * rec) {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  uint32_t count;
+  uint64_t data_len;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // zero-size array
+  char     data[];
+#pragma GCC diagnostic pop
+} __attribute__((packed));
+
+//-------------
+
+/**
+ * Results of a Work_batch_request, one record per request record.
+ * Response buffers are encoded as in Work_response.  A record whose
+ * responses do not fit is sent without them and with status
+ * E_INSUFFICIENT_SPACE (the work itself has completed).
+ */
+struct Work_batch_response : public Message {
+  static constexpr uint8_t id = MSG_TYPE_WORK_BATCH_RESPONSE;
+  static constexpr const char *description = "mcas::ipc::Work_batch_response";
+
+  struct record_t {
+    uint64_t work_key;
+    int32_t  status;
+    uint32_t count;        /*< response buffers */
+    uint64_t response_len; /*< bytes of response data following */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // zero-size array
+    char     data[];
+#pragma GCC diagnostic pop
+
+    inline size_t record_size() const { return sizeof(record_t) + response_len; }
+  } __attribute__((packed));
+
+  explicit Work_batch_response(size_t buffer_size)
+    : Message(id), count(0), data_len(0)
+  {
+    if(buffer_size < sizeof(Work_batch_response))
+      throw std::length_error(description);
+  }
+
+  bool append(size_t buffer_size,
+              const uint64_t work_key,
+              status_t status,
+              const Component::IADO_plugin::response_buffer_vector_t& response_buffers)
+  {
+    using response_buffer_t = Component::IADO_plugin::response_buffer_t;
+
+    if(get_message_size() + sizeof(record_t) > buffer_size) return false;
+
+    size_t response_len = 0;
+    for(auto& b : response_buffers)
+      response_len += sizeof(response_buffer_t) + (b.pool_ref ? 0 : b.len);
+
+    auto rec = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->work_key = work_key;
+    rec->count = 0;
+    rec->response_len = 0;
+
+    if(get_message_size() + sizeof(record_t) + response_len > buffer_size) {
+      if(status >= S_OK) status = E_INSUFFICIENT_SPACE;
+    }
+    else {
+      char * data_ptr = rec->data;
+      for(auto& b : response_buffers) {
+        assert(b.ptr);
+        auto out = reinterpret_cast<response_buffer_t*>(data_ptr);
+        out->len = b.len;
+        out->layer_id = b.layer_id;
+        out->pool_ref = b.pool_ref;
+        data_ptr += sizeof(response_buffer_t);
+        if(b.pool_ref == false) {
+          ::memcpy(data_ptr, b.ptr, b.len);
+          out->ptr = nullptr;
+          data_ptr += b.len;
+        }
+        else {
+          out->ptr = b.ptr;
+        }
+        rec->count++;
+      }
+      rec->response_len = response_len;
+    }
+    rec->status = status;
+
+    data_len += rec->record_size();
+    count++;
+    return true;
+  }
+
+  size_t get_message_size() const { return sizeof(Work_batch_response) + data_len; }
+
+  inline const record_t * first_record() const { return reinterpret_cast<const record_t*>(data); }
+
+  static inline const record_t * next_record(const record_t * rec) {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  static void copy_responses(const record_t * rec,
+                             Component::IADO_plugin::response_buffer_vector_t& out_vector) {
+    using response_buffer_t = Component::IADO_plugin::response_buffer_t;
+
+    auto data_ptr = rec->data;
+    for(uint32_t i=0; i<rec->count; i++) {
+      auto b = reinterpret_cast<const response_buffer_t*>(data_ptr);
+      data_ptr += sizeof(response_buffer_t);
+      if(b->pool_ref) {
+        out_vector.push_back({b->ptr, b->len, true});
+      }
+      else {
+        void * p = malloc(b->len);
+        ::memcpy(p, data_ptr, b->len);
+        out_vector.push_back({p, b->len, false});
+        data_ptr += b->len;
+      }
+      out_vector.back().layer_id = b->layer_id;
+    }
+  }
+
+  uint32_t count;
+  uint64_t data_len;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic" // zero-size array
+  char     data[];
+#pragma GCC diagnostic pop
+} __attribute__((packed));
+
+/* a batch response can always carry a result for every request record */
+static_assert(sizeof(Work_batch_response::record_t) <= sizeof(Work_batch_request::record_t),
+              "Work_batch_response record larger than request record");
+
 //-------------
 
 struct Table_request : public Message {
@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <deque>
 #include <memory>
 #include <string>
 
@@ -44,8 +45,8 @@ class ADO_protocol_builder
 public:
   static constexpr size_t MAX_MESSAGE_SIZE  = 4096;
   static constexpr size_t QUEUE_SIZE        = 8;
-  static constexpr size_t POLL_SLEEP_USEC   = 500000;
-  static constexpr size_t POLL_RETRY_LIMIT  = 1000000;
+  static constexpr unsigned POLL_WAIT_USEC  = 100000; /*< doorbell wait before re-checking */
+  static constexpr size_t POLL_RETRY_LIMIT  = 20000;  /*< spins before sleeping on the doorbell */
 
   static_assert(MAX_MESSAGE_SIZE > 64, "MAX_MESSAGE_SIZE too small");
   
@@ -93,6 +94,20 @@ private:
     }
     return rc;
   }
+
+  /* spin briefly, then sleep on the channel doorbell */
+  status_t wait_recv(channel_t ch, Buffer_header *& out_buffer) __attribute__((warn_unused_result))
+  {
+    for(size_t retries = 0; retries < POLL_RETRY_LIMIT; retries++) {
+      if(recv(ch, out_buffer) == S_OK) return S_OK;
+      cpu_relax();
+    }
+
+    void *v;
+    while(::uipc_recv_wait(ch, &v, POLL_WAIT_USEC) != S_OK) {}
+    out_buffer = static_cast<Buffer_header *>(v);
+    return S_OK;
+  }
 public:
   enum class Role {
     CONNECT,
@@ -146,9 +161,30 @@ public:
                           uint64_t work_key,
                           const Component::IADO_plugin::response_buffer_vector_t& response_buffers);
 
+  /* shard-side, must not block */
+  void send_work_batch_request(const std::vector<Component::IADO_proxy::work_item_t>& items);
+
+  static size_t work_batch_item_space(const size_t invocation_data_len);
+
+  static size_t work_batch_capacity();
+
+  struct work_result_t {
+    work_result_t() : work_key(0), status(E_FAIL), response_buffers() {}
+    work_result_t(const work_result_t&) = delete;
+    work_result_t& operator=(const work_result_t&) = delete;
+
+    uint64_t                                         work_key;
+    status_t                                         status;
+    Component::IADO_plugin::response_buffer_vector_t response_buffers;
+  };
+
+  /* results in request order */
+  void send_work_batch_response(const std::deque<work_result_t>& results);
+
   ssize_t recv_from_proxy(void * target, const size_t target_len);
 
-  /* shard-side, must not block */
+  /* shard-side, must not block; a batch response yields its results
+     one per call */
   bool recv_from_ado_work_completion(uint64_t& work_key,
                                      status_t& status,
                                      Component::IADO_plugin::response_buffer_vector_t& response_buffers);
@@ -300,32 +336,15 @@ public:
   static const uint8_t * buffer_header_to_message(Buffer_header *buffer);
 
   status_t poll_recv(Buffer_header *& out_buffer) __attribute__((warn_unused_result)) {
-    status_t s;
-    while((s = recv(out_buffer)) == E_EMPTY) {
-      cpu_relax();
-    }
-    return s;
+    return wait_recv(_channel, out_buffer);
   }
 
   status_t poll_recv_sleep(Buffer_header *& out_buffer) __attribute__((warn_unused_result)) {
-    status_t s;
-    unsigned retries = 0;
-    while((s = recv(out_buffer)) == E_EMPTY) {
-      if(retries++ < POLL_RETRY_LIMIT)
-        cpu_relax();
-      else
-        usleep(POLL_SLEEP_USEC);
-    }
-    return s;
+    return wait_recv(_channel, out_buffer);
   }
 
   status_t poll_recv_callback(Buffer_header *& out_buffer) __attribute__((warn_unused_result)) {
-    status_t s;
-    while((s = recv_callback(out_buffer)) == E_EMPTY) {
-      cpu_relax();
-    }
-
-    return s;
+    return wait_recv(_channel_callback, out_buffer);
   }
 
 private:
@@ -337,6 +356,8 @@ private:
    * is available. We hope that the ADO protocol will not exhaust the pool.
    */
   std::vector<buffer_space_shared_ptr_t> _buffer;
+  /* shard-side, remaining results of a received batch response */
+  std::deque<work_result_t> _batch_results;
 };
 
 
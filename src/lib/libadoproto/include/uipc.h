@@ -38,8 +38,8 @@ extern "C" {
 
 /**
  * Channel is bi-directional, user-level, lock-free exchange of
- * fixed sized messages (zero-copy).  Receiving is polling-based (it
- * can be configured as sleeping. It does not define the message
+ * fixed sized messages (zero-copy).  Receiving is polling-based or
+ * sleeping (uipc_recv_wait). It does not define the message
  * protocol which can be Protobuf etc.  Channel is a lock-free FIFO
  * (MPMC) in shared memory for passing pointers together with a slab
  * allocator (also lock-free and thread-safe across both sides) for
@@ -117,6 +117,18 @@ status_t uipc_send(channel_t channel, void* data) __attribute__((warn_unused_res
  * @return S_OK or E_EMPTY
  */
 status_t uipc_recv(channel_t channel, void** data_out) __attribute__((warn_unused_result));
+
+/**
+ * Recv a message, sleeping while the channel is empty.  The sender
+ * wakes the receiver through a futex doorbell in channel memory.
+ *
+ * @param channel Channel handle
+ * @param data_out If return S_OK, pointer to data popped off FIFO
+ * @param timeout_usec Maximum time to sleep in microseconds
+ *
+ * @return S_OK or E_EMPTY on timeout
+ */
+status_t uipc_recv_wait(channel_t channel, void** data_out, unsigned timeout_usec) __attribute__((warn_unused_result));
 #ifdef __cplusplus
 }
 #endif
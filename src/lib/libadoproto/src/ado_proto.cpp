@@ -77,6 +77,7 @@ ADO_protocol_builder::ADO_protocol_builder(const std::string& channel_prefix,
   , _channel()
   , _channel_callback()
   , _buffer()
+  , _batch_results()
 {
   /* connect UIPC channels */
   if(role == Role::CONNECT) {
@@ -323,11 +324,67 @@ void ADO_protocol_builder::send_work_response(status_t status,
   send(buffer);
 }
 
+void ADO_protocol_builder::send_work_batch_request(const std::vector<Component::IADO_proxy::work_item_t>& items)
+{
+  auto buffer = get_buffer().release();
+  assert(buffer);
+
+  auto msg = new (buffer) Work_batch_request(MAX_MESSAGE_SIZE);
+  for(auto& item : items) {
+    if(!msg->append(MAX_MESSAGE_SIZE,
+                    item.work_request_key,
+                    item.key,
+                    item.key_len,
+                    item.value_addr,
+                    item.value_len,
+                    item.invocation_data,
+                    item.invocation_len,
+                    item.new_root))
+      throw std::length_error(Work_batch_request::description);
+  }
+
+  send(buffer);
+}
+
+size_t ADO_protocol_builder::work_batch_item_space(const size_t invocation_data_len)
+{
+  return Work_batch_request::record_t::space(invocation_data_len);
+}
+
+size_t ADO_protocol_builder::work_batch_capacity()
+{
+  return MAX_MESSAGE_SIZE - sizeof(Work_batch_request);
+}
+
+void ADO_protocol_builder::send_work_batch_response(const std::deque<work_result_t>& results)
+{
+  auto buffer = get_buffer().release();
+  assert(buffer);
+
+  auto msg = new (buffer) Work_batch_response(MAX_MESSAGE_SIZE);
+  for(auto& r : results) {
+    if(!msg->append(MAX_MESSAGE_SIZE, r.work_key, r.status, r.response_buffers))
+      throw std::length_error(Work_batch_response::description);
+  }
+
+  send(buffer);
+}
+
 bool ADO_protocol_builder::
 recv_from_ado_work_completion(uint64_t& work_key,
                               status_t& status,
                               Component::IADO_plugin::response_buffer_vector_t& response_buffers)
 {
+  /* hand out remaining results of a batch first */
+  if(!_batch_results.empty()) {
+    auto& r = _batch_results.front();
+    work_key = r.work_key;
+    status = r.status;
+    response_buffers.swap(r.response_buffers);
+    _batch_results.pop_front();
+    return true;
+  }
+
   Buffer_header * buffer = nullptr;
   status_t s = recv(buffer);
 
@@ -335,6 +392,24 @@ recv_from_ado_work_completion(uint64_t& work_key,
     return false;
   }
 
+  if(mcas::ipc::Message::is_valid(buffer) &&
+     mcas::ipc::Message::type(buffer) == mcas::ipc::MSG_TYPE_WORK_BATCH_RESPONSE) {
+
+    auto * br = reinterpret_cast<mcas::ipc::Work_batch_response*>(buffer);
+    auto rec = br->first_record();
+    for(uint32_t i = 0; i < br->count; i++, rec = mcas::ipc::Work_batch_response::next_record(rec)) {
+      _batch_results.emplace_back();
+      auto& r = _batch_results.back();
+      r.work_key = rec->work_key;
+      r.status = rec->status;
+      mcas::ipc::Work_batch_response::copy_responses(rec, r.response_buffers);
+    }
+    free_ipc_buffer(buffer);
+
+    if(_batch_results.empty()) return false;
+    return recv_from_ado_work_completion(work_key, status, response_buffers);
+  }
+
   /*---------------------------------------*/
   /* custom IPC message protocol           */
   /*---------------------------------------*/
@@ -86,4 +86,10 @@ status_t uipc_recv(channel_t channel, void** data_out) {
   assert(ch);
   return ch->recv(*data_out);
 }
+
+status_t uipc_recv_wait(channel_t channel, void** data_out, unsigned timeout_usec) {
+  auto ch = static_cast<Core::UIPC::Channel*>(channel);
+  assert(ch);
+  return ch->recv_wait(*data_out, timeout_usec);
+}
 }
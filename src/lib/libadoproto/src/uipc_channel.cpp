@@ -22,6 +22,7 @@
 #include "uipc_channel.h"
 
 #include "resource_unavailable.h"
+#include "uipc_doorbell.h"
 #include "uipc_shared_memory.h"
 #include <common/errors.h>
 #include <common/exceptions.h>
@@ -63,9 +64,14 @@ Channel::Channel(const std::string &name, size_t message_size, size_t queue_size
   , _shmem_slab()
   , _in_queue(nullptr)
   , _out_queue(nullptr)
-  , _slab_ring(nullptr) {
+  , _slab_ring(nullptr)
+  , _state(nullptr)
+  , _in_bell(nullptr)
+  , _out_bell(nullptr) {
   const size_t queue_footprint = queue_t::memory_footprint(queue_size);
   size_t pages_per_queue = round_up(queue_footprint, PAGE_SIZE) / PAGE_SIZE;
+  /* m2s memory also holds the channel state block */
+  size_t pages_m2s = round_up(queue_footprint + sizeof(Channel_state), PAGE_SIZE) / PAGE_SIZE;
 
   assert((queue_size != 0) && ((queue_size & (~queue_size + 1)) ==
                                queue_size));  // queue len is a power of 2
@@ -96,12 +102,12 @@ Channel::Channel(const std::string &name, size_t message_size, size_t queue_size
   if(option_DEBUG)
     PLOG("slab_pages: %ld", slab_pages);
 
-  const size_t total_pages = ((pages_per_queue * 2) + slab_queue_pages + slab_pages);
+  const size_t total_pages = (pages_m2s + pages_per_queue + slab_queue_pages + slab_pages);
 
   if(option_DEBUG)
     PLOG("total_pages: %ld", total_pages);
 
-  _shmem_fifo_m2s = std::make_unique<Shared_memory>(name + "-m2s", pages_per_queue);
+  _shmem_fifo_m2s = std::make_unique<Shared_memory>(name + "-m2s", pages_m2s);
   _shmem_fifo_s2m = std::make_unique<Shared_memory>(name + "-s2m", pages_per_queue);
   _shmem_slab_ring = std::make_unique<Shared_memory>(name + "-slabring", slab_queue_pages);
   _shmem_slab = std::make_unique<Shared_memory>(name + "-slab", slab_pages);
@@ -129,6 +135,14 @@ Channel::Channel(const std::string &name, size_t message_size, size_t queue_size
     }
     slot_addr += message_size;
   }
+
+  _state = new (state_block(*_shmem_fifo_m2s)) Channel_state();
+  _in_bell = &_state->s2m;
+  _out_bell = &_state->m2s;
+
+  /* release the slave */
+  _state->ready.store(Channel_state::READY);
+  futex_wake(&_state->ready);
 }
 
 Channel::Channel(const std::string &name)
@@ -141,7 +155,10 @@ Channel::Channel(const std::string &name)
   , _shmem_slab(std::make_unique<Shared_memory>(name + "-slab"))
   , _in_queue(reinterpret_cast<queue_t*>(_shmem_fifo_m2s->get_addr()))
   , _out_queue(reinterpret_cast<queue_t*>(_shmem_fifo_s2m->get_addr()))
-  , _slab_ring(reinterpret_cast<mqueue_t*>(_shmem_slab_ring->get_addr())) {
+  , _slab_ring(reinterpret_cast<mqueue_t*>(_shmem_slab_ring->get_addr()))
+  , _state(state_block(*_shmem_fifo_m2s))
+  , _in_bell(&_state->m2s)
+  , _out_bell(&_state->s2m) {
 
   if(option_DEBUG) {
     PMAJOR("got fifo (m2s) @ %p - %lu bytes", _shmem_fifo_m2s->get_addr(),
@@ -157,8 +174,18 @@ Channel::Channel(const std::string &name)
            _shmem_slab->get_size());
   }
 
-  ::usleep(500000); /* hack to let master get ready - could improve with state in
-                     shared memory */
+  /* The master fills and initializes the memory after the address
+     negotiation; wait until it says the channel is ready.  The m2s
+     memory was filled before the negotiation of the later regions
+     completed, so a stale READY cannot be seen here. */
+  uint32_t ready;
+  while ((ready = _state->ready.load()) != Channel_state::READY)
+    futex_wait(&_state->ready, ready, 100000);
+}
+
+Channel_state* Channel::state_block(Shared_memory& shmem_m2s) {
+  return reinterpret_cast<Channel_state*>(static_cast<char*>(shmem_m2s.get_addr()) + shmem_m2s.get_size() -
+                                          sizeof(Channel_state));
 }
 
 Channel::~Channel() {
@@ -170,6 +197,7 @@ Channel::~Channel() {
 status_t Channel::send(void* msg) {
   assert(_out_queue);
   if (_out_queue->enqueue(msg)) {
+    _out_bell->ring();
     return S_OK;
   }
   else {
@@ -185,7 +213,27 @@ status_t Channel::recv(void*& recvd_msg) {
     return E_EMPTY;
 }
 
-void Channel::unblock_threads() { _in_queue->exit_threads(); }
+status_t Channel::recv_wait(void*& recvd_msg, unsigned timeout_usec) {
+  assert(_in_queue);
+  for (;;) {
+    if (_in_queue->dequeue(recvd_msg))
+      return S_OK;
+
+    const auto seq = _in_bell->prepare();
+    if (_in_queue->dequeue(recvd_msg)) {
+      _in_bell->cancel();
+      return S_OK;
+    }
+
+    if (!_in_bell->wait(seq, timeout_usec))
+      return _in_queue->dequeue(recvd_msg) ? S_OK : E_EMPTY;
+  }
+}
+
+void Channel::unblock_threads() {
+  _in_queue->exit_threads();
+  _in_bell->ring();
+}
 
 void* Channel::alloc_msg() {
   assert(_slab_ring);
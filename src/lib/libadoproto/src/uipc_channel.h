@@ -38,6 +38,8 @@ namespace Core
 namespace UIPC
 {
 class Shared_memory;
+class Doorbell;
+struct Channel_state;
 class Channel : public uipc_channel {
  private:
   static constexpr bool option_DEBUG = false;
@@ -100,6 +102,16 @@ class Channel : public uipc_channel {
    */
   status_t recv(void*& recvd_msg);
 
+  /**
+   * Receive message from channel, sleeping while the channel is empty
+   *
+   * @param out_msg Out message
+   * @param timeout_usec Maximum time to sleep in microseconds
+   *
+   * @return S_OK or E_EMPTY on timeout
+   */
+  status_t recv_wait(void*& recvd_msg, unsigned timeout_usec);
+
   /**
    * Allocate message (in shared memory) for
    * exchange on channel
@@ -140,6 +152,8 @@ class Channel : public uipc_channel {
  private:
   void initialize_data_structures();
 
+  static Channel_state* state_block(Shared_memory& shmem_m2s);
+
  private:
   bool _shutdown = false;
   bool _master;
@@ -153,6 +167,9 @@ class Channel : public uipc_channel {
   queue_t* _in_queue;
   queue_t* _out_queue;
   mqueue_t* _slab_ring;
+  Channel_state* _state;
+  Doorbell* _in_bell;
+  Doorbell* _out_bell;
 };
 
 }  // namespace UIPC
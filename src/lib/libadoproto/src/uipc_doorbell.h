@@ -0,0 +1,111 @@
+/*
+   Copyright [2020] [IBM Corporation]
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+       http://www.apache.org/licenses/LICENSE-2.0
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __CORE_UIPC_DOORBELL_H__
+#define __CORE_UIPC_DOORBELL_H__
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+namespace Core
+{
+namespace UIPC
+{
+/* futex operations on a word in shared memory (not FUTEX_PRIVATE: the
+   waker is in the other process) */
+inline long futex_wait(std::atomic<uint32_t> *word, uint32_t expected, unsigned timeout_usec)
+{
+  struct timespec ts = {time_t(timeout_usec / 1000000), long(timeout_usec % 1000000) * 1000};
+  return ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+inline void futex_wake(std::atomic<uint32_t> *word)
+{
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/**
+ * Doorbell for a queue in shared memory.  The consumer registers as a
+ * waiter, re-checks the queue and then sleeps on the sequence word; the
+ * producer advances the sequence after each enqueue and only enters the
+ * kernel when a waiter is registered, so a busy channel pays one atomic
+ * increment per message.
+ */
+class alignas(64) Doorbell {
+ public:
+  Doorbell() : _seq(0), _waiters(0) {}
+
+  Doorbell(const Doorbell &) = delete;
+  Doorbell &operator=(const Doorbell &) = delete;
+
+  /* producer side, after enqueue */
+  void ring()
+  {
+    _seq.fetch_add(1);
+    if (_waiters.load() > 0) futex_wake(&_seq);
+  }
+
+  /* consumer side; re-check the queue before calling wait() */
+  uint32_t prepare()
+  {
+    _waiters.fetch_add(1);
+    return _seq.load();
+  }
+
+  void cancel() { _waiters.fetch_sub(1); }
+
+  /**
+   * Sleep unless the bell has rung since prepare()
+   *
+   * @param seq Value returned by prepare()
+   * @param timeout_usec Timeout in microseconds
+   *
+   * @return False on timeout
+   */
+  bool wait(uint32_t seq, unsigned timeout_usec)
+  {
+    const long rc = futex_wait(&_seq, seq, timeout_usec);
+    const bool timed_out = (rc == -1 && errno == ETIMEDOUT);
+    _waiters.fetch_sub(1);
+    return !timed_out;
+  }
+
+ private:
+  std::atomic<uint32_t> _seq;
+  std::atomic<uint32_t> _waiters;
+};
+
+/**
+ * Channel control block, placed at the end of the m2s queue memory.
+ * 'ready' is set by the master once all channel memory is initialized.
+ */
+struct Channel_state {
+  static constexpr uint32_t READY = 0x59444552; /* "REDY" */
+
+  Channel_state() : m2s(), s2m(), ready(0) {}
+
+  Doorbell              m2s; /*< rung by the master on send */
+  Doorbell              s2m; /*< rung by the slave on send */
+  std::atomic<uint32_t> ready;
+};
+
+}  // namespace UIPC
+}  // namespace Core
+
+#endif
@@ -331,8 +331,35 @@ static PyObject * get_stats(Session* self, PyObject *args, PyObject *kwds)
   macro_add_dict_item(op_get_twostage_count);
   macro_add_dict_item(op_erase_count);
   macro_add_dict_item(op_failed_request_count);
+  macro_add_dict_item(op_batch_count);
+  macro_add_dict_item(busy_cycles);
+  macro_add_dict_item(idle_cycles);
   macro_add_dict_item(last_op_count_snapshot);
 
+  /* latency percentiles: latency[op][component] = {count, p50_ns, ...} */
+  static const char * op_names[] = {"put", "get", "erase", "batch", "ado", "other"};
+  static const char * kind_names[] = {"queue", "service", "store", "ado"};
+
+  PyObject* latency = PyDict_New();
+  for(unsigned op = 0; op < Component::IMCAS::STATS_OP_COUNT; op++) {
+    PyObject* op_dict = PyDict_New();
+    for(unsigned kind = 0; kind < Component::IMCAS::STATS_LATENCY_COUNT; kind++) {
+      const auto& l = stats.latency[op][kind];
+      PyObject* kind_dict = PyDict_New();
+      PyDict_SetItemString(kind_dict, "count", PyLong_FromUnsignedLongLong(l.count));
+      PyDict_SetItemString(kind_dict, "p50_ns", PyLong_FromUnsignedLongLong(l.p50_ns));
+      PyDict_SetItemString(kind_dict, "p99_ns", PyLong_FromUnsignedLongLong(l.p99_ns));
+      PyDict_SetItemString(kind_dict, "p999_ns", PyLong_FromUnsignedLongLong(l.p999_ns));
+      PyDict_SetItemString(kind_dict, "max_ns", PyLong_FromUnsignedLongLong(l.max_ns));
+      PyDict_SetItemString(op_dict, kind_names[kind], kind_dict);
+      Py_DECREF(kind_dict);
+    }
+    PyDict_SetItemString(latency, op_names[op], op_dict);
+    Py_DECREF(op_dict);
+  }
+  PyDict_SetItemString(dict, "latency", latency);
+  Py_DECREF(latency);
+
   return dict;
 }
 
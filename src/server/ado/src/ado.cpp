@@ -12,6 +12,7 @@
 */
 
 #include "ado.h"
+#include "ado_work_pool.h"
 #include "ado_proto.h"
 #include "ado_ipc_proto.h"
 #include "ado_proto_buffer.h"
@@ -50,6 +51,34 @@ static bool check_xpmem_kernel_module()
   return (fd != -1);
 }
 
+/* FNV-1a; selects the worker that orders work on a key */
+static uint64_t key_hash(const char * key, size_t key_len)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for(size_t i = 0; i < key_len; i++) {
+    h ^= static_cast<unsigned char>(key[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+/* a Work_batch_request while its records run; the last one to finish
+   sends the batch response */
+struct work_batch_t
+{
+  explicit work_batch_t(mcas::ipc::Work_batch_request * request_p)
+    : request(request_p), results(request_p->count), remaining(request_p->count)
+  {
+  }
+
+  work_batch_t(const work_batch_t&) = delete;
+  work_batch_t& operator=(const work_batch_t&) = delete;
+
+  mcas::ipc::Work_batch_request *                  request;
+  std::deque<ADO_protocol_builder::work_result_t> results; /*< in record order */
+  std::atomic<uint32_t>                            remaining;
+};
+
 /**
  * Class to manage plugins
  */
@@ -128,6 +157,12 @@ public:
     for(auto i: _i_plugins)
       i->notify_op_event(op);
   }
+
+  bool thread_safe() const {
+    for(auto i: _i_plugins)
+      if(!i->thread_safe()) return false;
+    return true;
+  }
   
 private:
   std::vector<IADO_plugin*> _i_plugins;
@@ -147,6 +182,7 @@ int main(int argc, char* argv[])
 {
   std::string plugins, channel_id;
   unsigned debug_level;
+  unsigned threads;
   std::string cpu_mask;
 
   try {
@@ -158,6 +194,7 @@ int main(int argc, char* argv[])
       ("channel_id", po::value<std::string>(&channel_id)->required(), "Channel (prefix) identifier")
       ("debug", po::value<unsigned>(&debug_level)->default_value(0), "Debug level")
       ("cpumask", po::value<std::string>(&cpu_mask), "Cores to restrict threads to (string form)")
+      ("threads", po::value<unsigned>(&threads)->default_value(0), "Work request threads for thread-safe plugins (0 for one per cpumask core)")
       ;
 
     po::variables_map vm;
@@ -182,10 +219,15 @@ int main(int argc, char* argv[])
 
   ADO_protocol_builder ipc(channel_id, ADO_protocol_builder::Role::ACCEPT);
 
+  /* Serializes sends, callback round trips and buffer recycling once
+     work requests run on worker threads.  Only the main loop receives
+     from the work channel, so it polls without the lock. */
+  std::mutex ipc_lock;
+
   /* Callback functions */
 
   auto ipc_create_key =
-    [&ipc] (const uint64_t work_request_id,
+    [&ipc, &ipc_lock] (const uint64_t work_request_id,
             const std::string& key_name,
             const size_t value_size,
             const int flags,
@@ -193,6 +235,7 @@ int main(int argc, char* argv[])
             const char ** out_key_ptr,
             Component::IKVStore::key_t * out_key_handle) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_table_op_create(work_request_id, key_name, value_size, flags);
       ipc.recv_table_op_response(rc, out_value_addr, nullptr /* value len */, out_key_ptr, out_key_handle);
@@ -200,7 +243,7 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_open_key =
-    [&ipc] (const uint64_t work_request_id,
+    [&ipc, &ipc_lock] (const uint64_t work_request_id,
             const std::string& key_name,
             const int flags,
             void*& out_value_addr,
@@ -208,6 +251,7 @@ int main(int argc, char* argv[])
             const char** out_key_ptr,
             Component::IKVStore::key_t * out_key_handle) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_table_op_open(work_request_id, key_name, flags);
       ipc.recv_table_op_response(rc, out_value_addr, &out_value_len, out_key_ptr, out_key_handle);
@@ -215,8 +259,9 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_erase_key =
-    [&ipc] (const std::string& key_name) -> status_t
+    [&ipc, &ipc_lock] (const std::string& key_name) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       void* na;
       ipc.send_table_op_erase(key_name);
@@ -225,11 +270,12 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_resize_value =
-    [&ipc] (const uint64_t work_request_id,
+    [&ipc, &ipc_lock] (const uint64_t work_request_id,
             const std::string& key_name,
             const size_t new_value_size,
             void*& out_new_value_addr) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_table_op_resize(work_request_id, key_name, new_value_size);
       ipc.recv_table_op_response(rc, out_new_value_addr);
@@ -238,10 +284,11 @@ int main(int argc, char* argv[])
 
 
   auto ipc_allocate_pool_memory =
-    [&ipc] (const size_t size,
+    [&ipc, &ipc_lock] (const size_t size,
             const size_t alignment,
             void *&out_new_addr) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_table_op_allocate_pool_memory(size, alignment);
       ipc.recv_table_op_response(rc, out_new_addr);
@@ -249,9 +296,10 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_free_pool_memory =
-    [&ipc] (const size_t size,
+    [&ipc, &ipc_lock] (const size_t size,
             const void * addr) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       void * na;
       ipc.send_table_op_free_pool_memory(addr, size);
@@ -260,12 +308,13 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_find_key =
-    [&ipc] (const std::string& key_expression,
+    [&ipc, &ipc_lock] (const std::string& key_expression,
             const offset_t begin_position,
             const Component::IKVIndex::find_t find_type,
             offset_t& out_matched_position,
             std::string& out_matched_key) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_find_index_request(key_expression,
                                   begin_position,
@@ -279,10 +328,11 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_get_reference_vector =
-    [&ipc] (const epoch_time_t t_begin,
+    [&ipc, &ipc_lock] (const epoch_time_t t_begin,
             const epoch_time_t t_end,
             IADO_plugin::Reference_vector& out_vector) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_vector_request(t_begin, t_end);
       ipc.recv_vector_response(rc, out_vector);
@@ -290,8 +340,9 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_get_pool_info =
-    [&ipc] (std::string& out_response) -> status_t
+    [&ipc, &ipc_lock] (std::string& out_response) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_pool_info_request();
       ipc.recv_pool_info_response(rc, out_response);
@@ -299,11 +350,12 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_iterate =
-    [&ipc] (const epoch_time_t t_begin,
+    [&ipc, &ipc_lock] (const epoch_time_t t_begin,
             const epoch_time_t t_end,
             Component::IKVStore::pool_iterator_t& iterator,
             Component::IKVStore::pool_reference_t& reference) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       ipc.send_iterate_request(t_begin, t_end, iterator);
       ipc.recv_iterate_response(rc, iterator, reference);
@@ -311,9 +363,10 @@ int main(int argc, char* argv[])
     };
 
   auto ipc_unlock =
-    [&ipc] (const uint64_t work_id,
+    [&ipc, &ipc_lock] (const uint64_t work_id,
             Component::IKVStore::key_t key_handle) -> status_t
     {
+      std::lock_guard<std::mutex> g(ipc_lock);
       status_t rc;
       if(work_id == 0 || key_handle == nullptr) return E_INVAL;
       ipc.send_unlock_request(work_id, key_handle);
@@ -361,6 +414,81 @@ int main(int argc, char* argv[])
 
   PLOG("ADO process: main thread (%lu)", pthread_self());
 
+  /* run a work request and send its response; frees the request buffer */
+  auto execute_work_request = [&](mcas::ipc::Work_request * wr)
+    {
+      Component::IADO_plugin::response_buffer_vector_t response_buffers;
+      auto work_request_id = wr->work_key;
+
+      IADO_plugin::value_space_t values;
+      values.append(wr->get_value_addr(),wr->value_len);
+      values.append(wr->get_detached_value_addr(), wr->detached_value_len);
+
+      /* forward to plugins */
+      status_t rc =
+        plugin_mgr.do_work(work_request_id,
+                           wr->get_key(),
+                           wr->get_key_len(),
+                           values,
+                           wr->get_invocation_data(),
+                           wr->invocation_data_len,
+                           wr->new_root,
+                           response_buffers);
+
+      /* pass back response data */
+      std::lock_guard<std::mutex> g(ipc_lock);
+      ipc.send_work_response(rc,
+                             work_request_id,
+                             response_buffers);
+      ipc.free_ipc_buffer(wr);
+    };
+
+  /* run one record of a work batch; the last record sends the batch
+     response and frees the request buffer */
+  auto execute_batch_record = [&](const std::shared_ptr<work_batch_t>& batch,
+                                  const mcas::ipc::Work_batch_request::record_t * rec,
+                                  const uint32_t index)
+    {
+      auto& result = batch->results[index];
+      result.work_key = rec->work_key;
+
+      IADO_plugin::value_space_t values;
+      values.append(rec->get_value_addr(), rec->value_len);
+      values.append(nullptr, 0);
+
+      result.status =
+        plugin_mgr.do_work(rec->work_key,
+                           rec->get_key(),
+                           rec->key_len,
+                           values,
+                           rec->get_invocation_data(),
+                           rec->invocation_data_len,
+                           rec->new_root,
+                           result.response_buffers);
+
+      if(--batch->remaining == 0) {
+        std::lock_guard<std::mutex> g(ipc_lock);
+        ipc.send_work_batch_response(batch->results);
+        ipc.free_ipc_buffer(batch->request);
+      }
+    };
+
+  /* optional worker pool; threads inherit the cpu mask set above */
+  std::unique_ptr<ADO_work_pool> work_pool;
+  if(threads == 0) {
+    cpu_mask_t m;
+    threads = (!cpu_mask.empty() && string_to_mask(cpu_mask, m) == S_OK) ? unsigned(m.count()) : 1;
+  }
+  if(threads > 1) {
+    if(plugin_mgr.thread_safe()) {
+      work_pool.reset(new ADO_work_pool(threads));
+      PLOG("ADO process: %u work request threads", threads);
+    }
+    else if(debug_level > 0) {
+      PLOG("ADO process: plugins not thread safe; work requests on main thread");
+    }
+  }
+
   while (!exit) {
 
     /* main loop servicing incoming IPC requests */
@@ -369,6 +497,7 @@ int main(int argc, char* argv[])
       PLOG("ADO process: waiting for message (%lu)", count);
 
     Buffer_header * buffer = nullptr; /* recv will dequeue this */
+    bool buffer_consumed = false;
 
     /* poll until there is a request, sleep on too much polling  */
     auto st = ipc.poll_recv_sleep(buffer);
@@ -395,6 +524,7 @@ int main(int argc, char* argv[])
             case chirp_t::SHUTDOWN:
               PMAJOR("ADO: received Shutdown chirp in %p",
                      static_cast<void *>(buffer));
+              if(work_pool) work_pool->drain();
               plugin_mgr.shutdown();
               exit = true;
               break;
@@ -431,6 +561,7 @@ int main(int argc, char* argv[])
           PMAJOR("ADO: mapped memory %lx size:%lu", mm->token, mm->size);
 
           /* register memory with plugins */
+          if(work_pool) work_pool->drain();
           if(plugin_mgr.register_mapped_memory(mm->shard_addr, mm_addr, mm->size) != S_OK)
             throw General_exception("calling register_mapped_memory on ADO plugin failed");
 
@@ -438,7 +569,6 @@ int main(int argc, char* argv[])
         }
         case(mcas::ipc::MSG_TYPE_WORK_REQUEST):  {
         
-          Component::IADO_plugin::response_buffer_vector_t response_buffers;
           auto * wr = reinterpret_cast<Work_request*>(buffer);
 
           if(debug_level > 1)
@@ -453,28 +583,41 @@ int main(int argc, char* argv[])
                  wr->detached_value_len,
                  wr->new_root);
 
-          auto work_request_id = wr->work_key;
+          /* same key, same worker: per-key order is kept */
+          if(work_pool) {
+            work_pool->post(key_hash(wr->get_key(), wr->get_key_len()),
+                            [&execute_work_request, wr]() { execute_work_request(wr); });
+          }
+          else {
+            execute_work_request(wr);
+          }
+          buffer_consumed = true;
+          break;
+        }
+        case(mcas::ipc::MSG_TYPE_WORK_BATCH_REQUEST):  {
 
-          IADO_plugin::value_space_t values;
-          values.append(wr->get_value_addr(),wr->value_len);
-          values.append(wr->get_detached_value_addr(), wr->detached_value_len);
-          
-          /* forward to plugins */
-          status_t rc =
-            plugin_mgr.do_work(work_request_id,
-                               wr->get_key(),
-                               wr->get_key_len(),
-                               values,
-                               wr->get_invocation_data(),
-                               wr->invocation_data_len,
-                               wr->new_root,
-                               response_buffers);
-
-          /* pass back response data */
-          ipc.send_work_response(rc,
-                                 work_request_id,
-                                 response_buffers);
+          auto * br = reinterpret_cast<Work_batch_request*>(buffer);
 
+          if(debug_level > 1)
+            PLOG("ADO process: RECEIVED Work_batch_request: count=%u", br->count);
+
+          if(br->count == 0)
+            throw Protocol_exception("empty work batch");
+
+          /* records are independent work requests; the shard never puts
+             the same key twice in one batch */
+          auto batch = std::make_shared<work_batch_t>(br);
+          auto rec = br->first_record();
+          for(uint32_t i = 0; i < br->count; i++, rec = Work_batch_request::next_record(rec)) {
+            if(work_pool) {
+              work_pool->post(key_hash(rec->get_key(), rec->key_len),
+                              [&execute_batch_record, batch, rec, i]() { execute_batch_record(batch, rec, i); });
+            }
+            else {
+              execute_batch_record(batch, rec, i);
+            }
+          }
+          buffer_consumed = true;
           break;
         }
         case(mcas::ipc::MSG_TYPE_BOOTSTRAP_REQUEST):  {
@@ -494,6 +637,7 @@ int main(int argc, char* argv[])
                                   boot_req->pool_flags,
                                   boot_req->expected_obj_count);
           
+          std::lock_guard<std::mutex> g(ipc_lock);
           ipc.send_bootstrap_response();
           break;
         }
@@ -503,7 +647,9 @@ int main(int argc, char* argv[])
             PLOG("ADO_process: received op event (%s)", to_str(event->op).c_str());
           
           /* invoke plugin then return completion */
-          plugin_mgr.notify_op_event(event->op);          
+          if(work_pool) work_pool->drain();
+          plugin_mgr.notify_op_event(event->op);
+          std::lock_guard<std::mutex> g(ipc_lock);
           ipc.send_op_event_response(event->op);
           /* now exit */
           exit = true;
@@ -514,7 +660,10 @@ int main(int argc, char* argv[])
         }
         }
 
-      ipc.free_ipc_buffer(buffer);
+      if(!buffer_consumed) {
+        std::lock_guard<std::mutex> g(ipc_lock);
+        ipc.free_ipc_buffer(buffer);
+      }
       count++;
       continue;
     }
@@ -0,0 +1,115 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef __ADO_WORK_POOL_H__
+#define __ADO_WORK_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads for ADO work requests.  Each thread has its own queue
+ * and work is placed by ordering key, so work with the same key runs one
+ * item at a time in posting order while different keys run in parallel.
+ * Threads inherit the process CPU affinity.
+ */
+class ADO_work_pool {
+ public:
+  using work_t = std::function<void()>;
+
+  explicit ADO_work_pool(unsigned thread_count) : _workers(), _pending(0), _pending_lock(), _pending_cv()
+  {
+    for (unsigned i = 0; i < thread_count; i++) _workers.emplace_back(new worker_t());
+    for (auto &w : _workers) w->thread = std::thread(&ADO_work_pool::worker_entry, this, w.get());
+  }
+
+  ADO_work_pool(const ADO_work_pool &) = delete;
+  ADO_work_pool &operator=(const ADO_work_pool &) = delete;
+
+  ~ADO_work_pool()
+  {
+    for (auto &w : _workers) {
+      {
+        std::lock_guard<std::mutex> g(w->lock);
+        w->exit = true;
+      }
+      w->cv.notify_one();
+    }
+    for (auto &w : _workers) w->thread.join();
+  }
+
+  size_t size() const { return _workers.size(); }
+
+  void post(const uint64_t ordering_key, work_t &&work)
+  {
+    {
+      std::lock_guard<std::mutex> g(_pending_lock);
+      _pending++;
+    }
+    auto &w = *_workers[ordering_key % _workers.size()];
+    {
+      std::lock_guard<std::mutex> g(w.lock);
+      w.queue.push_back(std::move(work));
+    }
+    w.cv.notify_one();
+  }
+
+  /* wait until all posted work has completed */
+  void drain()
+  {
+    std::unique_lock<std::mutex> g(_pending_lock);
+    _pending_cv.wait(g, [this]() { return _pending == 0; });
+  }
+
+ private:
+  struct worker_t {
+    worker_t() : thread(), lock(), cv(), queue(), exit(false) {}
+
+    std::thread             thread;
+    std::mutex              lock;
+    std::condition_variable cv;
+    std::deque<work_t>      queue;
+    bool                    exit;
+  };
+
+  void worker_entry(worker_t *w)
+  {
+    for (;;) {
+      work_t work;
+      {
+        std::unique_lock<std::mutex> g(w->lock);
+        w->cv.wait(g, [w]() { return w->exit || !w->queue.empty(); });
+        if (w->queue.empty()) return; /* exit once drained */
+        work = std::move(w->queue.front());
+        w->queue.pop_front();
+      }
+
+      work();
+
+      std::lock_guard<std::mutex> g(_pending_lock);
+      if (--_pending == 0) _pending_cv.notify_all();
+    }
+  }
+
+  std::vector<std::unique_ptr<worker_t>> _workers;
+  size_t                                 _pending;
+  std::mutex                             _pending_lock;
+  std::condition_variable                _pending_cv;
+};
+
+#endif
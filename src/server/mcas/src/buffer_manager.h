@@ -21,11 +21,134 @@
 #include <sys/mman.h>
 
 #include "mcas_config.h"
+#include "resource_unavailable.h"
+#include <algorithm> /* find_if */
+#include <atomic>
 #include <cstring> /* memset */
 #include <memory> /* unique_ptr */
+#include <mutex>
+#include <vector>
 
 namespace mcas
 {
+/**
+ * Shard-wide source of IO buffer memory, in size classes.
+ *
+ * Connections take memory as they need buffers and give back what they do
+ * not expect to reuse, so a shard's buffer memory follows its load rather
+ * than its connection count. Memory is registered by each connection, so
+ * blocks are pooled but registrations are not.
+ */
+class Buffer_pool {
+ public:
+  static constexpr unsigned CLASS_COUNT = 3;
+
+  /* SMALL holds most responses; LARGE holds any message */
+  static constexpr size_t class_len(unsigned c) { return c == 0 ? KiB(4) : c == 1 ? KiB(64) : MiB(2); }
+
+  /* idle buffers of each class which a connection keeps registered; large
+     buffers only carry occasional large messages, so none is kept idle */
+  static constexpr size_t class_keep(unsigned c) { return c == 0 ? 4 : c == 1 ? 2 : 0; }
+
+  static unsigned size_class(size_t len)
+  {
+    unsigned c = 0;
+    while (c + 1 != CLASS_COUNT && class_len(c) < len) ++c;
+    assert(len <= class_len(c));
+    return c;
+  }
+
+  /**
+   * Constructor
+   *
+   * @param budget Bytes of buffer memory which the pool may allocate (0 = no limit)
+   */
+  explicit Buffer_pool(size_t budget) : _budget(budget), _m{}, _free{}, _allocated(0), _pressure(false) {}
+
+  Buffer_pool(const Buffer_pool &) = delete;
+  Buffer_pool &operator=(const Buffer_pool &) = delete;
+
+  ~Buffer_pool()
+  {
+    for (auto &f : _free) {
+      for (auto p : f) ::free(p);
+    }
+  }
+
+  /* @throw resource_unavailable if the budget is exhausted */
+  void *get(unsigned c)
+  {
+    {
+      std::lock_guard<std::mutex> g(_m);
+      if (!_free[c].empty()) {
+        auto p = _free[c].back();
+        _free[c].pop_back();
+        _pressure.store(false, std::memory_order_relaxed);
+        return p;
+      }
+      const auto len = class_len(c);
+      if (_budget && _budget < _allocated + len) {
+        reclaim(len);
+        if (_budget < _allocated + len) {
+          /* connections give back their idle buffers until a get succeeds */
+          _pressure.store(true, std::memory_order_relaxed);
+          throw resource_unavailable("shard buffer budget exhausted");
+        }
+      }
+      _allocated += len;
+    }
+    _pressure.store(false, std::memory_order_relaxed);
+    return alloc_base(class_len(c));
+  }
+
+  void put(unsigned c, void *p)
+  {
+    std::lock_guard<std::mutex> g(_m);
+    _free[c].push_back(p);
+  }
+
+  /* bytes allocated; may be read from other threads */
+  size_t allocated() const
+  {
+    std::lock_guard<std::mutex> g(_m);
+    return _allocated;
+  }
+
+  size_t budget() const { return _budget; }
+
+  /* true while the budget is exhausted; may be read from other threads */
+  bool under_pressure() const { return _pressure.load(std::memory_order_relaxed); }
+
+ private:
+  /* free memory idle in the pool, of any class, until len more bytes fit in the budget */
+  void reclaim(size_t len)
+  {
+    for (unsigned c = 0; c != CLASS_COUNT; c++) {
+      while (!_free[c].empty() && _budget < _allocated + len) {
+        ::free(_free[c].back());
+        _free[c].pop_back();
+        _allocated -= class_len(c);
+      }
+    }
+  }
+
+  static auto alloc_base(std::size_t len) -> void *
+  {
+    /* large buffers are huge-page aligned */
+    auto base = aligned_alloc(len < MiB(2) ? KiB(4) : MiB(2), len);
+    if (!base) throw resource_unavailable("buffer allocation failed");
+    if (MiB(2) <= len) ::madvise(base, len, MADV_HUGEPAGE);
+    std::memset(base, 0, len);
+    return base;
+  }
+
+  const size_t       _budget;
+  mutable std::mutex _m;
+  std::vector<void *> _free[CLASS_COUNT];
+  size_t             _allocated;
+  std::atomic<bool>  _pressure;
+};
+
 template <class Transport>
 class Buffer_manager {
   unsigned option_DEBUG = mcas::Global::debug_level;
@@ -33,6 +156,7 @@ class Buffer_manager {
  public:
   static constexpr size_t DEFAULT_BUFFER_COUNT = NUM_SHARD_BUFFERS;
   static constexpr size_t BUFFER_LEN           = MiB(2);
+  static_assert(BUFFER_LEN == Buffer_pool::class_len(Buffer_pool::CLASS_COUNT - 1), "largest buffer class must hold any message");
 
   enum {
     BUFFER_FLAGS_EXTERNAL = 1,
@@ -89,14 +213,35 @@ class Buffer_manager {
   };
 
  public:
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  /**
+   * Constructor
+   *
+   * @param transport Connection against which buffers are registered
+   * @param pool Shard-wide source of buffer memory
+   * @param buffer_count Buffers of each size class which one connection may hold
+   */
+  Buffer_manager(Transport *transport, Buffer_pool &pool, size_t buffer_count = DEFAULT_BUFFER_COUNT)
+      : _buffer_count(buffer_count), _keep_all(false), _transport(transport), _own_pool{}, _pool(pool), _buffers{},
+        _classes{}
+  {
+  }
+
+  /**
+   * Constructor for a manager with its own memory (the client): buffer_count
+   * large buffers are registered up front, and no buffer is ever given back.
+   *
+   * @param transport Connection against which buffers are registered
+   * @param buffer_count Buffers of each size class
+   */
   Buffer_manager(Transport *transport, size_t buffer_count = DEFAULT_BUFFER_COUNT)
-      : _buffer_count(buffer_count), _transport(transport)
+      : _buffer_count(buffer_count), _keep_all(true), _transport(transport), _own_pool(new Buffer_pool(0)),
+        _pool(*_own_pool), _buffers{}, _classes{}
   {
-    init();
+    const auto c = Buffer_pool::CLASS_COUNT - 1;
+    for (unsigned i = 0; i < _buffer_count; i++) {
+      _classes[c].free.push_back(acquire(c));
+    }
   }
-#pragma GCC diagnostic pop
 
   Buffer_manager(const Buffer_manager &) = delete;
   Buffer_manager &operator=(const Buffer_manager &) = delete;
@@ -104,19 +249,37 @@ class Buffer_manager {
   ~Buffer_manager()
   {
     /* Note: A buffer_t does not own its iov->iov_base.
+     * Memory of buffers still posted to the transport goes back to the pool too.
      */
     for (auto &b : _buffers) {
-      ::free(b->iov->iov_base);
+      _transport->deregister_memory(b->region);
+      _pool.put(Buffer_pool::size_class(b->original_length), b->base());
     }
   }
 
-  buffer_t *allocate()
+  /**
+   * Allocate a buffer of at least len bytes (default: large enough for any message)
+   *
+   * @throw resource_unavailable if the connection or the shard is out of buffers;
+   * the caller should retry later
+   */
+  buffer_t *allocate(size_t len = BUFFER_LEN)
   {
-    if (UNLIKELY(_free.empty())) throw Program_exception("buffer_manager.h: no shard buffers remaining");
-    auto iob = _free.back();
+    const auto c  = Buffer_pool::size_class(len);
+    auto &     cl = _classes[c];
+    buffer_t * iob;
+    if (!cl.free.empty()) {
+      iob = cl.free.back();
+      cl.free.pop_back();
+    }
+    else {
+      if (UNLIKELY(_buffer_count <= cl.in_use)) throw resource_unavailable("no connection buffers remaining");
+      iob = acquire(c); /* may throw resource_unavailable */
+    }
     assert(iob->flags == 0);
-    _free.pop_back();
-    if (option_DEBUG > 3) PLOG("bm: allocate : %p %lu", static_cast<const void *>(iob), _free.size());
+    ++cl.in_use;
+    _in_use.store(_in_use.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (option_DEBUG > 3) PLOG("bm: allocate : %p %lu", static_cast<const void *>(iob), cl.free.size());
     assert(iob);
     iob->reset_length();
     return iob;
@@ -128,39 +291,87 @@ class Buffer_manager {
     assert(iob->flags == 0);
 
     if (option_DEBUG > 3) PLOG("bm: free     : %p", static_cast<const void *>(iob));
-    iob->reset_length();
-    _free.push_back(iob);
+    const auto c  = Buffer_pool::size_class(iob->original_length);
+    auto &     cl = _classes[c];
+    assert(cl.in_use != 0);
+    --cl.in_use;
+    /* keep a few idle buffers registered, unless the shard is short of memory;
+       return the rest to the shard */
+    if (_keep_all || (cl.free.size() < Buffer_pool::class_keep(c) && !_pool.under_pressure())) {
+      iob->reset_length();
+      cl.free.push_back(iob);
+    }
+    else {
+      release(c, iob);
+    }
+    _in_use.store(_in_use.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
   }
 
+  /**
+   * Give idle buffers back to the shard while it is short of memory, so that
+   * a quiet connection does not hold memory a busy one is waiting for
+   */
+  void trim()
+  {
+    if (_keep_all || !_pool.under_pressure()) return;
+    for (unsigned c = 0; c != Buffer_pool::CLASS_COUNT; c++) {
+      auto &cl = _classes[c];
+      while (!cl.free.empty()) {
+        release(c, cl.free.back());
+        cl.free.pop_back();
+      }
+    }
+  }
+
+  /* buffers currently allocated; may be read from other threads */
+  size_t in_use() const { return _in_use.load(std::memory_order_relaxed); }
+
+  /* buffers currently held (allocated or idle); may be read from other threads */
+  size_t buffer_count() const { return _buffer_total.load(std::memory_order_relaxed); }
+
  private:
-  // static constexpr size_t buffer_len() { return BUFFER_LEN; }
-  static auto alloc_base(std::size_t len) -> void * {
-    auto base = aligned_alloc(MiB(2), len);
-    assert(base);
-    ::madvise(base, len, MADV_HUGEPAGE);
-    std::memset(base, 0, len);
-    return base;
-  };
-  void init()
+  buffer_t *acquire(unsigned c)
   {
-    for (unsigned i = 0; i < _buffer_count; i++) {
-      const auto len = BUFFER_LEN;
-      auto base = alloc_base(len);
-      auto region = _transport->register_memory(base, len, 0, 0);
-      auto desc   = _transport->get_memory_descriptor(region);
-      auto new_buffer = std::make_unique<buffer_t>(base, len, region, desc);
-      _free.push_back(new_buffer.get());
-      _buffers.push_back(std::move(new_buffer));
+    const auto len    = Buffer_pool::class_len(c);
+    auto       base   = _pool.get(c);
+    memory_region_t region;
+    try {
+      region = _transport->register_memory(base, len, 0, 0);
+    }
+    catch (...) {
+      _pool.put(c, base);
+      throw;
     }
+    auto desc = _transport->get_memory_descriptor(region);
+    _buffers.push_back(std::make_unique<buffer_t>(base, len, region, desc));
+    _buffer_total.store(_buffers.size(), std::memory_order_relaxed);
+    return _buffers.back().get();
   }
 
-  using pool_t = Component::IKVStore::pool_t;
-  using key_t  = std::uint64_t;
+  void release(unsigned c, buffer_t *iob)
+  {
+    _transport->deregister_memory(iob->region);
+    _pool.put(c, iob->base());
+    auto it = std::find_if(_buffers.begin(), _buffers.end(), [iob](const std::unique_ptr<buffer_t> &b) { return b.get() == iob; });
+    assert(it != _buffers.end());
+    _buffers.erase(it);
+    _buffer_total.store(_buffers.size(), std::memory_order_relaxed);
+  }
+
+  struct class_state_t {
+    std::vector<buffer_t *> free;
+    size_t                  in_use = 0;
+  };
 
-  const size_t            _buffer_count;
-  Transport *             _transport;
-  std::vector<std::unique_ptr<buffer_t>> _buffers;
-  std::vector<buffer_t *> _free;
+  const size_t                           _buffer_count;
+  const bool                             _keep_all;
+  Transport *                            _transport;
+  std::unique_ptr<Buffer_pool>           _own_pool;
+  Buffer_pool &                          _pool;
+  std::vector<std::unique_ptr<buffer_t>> _buffers; /* all buffers registered by this connection */
+  class_state_t                          _classes[Buffer_pool::CLASS_COUNT];
+  std::atomic<size_t>                    _in_use{0};       /* written only by the owning thread */
+  std::atomic<size_t>                    _buffer_total{0}; /* written only by the owning thread */
 };
 
 }  // namespace mcas
@@ -73,6 +73,10 @@ class Config_file {
  private:
   static constexpr bool option_DEBUG     = true;
   static constexpr auto DEFAULT_PROVIDER = "verbs";
+  static constexpr unsigned DEFAULT_POLL_SPIN_USEC  = 1000;
+  static constexpr unsigned DEFAULT_POLL_BLOCK_MSEC = 10;
+  static constexpr unsigned DEFAULT_MR_CACHE_MB     = 4096;
+  static constexpr unsigned DEFAULT_BUFFER_POOL_MB  = 2048;
 
  public:
 #pragma GCC diagnostic push
@@ -235,6 +239,54 @@ class Config_file {
     return shard["core"].GetUint();
   }
 
+  /* optional shard worker pool; 0 means the shard thread services all connections */
+  unsigned int get_shard_worker_count(rapidjson::SizeType i) const { return get_shard_uint("worker_threads", i, 0); }
+
+  std::string get_shard_worker_cores(rapidjson::SizeType i) const
+  {
+    if (i > shard_count()) throw Config_exception("get_shard out of bounds");
+    assert(_shards[i].IsObject());
+    auto shard = _shards[i].GetObject();
+    if (!shard.HasMember("worker_cores")) return "";
+    if (!shard["worker_cores"].IsString()) throw Config_exception("bad JSON: optional shards::worker_cores not string");
+    return std::string(shard["worker_cores"].GetString());
+  }
+
+  /* idle-loop tuning: spin this long after the last activity before blocking */
+  unsigned int get_shard_poll_spin_usec(rapidjson::SizeType i) const
+  {
+    return get_shard_uint("poll_spin_usec", i, DEFAULT_POLL_SPIN_USEC);
+  }
+
+  /* upper bound on a single blocking wait for fabric completions */
+  unsigned int get_shard_poll_block_msec(rapidjson::SizeType i) const
+  {
+    return get_shard_uint("poll_block_msec", i, DEFAULT_POLL_BLOCK_MSEC);
+  }
+
+  /* memory registration cache: unreferenced registrations are evicted beyond this many MiB (0 = no limit) */
+  unsigned int get_shard_mr_cache_mb(rapidjson::SizeType i) const
+  {
+    return get_shard_uint("mr_cache_mb", i, DEFAULT_MR_CACHE_MB);
+  }
+
+  /* IO buffer memory shared by all of a shard's connections, in MiB (0 = no limit) */
+  unsigned int get_shard_buffer_pool_mb(rapidjson::SizeType i) const
+  {
+    return get_shard_uint("buffer_pool_mb", i, DEFAULT_BUFFER_POOL_MB);
+  }
+
+  unsigned int get_shard_uint(const std::string &field, rapidjson::SizeType i, unsigned int default_value) const
+  {
+    if (i > shard_count()) throw Config_exception("get_shard out of bounds");
+    assert(_shards[i].IsObject());
+    auto shard = _shards[i].GetObject();
+    if (!shard.HasMember(field.c_str())) return default_value;
+    if (!shard[field.c_str()].IsUint())
+      throw Config_exception("bad JSON: optional shards::%s not unsigned int", field.c_str());
+    return shard[field.c_str()].GetUint();
+  }
+
   unsigned int get_shard_port(rapidjson::SizeType i) const
   {
     if (i > shard_count()) throw Config_exception("get_shard out of bounds");
@@ -21,7 +21,7 @@ int Connection_handler::tick()
 {
   using namespace mcas::Protocol;
 
-  auto response = TICK_RESPONSE_CONTINUE;
+  int response = TICK_RESPONSE_CONTINUE;
   _tick_count++;
 
 #if 0
@@ -44,11 +44,17 @@ int Connection_handler::tick()
     return mcas::Connection_handler::TICK_RESPONSE_CLOSE;
   }
 
+  /* only while the shard is short of buffer memory or over its registration budget */
+  trim_buffers();
+  trim_regions();
+
   switch (_state) {
     case POST_MSG_RECV: { /*< post buffer to receive new message */
       if (option_DEBUG > 2) PMAJOR("Shard State: %lu %p POST_MSG_RECV", _tick_count, static_cast<const void *>(this));
-      post_recv_buffer(allocate());
-      set_state(WAIT_NEW_MSG_RECV);
+      if (buffer_t *iob = try_allocate(_recv_len)) {
+        post_recv_buffer(iob);
+        set_state(WAIT_NEW_MSG_RECV);
+      }
 
       break;
     }
@@ -58,46 +64,20 @@ int Connection_handler::tick()
         const auto iob = posted_recv();
         assert(iob);
 
-        const Message *msg = mcas::Protocol::message_cast(iob->base());
+        const Message *  msg = mcas::Protocol::message_cast(iob->base());
+        const cpu_time_t now = rdtsc();
         assert(msg);
 
-        switch (msg->type_id) {
-          case MSG_TYPE_IO_REQUEST: {
-            if (option_DEBUG > 2) PMAJOR("Shard: IO_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV);
-            break;
-          }
-          case MSG_TYPE_PUT_ADO_REQUEST:
-          case MSG_TYPE_ADO_REQUEST: {
-            if (option_DEBUG > 2) PMAJOR("Shard: ADO_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV);
-            break;
-          }
-          case MSG_TYPE_CLOSE_SESSION: {
-            if (option_DEBUG > 2) PMAJOR("Shard: CLOSE_SESSION");
-            free_recv_buffer();
-            response = TICK_RESPONSE_CLOSE;
-            break;
-          }
-          case MSG_TYPE_POOL_REQUEST: {
-            if (option_DEBUG > 2) PMAJOR("Shard: POOL_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV); /* move state to new message recv */
-            break;
-          }
-          case MSG_TYPE_INFO_REQUEST: {
-            if (option_DEBUG > 2) PMAJOR("Shard: INFO_REQUEST");
-            _pending_msgs.push_back(iob);
-            set_state(POST_MSG_RECV); /* move state to new message recv */
-            break;
-          }
-          default:
-            throw Logic_exception("unhandled message (type:%x)", msg->type_id);
+        if (msg->type_id == MSG_TYPE_INDIRECT) {
+          /* the message itself is read from client memory */
+          if (option_DEBUG > 2) PMAJOR("Shard: INDIRECT");
+          _indirect_msg = iob;
+          _indirect_tsc = now;
+          set_state(POST_INDIRECT_READ);
+        }
+        else {
+          response = dispatch_msg(iob, now);
         }
-
-        _stats.recv_msg_count++;
 
         if (option_DEBUG > 2) PMAJOR("Shard State: %lu %p WAIT_MSG_RECV complete", _tick_count, static_cast<const void *>(this));
       }
@@ -107,6 +87,47 @@ int Connection_handler::tick()
 
       break;
     }
+    case POST_INDIRECT_READ: {
+      if (buffer_t *iob = try_allocate()) {
+        const auto msg = mcas::Protocol::message_cast(_indirect_msg->base())->ptr_cast<Message_indirect>();
+        const auto len = msg->total_length();
+
+        if (msg->count > Message_indirect::MAX_SEGMENTS || len < sizeof(Message) || iob->length() < len) {
+          free_buffer(iob);
+          throw Protocol_exception("bad indirect message (segments:%u len:%lu)", msg->count, len);
+        }
+
+        size_t offset = 0;
+        for (uint32_t i = 0; i != msg->count; i++) {
+          const auto &s = msg->segments[i];
+          if (s.len) post_read_buffer(iob, offset, s.len, s.addr, s.key);
+          offset += s.len;
+        }
+        iob->set_length(len);
+
+        free_buffer(_indirect_msg);
+        _indirect_msg = nullptr;
+        set_state(WAIT_INDIRECT_READ);
+      }
+      break;
+    }
+    case WAIT_INDIRECT_READ: {
+      bool failed = false;
+      if (buffer_t *iob = posted_read(failed)) {
+        if (failed) {
+          PWRN("Connection_handler: read of indirect message failed; message dropped");
+          free_buffer(iob);
+          set_state(POST_MSG_RECV);
+        }
+        else if (mcas::Protocol::message_cast(iob->base())->type_id == MSG_TYPE_INDIRECT) {
+          throw Protocol_exception("nested indirect message");
+        }
+        else {
+          response = dispatch_msg(iob, _indirect_tsc);
+        }
+      }
+      break;
+    }
     case WAIT_SEND_VALUE:
     case WAIT_RECV_VALUE: {
       if (check_for_posted_value_complete()) {
@@ -142,13 +163,15 @@ int Connection_handler::tick()
     case POST_HANDSHAKE: {
       if (option_DEBUG > 2) PMAJOR("Shard State: %lu %p POST_HANDSHAKE", _tick_count, static_cast<const void *>(this));
 
-      post_recv_buffer(allocate());
-
-      set_state(WAIT_HANDSHAKE);
+      if (buffer_t *iob = try_allocate(KiB(4))) {
+        post_recv_buffer(iob);
+        set_state(WAIT_HANDSHAKE);
+      }
       break;
     }
     case WAIT_HANDSHAKE: {
-      if (check_for_posted_recv_complete()) {
+      buffer_t *reply_iob;
+      if (check_for_posted_recv_complete() && (reply_iob = try_allocate(KiB(4))) != nullptr) {
         if (option_DEBUG > 2) PMAJOR("Shard State: %lu %p WAIT_HANDSHAKE complete", _tick_count, static_cast<const void *>(this));
 
         const auto iob = posted_recv();
@@ -161,13 +184,16 @@ int Connection_handler::tick()
         /* set authentication token ; TODO - verify token with AAA */
         set_auth_id(msg->auth_id);
 
-        auto reply_iob = allocate();
-        assert(reply_iob);
+        /* a client which sends large messages indirectly gets small receives */
+        const bool indirect = msg->resvd & HANDSHAKE_FLAG_INDIRECT;
+        if (indirect) _recv_len = INDIRECT_RECV_LEN;
 
         auto reply_msg = new (reply_iob->base()) mcas::Protocol::Message_handshake_reply(
-            iob->length(), auth_id(), 1 /* seq */, max_message_size(), reinterpret_cast<uint64_t>(this),
+            reply_iob->length(), auth_id(), 1 /* seq */, indirect ? _recv_len : max_message_size(),
+            reinterpret_cast<uint64_t>(this),
             nullptr,  // cert
             0);
+        if (indirect) reply_msg->resvd = HANDSHAKE_FLAG_INDIRECT;
 
         if(option_DEBUG > 2) {
           PINF("RDMA: max message size (%lu)", max_message_size());
@@ -195,6 +221,68 @@ int Connection_handler::tick()
   return response;
 }
 
+int Connection_handler::dispatch_msg(buffer_t *iob, const cpu_time_t now)
+{
+  using namespace mcas::Protocol;
+
+  int response = TICK_RESPONSE_CONTINUE;
+
+  const Message *msg = mcas::Protocol::message_cast(iob->base());
+  assert(msg);
+
+  switch (msg->type_id) {
+    case MSG_TYPE_IO_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: IO_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV);
+      break;
+    }
+    case MSG_TYPE_IO_BATCH_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: IO_BATCH_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV);
+      break;
+    }
+    case MSG_TYPE_SCAN_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: SCAN_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV);
+      break;
+    }
+    case MSG_TYPE_PUT_ADO_REQUEST:
+    case MSG_TYPE_ADO_BATCH_REQUEST:
+    case MSG_TYPE_ADO_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: ADO_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV);
+      break;
+    }
+    case MSG_TYPE_CLOSE_SESSION: {
+      if (option_DEBUG > 2) PMAJOR("Shard: CLOSE_SESSION");
+      free_recv_buffer();
+      response = TICK_RESPONSE_CLOSE;
+      break;
+    }
+    case MSG_TYPE_POOL_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: POOL_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV); /* move state to new message recv */
+      break;
+    }
+    case MSG_TYPE_INFO_REQUEST: {
+      if (option_DEBUG > 2) PMAJOR("Shard: INFO_REQUEST");
+      push_pending_msg(iob, now);
+      set_state(POST_MSG_RECV); /* move state to new message recv */
+      break;
+    }
+    default:
+      throw Logic_exception("unhandled message (type:%x)", msg->type_id);
+  }
+
+  _stats.recv_msg_count++;
+  return response;
+}
+
 void Connection_handler::set_pending_value(void *target, size_t target_len, memory_region_t region)
 {
   assert(target);
@@ -24,6 +24,9 @@
 #include <common/logging.h>
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <deque>
+#include <iterator>
 #include <map>
 #include <queue>
 #include <set>
@@ -74,26 +77,34 @@ class Connection_handler
     WAIT_HANDSHAKE_RESPONSE_COMPLETION,
     POST_MSG_RECV,
     WAIT_NEW_MSG_RECV,
+    POST_INDIRECT_READ,
+    WAIT_INDIRECT_READ,
     WAIT_RECV_VALUE,
     WAIT_SEND_VALUE,
   };
 
   State _state = State::INITIALIZE;
 
+  /* receive size for a client which sends larger messages as Message_indirect */
+  static constexpr size_t INDIRECT_RECV_LEN = Buffer_pool::class_len(1);
+
  public:
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++" // many uninitialized/default initialized elements
-  Connection_handler(Factory* factory, Connection* connection)
-      : Connection_base(factory, connection), Region_manager(connection),
+  Connection_handler(Factory* factory, Connection* connection, Buffer_pool& buffer_pool, Region_budget& region_budget)
+      : Connection_base(factory, connection, buffer_pool), Region_manager(connection, region_budget),
         _pending_msgs{},
+        _pending_msg_tsc{},
         _pending_actions{},
         _freq_mhz(Common::get_rdtsc_frequency_mhz())
   {
     _pending_actions.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
-    _pending_msgs.reserve(Buffer_manager<Connection>::DEFAULT_BUFFER_COUNT);
   }
 #pragma GCC diagnostic pop
 
+  Connection_handler(const Connection_handler&) = delete;
+  Connection_handler& operator=(const Connection_handler&) = delete;
+
   ~Connection_handler()
   {
     dump_stats();
@@ -129,12 +140,18 @@ class Connection_handler
         add_pending_action(action_t{ACTION_RELEASE_VALUE_LOCK, _deferred_unlock});
         _deferred_unlock = nullptr;
       }
+      for (auto v : _completed_writes) {
+        if (option_DEBUG > 2) PLOG("adding action for unlocking written value @ %p", v);
+        add_pending_action(action_t{ACTION_RELEASE_VALUE_LOCK, const_cast<void *>(v)});
+      }
+      _completed_writes.clear();
     }
     return state;
   }
 
   /**
-   * Get pending message from the connection
+   * Get pending message from the connection. Messages are taken in the
+   * order received, so a connection's requests are processed in order.
    *
    * @param msg [out] Pointer to base protocol message
    *
@@ -143,9 +160,10 @@ class Connection_handler
   inline buffer_t* get_pending_msg(mcas::Protocol::Message*& msg)
   {
     if (_pending_msgs.empty()) return nullptr;
-    auto iob = _pending_msgs.back();
+    auto iob = _pending_msgs.front();
     assert(iob);
-    _pending_msgs.pop_back();
+    _pending_msgs.pop_front();
+    _pending_msg_tsc.pop_front();
     msg = static_cast<mcas::Protocol::Message*>(iob->base());
     return iob;
   }
@@ -161,11 +179,32 @@ class Connection_handler
   inline mcas::Protocol::Message* peek_pending_msg() const
   {
     if (_pending_msgs.empty()) return nullptr;
-    auto iob = _pending_msgs.back();
+    auto iob = _pending_msgs.front();
     assert(iob);
     return static_cast<mcas::Protocol::Message*>(iob->base());
   }
 
+  /**
+   * Receive completion time (rdtsc) of the message returned by peek_pending_msg
+   *
+   */
+  inline cpu_time_t pending_msg_tsc() const
+  {
+    assert(!_pending_msg_tsc.empty());
+    return _pending_msg_tsc.front();
+  }
+
+  /**
+   * Length of the buffer holding the message returned by peek_pending_msg,
+   * which bounds any length the message claims
+   *
+   */
+  inline size_t pending_msg_buffer_len() const
+  {
+    assert(!_pending_msgs.empty());
+    return _pending_msgs.front()->length();
+  }
+
   /**
    * Discard a pending message from the connection. Used as a complement to
    * peek_pending_msg
@@ -177,8 +216,9 @@ class Connection_handler
   inline buffer_t* pop_pending_msg()
   {
     assert(!_pending_msgs.empty());
-    auto iob = _pending_msgs.back();
-    _pending_msgs.pop_back();
+    auto iob = _pending_msgs.front();
+    _pending_msgs.pop_front();
+    _pending_msg_tsc.pop_front();
     return iob;
   }
 
@@ -249,11 +289,56 @@ class Connection_handler
     return mr;
   }
 
+  /* segmented put in progress; the value is write-locked under its pending key */
+  struct segmented_put_t {
+    void*                      target;
+    size_t                     len;
+    Component::IKVStore::key_t key_handle;
+    size_t                     received = 0;  /*< bytes covered by ranges */
+    std::map<size_t, size_t>   ranges   = {}; /*< disjoint [begin, end) byte ranges received */
+
+    /* record [offset, offset + n); segments may arrive in any order, or twice */
+    void add_range(size_t offset, size_t n)
+    {
+      if (n == 0) return;
+      size_t begin = offset;
+      size_t end   = offset + n;
+      auto   it    = ranges.upper_bound(begin);
+      if (it != ranges.begin() && std::prev(it)->second >= begin) --it;
+      while (it != ranges.end() && it->first <= end) {
+        begin = std::min(begin, it->first);
+        end   = std::max(end, it->second);
+        received -= it->second - it->first;
+        it = ranges.erase(it);
+      }
+      ranges.emplace(begin, end);
+      received += end - begin;
+    }
+
+    bool complete() const { return received == len; }
+  };
+
+  using segmented_put_map_t = std::map<std::pair<Component::IKVStore::pool_t, std::string>, segmented_put_t>;
+
+  inline segmented_put_map_t& segmented_puts() { return _segmented_puts; }
+
   inline uint64_t auth_id() const { return _auth_id; }
   inline void     set_auth_id(uint64_t id) { _auth_id = id; }
 
   inline size_t max_message_size() const { return _max_message_size; }
 
+  /* buffer, or nullptr to retry later if none is available */
+  buffer_t* try_allocate(size_t len = Buffer_manager<Connection>::BUFFER_LEN)
+  {
+    try {
+      return allocate(len);
+    }
+    catch (const resource_unavailable&) {
+      ++_stats.buffer_waits;
+      return nullptr;
+    }
+  }
+
   inline Pool_manager& pool_manager() { return _pool_manager; }
 
  private:
@@ -264,6 +349,7 @@ class Connection_handler
     uint64_t wait_recv_value_misses       = 0;
     uint64_t wait_msg_recv_misses         = 0;
     uint64_t wait_respond_complete_misses = 0;
+    uint64_t buffer_waits                 = 0;
     uint64_t last_count                   = 0;
     uint64_t next_stamp                   = 0;
   } _stats alignas(8);
@@ -281,19 +367,47 @@ class Connection_handler
     PINF("Response count              : %lu", _stats.response_count);
     PINF("WAIT_RECV_VALUE misses      : %lu", _stats.wait_recv_value_misses);
     PINF("WAIT_RESPOND_COMPLETE misses: %lu", _stats.wait_respond_complete_misses);
+    PINF("Buffer waits                : %lu", _stats.buffer_waits);
+    PINF("MR cache hits               : %lu", mr_cache_stats().hits);
+    PINF("MR cache misses             : %lu", mr_cache_stats().misses);
+    PINF("MR cache evictions          : %lu", mr_cache_stats().evictions);
+    PINF("MR pinned bytes             : %lu", mr_cache_stats().pinned_bytes);
     PINF("-----------------------------------------");
   }
 
  private:
+  inline void push_pending_msg(buffer_t* iob, const cpu_time_t recv_tsc)
+  {
+    _pending_msgs.push_back(iob);
+    _pending_msg_tsc.push_back(recv_tsc);
+  }
+
+  /**
+   * Handle a received message
+   *
+   * @param iob Buffer holding the message
+   * @param recv_tsc Receive time
+   *
+   * @return Tick response
+   */
+  int dispatch_msg(buffer_t* iob, cpu_time_t recv_tsc);
+
+  /* posted receive size; small once the client sends large messages indirectly */
+  size_t     _recv_len = Buffer_manager<Connection>::BUFFER_LEN;
+  buffer_t*  _indirect_msg = nullptr; /*< Message_indirect awaiting a buffer for the read */
+  cpu_time_t _indirect_tsc = 0;
+
   /* list of pre-registered memory regions; normally one region */
   std::vector<Component::IKVStore::memory_handle_t> _mr_vector;
 
   uint64_t               _tick_count alignas(8) = 0;
   uint64_t               _auth_id               = 0;
-  std::vector<buffer_t*> _pending_msgs;
-  std::vector<action_t>  _pending_actions;
+  std::deque<buffer_t*>    _pending_msgs;    /*< in order of receipt */
+  std::deque<cpu_time_t>   _pending_msg_tsc; /*< receive time of each pending message */
+  std::vector<action_t>    _pending_actions;
   float                  _freq_mhz;
   Pool_manager           _pool_manager; /* instance shared across connections */
+  segmented_put_map_t    _segmented_puts;
 };
 
 }  // namespace mcas
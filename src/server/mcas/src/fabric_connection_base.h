@@ -13,7 +13,10 @@
 #ifndef __FABRIC_CONNECTION_BASE_H__
 #define __FABRIC_CONNECTION_BASE_H__
 
+#include <algorithm>
+#include <chrono>
 #include <list>
+#include <vector>
 
 #include "mcas_config.h"
 
@@ -51,14 +54,21 @@ class Fabric_connection_base {
    *
    * @param factory
    * @param fabric_connection
+   * @param buffer_pool Shard-wide source of IO buffer memory
    */
-  Fabric_connection_base(Component::IFabric_server_factory *factory, Component::IFabric_server *fabric_connection)
-      : _bm(fabric_connection), _factory(factory),
+  Fabric_connection_base(Component::IFabric_server_factory *factory,
+                         Component::IFabric_server *fabric_connection,
+                         Buffer_pool &buffer_pool)
+      : _bm(fabric_connection, buffer_pool), _factory(factory),
         _transport(fabric_connection),
         _max_message_size((assert(_transport),
         _transport->max_message_size())),
         _registered_regions{},
-        _completed_recv_buffers{}
+        _completed_recv_buffers{},
+        _posted_send_buffers{},
+        _completed_send_buffers{},
+        _posted_writes{},
+        _completed_writes{}
   {
   }
 
@@ -85,6 +95,42 @@ class Fabric_connection_base {
     //    _factory->close_connection(_transport);
   }
 
+  /**
+   * Block until this connection's completion queues signal activity
+   * or the timeout expires
+   *
+   * @param timeout Maximum time to block
+   */
+  void wait_for_next_completion(std::chrono::milliseconds timeout)
+  {
+    try {
+      _transport->wait_for_next_completion(timeout);
+    }
+    catch (const std::exception &e) {
+      /* waiting is only an optimization; polling will surface real errors */
+      if (option_DEBUG > 2) PLOG("wait_for_next_completion: %s", e.what());
+    }
+  }
+
+  /**
+   * Add this connection's completion queue descriptors to a wait on
+   * several connections
+   *
+   * @param fds [out] Descriptors to wait on
+   *
+   * @return true if the caller may block on fds
+   */
+  bool prepare_wait(std::vector<int> &fds)
+  {
+    try {
+      return _transport->prepare_wait(fds);
+    }
+    catch (const std::exception &e) {
+      if (option_DEBUG > 2) PLOG("prepare_wait: %s", e.what());
+      return false;
+    }
+  }
+
   static void completion_callback(void *   context,
                                   status_t st,
                                   std::uint64_t,  // completion_flags,
@@ -100,6 +146,10 @@ class Fabric_connection_base {
     if (UNLIKELY(st != S_OK)) {
       PERR("Fabric_connection_base: fabric operation failed st != S_OK (st=%d, context=%p, len=%lu)", st, context, len);
       PERR("Error: %s", static_cast<char *>(error_data));
+      if (context && context == pThis->_posted_read_buffer) {
+        pThis->_posted_read_failed = true;
+        pThis->_posted_read_count--;
+      }
       return;
     }
 
@@ -111,10 +161,21 @@ class Fabric_connection_base {
     //   return;
     // }
 
-    if (context == pThis->_posted_send_buffer) {
-      assert(pThis->_posted_send_buffer_outstanding);
+    auto &sends = pThis->_posted_send_buffers;
+    auto  send  = std::find(sends.begin(), sends.end(), context);
+    if (send != sends.end()) {
       if (option_DEBUG) PLOG("Posted send complete (%p).", context);
-      pThis->_posted_send_buffer_outstanding = false; /* signal send completion */
+      pThis->_completed_send_buffers.push_back(*send); /* signal send completion */
+      sends.erase(send);
+      return;
+    }
+
+    auto &writes = pThis->_posted_writes;
+    auto  write  = std::find(writes.begin(), writes.end(), context);
+    if (write != writes.end()) {
+      if (option_DEBUG) PLOG("Posted write complete (%p).", context);
+      pThis->_completed_writes.push_back(*write); /* value may now be unlocked */
+      writes.erase(write);
       return;
     }
     else if (context == pThis->_posted_value_buffer) {
@@ -126,6 +187,10 @@ class Fabric_connection_base {
       }
       pThis->_posted_value_buffer_outstanding = false; /* signal value completion */
     }
+    else if (context == pThis->_posted_read_buffer) {
+      if (option_DEBUG) PLOG("Posted read complete (%p).", context);
+      pThis->_posted_read_count--;
+    }
     else { /* must be recv completion */
       pThis->_completed_recv_buffers.push_front(reinterpret_cast<buffer_t *>(context));
       pThis->_posted_recv_buffer_count--;
@@ -138,16 +203,14 @@ class Fabric_connection_base {
 
   bool check_for_posted_send_complete()
   {
-    if (_posted_send_buffer_outstanding) return false;
+    for (auto b : _completed_send_buffers) {
+      if (option_DEBUG > 2) PLOG("Fabric_connection_base::freeing buffer (%p)", static_cast<const void *>(b));
 
-    if (_posted_send_buffer) {
-      if (option_DEBUG > 2) PLOG("Fabric_connection_base::freeing buffer (%p)", static_cast<const void *>(_posted_send_buffer));
-
-      free_buffer(_posted_send_buffer);
-      _posted_send_buffer = nullptr;
+      free_buffer(b);
     }
+    _completed_send_buffers.clear();
 
-    return true;
+    return _posted_send_buffers.empty();
   }
 
   bool check_for_posted_recv_complete()
@@ -194,7 +257,6 @@ class Fabric_connection_base {
   void post_send_buffer(buffer_t *buffer, buffer_t *val_buffer = nullptr)
   {
     assert(buffer);
-    assert(_posted_send_buffer_outstanding == false);
     const auto iov = buffer->iov;
 
     if (!val_buffer) {
@@ -206,17 +268,15 @@ class Fabric_connection_base {
         free_buffer(buffer); /* buffer can be immediately released; see fi_inject */
       }
       else {
-        _posted_send_buffer             = buffer;
-        _posted_send_buffer_outstanding = true;
+        _posted_send_buffers.push_back(buffer);
 
         if (option_DEBUG > 2) PLOG("Fabric_connection_base: posting send (%p, %p)", static_cast<const void *>(buffer), iov->iov_base);
 
-        _transport->post_send(iov, iov + 1, &_posted_send_buffer->desc, _posted_send_buffer);
+        _transport->post_send(iov, iov + 1, &buffer->desc, buffer);
       }
     }
     else {
-      _posted_send_buffer             = buffer;
-      _posted_send_buffer_outstanding = true;
+      _posted_send_buffers.push_back(buffer);
 
       iovec v[2]   = {*buffer->iov, *val_buffer->iov};
       void *desc[] = {buffer->desc, val_buffer->desc};
@@ -262,6 +322,69 @@ class Fabric_connection_base {
            _posted_value_buffer->iov->iov_len, _posted_value_buffer->desc);
   }
 
+  /**
+   * RDMA write a value straight from (registered) pool memory into the
+   * client's landing buffer. The value must stay locked until the write
+   * completes; poll_completions reports it as a deferred unlock.
+   *
+   * @param value Value in pool memory
+   * @param len Value length
+   * @param region Memory region which covers the value
+   * @param remote_addr Landing buffer address
+   * @param key Landing buffer remote key
+   */
+  void post_write_value(const void *value, size_t len, memory_region_t region, uint64_t remote_addr, uint64_t key)
+  {
+    iovec v{const_cast<void *>(value), len};
+    void *desc = get_memory_descriptor(region);
+
+    _posted_writes.push_back(value);
+    _transport->post_write(&v, &v + 1, &desc, remote_addr, key, const_cast<void *>(value));
+
+    if (option_DEBUG > 2) PLOG("posted value write (%p,len=%lu) to 0x%lx", value, len, remote_addr);
+  }
+
+  /**
+   * RDMA read from client memory into part of a buffer. All reads posted
+   * into the buffer must complete before posted_read returns it.
+   *
+   * @param buffer Target buffer
+   * @param offset Offset in the buffer
+   * @param len Bytes to read
+   * @param remote_addr Client address
+   * @param key Client memory remote key
+   */
+  void post_read_buffer(buffer_t *buffer, size_t offset, size_t len, uint64_t remote_addr, uint64_t key)
+  {
+    assert(buffer);
+    assert(_posted_read_buffer == nullptr || _posted_read_buffer == buffer);
+    assert(offset + len <= buffer->length());
+    iovec v{static_cast<char *>(buffer->base()) + offset, len};
+
+    _posted_read_buffer = buffer;
+    _posted_read_count++;
+    _transport->post_read(&v, &v + 1, &buffer->desc, remote_addr, key, buffer);
+
+    if (option_DEBUG > 2) PLOG("posted read (%p,len=%lu) from 0x%lx", v.iov_base, len, remote_addr);
+  }
+
+  /**
+   * Buffer of completed reads
+   *
+   * @param failed [out] Set if any of the reads failed
+   *
+   * @return Buffer, or nullptr if reads are still outstanding
+   */
+  buffer_t *posted_read(bool &failed)
+  {
+    if (_posted_read_count != 0) return nullptr;
+    auto rb             = _posted_read_buffer;
+    failed              = _posted_read_failed;
+    _posted_read_buffer = nullptr;
+    _posted_read_failed = false;
+    return rb;
+  }
+
   buffer_t *posted_recv()
   {
     if (_completed_recv_buffers.size() == 0) return nullptr;
@@ -270,18 +393,16 @@ class Fabric_connection_base {
     return rb;
   }
 
-  inline buffer_t *posted_send() const { return _posted_send_buffer; }
-
   Completion_state poll_completions()
   {
-    if (_posted_recv_buffer_count > 0 || _posted_send_buffer_outstanding || _posted_value_buffer_outstanding) {
+    if (_posted_recv_buffer_count > 0 || !_posted_send_buffers.empty() || !_posted_writes.empty() ||
+        _posted_read_count > 0 || _posted_value_buffer_outstanding) {
       bool added_deferred_unlock = false;
       try {
         _transport->poll_completions(&Fabric_connection_base::completion_callback, this);
         /* Note: this test may be in error, as the function of
          * check_for_posted_send_complete is not to complete the
          * send but to free the buffer after the send completes. */
-        //          if(_posted_send_buffer_outstanding)
         check_for_posted_send_complete();
 
         //          if(_posted_value_buffer_outstanding)
@@ -291,7 +412,8 @@ class Fabric_connection_base {
         return Completion_state::CLIENT_DISCONNECT;
       }
 
-      return added_deferred_unlock ? Completion_state::ADDED_DEFERRED_LOCK : Completion_state::NO_DEFER;
+      return added_deferred_unlock || !_completed_writes.empty() ? Completion_state::ADDED_DEFERRED_LOCK
+                                                                 : Completion_state::NO_DEFER;
     }
     return Completion_state::NONE;
   }
@@ -309,10 +431,19 @@ class Fabric_connection_base {
 
   inline void *get_memory_descriptor(memory_region_t region) { return _transport->get_memory_descriptor(region); }
 
-  inline auto allocate() { return _bm.allocate(); }
+  inline uint64_t get_memory_remote_key(memory_region_t region) { return _transport->get_memory_remote_key(region); }
+
+  /* @throw resource_unavailable if no buffer is available */
+  inline auto allocate(size_t len = Buffer_manager<Component::IFabric_server>::BUFFER_LEN) { return _bm.allocate(len); }
 
   inline void free_buffer(buffer_t *buffer) { _bm.free(buffer); }
 
+  inline void trim_buffers() { _bm.trim(); }
+
+  inline size_t buffers_in_use() const { return _bm.in_use(); }
+
+  inline size_t buffer_count() const { return _bm.buffer_count(); }
+
   inline size_t IO_buffer_size() const { return Buffer_manager<Component::IFabric_server>::BUFFER_LEN; }
 
   auto transport() const { return _transport; }
@@ -333,8 +464,19 @@ class Fabric_connection_base {
   std::list<buffer_t *> _completed_recv_buffers;
   unsigned              _posted_recv_buffer_count = 0;
 
-  buffer_t *_posted_send_buffer             = nullptr;
-  bool      _posted_send_buffer_outstanding = false;
+  /* a pipelining client can have several responses in flight */
+  std::vector<buffer_t *> _posted_send_buffers;
+  std::vector<buffer_t *> _completed_send_buffers;
+
+  /* values being written to client landing buffers; each stays locked
+     until its write completes */
+  std::vector<const void *> _posted_writes;
+  std::vector<const void *> _completed_writes;
+
+  /* message being read from client memory (Message_indirect) */
+  buffer_t *_posted_read_buffer = nullptr;
+  unsigned  _posted_read_count  = 0;
+  bool      _posted_read_failed = false;
 
   /* value for two-phase get & put - assumes get and put don't happen
      at the same time for the same FSM
@@ -26,7 +26,9 @@ namespace mcas
 class Connection_handler;
 
 class Fabric_transport {
-  bool _fabric_debug;
+  bool        _fabric_debug;
+  Region_budget _region_budget; /* memory registrations of all connections */
+  Buffer_pool   _buffer_pool;   /* IO buffers for all connections */
 
  public:
   static constexpr unsigned INJECT_SIZE = 128;
@@ -36,8 +38,14 @@ class Fabric_transport {
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weffc++" // uninitialized _fabric, _server_factory
-  Fabric_transport(const std::string provider, const std::string device, unsigned port)
+  Fabric_transport(const std::string provider,
+                   const std::string device,
+                   unsigned          port,
+                   size_t            mr_cache_budget,
+                   size_t            buffer_budget)
     : _fabric_debug( mcas::Global::debug_level > 1 )
+    , _region_budget(mr_cache_budget)
+    , _buffer_pool(buffer_budget)
   {
     if (_fabric_debug)
       PLOG("fabric_transport: (provider=%s, device=%s, port=%u)", provider.c_str(), device.c_str(), port);
@@ -46,11 +54,18 @@ class Fabric_transport {
   }
 #pragma GCC diagnostic pop
 
+  Fabric_transport(const Fabric_transport&) = delete;
+  Fabric_transport& operator=(const Fabric_transport&) = delete;
+
+  const Buffer_pool& buffer_pool() const { return _buffer_pool; }
+
+  const Region_budget& region_budget() const { return _region_budget; }
+
   Connection_handler* get_new_connection()
   {
     auto connection = _server_factory->get_new_connection();
     if (!connection) return nullptr;
-    return new Connection_handler(_server_factory, connection);
+    return new Connection_handler(_server_factory, connection, _buffer_pool, _region_budget);
   }
 
  private:
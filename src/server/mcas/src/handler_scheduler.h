@@ -0,0 +1,139 @@
+/*
+  Copyright [2017-2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#ifndef __mcas_HANDLER_SCHEDULER_H__
+#define __mcas_HANDLER_SCHEDULER_H__
+
+#include <common/exceptions.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mcas
+{
+class Connection_handler;
+
+/**
+ * Work-stealing run queues for connection handlers.  Each shard worker
+ * owns a queue; a handler is popped, serviced and pushed back by the
+ * same worker.  An idle worker steals from the tail of the busiest
+ * queue.  A handler is only ever held by one worker at a time, so
+ * per-connection state (buffers, pending messages) needs no locking.
+ */
+class Handler_scheduler {
+ private:
+  struct queue_t {
+    std::mutex                       lock;
+    std::deque<Connection_handler *> handlers;
+    std::atomic<size_t>              size;
+    queue_t() : lock{}, handlers{}, size{0} {}
+  };
+
+ public:
+  explicit Handler_scheduler(const unsigned worker_count) : _queues{}, _steal_count{0}
+  {
+    if (worker_count == 0) throw Constructor_exception("Handler_scheduler requires at least one worker");
+    for (unsigned i = 0; i < worker_count; i++) _queues.emplace_back(new queue_t);
+  }
+
+  Handler_scheduler(const Handler_scheduler &) = delete;
+  Handler_scheduler &operator=(const Handler_scheduler &) = delete;
+
+  unsigned worker_count() const { return static_cast<unsigned>(_queues.size()); }
+
+  uint64_t steal_count() const { return _steal_count.load(std::memory_order_relaxed); }
+
+  /**
+   * Add a new connection to the least loaded worker queue
+   */
+  void add(Connection_handler *handler)
+  {
+    unsigned target = 0;
+    size_t   lowest = _queues[0]->size.load(std::memory_order_relaxed);
+    for (unsigned i = 1; i < _queues.size(); i++) {
+      auto s = _queues[i]->size.load(std::memory_order_relaxed);
+      if (s < lowest) {
+        lowest = s;
+        target = i;
+      }
+    }
+    push(target, handler);
+  }
+
+  /**
+   * Take a handler for servicing; tries own queue first then steals
+   *
+   * @param worker Worker index
+   *
+   * @return Handler or nullptr if there is no work
+   */
+  Connection_handler *acquire(const unsigned worker)
+  {
+    auto &own = *_queues[worker];
+    if (own.size.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> g(own.lock);
+      if (!own.handlers.empty()) {
+        auto h = own.handlers.front();
+        own.handlers.pop_front();
+        own.size.store(own.handlers.size(), std::memory_order_relaxed);
+        return h;
+      }
+    }
+
+    /* steal from the busiest victim; only worth it if the victim
+       has more than the one handler it is likely servicing next */
+    unsigned victim = worker;
+    size_t   most   = 1;
+    for (unsigned i = 0; i < _queues.size(); i++) {
+      if (i == worker) continue;
+      auto s = _queues[i]->size.load(std::memory_order_relaxed);
+      if (s > most) {
+        most   = s;
+        victim = i;
+      }
+    }
+    if (victim == worker) return nullptr;
+
+    auto &                      q = *_queues[victim];
+    std::lock_guard<std::mutex> g(q.lock);
+    if (q.handlers.empty()) return nullptr;
+    auto h = q.handlers.back();
+    q.handlers.pop_back();
+    q.size.store(q.handlers.size(), std::memory_order_relaxed);
+    _steal_count.fetch_add(1, std::memory_order_relaxed);
+    return h;
+  }
+
+  /**
+   * Return a serviced handler to the worker's own queue
+   */
+  void release(const unsigned worker, Connection_handler *handler) { push(worker, handler); }
+
+ private:
+  void push(const unsigned worker, Connection_handler *handler)
+  {
+    auto &                      q = *_queues[worker];
+    std::lock_guard<std::mutex> g(q.lock);
+    q.handlers.push_back(handler);
+    q.size.store(q.handlers.size(), std::memory_order_relaxed);
+  }
+
+  std::vector<std::unique_ptr<queue_t>> _queues;
+  std::atomic<uint64_t>                 _steal_count;
+};
+
+}  // namespace mcas
+
+#endif
@@ -0,0 +1,106 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#ifndef __mcas_LATENCY_HISTOGRAM_H__
+#define __mcas_LATENCY_HISTOGRAM_H__
+
+#include <api/mcas_itf.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace mcas
+{
+/**
+ * Log-linear histogram of cycle counts.  Each power of two is split into
+ * SUB_COUNT equal buckets, so any recorded value is reported within
+ * 1/SUB_COUNT of itself; recording is an increment and a bit scan.
+ */
+class Latency_histogram {
+ public:
+  static constexpr unsigned SUB_BITS     = 3;
+  static constexpr unsigned SUB_COUNT    = 1U << SUB_BITS;
+  static constexpr unsigned BUCKET_COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+  Latency_histogram() : _counts(), _count(0), _max(0) {}
+
+  inline void record(uint64_t cycles)
+  {
+    _counts[index(cycles)]++;
+    _count++;
+    if (cycles > _max) _max = cycles;
+  }
+
+  void merge(const Latency_histogram &other)
+  {
+    for (unsigned i = 0; i < BUCKET_COUNT; i++) _counts[i] += other._counts[i];
+    _count += other._count;
+    _max = std::max(_max, other._max);
+  }
+
+  uint64_t count() const { return _count; }
+  uint64_t max() const { return _max; }
+
+  /**
+   * Value at quantile q (0 < q <= 1), as the midpoint of its bucket
+   */
+  uint64_t percentile(double q) const
+  {
+    if (_count == 0) return 0;
+    const auto target = static_cast<uint64_t>(std::ceil(q * double(_count)));
+    uint64_t   seen   = 0;
+    for (unsigned i = 0; i < BUCKET_COUNT; i++) {
+      seen += _counts[i];
+      if (seen >= target) return std::min(lower_bound(i) + width(i) / 2, _max);
+    }
+    return _max;
+  }
+
+  /**
+   * Summarize with values converted from cycles to nanoseconds
+   */
+  Component::IMCAS::Latency_summary summary(double cycles_per_ns) const
+  {
+    const auto ns = [cycles_per_ns](uint64_t cycles) { return static_cast<uint64_t>(double(cycles) / cycles_per_ns); };
+    return {_count, ns(percentile(0.5)), ns(percentile(0.99)), ns(percentile(0.999)), ns(_max)};
+  }
+
+ private:
+  static inline unsigned index(uint64_t v)
+  {
+    if (v < SUB_COUNT) return unsigned(v);
+    const unsigned shift = unsigned(63 - __builtin_clzll(v)) - SUB_BITS;
+    return (shift + 1) * SUB_COUNT + unsigned((v >> shift) & (SUB_COUNT - 1));
+  }
+
+  static inline uint64_t lower_bound(unsigned i)
+  {
+    if (i < SUB_COUNT) return i;
+    return uint64_t(SUB_COUNT + i % SUB_COUNT) << (i / SUB_COUNT - 1);
+  }
+
+  static inline uint64_t width(unsigned i) { return i < SUB_COUNT ? 1 : uint64_t(1) << (i / SUB_COUNT - 1); }
+
+  uint64_t _counts[BUCKET_COUNT];
+  uint64_t _count;
+  uint64_t _max;
+};
+
+/* per-thread latency histograms, indexed as Shard_stats::latency */
+struct Shard_latency {
+  Latency_histogram hist[Component::IMCAS::STATS_OP_COUNT][Component::IMCAS::STATS_LATENCY_COUNT];
+};
+
+}  // namespace mcas
+
+#endif
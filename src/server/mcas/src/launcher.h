@@ -61,6 +61,13 @@ class Shard_launcher {
     for (auto &sp : _shards) delete sp;
   }
 
+  std::vector<const Shard_metrics_snapshot *> metrics_sources() const
+  {
+    std::vector<const Shard_metrics_snapshot *> sources;
+    for (auto &sp : _shards) sources.push_back(&sp->metrics());
+    return sources;
+  }
+
   void wait_for_all()
   {
     pthread_setname_np(pthread_self(), "launcher");
@@ -14,10 +14,12 @@
 
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <memory>
 
 #include "ado_manager.h"
 #include "launcher.h"
 #include "mcas_config.h"
+#include "metrics.h"
 
 Program_options g_options {};
 
@@ -46,6 +48,7 @@ int main(int argc, char *argv[])
         ("debug", po::value<unsigned>()->default_value(0), "Debug level 0-3")                           //
         ("forced-exit", "Forced exit")                                                                  //
         ("device", po::value<std::string>()->default_value("mlx5_0"), "Network device (e.g., mlx5_0)")  //
+        ("metrics-port", po::value<unsigned>()->default_value(0), "Metrics HTTP port (0 = disabled)")   //
         ;
 
     po::variables_map vm;
@@ -64,6 +67,7 @@ int main(int argc, char *argv[])
     g_options.config_file = vm["config"].as<std::string>();
     g_options.device      = vm["device"].as<std::string>();
     g_options.forced_exit = vm.count("forced-exit");
+    g_options.metrics_port = vm["metrics-port"].as<unsigned>();
     PLOG("forced-exit:%s", g_options.forced_exit ? "yes" : "no");
 
     mcas::Global::debug_level = g_options.debug_level = vm["debug"].as<unsigned>();
@@ -79,6 +83,17 @@ int main(int argc, char *argv[])
     /* launch shards */
     {
       mcas::Shard_launcher launcher(g_options);
+
+      std::unique_ptr<mcas::Metrics_listener> metrics;
+      if (g_options.metrics_port) {
+        try {
+          metrics.reset(new mcas::Metrics_listener(g_options.metrics_port, launcher.metrics_sources()));
+        }
+        catch (const General_exception &e) {
+          PWRN("metrics listener disabled: %s", e.cause());
+        }
+      }
+
       launcher.wait_for_all();
     }
     PLOG("All shards shutdown");
@@ -13,11 +13,11 @@
 #ifndef __MCAS_CONFIG_H__
 #define __MCAS_CONFIG_H__
 
-/* NUM_SHARD_BUFFERS: number of 2MiB buffers per connection */
+/* NUM_SHARD_BUFFERS: maximum buffers of each size class per connection */
 static constexpr size_t NUM_SHARD_BUFFERS = 8;
 
 /* WORK_REQUEST_ALLOCATOR_COUNT: number of work request slots for ADO communications */
-static constexpr size_t WORK_REQUEST_ALLOCATOR_COUNT = 16;
+static constexpr size_t WORK_REQUEST_ALLOCATOR_COUNT = 256;
 
 /* Maximum number of comparison to make on a index scan.  We limit the max so that
    the shard thread does not get "jammed up" scanning the index. */
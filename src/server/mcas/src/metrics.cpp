@@ -0,0 +1,204 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <common/exceptions.h>
+#include <common/logging.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <sstream>
+
+namespace mcas
+{
+namespace
+{
+const char *op_names[]   = {"put", "get", "erase", "batch", "ado", "other"};
+const char *stage_names[] = {"queue", "service", "store", "ado"};
+
+/* one metric family; shard labels are added per sample */
+class Family {
+ public:
+  Family(std::ostringstream &out, const char *name, const char *type, const char *help) : _out(out), _name(name)
+  {
+    _out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+  }
+
+  Family(const Family &) = delete;
+  Family &operator=(const Family &) = delete;
+
+  template <typename V>
+  void sample(const Shard_metrics &m, V value, const std::string &labels = "", const char *suffix = "")
+  {
+    _out << _name << suffix << "{core=\"" << m.core << "\",port=\"" << m.port << '"' << labels << "} " << value
+         << '\n';
+  }
+
+ private:
+  std::ostringstream &_out;
+  const char *        _name;
+};
+}  // namespace
+
+Metrics_listener::Metrics_listener(const unsigned port, const std::vector<const Shard_metrics_snapshot *> &shards)
+    : _shards(shards), _fd(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)), _exit(false), _thread()
+{
+  if (_fd < 0) throw General_exception("metrics: socket failed (%s)", strerror(errno));
+
+  int one = 1;
+  ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+
+  sockaddr_in addr{};
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port        = htons(uint16_t(port));
+
+  if (::bind(_fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0 || ::listen(_fd, SOMAXCONN) != 0) {
+    const int err = errno;
+    ::close(_fd);
+    throw General_exception("metrics: cannot listen on port %u (%s)", port, strerror(err));
+  }
+
+  _thread = std::thread(&Metrics_listener::thread_entry, this);
+  PMAJOR("metrics: listening on port %u", port);
+}
+
+Metrics_listener::~Metrics_listener()
+{
+  _exit = true;
+  _thread.join();
+  ::close(_fd);
+}
+
+void Metrics_listener::thread_entry()
+{
+  pthread_setname_np(pthread_self(), "metrics");
+
+  pollfd pfd{_fd, POLLIN, 0};
+  while (!_exit) {
+    if (::poll(&pfd, 1, POLL_TIMEOUT_MSEC) <= 0) continue;
+
+    const int fd = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) continue;
+
+    /* a stalled scraper must not hold up the next one for long */
+    timeval tv{1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+    serve(fd);
+    ::close(fd);
+  }
+}
+
+void Metrics_listener::serve(const int fd) const
+{
+  /* read up to the end of the request header */
+  std::string request;
+  char        buf[512];
+  while (request.size() < MAX_REQUEST_LEN && request.find("\r\n\r\n") == std::string::npos) {
+    const auto n = ::recv(fd, buf, sizeof buf, 0);
+    if (n <= 0) return;
+    request.append(buf, size_t(n));
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+    body = render();
+  else
+    status = "404 Not Found";
+
+  std::ostringstream response;
+  response << "HTTP/1.0 " << status << "\r\n"
+           << "Content-Type: text/plain; version=0.0.4\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: close\r\n\r\n"
+           << body;
+
+  const std::string out = response.str();
+  size_t            sent = 0;
+  while (sent < out.size()) {
+    const auto n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    sent += size_t(n);
+  }
+}
+
+std::string Metrics_listener::render() const
+{
+  using Component::IMCAS;
+
+  std::vector<Shard_metrics> shards;
+  for (auto s : _shards) {
+    Shard_metrics m;
+    if (s->read(m)) shards.push_back(m);
+  }
+
+  std::ostringstream out;
+  const auto         counter = [&](const char *name, const char *help, uint64_t IMCAS::Shard_stats::*field) {
+    Family f(out, name, "counter", help);
+    for (auto &m : shards) f.sample(m, m.stats.*field);
+  };
+  const auto gauge = [&](const char *name, const char *help, uint64_t Shard_metrics::*field) {
+    Family f(out, name, "gauge", help);
+    for (auto &m : shards) f.sample(m, m.*field);
+  };
+
+  counter("mcas_requests_total", "Requests received", &IMCAS::Shard_stats::op_request_count);
+  counter("mcas_put_total", "PUT operations", &IMCAS::Shard_stats::op_put_count);
+  counter("mcas_get_total", "GET operations", &IMCAS::Shard_stats::op_get_count);
+  counter("mcas_put_direct_total", "PUT_DIRECT operations", &IMCAS::Shard_stats::op_put_direct_count);
+  counter("mcas_get_twostage_total", "Two-stage GET operations", &IMCAS::Shard_stats::op_get_twostage_count);
+  counter("mcas_erase_total", "ERASE operations", &IMCAS::Shard_stats::op_erase_count);
+  counter("mcas_ado_total", "ADO invocations", &IMCAS::Shard_stats::op_ado_count);
+  counter("mcas_batch_total", "Batch requests", &IMCAS::Shard_stats::op_batch_count);
+  counter("mcas_failed_requests_total", "Failed requests", &IMCAS::Shard_stats::op_failed_request_count);
+  counter("mcas_busy_cycles_total", "Shard loop cycles spent doing work", &IMCAS::Shard_stats::busy_cycles);
+  counter("mcas_idle_cycles_total", "Shard loop cycles spent polling or blocked", &IMCAS::Shard_stats::idle_cycles);
+
+  gauge("mcas_sessions", "Client sessions", &Shard_metrics::session_count);
+  gauge("mcas_open_pools", "Open pools", &Shard_metrics::open_pool_count);
+  gauge("mcas_open_pool_bytes", "Total size of open pools", &Shard_metrics::open_pool_bytes);
+  gauge("mcas_ado_processes", "ADO processes", &Shard_metrics::ado_process_count);
+  gauge("mcas_ado_outstanding_work", "Work requests awaiting an ADO response", &Shard_metrics::ado_outstanding_work);
+  gauge("mcas_tasks", "Pending shard tasks", &Shard_metrics::task_count);
+  gauge("mcas_buffers_in_use", "IO buffers in use", &Shard_metrics::buffers_in_use);
+  gauge("mcas_buffers", "IO buffers", &Shard_metrics::buffers_total);
+  gauge("mcas_buffer_pool_bytes", "IO buffer memory allocated", &Shard_metrics::buffer_pool_bytes);
+
+  {
+    Family f(out, "mcas_latency_seconds", "summary", "Request latency by operation and stage");
+    for (auto &m : shards) {
+      for (unsigned op = 0; op < IMCAS::STATS_OP_COUNT; op++) {
+        for (unsigned stage = 0; stage < IMCAS::STATS_LATENCY_COUNT; stage++) {
+          const auto &l = m.stats.latency[op][stage];
+          if (l.count == 0) continue;
+          const std::string labels = std::string(",op=\"") + op_names[op] + "\",stage=\"" + stage_names[stage] + '"';
+          f.sample(m, double(l.p50_ns) / 1e9, labels + ",quantile=\"0.5\"");
+          f.sample(m, double(l.p99_ns) / 1e9, labels + ",quantile=\"0.99\"");
+          f.sample(m, double(l.p999_ns) / 1e9, labels + ",quantile=\"0.999\"");
+          f.sample(m, l.count, labels, "_count");
+        }
+      }
+    }
+  }
+
+  return out.str();
+}
+
+}  // namespace mcas
@@ -0,0 +1,129 @@
+/*
+  Copyright [2020] [IBM Corporation]
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+  http://www.apache.org/licenses/LICENSE-2.0
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+#ifndef __mcas_METRICS_H__
+#define __mcas_METRICS_H__
+
+#include <api/mcas_itf.h>
+#include <common/utils.h> /* cpu_relax */
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mcas
+{
+/**
+ * Single-writer seqlock holding the latest copy of a trivially copyable
+ * value.  The writer never waits; readers retry if they overlap a publish.
+ */
+template <typename T>
+class Seqlock_snapshot {
+  static_assert(std::is_trivially_copyable<T>::value, "seqlock value must be trivially copyable");
+
+ public:
+  Seqlock_snapshot() : _seq(0), _value() {}
+
+  Seqlock_snapshot(const Seqlock_snapshot &) = delete;
+  Seqlock_snapshot &operator=(const Seqlock_snapshot &) = delete;
+
+  void publish(const T &value)
+  {
+    const auto seq = _seq.load(std::memory_order_relaxed);
+    _seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void *>(&_value), &value, sizeof(T));
+    _seq.store(seq + 2, std::memory_order_release);
+  }
+
+  /* false if nothing has been published yet */
+  bool read(T &out) const
+  {
+    for (;;) {
+      const auto seq = _seq.load(std::memory_order_acquire);
+      if (seq & 1) {
+        cpu_relax();
+        continue;
+      }
+      std::memcpy(static_cast<void *>(&out), &_value, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_seq.load(std::memory_order_relaxed) == seq) return seq != 0;
+    }
+  }
+
+ private:
+  std::atomic<uint64_t> _seq;
+  T                     _value;
+};
+
+/* per-shard state published for the metrics listener */
+struct Shard_metrics {
+  Shard_metrics()
+      : stats(), core(0), port(0), session_count(0), open_pool_count(0), open_pool_bytes(0), ado_process_count(0),
+        ado_outstanding_work(0), task_count(0), buffers_in_use(0), buffers_total(0), buffer_pool_bytes(0)
+  {
+  }
+
+  Component::IMCAS::Shard_stats stats;
+  uint32_t                      core;
+  uint32_t                      port;
+  uint64_t                      session_count;
+  uint64_t                      open_pool_count;
+  uint64_t                      open_pool_bytes;
+  uint64_t                      ado_process_count;
+  uint64_t                      ado_outstanding_work; /*< work requests sent to ADO processes, not yet answered */
+  uint64_t                      task_count;
+  uint64_t                      buffers_in_use; /*< IO buffers held, summed over sessions */
+  uint64_t                      buffers_total;
+  uint64_t                      buffer_pool_bytes; /*< IO buffer memory allocated by the shard */
+};
+
+using Shard_metrics_snapshot = Seqlock_snapshot<Shard_metrics>;
+
+/**
+ * Plain HTTP listener serving shard snapshots in the Prometheus text
+ * exposition format at /metrics.  Runs on its own thread and only reads
+ * the published snapshots.
+ */
+class Metrics_listener {
+ public:
+  static constexpr unsigned POLL_TIMEOUT_MSEC = 200;
+  static constexpr size_t   MAX_REQUEST_LEN   = 4096;
+
+  Metrics_listener(unsigned port, const std::vector<const Shard_metrics_snapshot *> &shards);
+
+  Metrics_listener(const Metrics_listener &) = delete;
+  Metrics_listener &operator=(const Metrics_listener &) = delete;
+
+  ~Metrics_listener();
+
+  /* render all shards in text exposition format */
+  std::string render() const;
+
+ private:
+  void thread_entry();
+
+  void serve(int fd) const;
+
+  const std::vector<const Shard_metrics_snapshot *> _shards;
+  int                                               _fd;
+  std::atomic<bool>                                 _exit;
+  std::thread                                       _thread;
+};
+
+}  // namespace mcas
+
+#endif
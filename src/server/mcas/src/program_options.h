@@ -18,6 +18,7 @@ struct Program_options {
   std::string device;
   unsigned    debug_level;
   bool        forced_exit;
+  unsigned    metrics_port; /*< 0 disables the metrics listener */
 };
 
 #endif  // __mcas_PROGRAM_OPTIONS_H__
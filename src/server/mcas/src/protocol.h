@@ -43,15 +43,22 @@ enum {
   MSG_TYPE_HANDSHAKE_REPLY = 0x2,
   MSG_TYPE_CLOSE_SESSION   = 0x3,
   MSG_TYPE_STATS           = 0x4,
+  MSG_TYPE_INDIRECT        = 0x5,
   MSG_TYPE_POOL_REQUEST    = 0x10,
   MSG_TYPE_POOL_RESPONSE   = 0x11,
   MSG_TYPE_IO_REQUEST      = 0x20,
   MSG_TYPE_IO_RESPONSE     = 0x21,
+  MSG_TYPE_IO_BATCH_REQUEST  = 0x22,
+  MSG_TYPE_IO_BATCH_RESPONSE = 0x23,
+  MSG_TYPE_SCAN_REQUEST    = 0x24,
+  MSG_TYPE_SCAN_RESPONSE   = 0x25,
   MSG_TYPE_INFO_REQUEST    = 0x30,
   MSG_TYPE_INFO_RESPONSE   = 0x31,
   MSG_TYPE_ADO_REQUEST     = 0x40,
   MSG_TYPE_ADO_RESPONSE    = 0x41,
   MSG_TYPE_PUT_ADO_REQUEST = 0x42,
+  MSG_TYPE_ADO_BATCH_REQUEST  = 0x43,
+  MSG_TYPE_ADO_BATCH_RESPONSE = 0x44,
   MSG_TYPE_MAX             = 0xFF,
 };
 
@@ -69,6 +76,10 @@ enum {
 enum {
   MSG_RESVD_SCBE   = 0x2, /* indicates short-circuit function (testing only) */
   MSG_RESVD_DIRECT = 0x4, /* indicate get_direct from client side */
+  MSG_RESVD_INLINE = 0x8, /* value must be returned in the response message (pipelined client) */
+  MSG_RESVD_WRITE  = 0x10, /* GET: client offers a registered landing buffer for an RDMA write of the value */
+  MSG_RESVD_LEASE  = 0x20, /* GET: respond with a Value_lease rather than the value */
+  MSG_RESVD_RANGE  = 0x40, /* GET: only a range of the value (set_range) */
 };
 
 enum {
@@ -333,6 +344,51 @@ struct Message_IO_request : public Message {
   inline size_t get_key_len() const { return key_len; }
   inline size_t get_value_len() const { return val_len; }
 
+  /**
+   * GET: offer a registered buffer of val_len bytes into which the server
+   * may write the value directly
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param addr Address of the landing buffer
+   * @param key Remote key of the landing buffer's memory region
+   */
+  void set_landing(size_t buffer_size, const void* addr, uint64_t key)
+  {
+    append_trailer(buffer_size, reinterpret_cast<uint64_t>(addr), key);
+    resvd |= MSG_RESVD_WRITE;
+  }
+
+  inline uint64_t landing_addr() const { return trailer(0); }
+  inline uint64_t landing_key() const { return trailer(1); }
+
+  /**
+   * GET: ask for only part of the value (not combined with set_landing)
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param offset Offset of the range within the value
+   * @param len Maximum length of the range
+   */
+  void set_range(size_t buffer_size, uint64_t offset, uint64_t len)
+  {
+    append_trailer(buffer_size, offset, len);
+    resvd |= MSG_RESVD_RANGE;
+  }
+
+  inline uint64_t range_offset() const { return trailer(0); }
+  inline uint64_t range_length() const { return trailer(1); }
+
+  /**
+   * PUT_SEGMENT: place this message's value within a larger value
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param offset Offset of the segment within the value
+   * @param total Length of the whole value
+   */
+  void set_segment(size_t buffer_size, uint64_t offset, uint64_t total) { append_trailer(buffer_size, offset, total); }
+
+  inline uint64_t segment_offset() const { return trailer(0); }
+  inline uint64_t segment_total() const { return trailer(1); }
+
   void set_key_value_len(size_t buffer_size, const void* key, const size_t key_len, const size_t value_len)
   {
     if (UNLIKELY((key_len + 1 + (sizeof *this)) > buffer_size))
@@ -365,6 +421,25 @@ struct Message_IO_request : public Message {
     this->key_len = p_key_len;
   }
 
+ private:
+  /* two words following the key and, for PUT_SEGMENT, the value */
+  void append_trailer(size_t buffer_size, uint64_t a, uint64_t b)
+  {
+    const uint64_t words[2] = {a, b};
+    if (UNLIKELY(msg_len + sizeof words > buffer_size))
+      throw API_exception("%s::%s - insufficient buffer for trailer", description, __func__);
+    memcpy(reinterpret_cast<char*>(this) + msg_len, words, sizeof words);
+    msg_len += boost::numeric_cast<decltype(msg_len)>(sizeof words);
+  }
+
+  uint64_t trailer(unsigned i) const
+  {
+    uint64_t v;
+    memcpy(&v, &data[key_len + 1 + (op == OP_PUT_SEGMENT ? val_len : 0) + i * sizeof v], sizeof v);
+    return v;
+  }
+
+ public:
   // fields
   uint64_t pool_id;
   uint64_t request_id; /*< id or sender timestamp counter */
@@ -376,8 +451,29 @@ struct Message_IO_request : public Message {
 
 } __attribute__((packed));
 
+/**
+ * Everything a client needs to read a value with one-sided RDMA reads.
+ * The client reads the value, then its version word; the read is valid
+ * only if the version word is still the one leased and the checksum of
+ * the bytes read matches. Every server-side write to the value moves the
+ * version word on first, so a value changed, moved or erased since it was
+ * leased, or while it was read, fails validation; the checksum catches
+ * what the version word cannot see (see IMCAS::configure_pool).
+ */
+struct Value_lease {
+  uint64_t addr;         /*< value address in server memory */
+  uint64_t key;          /*< remote key of a remote-read-only registration covering the value */
+  uint64_t len;          /*< value length */
+  uint64_t version_addr; /*< address of the value's version word (8 bytes) */
+  uint64_t version_key;  /*< remote key of a remote-read-only registration covering the version word */
+  uint64_t version;      /*< version word when leased (even) */
+  uint32_t chksum;       /*< Common::chksum32 of the value when leased */
+  uint32_t msec;         /*< longest time the lease may be used */
+} __attribute__((packed));
+
 struct Message_IO_response : public Message {
   static constexpr uint64_t    BIT_TWOSTAGE = 1ULL << 63;
+  static constexpr uint64_t    BIT_WRITTEN  = 1ULL << 62; /* value was written to the client's landing buffer */
   static constexpr uint8_t     id           = MSG_TYPE_IO_RESPONSE;
   static constexpr const char* description  = "Message_IO_response";
 
@@ -405,11 +501,316 @@ struct Message_IO_response : public Message {
 
   bool is_set_twostage_bit() const { return data_len & BIT_TWOSTAGE; }
 
-  size_t data_length() const { return data_len & (~BIT_TWOSTAGE); }
+  void set_written_bit() { data_len |= BIT_WRITTEN; }
+
+  bool is_set_written_bit() const { return data_len & BIT_WRITTEN; }
+
+  size_t data_length() const { return data_len & ~(BIT_TWOSTAGE | BIT_WRITTEN); }
 
   // fields
   uint64_t request_id; /*< id or sender time stamp counter */
-  uint64_t data_len;   /* bit 63 is twostage flag */
+  uint64_t data_len;   /* bit 63 is twostage flag, bit 62 is written flag */
+  char     data[];
+} __attribute__((packed));
+
+////////////////////////////////////////////////////////////////////////
+// BATCHED IO OPERATIONS
+
+/**
+ * Vectored IO request.  A single message carries N records of the
+ * same operation (PUT, GET or ERASE).  Each record is a key with an
+ * optional inline value (PUT only).  Records are packed back-to-back
+ * after the header.
+ */
+struct Message_IO_batch_request : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_IO_BATCH_REQUEST;
+  static constexpr const char* description = "Message_IO_batch_request";
+
+  struct record_t {
+    uint32_t key_len;
+    uint32_t value_len;
+    char     data[];
+
+    inline const char* key() const { return &data[0]; }
+    inline const char* value() const { return &data[key_len]; }
+    inline size_t      record_size() const { return (sizeof *this) + key_len + value_len; }
+  } __attribute__((packed));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_IO_batch_request(size_t   buffer_size,
+                           uint64_t auth_id,
+                           uint64_t request_id,
+                           uint64_t pool_id,
+                           uint8_t  op,
+                           uint32_t flags)
+      : Message(auth_id, id, op), pool_id(pool_id), request_id(request_id), flags(flags), count(0), data_len(0)
+  {
+    if (buffer_size < (sizeof *this)) throw std::length_error(description);
+    msg_len = (sizeof *this);
+  }
+#pragma GCC diagnostic pop
+
+  /**
+   * Append a record to the batch
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param key Key
+   * @param key_len Key length in bytes
+   * @param value Optional value (PUT only)
+   * @param value_len Value length in bytes
+   *
+   * @return False if the record does not fit in the remaining buffer
+   */
+  bool append(size_t buffer_size, const void* key, size_t key_len, const void* value, size_t value_len)
+  {
+    const size_t record_len = sizeof(record_t) + key_len + value_len;
+    if (msg_len + record_len > buffer_size) return false;
+
+    auto rec       = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->key_len   = boost::numeric_cast<uint32_t>(key_len);
+    rec->value_len = boost::numeric_cast<uint32_t>(value_len);
+    memcpy(rec->data, key, key_len);
+    if (value_len) memcpy(&rec->data[key_len], value, value_len);
+
+    data_len += record_len;
+    msg_len = boost::numeric_cast<decltype(msg_len)>(msg_len + record_len);
+    count++;
+    return true;
+  }
+
+  inline const record_t* first_record() const { return count ? reinterpret_cast<const record_t*>(data) : nullptr; }
+
+  static inline const record_t* next_record(const record_t* rec)
+  {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  /**
+   * Check the sender's lengths: the message must lie within its buffer,
+   * and each record within the message
+   *
+   * @param buffer_size Size of the buffer holding the message
+   *
+   * @return True if every record may be read
+   */
+  bool valid(size_t buffer_size) const
+  {
+    if (msg_len < (sizeof *this) || msg_len > buffer_size || data_len != msg_len - (sizeof *this)) return false;
+
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (data_len - offset < sizeof(record_t)) return false;
+      const auto rec = reinterpret_cast<const record_t*>(&data[offset]);
+      offset += sizeof(record_t);
+      if (data_len - offset < uint64_t(rec->key_len) + rec->value_len) return false;
+      offset += uint64_t(rec->key_len) + rec->value_len;
+    }
+    return true;
+  }
+
+  // fields
+  uint64_t pool_id;
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint32_t flags;
+  uint32_t count;    /*< number of records */
+  uint64_t data_len; /*< length of packed records */
+  char     data[];
+
+} __attribute__((packed));
+
+/**
+ * Vectored IO response.  The shard may process only a prefix of the
+ * request records (e.g. when GET values exhaust the response buffer);
+ * 'count' gives the number of records answered and the client re-issues
+ * the remainder.
+ */
+struct Message_IO_batch_response : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_IO_BATCH_RESPONSE;
+  static constexpr const char* description = "Message_IO_batch_response";
+
+  struct record_t {
+    int32_t  status;
+    uint32_t value_len;
+    char     data[];
+
+    inline const char* value() const { return &data[0]; }
+    inline size_t      record_size() const { return (sizeof *this) + value_len; }
+  } __attribute__((packed));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_IO_batch_response(size_t buffer_size, uint64_t auth_id, uint64_t request_id)
+      : Message(auth_id, id), request_id(request_id), count(0), pad(0), data_len(0)
+  {
+    if (buffer_size < (sizeof *this)) throw std::length_error(description);
+    msg_len = (sizeof *this);
+  }
+#pragma GCC diagnostic pop
+
+  /**
+   * Append a per-record result
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param status Status of the operation for this record
+   * @param value Optional value (GET only)
+   * @param value_len Value length in bytes
+   *
+   * @return False if the result does not fit in the remaining buffer
+   */
+  bool append(size_t buffer_size, status_t status, const void* value = nullptr, size_t value_len = 0)
+  {
+    const size_t record_len = sizeof(record_t) + value_len;
+    if (msg_len + record_len > buffer_size) return false;
+
+    auto rec       = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->status    = status;
+    rec->value_len = boost::numeric_cast<uint32_t>(value_len);
+    if (value_len) memcpy(rec->data, value, value_len);
+
+    data_len += record_len;
+    msg_len = boost::numeric_cast<decltype(msg_len)>(msg_len + record_len);
+    count++;
+    return true;
+  }
+
+  inline const record_t* first_record() const { return count ? reinterpret_cast<const record_t*>(data) : nullptr; }
+
+  static inline const record_t* next_record(const record_t* rec)
+  {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  // fields
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint32_t count;      /*< number of records answered */
+  uint32_t pad;
+  uint64_t data_len; /*< length of packed records */
+  char     data[];
+} __attribute__((packed));
+
+////////////////////////////////////////////////////////////////////////
+// SCAN REQUEST/RESPONSE
+
+/**
+ * Ordered range scan over the pool index.  Keys in [start_key,
+ * end_key) are returned in index order, one page per response buffer.
+ * An empty end key means scan to the end of the index.
+ */
+struct Message_scan_request : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_SCAN_REQUEST;
+  static constexpr const char* description = "Message_scan_request";
+
+  static constexpr uint32_t FLAG_WITH_VALUES     = 0x1; /*< return values inline */
+  static constexpr uint32_t FLAG_EXCLUSIVE_START = 0x2; /*< continuation; skip start_key itself */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_scan_request(size_t             buffer_size,
+                       uint64_t           auth_id,
+                       uint64_t           request_id,
+                       uint64_t           pool_id,
+                       const std::string& start_key,
+                       const std::string& end_key,
+                       uint32_t           limit,
+                       uint32_t           flags)
+      : Message(auth_id, id), pool_id(pool_id), request_id(request_id), limit(limit), flags(flags),
+        start_key_len(boost::numeric_cast<uint32_t>(start_key.length())),
+        end_key_len(boost::numeric_cast<uint32_t>(end_key.length()))
+  {
+    msg_len = boost::numeric_cast<decltype(msg_len)>((sizeof *this) + start_key_len + end_key_len);
+    if (buffer_size < msg_len) throw std::length_error(description);
+    memcpy(data, start_key.data(), start_key_len);
+    memcpy(&data[start_key_len], end_key.data(), end_key_len);
+  }
+#pragma GCC diagnostic pop
+
+  inline std::string start_key() const { return std::string(data, start_key_len); }
+  inline std::string end_key() const { return std::string(&data[start_key_len], end_key_len); }
+
+  // fields
+  uint64_t pool_id;
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint32_t limit;      /*< maximum number of keys in this page */
+  uint32_t flags;
+  uint32_t start_key_len;
+  uint32_t end_key_len;
+  char     data[];
+} __attribute__((packed));
+
+/**
+ * One page of scan results.  'more' is set when the page stopped
+ * before the end of the range; the client continues from the last key
+ * returned.  A record whose value cannot fit in any page carries
+ * E_INSUFFICIENT_SPACE and no value.
+ */
+struct Message_scan_response : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_SCAN_RESPONSE;
+  static constexpr const char* description = "Message_scan_response";
+
+  struct record_t {
+    uint32_t key_len;
+    uint32_t value_len;
+    int32_t  status;
+    char     data[];
+
+    inline const char* key() const { return &data[0]; }
+    inline const char* value() const { return &data[key_len]; }
+    inline size_t      record_size() const { return (sizeof *this) + key_len + value_len; }
+  } __attribute__((packed));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_scan_response(size_t buffer_size, uint64_t auth_id, uint64_t request_id)
+      : Message(auth_id, id), request_id(request_id), count(0), more(0), data_len(0)
+  {
+    if (buffer_size < (sizeof *this)) throw std::length_error(description);
+    msg_len = (sizeof *this);
+  }
+#pragma GCC diagnostic pop
+
+  static inline size_t record_size(size_t key_len, size_t value_len) { return sizeof(record_t) + key_len + value_len; }
+
+  /**
+   * Append a key (and optional value) to the page
+   *
+   * @return False if the record does not fit in the remaining buffer
+   */
+  bool append(size_t      buffer_size,
+              const void* key,
+              size_t      key_len,
+              status_t    status    = S_OK,
+              const void* value     = nullptr,
+              size_t      value_len = 0)
+  {
+    const size_t record_len = record_size(key_len, value_len);
+    if (msg_len + record_len > buffer_size) return false;
+
+    auto rec       = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->key_len   = boost::numeric_cast<uint32_t>(key_len);
+    rec->value_len = boost::numeric_cast<uint32_t>(value_len);
+    rec->status    = status;
+    memcpy(rec->data, key, key_len);
+    if (value_len) memcpy(&rec->data[key_len], value, value_len);
+
+    data_len += record_len;
+    msg_len = boost::numeric_cast<decltype(msg_len)>(msg_len + record_len);
+    count++;
+    return true;
+  }
+
+  inline const record_t* first_record() const { return count ? reinterpret_cast<const record_t*>(data) : nullptr; }
+
+  static inline const record_t* next_record(const record_t* rec)
+  {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  // fields
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint32_t count;      /*< number of records in this page */
+  uint32_t more;       /*< non-zero if the range continues */
+  uint64_t data_len;   /*< length of packed records */
   char     data[];
 } __attribute__((packed));
 
@@ -484,10 +885,16 @@ struct Message_INFO_response : public Message {
 ////////////////////////////////////////////////////////////////////////
 // HANDSHAKE
 
+/* resvd flags of Message_handshake and Message_handshake_reply */
+enum {
+  HANDSHAKE_FLAG_INDIRECT = 0x1, /* sends Message_indirect for messages larger than max_message_size */
+};
+
 struct Message_handshake : public Message {
   Message_handshake(uint64_t auth_id, uint64_t sequence) : Message(auth_id, id), seq(sequence), protocol(PROTOCOL_V1)
   {
     msg_len = (sizeof *this);
+    resvd   = 0;
   }
 
   static constexpr uint8_t     id          = MSG_TYPE_HANDSHAKE;
@@ -522,6 +929,7 @@ struct Message_handshake_reply : public Message {
         x509_cert_len(x509_cert_len)
   {
     msg_len = boost::numeric_cast<uint32_t>(sizeof(Message_handshake_reply)) + x509_cert_len;
+    resvd   = 0;
     if (msg_len > buffer_size)
       throw Logic_exception("%s::%s - insufficient buffer for Message_handshake_reply", description, __func__);
     if (x509_cert_ptr && (x509_cert_len > 0)) {
@@ -532,7 +940,8 @@ struct Message_handshake_reply : public Message {
   // fields
   uint64_t      seq;
   uint64_t      session_id;
-  size_t        max_message_size; /* RDMA max message size in bytes */
+  size_t        max_message_size; /* RDMA max message size in bytes; with HANDSHAKE_FLAG_INDIRECT,
+                                     the largest message the server receives directly */
   uint32_t      x509_cert_len;
   unsigned char x509_cert[];
 
@@ -555,6 +964,51 @@ struct Message_close_session : public Message {
 
 } __attribute__((packed));
 
+////////////////////////////////////////////////////////////////////////
+// INDIRECT
+
+/**
+ * Stands in for a message larger than the server's receive buffers. The
+ * server RDMA-reads the segments back to back and handles the result as
+ * the received message. The segments must stay unchanged until the
+ * message's response arrives.
+ */
+struct Message_indirect : public Message {
+  static constexpr uint8_t     id           = MSG_TYPE_INDIRECT;
+  static constexpr const char* description  = "Message_indirect";
+  static constexpr unsigned    MAX_SEGMENTS = 2; /* header and separate value, as in a two-buffer send */
+
+  struct segment_t {
+    uint64_t addr;
+    uint64_t key;
+    uint64_t len;
+  } __attribute__((packed));
+
+  Message_indirect(uint64_t auth_id) : Message(auth_id, id), count(0), segments{}
+  {
+    msg_len = (sizeof *this);
+    resvd   = 0;
+  }
+
+  void add_segment(const void* addr, uint64_t key, size_t len)
+  {
+    if (count == MAX_SEGMENTS) throw Logic_exception("%s::%s - too many segments", description, __func__);
+    segments[count++] = segment_t{reinterpret_cast<uint64_t>(addr), key, len};
+  }
+
+  size_t total_length() const
+  {
+    size_t len = 0;
+    for (uint32_t i = 0; i != count && i != MAX_SEGMENTS; i++) len += segments[i].len;
+    return len;
+  }
+
+  // fields
+  uint32_t  count;
+  segment_t segments[MAX_SEGMENTS];
+
+} __attribute__((packed));
+
 #pragma GCC diagnostic push
 #if 8 <= __GNUC__
 #pragma GCC diagnostic ignored "-Wpacked-not-aligned"
@@ -783,8 +1237,203 @@ struct Message_ado_response : public Message {
 
 } __attribute__((packed));
 
+/**
+ * Batched ADO invocation: one request per key, all with the same flags.
+ * Records (key, invocation data) are packed back-to-back after the
+ * header.  The shard answers with a single Message_ado_batch_response.
+ */
+struct Message_ado_batch_request : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_ADO_BATCH_REQUEST;
+  static constexpr const char* description = "Message_ado_batch_request";
+
+  struct record_t {
+    uint32_t key_len;
+    uint32_t request_len;
+    char     data[];
+
+    inline const char* key() const { return &data[0]; }
+    inline const char* request() const { return &data[key_len]; }
+    inline size_t      record_size() const { return (sizeof *this) + key_len + request_len; }
+  } __attribute__((packed));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_ado_batch_request(size_t   buffer_size,
+                            uint64_t auth_id,
+                            uint64_t request_id,
+                            uint64_t pool_id,
+                            uint32_t flags,
+                            size_t   odvl)
+      : Message(auth_id, id), request_id(request_id), pool_id(pool_id), ondemand_val_len(odvl), flags(flags),
+        count(0), data_len(0)
+  {
+    if (buffer_size < (sizeof *this)) throw std::length_error(description);
+    msg_len = (sizeof *this);
+  }
+#pragma GCC diagnostic pop
+
+  /**
+   * Append a record to the batch
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param key Key
+   * @param key_len Key length in bytes
+   * @param request Invocation data
+   * @param request_len Invocation data length in bytes
+   *
+   * @return False if the record does not fit in the remaining buffer
+   */
+  bool append(size_t buffer_size, const void* key, size_t key_len, const void* request, size_t request_len)
+  {
+    const size_t record_len = sizeof(record_t) + key_len + request_len;
+    if (msg_len + record_len > buffer_size) return false;
+
+    auto rec         = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->key_len     = boost::numeric_cast<uint32_t>(key_len);
+    rec->request_len = boost::numeric_cast<uint32_t>(request_len);
+    memcpy(rec->data, key, key_len);
+    if (request_len) memcpy(&rec->data[key_len], request, request_len);
+
+    data_len += record_len;
+    msg_len = boost::numeric_cast<decltype(msg_len)>(msg_len + record_len);
+    count++;
+    return true;
+  }
+
+  inline const record_t* first_record() const { return count ? reinterpret_cast<const record_t*>(data) : nullptr; }
+
+  static inline const record_t* next_record(const record_t* rec)
+  {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  /**
+   * Check the sender's lengths: the message must lie within its buffer,
+   * and each record within the message
+   *
+   * @param buffer_size Size of the buffer holding the message
+   *
+   * @return True if every record may be read
+   */
+  bool valid(size_t buffer_size) const
+  {
+    if (msg_len < (sizeof *this) || msg_len > buffer_size || data_len != msg_len - (sizeof *this)) return false;
+
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      if (data_len - offset < sizeof(record_t)) return false;
+      const auto rec = reinterpret_cast<const record_t*>(&data[offset]);
+      offset += sizeof(record_t);
+      if (data_len - offset < uint64_t(rec->key_len) + rec->request_len) return false;
+      offset += uint64_t(rec->key_len) + rec->request_len;
+    }
+    return true;
+  }
+
+  // fields
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint64_t pool_id;
+  uint64_t ondemand_val_len;
+  uint32_t flags;
+  uint32_t count;    /*< number of records */
+  uint64_t data_len; /*< length of packed records */
+  char     data[];
+
+} __attribute__((packed));
+
+/**
+ * Results of a Message_ado_batch_request, one record per request record
+ * in request order.  Each record carries the invocation status and the
+ * ADO response buffers encoded as in Message_ado_response (32-bit length,
+ * 32-bit layer id, data).  A record whose responses do not fit carries
+ * none and has status E_INSUFFICIENT_SPACE.
+ */
+struct Message_ado_batch_response : public Message {
+  static constexpr uint8_t     id          = MSG_TYPE_ADO_BATCH_RESPONSE;
+  static constexpr const char* description = "Message_ado_batch_response";
+
+  struct record_t {
+    int32_t  status;
+    uint32_t response_len; /*< bytes of encoded responses */
+    char     data[];
+
+    inline size_t record_size() const { return (sizeof *this) + response_len; }
+
+    /* call f(data, len, layer_id) for each response buffer */
+    template <typename F>
+    void for_each_response(F f) const
+    {
+      for (uint32_t pos = 0; pos < response_len;) {
+        auto size_ptr = reinterpret_cast<const uint32_t*>(&data[pos]);
+        f(&data[pos + 8], size_t(size_ptr[0]), size_ptr[1]);
+        pos += size_ptr[0] + 8;
+      }
+    }
+  } __attribute__((packed));
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++" // missing initializers
+  Message_ado_batch_response(size_t buffer_size, uint64_t auth_id, uint64_t request_id)
+      : Message(auth_id, id), request_id(request_id), count(0), pad(0), data_len(0)
+  {
+    if (buffer_size < (sizeof *this)) throw std::length_error(description);
+    msg_len = (sizeof *this);
+  }
+#pragma GCC diagnostic pop
+
+  /**
+   * Append a per-record result
+   *
+   * @param buffer_size Size of the underlying buffer
+   * @param status Invocation status
+   * @param responses Encoded response buffers
+   * @param responses_len Length of encoded responses in bytes
+   *
+   * @return False if even an empty result does not fit
+   */
+  bool append(size_t buffer_size, status_t status, const void* responses, size_t responses_len)
+  {
+    if (msg_len + sizeof(record_t) > buffer_size) return false;
+    if (msg_len + sizeof(record_t) + responses_len > buffer_size) {
+      if (status >= S_OK) status = E_INSUFFICIENT_SPACE;
+      responses_len = 0;
+    }
+
+    const size_t record_len = sizeof(record_t) + responses_len;
+    auto         rec        = reinterpret_cast<record_t*>(&data[data_len]);
+    rec->status             = status;
+    rec->response_len       = boost::numeric_cast<uint32_t>(responses_len);
+    if (responses_len) memcpy(rec->data, responses, responses_len);
+
+    data_len += record_len;
+    msg_len = boost::numeric_cast<decltype(msg_len)>(msg_len + record_len);
+    count++;
+    return true;
+  }
+
+  inline const record_t* first_record() const { return count ? reinterpret_cast<const record_t*>(data) : nullptr; }
+
+  static inline const record_t* next_record(const record_t* rec)
+  {
+    return reinterpret_cast<const record_t*>(reinterpret_cast<const char*>(rec) + rec->record_size());
+  }
+
+  // fields
+  uint64_t request_id; /*< id or sender timestamp counter */
+  uint32_t count;      /*< number of records answered */
+  uint32_t pad;
+  uint64_t data_len; /*< length of packed records */
+  char     data[];
+} __attribute__((packed));
+
 static_assert(sizeof(Message_IO_request) % 8 == 0, "Message_IO_request should be 64bit aligned");
 static_assert(sizeof(Message_IO_response) % 8 == 0, "Message_IO_request should be 64bit aligned");
+static_assert(sizeof(Message_IO_batch_request) % 8 == 0, "Message_IO_batch_request should be 64bit aligned");
+static_assert(sizeof(Message_IO_batch_response) % 8 == 0, "Message_IO_batch_response should be 64bit aligned");
+static_assert(sizeof(Message_scan_request) % 8 == 0, "Message_scan_request should be 64bit aligned");
+static_assert(sizeof(Message_scan_response) % 8 == 0, "Message_scan_response should be 64bit aligned");
+static_assert(sizeof(Message_ado_batch_request) % 8 == 0, "Message_ado_batch_request should be 64bit aligned");
+static_assert(sizeof(Message_ado_batch_response) % 8 == 0, "Message_ado_batch_response should be 64bit aligned");
 
 }  // namespace Protocol
 }  // namespace mcas
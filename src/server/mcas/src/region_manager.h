@@ -14,18 +14,97 @@
 #define __mcas_REGION_MANAGER_H__
 
 #include <api/fabric_itf.h>
+#include <common/interval_tree.h>
 #include <common/utils.h>
+#include <rdma/fabric.h> /* FI_REMOTE_READ */
 
-#include <set>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "connection_handler.h"
 #include "types.h"
 
 namespace mcas
 {
+/**
+ * Registered bytes of all of a shard's connections, against a shard-wide
+ * budget. May be used from any thread.
+ */
+class Region_budget {
+ public:
+  /**
+   * Constructor
+   *
+   * @param budget Bytes of registered memory beyond which connections evict unreferenced registrations (0 = no limit)
+   */
+  explicit Region_budget(size_t budget) : _budget(budget), _pinned(0) {}
+
+  Region_budget(const Region_budget &) = delete;
+  Region_budget &operator=(const Region_budget &) = delete;
+
+  inline void add(size_t len) { _pinned.fetch_add(len, std::memory_order_relaxed); }
+  inline void remove(size_t len) { _pinned.fetch_sub(len, std::memory_order_relaxed); }
+
+  inline bool exceeded() const { return _budget && _budget < _pinned.load(std::memory_order_relaxed); }
+
+  inline size_t pinned_bytes() const { return _pinned.load(std::memory_order_relaxed); }
+
+ private:
+  const size_t        _budget;
+  std::atomic<size_t> _pinned;
+};
+
+/**
+ * Cache of memory registrations for one connection.
+ *
+ * A registration request is satisfied by any existing registration which
+ * covers the requested range. Registrations are reference counted; those
+ * with no references are kept, in LRU order, while the shard's registered
+ * bytes are within its budget.
+ */
 class Region_manager {
+  using interval_t      = Common::Interval<memory_region_t, std::uintptr_t>;
+  using interval_tree_t = Common::Interval_tree<memory_region_t, std::uintptr_t>;
+
+  /* unindexed registrations tolerated before the interval tree is rebuilt */
+  static constexpr size_t REBUILD_THRESHOLD = 32;
+
+  struct entry_t {
+    interval_t                           range; /* inclusive [start, stop] */
+    unsigned                             refs;
+    std::list<memory_region_t>::iterator lru;     /* valid iff refs == 0 */
+    bool                                 pinned;  /* released only by forget_regions */
+    bool                                 retired;   /* memory unmapped; deregistered on last release */
+    bool                                 read_only; /* remote read access only */
+  };
+
  public:
-  Region_manager(Connection* conn) : _conn(conn), _reg{} { assert(conn); }
+  struct Stats {
+    uint64_t hits         = 0;
+    uint64_t misses       = 0;
+    uint64_t evictions    = 0;
+    uint64_t pinned_bytes = 0;
+  };
+
+  /**
+   * Constructor
+   *
+   * @param conn Connection against which memory is registered
+   * @param budget Shard-wide registration budget
+   */
+  Region_manager(Connection* conn, Region_budget& budget)
+      : _conn(conn), _budget(budget), _entries{}, _lru{}, _held{}, _tree(new interval_tree_t()), _unindexed{},
+        _stale(0), _stats{}, _forget_lock{}, _forget{}, _forget_pending(false)
+  {
+    assert(conn);
+  }
 
   Region_manager(const Region_manager &) = delete;
   Region_manager &operator=(const Region_manager &) = delete;
@@ -33,13 +112,16 @@ class Region_manager {
   ~Region_manager()
   {
     /* deregister memory regions */
-    for (auto& r : _reg) {
-      _conn->deregister_memory(r);
+    for (auto& e : _entries) {
+      _conn->deregister_memory(e.first);
     }
+    _budget.remove(_stats.pinned_bytes);
   }
 
   /**
-   * Register memory with network transport for direct IO.  Cache in map.
+   * Register memory with network transport for direct IO, reusing a cached
+   * registration if one covers the range. The caller holds a reference until
+   * ondemand_release is called with the same target.
    *
    * @param target Pointer to start or region
    * @param target_len Region length in bytes
@@ -48,15 +130,239 @@ class Region_manager {
    */
   inline memory_region_t ondemand_register(const void* target, size_t target_len)
   {
-    /* transport will now take care of repeat registrations */
-    auto mr = _conn->register_memory(target, target_len, 0, 0);
-    _reg.insert(mr);
+    auto mr = acquire(target, target_len);
+    _held.emplace(target, mr);
     return mr;
   }
 
+  /**
+   * Register memory for the life of the connection (e.g. a whole pool)
+   *
+   * @param target Pointer to start or region
+   * @param target_len Region length in bytes
+   * @param read_only Grant remote read access only, as for a registration
+   *                  whose key is handed to clients; kept apart from the
+   *                  registrations used for the connection's own IO
+   *
+   * @return Memory region handle
+   */
+  inline memory_region_t pinned_register(const void* target, size_t target_len, bool read_only = false)
+  {
+    auto  mr = acquire(target, target_len, read_only);
+    auto &e  = _entries.at(mr);
+    if (e.pinned)
+      --e.refs; /* one reference stands for every pinned_register of the region */
+    else
+      e.pinned = true;
+    return mr;
+  }
+
+  /**
+   * Find a registration made by pinned_register which covers a range;
+   * unlike ondemand registrations it stays valid for the connection
+   *
+   * @param target Pointer to start or region
+   * @param target_len Region length in bytes
+   * @param read_only Find a registration made with read_only set
+   *
+   * @return Memory region handle or nullptr
+   */
+  memory_region_t pinned_region(const void* target, size_t target_len, bool read_only = false)
+  {
+    apply_forget();
+    const auto start = reinterpret_cast<std::uintptr_t>(target);
+    interval_t found;
+    return find_covering(start, start + target_len - 1, found, read_only, true) ? found.value : nullptr;
+  }
+
+  /**
+   * Drop the reference taken by ondemand_register
+   *
+   * @param target Pointer passed to ondemand_register; other pointers are ignored
+   */
+  void ondemand_release(const void* target)
+  {
+    auto it = _held.find(target);
+    if (it == _held.end()) return;
+    auto mr = it->second;
+    _held.erase(it);
+
+    auto &e = _entries.at(mr);
+    assert(e.refs != 0);
+    if (--e.refs == 0) {
+      if (e.retired) {
+        drop(_entries.find(mr));
+        return;
+      }
+      e.lru = _lru.insert(_lru.begin(), mr);
+      evict();
+    }
+  }
+
+  /**
+   * Drop registrations of memory about to be unmapped (e.g. a closing
+   * pool), pinned or not, since a later mapping may reuse the addresses.
+   * May be called from any thread; takes effect before the next lookup.
+   *
+   * @param regions Memory ranges
+   */
+  void forget_regions(const std::vector<::iovec>& regions)
+  {
+    std::lock_guard<std::mutex> g(_forget_lock);
+    _forget.insert(_forget.end(), regions.begin(), regions.end());
+    _forget_pending.store(true, std::memory_order_release);
+  }
+
+  /* evict while the shard is over its budget, which other connections may have filled */
+  void trim_regions()
+  {
+    apply_forget();
+    evict();
+  }
+
+  const Stats &mr_cache_stats() const { return _stats; }
+
  private:
-  Connection*               _conn;
-  std::set<memory_region_t> _reg;
+  memory_region_t acquire(const void* target, size_t target_len, bool read_only = false)
+  {
+    assert(target_len);
+    apply_forget();
+    const auto start = reinterpret_cast<std::uintptr_t>(target);
+    const auto stop  = start + target_len - 1;
+
+    interval_t found;
+    if (find_covering(start, stop, found, read_only)) {
+      ++_stats.hits;
+      auto &e = _entries.at(found.value);
+      if (e.refs++ == 0) _lru.erase(e.lru);
+      return found.value;
+    }
+
+    ++_stats.misses;
+    auto mr = _conn->register_memory(target, target_len, 0, read_only ? FI_REMOTE_READ : 0);
+    _entries.emplace(mr, entry_t{interval_t(start, stop, mr), 1, _lru.end(), false, false, read_only});
+    _unindexed.emplace_back(start, stop, mr);
+    _stats.pinned_bytes += target_len;
+    _budget.add(target_len);
+    evict();
+    return mr;
+  }
+
+  void apply_forget()
+  {
+    if (!_forget_pending.load(std::memory_order_acquire)) return;
+
+    std::vector<::iovec> regions;
+    {
+      std::lock_guard<std::mutex> g(_forget_lock);
+      regions.swap(_forget);
+      _forget_pending.store(false, std::memory_order_relaxed);
+    }
+
+    for (auto &r : regions) {
+      const auto start = reinterpret_cast<std::uintptr_t>(r.iov_base);
+      const auto stop  = start + r.iov_len - 1;
+      for (auto it = _entries.begin(); it != _entries.end();) {
+        auto &e = it->second;
+        if (e.retired || e.range.stop < start || stop < e.range.start) {
+          ++it;
+          continue;
+        }
+        const bool on_lru = e.refs == 0;
+        if (e.pinned) {
+          e.pinned = false;
+          --e.refs;
+        }
+        if (e.refs == 0) {
+          if (on_lru) _lru.erase(e.lru);
+          it = drop(it);
+        }
+        else {
+          e.retired = true; /* still in use by an IO; deregistered on release */
+          ++it;
+        }
+      }
+    }
+  }
+
+  bool is_live(const interval_t &i, bool read_only, bool pinned_only) const
+  {
+    auto it = _entries.find(i.value);
+    /* a region handle may be reused by a later registration of a different range */
+    return it != _entries.end() && it->second.range.start == i.start && it->second.range.stop == i.stop &&
+           !it->second.retired && it->second.read_only == read_only && (!pinned_only || it->second.pinned);
+  }
+
+  bool find_covering(std::uintptr_t start,
+                     std::uintptr_t stop,
+                     interval_t &   found,
+                     bool           read_only,
+                     bool           pinned_only = false)
+  {
+    if (REBUILD_THRESHOLD < _unindexed.size() || _entries.size() < _stale) {
+      rebuild();
+    }
+
+    for (auto it = _unindexed.rbegin(); it != _unindexed.rend(); ++it) {
+      if (it->start <= start && stop <= it->stop && is_live(*it, read_only, pinned_only)) {
+        found = *it;
+        return true;
+      }
+    }
+
+    return _tree->find_covering(start, stop, found, [this, read_only, pinned_only](const interval_t &i) {
+      return is_live(i, read_only, pinned_only);
+    });
+  }
+
+  void rebuild()
+  {
+    std::vector<interval_t> v;
+    v.reserve(_entries.size());
+    for (auto &e : _entries) v.push_back(e.second.range);
+    _tree.reset(new interval_tree_t(v));
+    _unindexed.clear();
+    _stale = 0;
+  }
+
+  /* deregister least recently used, unreferenced regions until the shard is within budget */
+  void evict()
+  {
+    while (_budget.exceeded() && !_lru.empty()) {
+      auto mr = _lru.back();
+      _lru.pop_back();
+      auto it = _entries.find(mr);
+      assert(it != _entries.end());
+      drop(it);
+      ++_stats.evictions;
+    }
+  }
+
+  /* deregister an unreferenced region which is not on the LRU list */
+  std::unordered_map<memory_region_t, entry_t>::iterator drop(std::unordered_map<memory_region_t, entry_t>::iterator it)
+  {
+    const auto mr  = it->first;
+    const auto len = it->second.range.stop - it->second.range.start + 1;
+    _stats.pinned_bytes -= len;
+    _budget.remove(len);
+    ++_stale;
+    it = _entries.erase(it);
+    _conn->deregister_memory(mr);
+    return it;
+  }
+
+  Connection*                                                  _conn;
+  Region_budget&                                               _budget;
+  std::unordered_map<memory_region_t, entry_t>                 _entries;
+  std::list<memory_region_t>                                   _lru; /* unreferenced regions, most recent first */
+  std::unordered_multimap<const void*, memory_region_t>        _held; /* references held by ondemand_register */
+  std::unique_ptr<interval_tree_t>                             _tree;
+  std::vector<interval_t>                                      _unindexed; /* registered since the last rebuild */
+  size_t                                                       _stale;     /* evicted since the last rebuild */
+  Stats                                                        _stats;
+  std::mutex                                                   _forget_lock;
+  std::vector<::iovec>                                         _forget; /* ranges from forget_regions, not yet applied */
+  std::atomic<bool>                                            _forget_pending;
 };
 }  // namespace mcas
 
@@ -17,6 +17,8 @@
 
 #include <api/components.h>
 #include <api/kvindex_itf.h>
+#include <common/chksum.h>
+#include <common/cycles.h>
 #include <common/dump_utils.h>
 #include <common/utils.h>
 #include <common/str_utils.h>
@@ -32,7 +34,12 @@
 #include <gperftools/profiler.h>
 #endif
 
+#include <poll.h>
+#include <unistd.h>
+
 #include <algorithm> /* remove */
+#include <chrono>
+#include <iomanip>
 #include <sstream>
 
 using namespace mcas;
@@ -65,6 +72,14 @@ void Shard::thread_entry(const std::string &backend,
   try {
     initialize_components(backend, index, pci_addr, dax_config, pm_path, debug_level, ado_cores, ado_core_num);
 
+    if (_worker_count > 0) {
+      /* UIPC channels to ADO processes are single-producer */
+      if (ado_enabled())
+        PWRN("Shard: worker_threads ignored, not supported with ADO");
+      else
+        start_workers();
+    }
+
     main_loop();
   }
   catch (General_exception e) {
@@ -95,6 +110,8 @@ void Shard::initialize_components(const std::string &backend,
       comp = load_component("libcomponent-hstore.so", hstore_factory);
     else if (backend == "hstore-cc")
       comp = load_component("libcomponent-hstore-cc.so", hstore_factory);
+    else if (backend == "hstore-mt")
+      comp = load_component("libcomponent-hstore-mt.so", hstore_factory);
     else
       throw General_exception("invalid backend (%s)", backend.c_str());
 
@@ -105,7 +122,7 @@ void Shard::initialize_components(const std::string &backend,
     auto fact = static_cast<IKVStore_factory *>(comp->query_interface(IKVStore_factory::iid()));
     assert(fact);
 
-    if (backend == "hstore" || backend == "hstore-cc") {
+    if (backend == "hstore" || backend == "hstore-cc" || backend == "hstore-mt") {
       if (dax_config.empty()) throw General_exception("hstore backend requires dax configuration");
 
       _i_kvstore            = fact->create("owner", "name", dax_config);
@@ -142,6 +159,431 @@ void Shard::initialize_components(const std::string &backend,
   }
 }
 
+/* per-worker statistics; null on the shard thread itself */
+static thread_local Component::IMCAS::Shard_stats *worker_stats = nullptr;
+static thread_local mcas::Shard_latency *          worker_latency = nullptr;
+static thread_local mcas::Stats_snapshot *         worker_snapshot = nullptr;
+
+inline Component::IMCAS::Shard_stats &Shard::stats() { return worker_stats ? *worker_stats : _stats; }
+
+inline void Shard::record_latency(const unsigned op, const unsigned kind, const cpu_time_t cycles)
+{
+  (worker_latency ? *worker_latency : _latency).hist[op][kind].record(cycles);
+}
+
+/* latency class of a pending message */
+static unsigned latency_op_class(const mcas::Protocol::Message *msg)
+{
+  using namespace mcas::Protocol;
+  switch (msg->type_id) {
+    case MSG_TYPE_IO_REQUEST:
+      switch (msg->op) {
+        case OP_PUT:
+        case OP_PUT_ADVANCE:
+        case OP_PUT_SEGMENT:
+          return Component::IMCAS::STATS_OP_PUT;
+        case OP_GET:
+          return Component::IMCAS::STATS_OP_GET;
+        case OP_ERASE:
+          return Component::IMCAS::STATS_OP_ERASE;
+        default:
+          return Component::IMCAS::STATS_OP_OTHER;
+      }
+    case MSG_TYPE_IO_BATCH_REQUEST:
+      return Component::IMCAS::STATS_OP_BATCH;
+    case MSG_TYPE_ADO_REQUEST:
+    case MSG_TYPE_PUT_ADO_REQUEST:
+    case MSG_TYPE_ADO_BATCH_REQUEST:
+      return Component::IMCAS::STATS_OP_ADO;
+    default:
+      return Component::IMCAS::STATS_OP_OTHER;
+  }
+}
+
+void Shard::publish_stats()
+{
+  auto &s = worker_snapshot ? *worker_snapshot : _shard_snapshot;
+  std::lock_guard<std::mutex> g(s.lock);
+  s.stats   = stats();
+  s.latency = worker_latency ? *worker_latency : _latency;
+}
+
+Component::IMCAS::Shard_stats Shard::aggregate_stats()
+{
+  using Component::IMCAS;
+
+  publish_stats(); /* this thread's counts as of now, the others' as last published */
+
+  IMCAS::Shard_stats             result;
+  std::unique_ptr<Shard_latency> latency(new Shard_latency());
+  {
+    std::lock_guard<std::mutex> g(_shard_snapshot.lock);
+    result   = _shard_snapshot.stats;
+    *latency = _shard_snapshot.latency;
+  }
+
+  for (auto &w : _worker_snapshots) {
+    std::lock_guard<std::mutex> g(w->lock);
+    result.op_request_count += w->stats.op_request_count;
+    result.op_put_count += w->stats.op_put_count;
+    result.op_get_count += w->stats.op_get_count;
+    result.op_put_direct_count += w->stats.op_put_direct_count;
+    result.op_get_twostage_count += w->stats.op_get_twostage_count;
+    result.op_ado_count += w->stats.op_ado_count;
+    result.op_erase_count += w->stats.op_erase_count;
+    result.op_failed_request_count += w->stats.op_failed_request_count;
+    result.op_batch_count += w->stats.op_batch_count;
+    result.busy_cycles += w->stats.busy_cycles;
+    result.idle_cycles += w->stats.idle_cycles;
+    for (unsigned op = 0; op < IMCAS::STATS_OP_COUNT; op++)
+      for (unsigned kind = 0; kind < IMCAS::STATS_LATENCY_COUNT; kind++)
+        latency->hist[op][kind].merge(w->latency.hist[op][kind]);
+  }
+
+  const double cycles_per_ns = double(Common::get_rdtsc_frequency_mhz()) / 1000.0;
+  for (unsigned op = 0; op < IMCAS::STATS_OP_COUNT; op++)
+    for (unsigned kind = 0; kind < IMCAS::STATS_LATENCY_COUNT; kind++)
+      result.latency[op][kind] = latency->hist[op][kind].summary(cycles_per_ns);
+
+  return result;
+}
+
+void Shard::publish_metrics()
+{
+  Shard_metrics m;
+  m.stats      = aggregate_stats();
+  m.core       = _core;
+  m.port       = _port;
+  m.task_count = _task_count.load();
+  m.buffer_pool_bytes = buffer_pool().allocated();
+
+  {
+    /* pool requests run under the admin lock in worker mode */
+    auto                        g = shared_guard(_admin_lock);
+    std::lock_guard<std::mutex> hg(_handlers_lock);
+    std::set<pool_t>            pools;
+
+    m.session_count = _handlers.size();
+    for (auto h : _handlers) {
+      m.buffers_in_use += h->buffers_in_use();
+      m.buffers_total += h->buffer_count();
+      for (auto &p : h->pool_manager().open_pool_set()) {
+        if (!pools.insert(p.first).second) continue;
+        uint64_t     obj_count = 0;
+        size_t       size      = 0;
+        unsigned int flags     = 0;
+        h->pool_manager().get_pool_info(p.first, obj_count, size, flags);
+        m.open_pool_bytes += size;
+      }
+    }
+    m.open_pool_count = pools.size();
+  }
+
+  /* ADO state belongs to the shard thread, and workers exclude ADO */
+  if (!_scheduler) {
+    m.ado_process_count    = _ado_map.size();
+    m.ado_outstanding_work = _outstanding_work.size();
+  }
+
+  _metrics.publish(m);
+}
+
+std::unique_lock<std::mutex> Shard::store_guard(const pool_t pool)
+{
+  if (!_scheduler || !_store_serialized) return std::unique_lock<std::mutex>();
+
+  if (_store_thread_model == Component::IKVStore::THREAD_MODEL_UNSAFE) return std::unique_lock<std::mutex>(_store_lock);
+
+  /* THREAD_MODEL_SINGLE_PER_POOL */
+  std::mutex *m;
+  {
+    std::lock_guard<std::mutex> g(_pool_locks_lock);
+    auto &                      p = _pool_locks[pool];
+    if (!p) p.reset(new std::mutex);
+    m = p.get();
+  }
+  return std::unique_lock<std::mutex>(*m);
+}
+
+void Shard::start_workers()
+{
+  using namespace Component;
+
+  std::vector<int> cores;
+  if (!_worker_cores.empty()) {
+    cpu_mask_t mask;
+    if (string_to_mask(_worker_cores, mask) != S_OK)
+      throw General_exception("bad shard worker_cores (%s)", _worker_cores.c_str());
+    for (int c = 0; c < CPU_SETSIZE; c++)
+      if (mask.check_core(c)) cores.push_back(c);
+  }
+
+  _store_thread_model = _i_kvstore->thread_safety();
+  _store_serialized   = (_store_thread_model == IKVStore::THREAD_MODEL_UNSAFE) ||
+                      (_store_thread_model == IKVStore::THREAD_MODEL_SINGLE_PER_POOL);
+
+  _scheduler.reset(new Handler_scheduler(_worker_count));
+
+  for (unsigned i = 0; i < _worker_count; i++) {
+    _worker_stats.emplace_back(new IMCAS::Shard_stats());
+    _worker_latency.emplace_back(new Shard_latency());
+    _worker_snapshots.emplace_back(new Stats_snapshot());
+  }
+
+  for (unsigned i = 0; i < _worker_count; i++) {
+    const int core = cores.empty() ? -1 : cores[i % cores.size()];
+    _workers.emplace_back(&Shard::worker_loop, this, i, core);
+  }
+
+  PMAJOR("Shard: %u worker threads (store thread model %d%s)", _worker_count, _store_thread_model,
+         _store_serialized ? ", serialized" : "");
+}
+
+void Shard::worker_loop(const unsigned worker_id, const int core)
+{
+  std::ostringstream ss;
+  ss << "shard-" << _core << "-w" << worker_id;
+  pthread_setname_np(pthread_self(), ss.str().c_str());
+
+  if (core >= 0) {
+    cpu_mask_t mask;
+    mask.add_core(core);
+    set_cpu_affinity_mask(mask);
+  }
+
+  worker_stats    = _worker_stats[worker_id].get();
+  worker_latency  = _worker_latency[worker_id].get();
+  worker_snapshot = _worker_snapshots[worker_id].get();
+
+  const double     mhz            = double(Common::get_rdtsc_frequency_mhz());
+  const cpu_time_t spin_cycles    = static_cast<cpu_time_t>(double(_poll_spin_usec) * mhz);
+  const cpu_time_t publish_cycles = static_cast<cpu_time_t>(double(METRICS_PUBLISH_USEC) * mhz);
+
+  unsigned   idle         = 0;
+  cpu_time_t last_work    = rdtsc();
+  cpu_time_t last_publish = 0;
+  while (_thread_exit == false) {
+    const cpu_time_t start = rdtsc();
+    if (start - last_publish > publish_cycles) {
+      publish_stats();
+      last_publish = start;
+    }
+
+    auto handler = _scheduler->acquire(worker_id);
+
+    if (handler == nullptr) {
+      /* no runnable sessions; handlers may be spread over other workers
+         so there is no single completion queue to block on */
+      if (start - last_work > spin_cycles) usleep(WORKER_IDLE_SLEEP_USEC);
+      worker_stats->idle_cycles += rdtsc() - start;
+      continue;
+    }
+
+    idle            = 1;
+    const bool done = service_handler(handler, idle);
+
+    const cpu_time_t end = rdtsc();
+    if (idle == 0) {
+      worker_stats->busy_cycles += end - start;
+      last_work = end;
+    }
+    else {
+      worker_stats->idle_cycles += end - start;
+    }
+
+    if (done) {
+      {
+        std::lock_guard<std::mutex> g(_handlers_lock);
+        _handlers.erase(std::remove(_handlers.begin(), _handlers.end(), handler), _handlers.end());
+      }
+      if (_debug_level > 1) PLOG("Worker %u deleting handler (%p)", worker_id, static_cast<const void *>(handler));
+      delete handler;
+    }
+    else {
+      _scheduler->release(worker_id, handler);
+    }
+  }
+
+  publish_stats();
+  if (_debug_level > 1) PLOG("Shard:%u worker %u exited", _core, worker_id);
+}
+
+void Shard::close_session_pools(Connection_handler *handler)
+{
+  auto g = shared_guard(_admin_lock);
+
+  /* unfinished segmented puts would otherwise leave their values locked */
+  while (!handler->segmented_puts().empty()) {
+    const auto pool_id = handler->segmented_puts().begin()->first.first;
+    auto       sg      = store_guard(pool_id);
+    abandon_segmented_puts(handler, pool_id);
+  }
+
+  for (auto &p : handler->pool_manager().open_pool_set()) {
+    auto pool_id = p.first;
+    /* close ADO process on pool close */
+    if (ado_enabled()) {
+      auto ado_itf = get_ado_interface(pool_id);
+      ado_itf->shutdown();
+      ado_itf->release_ref();
+      _ado_map.erase(pool_id);
+    }
+
+    auto sg = store_guard(pool_id);
+    forget_pool_regions(pool_id);
+    _i_kvstore->close_pool(pool_id);
+    /* for debugging we force exit after pool closure */
+  }
+}
+
+bool Shard::service_handler(Connection_handler *handler, unsigned &idle)
+{
+  using namespace mcas::Protocol;
+
+  Connection_handler::action_t action;
+  bool                         close = false;
+
+  /* issue tick, unless we are stalling */
+  auto tick_response = handler->tick();
+
+  /* close session */
+  if (tick_response == mcas::Connection_handler::TICK_RESPONSE_CLOSE) {
+    idle = 0;
+
+    /* close all open pools belonging to session  */
+    if (_debug_level > 1) PLOG("Shard: forcing pool closures");
+
+    if (_forced_exit) {
+      PLOG("Shard: forcing exit..");
+      _thread_exit = true;
+    }
+
+    close_session_pools(handler);
+    if (ado_enabled()) forget_ado_requests(handler);
+
+    if (_debug_level > 1) PMAJOR("Shard: closing connection %p", static_cast<const void *>(handler));
+    close = true;
+  }
+
+  /* process ALL deferred actions */
+  while (handler->get_pending_action(action)) {
+    idle = 0;
+    switch (action.op) {
+      case Connection_handler::ACTION_RELEASE_VALUE_LOCK:
+        if (_debug_level > 2) PLOG("releasing value lock (%p)", action.parm);
+        release_locked_value(action.parm);
+        release_pending_rename(action.parm);
+        handler->ondemand_release(action.parm);
+        break;
+      default:
+        throw Logic_exception("unknown action type");
+    }
+  }
+
+  /* A process which cannot handle the top queue message due to
+   * lack of resource may throw resource_unavailable, which will
+   * leave the Protocol::Message on the queue for later
+   * handling.
+   */
+  try {
+    /* collect ALL available messages */
+    while (Protocol::Message *p_msg = handler->peek_pending_msg()) {
+      idle = 0;
+      assert(p_msg);
+      const cpu_time_t start    = rdtsc();
+      const unsigned   op_class = latency_op_class(p_msg);
+      switch (p_msg->type_id) {
+        case MSG_TYPE_IO_REQUEST: {
+          auto msg = static_cast<Protocol::Message_IO_request *>(p_msg);
+          auto g   = store_guard(msg->pool_id);
+          process_message_IO_request(handler, msg);
+          break;
+        }
+        case MSG_TYPE_IO_BATCH_REQUEST: {
+          auto msg = static_cast<Protocol::Message_IO_batch_request *>(p_msg);
+          auto g   = store_guard(msg->pool_id);
+          process_message_IO_batch_request(handler, msg);
+          break;
+        }
+        case MSG_TYPE_SCAN_REQUEST: {
+          auto msg = static_cast<Protocol::Message_scan_request *>(p_msg);
+          auto g   = store_guard(msg->pool_id);
+          process_scan_request(handler, msg);
+          break;
+        }
+        case MSG_TYPE_ADO_REQUEST:
+          process_ado_request(handler, static_cast<Protocol::Message_ado_request *>(p_msg));
+          break;
+        case MSG_TYPE_PUT_ADO_REQUEST:
+          process_put_ado_request(handler, static_cast<Protocol::Message_put_ado_request *>(p_msg));
+          break;
+        case MSG_TYPE_ADO_BATCH_REQUEST:
+          process_ado_batch_request(handler, static_cast<Protocol::Message_ado_batch_request *>(p_msg));
+          break;
+        case MSG_TYPE_POOL_REQUEST: {
+          auto msg = static_cast<Protocol::Message_pool_request *>(p_msg);
+          auto g   = shared_guard(_admin_lock);
+          auto sg  = store_guard(msg->pool_id);
+          process_message_pool_request(handler, msg);
+          break;
+        }
+        case MSG_TYPE_INFO_REQUEST: {
+          auto msg = static_cast<Protocol::Message_INFO_request *>(p_msg);
+          auto g   = store_guard(msg->pool_id);
+          process_info_request(handler, msg);
+          break;
+        }
+        default:
+          throw General_exception("unrecognizable message type");
+      }
+      const cpu_time_t recv_tsc = handler->pending_msg_tsc();
+      handler->free_buffer(handler->pop_pending_msg());  // recv_buffer();
+      record_latency(op_class, Component::IMCAS::STATS_LATENCY_QUEUE, start - recv_tsc);
+      record_latency(op_class, Component::IMCAS::STATS_LATENCY_SERVICE, rdtsc() - start);
+      /* send_buffer may have been consumed. Refresh it. */
+    }
+  }
+  catch (const resource_unavailable &e) {
+    PLOG("short of buffers in 'handler' processing: %s", e.what());
+  }
+
+  /* in worker mode, tasks are run by the worker that owns the handler */
+  if (_scheduler && _task_count.load(std::memory_order_relaxed) > 0) process_tasks(idle, handler);
+
+  return close;
+}
+
+void Shard::wait_for_activity()
+{
+  /* don't block with work still owed to clients */
+  if (!_tasks.empty() || !_outstanding_work.empty() || !_deferred_ado_responses.empty()) return;
+
+  const unsigned timeout_ms = ado_enabled() ? std::min(_poll_block_msec, ADO_MAX_BLOCK_MSEC) : _poll_block_msec;
+
+  if (_handlers.empty()) {
+    usleep(timeout_ms * 1000);
+    return;
+  }
+
+  if (_handlers.size() == 1) {
+    _handlers[0]->wait_for_next_completion(std::chrono::milliseconds(timeout_ms));
+    return;
+  }
+
+  /* wait on the completion queues of every session at once; if any
+     session may already have completions queued, poll instead */
+  std::vector<int> fds;
+  for (auto h : _handlers) {
+    if (!h->prepare_wait(fds)) return;
+  }
+
+  std::vector<pollfd> pfds;
+  pfds.reserve(fds.size());
+  for (auto fd : fds) pfds.push_back(pollfd{fd, POLLIN | POLLOUT | POLLPRI, 0});
+  if (::poll(pfds.data(), pfds.size(), int(timeout_ms)) == -1 && errno != EINTR)
+    PWRN("Shard: poll on completion queues failed (%s)", strerror(errno));
+}
+
 void Shard::main_loop()
 {
   using namespace mcas::Protocol;
@@ -155,116 +597,57 @@ void Shard::main_loop()
   ProfilerStart("shard_main_loop");
 #endif
 
-  static constexpr uint64_t CHECK_CONNECTION_INTERVAL = 10000000;
+  const double     mhz            = double(Common::get_rdtsc_frequency_mhz());
+  const cpu_time_t publish_cycles = static_cast<cpu_time_t>(double(METRICS_PUBLISH_USEC) * mhz);
+  cpu_time_t       last_publish   = 0;
 
-  Connection_handler::action_t action;
+  if (_scheduler) {
+    /* workers service the sessions; this thread only admits new ones */
+    while (_thread_exit == false) {
+      check_for_new_connections();
+      _stats.client_count = boost::numeric_cast<uint16_t>(session_count());
+      if (rdtsc() - last_publish > publish_cycles) {
+        publish_metrics();
+        last_publish = rdtsc();
+      }
+      usleep(WORKER_ACCEPT_INTERVAL_USEC);
+    }
 
-  unsigned idle            = 0;
-  uint64_t tick alignas(8) = 0;
+    for (auto &w : _workers) w.join();
+  }
 
-  for (; _thread_exit == false; ++idle, ++tick) {
-    /* check for new connections - but not too often */
-    if (tick % CHECK_CONNECTION_INTERVAL == 0) check_for_new_connections();
+  const cpu_time_t spin_cycles  = static_cast<cpu_time_t>(double(_poll_spin_usec) * mhz);
+  const cpu_time_t check_cycles = static_cast<cpu_time_t>(double(CONNECTION_CHECK_USEC) * mhz);
+  cpu_time_t       last_work    = rdtsc();
+  cpu_time_t       last_check   = 0;
 
-#ifdef IDLE_CHECK
-    if (idle > 1000) usleep(100000);
-#endif
+  if (_debug_level > 1) PLOG("Shard: polling spin=%uus block=%ums", _poll_spin_usec, _poll_block_msec);
+
+  while (_thread_exit == false) {
+    const cpu_time_t start = rdtsc();
+    unsigned         idle  = 1; /* zeroed by any unit of work */
 
-    /* if there are no sessions, sleep thread */
-    if (_handlers.empty()) {
-      usleep(500000);
+    /* check for new connections - time based, so also while busy */
+    if (start - last_check > check_cycles) {
+      auto before = _handlers.size();
       check_for_new_connections();
+      if (_handlers.size() != before) idle = 0;
+      last_check = start;
     }
-    else {
+
+    if (start - last_publish > publish_cycles) {
+      publish_metrics();
+      last_publish = start;
+    }
+
+    if (!_handlers.empty()) {
       std::vector<Connection_handler *> pending_close;
 
       _stats.client_count = boost::numeric_cast<uint16_t>(_handlers.size()); /* update stats client count */
 
       /* iterate connection handlers (each connection is a client session) */
       for (const auto handler : _handlers) {
-        /* issue tick, unless we are stalling */
-        auto tick_response = handler->tick();
-
-        /* close session */
-        if (tick_response == mcas::Connection_handler::TICK_RESPONSE_CLOSE) {
-          idle = 0;
-
-          /* close all open pools belonging to session  */
-          if (_debug_level > 1) PLOG("Shard: forcing pool closures");
-
-          if (_forced_exit) {
-            PLOG("Shard: forcing exit..");
-            _thread_exit = true;
-          }
-
-          for (auto &p : handler->pool_manager().open_pool_set()) {
-            auto pool_id = p.first;
-            /* close ADO process on pool close */
-            if (ado_enabled()) {
-              auto ado_itf = get_ado_interface(pool_id);
-              ado_itf->shutdown();
-              ado_itf->release_ref();
-              _ado_map.erase(pool_id);
-            }
-
-            _i_kvstore->close_pool(pool_id);
-            /* for debugging we force exit after pool closure */
-          }
-
-          if (_debug_level > 1) PMAJOR("Shard: closing connection %p", static_cast<const void *>(handler));
-          pending_close.push_back(handler);
-        }
-
-        /* process ALL deferred actions */
-        while (handler->get_pending_action(action)) {
-          idle = 0;
-          switch (action.op) {
-            case Connection_handler::ACTION_RELEASE_VALUE_LOCK:
-              if (_debug_level > 2) PLOG("releasing value lock (%p)", action.parm);
-              release_locked_value(action.parm);
-              release_pending_rename(action.parm);
-              break;
-            default:
-              throw Logic_exception("unknown action type");
-          }
-        }
-
-        /* A process which cannot handle the top queue message due to
-         * lack of resource may throw resource_unavailable, which will
-         * leave the Protocol::Message on the queue for later
-         * handling.
-         */
-        try {
-          /* collect ALL available messages */
-          while (Protocol::Message *p_msg = handler->peek_pending_msg()) {
-            idle = 0;
-            assert(p_msg);
-            switch (p_msg->type_id) {
-              case MSG_TYPE_IO_REQUEST:
-                process_message_IO_request(handler, static_cast<Protocol::Message_IO_request *>(p_msg));
-                break;
-              case MSG_TYPE_ADO_REQUEST:
-                process_ado_request(handler, static_cast<Protocol::Message_ado_request *>(p_msg));
-                break;
-              case MSG_TYPE_PUT_ADO_REQUEST:
-                process_put_ado_request(handler, static_cast<Protocol::Message_put_ado_request *>(p_msg));
-                break;
-              case MSG_TYPE_POOL_REQUEST:
-                process_message_pool_request(handler, static_cast<Protocol::Message_pool_request *>(p_msg));
-                break;
-              case MSG_TYPE_INFO_REQUEST:
-                process_info_request(handler, static_cast<Protocol::Message_INFO_request *>(p_msg));
-                break;
-              default:
-                throw General_exception("unrecognizable message type");
-            }
-            handler->free_buffer(handler->pop_pending_msg());  // recv_buffer();
-            /* send_buffer may have been consumed. Refresh it. */
-          }
-        }
-        catch (const resource_unavailable &e) {
-          PLOG("short of buffers in 'handler' processing: %s", e.what());
-        }
+        if (service_handler(handler, idle)) pending_close.push_back(handler);
       }
 
       /* handle messages send back from ADO */
@@ -291,6 +674,21 @@ void Shard::main_loop()
         if (_debug_level > 1) PLOG("# remaining handlers (%lu)", _handlers.size());
       }
     }
+
+    cpu_time_t end = rdtsc();
+    if (idle == 0) {
+      _stats.busy_cycles += end - start;
+      last_work = end;
+      continue;
+    }
+
+    /* spin for a while after the last activity, then block */
+    if (end - last_work > spin_cycles) {
+      wait_for_activity();
+      if (_handlers.empty()) last_check = 0; /* check straight after the nap */
+      end = rdtsc();
+    }
+    _stats.idle_cycles += end - start;
   }
 
   if (_debug_level > 1) PMAJOR("Shard (%p) exited", static_cast<const void *>(this));
@@ -308,7 +706,7 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
   assert(msg->op);
 
   /* allocate response buffer */
-  auto response_iob = handler->allocate();
+  auto response_iob = handler->allocate(sizeof(Protocol::Message_pool_response));
   assert(response_iob);
   assert(response_iob->base());
   memset(response_iob->iov->iov_base, 0, response_iob->iov->iov_len);
@@ -351,6 +749,7 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
       else {
         /* register pool handle */
         pool_mgr.register_pool(pool_name, pool, msg->expected_object_count, msg->pool_size, msg->flags);
+        load_index_generation(pool);
 
         response->pool_id = pool;
         response->set_status(S_OK);
@@ -365,7 +764,7 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
         for (auto &r : regions) {
           if (_debug_level > 1) PLOG("region: %p %lu MiB", r.iov_base, REDUCE_MB(r.iov_len));
           /* pre-register memory region with RDMA */
-          handler->ondemand_register(r.iov_base, r.iov_len);
+          handler->pinned_register(r.iov_base, r.iov_len);
         }
       }
       else {
@@ -405,6 +804,7 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
       else {
         /* register pool handle */
         pool_mgr.register_pool(pool_name, pool, 0, 0, msg->flags);
+        load_index_generation(pool);
         response->pool_id = pool;
       }
     }
@@ -427,6 +827,10 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
       if (pool_mgr.release_pool_reference(msg->pool_id)) {
         if (_debug_level > 1) PLOG("Shard: pool reference now zero. pool_id=%lx", msg->pool_id);
 
+        close_index(msg->pool_id);
+        close_leases(msg->pool_id);
+        abandon_segmented_puts(handler, msg->pool_id);
+
         /* close ADO process on pool close */
         if (ado_enabled()) {
           auto ado_itf = get_ado_interface(msg->pool_id);
@@ -436,6 +840,7 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
           _ado_map.erase(msg->pool_id);
         }
 
+        forget_pool_regions(msg->pool_id);
         auto rc = _i_kvstore->close_pool(msg->pool_id);
         if (_debug_level) PLOG("Shard: close_pool result:%d", rc);
         response->set_status(rc);
@@ -458,6 +863,13 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
 
           if (!pool_mgr.release_pool_reference(msg->pool_id)) throw Logic_exception("unexpected pool reference count");
 
+          close_index(msg->pool_id);
+          close_leases(msg->pool_id);
+          abandon_segmented_puts(handler, msg->pool_id);
+          forget_pool_regions(msg->pool_id); /* before the ADO, if any, closes the pool */
+          auto index_path = index_file(pool_name);
+          if (!index_path.empty()) ::unlink(index_path.c_str());
+
           /* notify ADO if needed */
           if (ado_enabled()) {
             auto ado_itf = get_ado_interface(msg->pool_id);
@@ -498,6 +910,8 @@ void Shard::process_message_pool_request(Connection_handler *handler, Protocol::
         response->set_status(IKVStore::E_ALREADY_OPEN);
       }
       else {
+        auto index_path = index_file(pool_name);
+        if (!index_path.empty()) ::unlink(index_path.c_str());
         response->set_status(_i_kvstore->delete_pool(msg->pool_name()));
       }
     }
@@ -517,6 +931,7 @@ void Shard::add_locked_value(const pool_t pool_id,
                              Component::IKVStore::key_t key,
                              void *target, size_t target_len)
 {
+  auto g = shared_guard(_locked_values_lock);
   auto i = _locked_values.find(target);
   if (i == _locked_values.end()) {
     _locked_values[target] = {pool_id, key, 1, target_len};
@@ -526,25 +941,98 @@ void Shard::add_locked_value(const pool_t pool_id,
   }
 }
 
+Connection_base::memory_region_t Shard::lease_region(Connection_handler *handler,
+                                                     const pool_t        pool_id,
+                                                     const void *        target,
+                                                     size_t              target_len)
+{
+  {
+    auto g = shared_guard(_lease_pools_lock);
+    if (_lease_pools.count(pool_id) == 0) return nullptr;
+  }
+
+  /* the pool's own registration allows remote writes; clients get the key
+     of a separate, remote-read-only one */
+  if (auto region = handler->pinned_region(target, target_len, true)) return region;
+
+  /* registered on first use, and again once the pool has grown */
+  std::vector<::iovec> regions;
+  if (_i_kvstore->get_pool_regions(pool_id, regions) != S_OK) return nullptr;
+  for (auto &r : regions) handler->pinned_register(r.iov_base, r.iov_len, true);
+
+  return handler->pinned_region(target, target_len, true);
+}
+
+void Shard::close_leases(const pool_t pool_id)
+{
+  auto g = shared_guard(_lease_pools_lock);
+  _lease_pools.erase(pool_id);
+}
+
+Connection_base::memory_region_t Shard::lease_version_region(Connection_handler *handler)
+{
+  const auto len = LEASE_VERSION_SLOTS * sizeof(_lease_versions[0]);
+  if (auto region = handler->pinned_region(_lease_versions.get(), len, true)) return region;
+  return handler->pinned_register(_lease_versions.get(), len, true);
+}
+
+void Shard::abandon_segmented_put(Connection_handler *handler, const pool_t pool_id, const std::string &key)
+{
+  auto &puts = handler->segmented_puts();
+  auto  i    = puts.find(std::make_pair(pool_id, key));
+  if (i == puts.end()) return;
+
+  if (_debug_level > 1) PLOG("Shard: abandoning segmented put of (%s)", key.c_str());
+  _i_kvstore->unlock(pool_id, i->second.key_handle);
+  _i_kvstore->erase(pool_id, "___pending_" + key); /* partial value */
+  puts.erase(i);
+}
+
+void Shard::abandon_segmented_puts(Connection_handler *handler, const pool_t pool_id)
+{
+  auto &puts = handler->segmented_puts();
+  auto  i    = puts.lower_bound(std::make_pair(pool_id, std::string()));
+  while (i != puts.end() && i->first.first == pool_id) {
+    const auto key = (i++)->first.second;
+    abandon_segmented_put(handler, pool_id, key);
+  }
+}
+
+void Shard::forget_pool_regions(const pool_t pool_id)
+{
+  /* a pool mapped later may reuse the addresses */
+  std::vector<::iovec> regions;
+  if (_i_kvstore->get_pool_regions(pool_id, regions) != S_OK || regions.empty()) return;
+
+  std::lock_guard<std::mutex> g(_handlers_lock);
+  for (auto h : _handlers) h->forget_regions(regions);
+}
+
 void Shard::release_locked_value(const void *target)
 {
-  auto i = _locked_values.find(target); /* search by target address */
-  if (i == _locked_values.end()) throw Logic_exception("bad target to unlock value; value never locked? (%p)", target);
+  lock_info_t info;
+  {
+    auto g = shared_guard(_locked_values_lock);
+    auto i = _locked_values.find(target); /* search by target address */
+    if (i == _locked_values.end()) throw Logic_exception("bad target to unlock value; value never locked? (%p)", target);
 
-  if (i->second.count == 1) {
-    /* we may need to flush store */
-    if (_store_requires_flush) {
-      /* do this by hand to bypass pmem_is_pmem check */
-      pmem_flush(target, i->second.value_size);
-      pmem_drain();
+    if (i->second.count > 1) {
+      i->second.count--;
+      return;
     }
-
-    _i_kvstore->unlock(i->second.pool, i->second.key);
+    info = i->second;
     _locked_values.erase(i);
   }
-  else {
-    i->second.count--;
+
+  /* we may need to flush store */
+  if (_store_requires_flush) {
+    /* do this by hand to bypass pmem_is_pmem check */
+    pmem_flush(target, info.value_size);
+    pmem_drain();
   }
+
+  auto sg = store_guard(info.pool);
+  _i_kvstore->unlock(info.pool, info.key);
 }
 
 /* note, target address is used because it is unique for the shard */
@@ -552,7 +1040,8 @@ void Shard::add_pending_rename(const pool_t pool_id, const void* target, const s
 {
   if(_debug_level > 2)
     PLOG("added pending rename %p %s->%s", target, from.c_str(), to.c_str());
-    
+
+  auto g = shared_guard(_locked_values_lock);
   assert(_pending_renames.find(target) ==  _pending_renames.end());
 
   _pending_renames.emplace(std::piecewise_construct,
@@ -563,31 +1052,20 @@ void Shard::add_pending_rename(const pool_t pool_id, const void* target, const s
 void Shard::release_pending_rename(const void* target)
 {
   try {
-  auto info = _pending_renames.at(target);
+  auto info = [&]() {
+    auto g = shared_guard(_locked_values_lock);
+    auto i = _pending_renames.at(target);
+    _pending_renames.erase(target);
+    return i;
+  }();
 
   if(_debug_level > 2)
     PLOG("renaming (%s) to (%s)", info.from.c_str(), info.to.c_str());
   
-  void* value;
-  size_t value_len = 8;
-  Component::IKVStore::key_t keyh;
+  auto sg = store_guard(info.pool);
+  commit_pending_value(info.pool, info.from, info.to);
+  sg.unlock();
 
-  /* we do the lock/unlock first, because there might not be a prior
-     object so this will create one on demand. */
-  if(_i_kvstore->lock(info.pool, info.to, Component::IKVStore::STORE_LOCK_WRITE, value, value_len, keyh) < 0)
-    throw Logic_exception("release_pending_rename lock failed");
-
-  if(_i_kvstore->unlock(info.pool, keyh) != S_OK)
-    throw Logic_exception("release_pending_rename unlock failed");
-
-  if(_i_kvstore->swap_keys(info.pool, info.from, info.to) != S_OK)
-    throw Logic_exception("release_pending_rename swap_keys failed");
-    
-  if(_i_kvstore->erase(info.pool, info.from) != S_OK)
-    throw Logic_exception("release_pending_rename erase failed");
-
-  _pending_renames.erase(target);
-  
   /* now make available in the index */
   add_index_key(info.pool, info.to);
 
@@ -599,15 +1077,42 @@ void Shard::release_pending_rename(const void* target)
   }
 }
   
+void Shard::commit_pending_value(const pool_t pool_id, const std::string &from, const std::string &to)
+{
+  void* value;
+  size_t value_len = 8;
+  Component::IKVStore::key_t keyh;
+
+  /* we do the lock/unlock first, because there might not be a prior
+     object so this will create one on demand. */
+  if(_i_kvstore->lock(pool_id, to, Component::IKVStore::STORE_LOCK_WRITE, value, value_len, keyh) < 0)
+    throw Logic_exception("commit_pending_value lock failed");
+
+  if(_i_kvstore->unlock(pool_id, keyh) != S_OK)
+    throw Logic_exception("commit_pending_value unlock failed");
+
+  const lease_write lw(lease_version(pool_id, to));
+  if(_i_kvstore->swap_keys(pool_id, from, to) != S_OK)
+    throw Logic_exception("commit_pending_value swap_keys failed");
+    
+  if(_i_kvstore->erase(pool_id, from) != S_OK)
+    throw Logic_exception("commit_pending_value erase failed");
+}
+
 void Shard::process_message_IO_request(Connection_handler *handler, Protocol::Message_IO_request *msg)
 {
   using namespace Component;
   int status = S_OK;
 
-  const auto iob = handler->allocate();
+  /* only a GET response carries data: any value for an inline GET, else
+     at most a value copied below TWO_STAGE_THRESHOLD */
+  const auto iob = handler->allocate(msg->op != Protocol::OP_GET ? sizeof(Protocol::Message_IO_response)
+                                     : (msg->resvd & Protocol::MSG_RESVD_INLINE)
+                                         ? handler->IO_buffer_size()
+                                         : sizeof(Protocol::Message_IO_response) + TWO_STAGE_THRESHOLD);
   assert(iob);
 
-  _stats.op_request_count++;
+  stats().op_request_count++;
 
   /////////////////////////////////////////////////////////////////////////////
   //   PUT ADVANCE   //
@@ -627,7 +1132,7 @@ void Shard::process_message_IO_request(Connection_handler *handler, Protocol::Me
     if (msg->flags & IKVStore::FLAGS_DONT_STOMP) {
       status = E_INVAL;
       PWRN("PUT_ADVANCE failed IKVStore::FLAGS_DONT_STOMP not viable");
-      _stats.op_failed_request_count++;
+      stats().op_failed_request_count++;
       goto send_response;
     }
 
@@ -637,19 +1142,21 @@ void Shard::process_message_IO_request(Connection_handler *handler, Protocol::Me
     
     /* create (if needed) and lock value */
     Component::IKVStore::key_t key_handle;
+    const cpu_time_t           store_start = rdtsc();
     status_t rc = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_WRITE, target, target_len, key_handle);
+    record_latency(IMCAS::STATS_OP_PUT, IMCAS::STATS_LATENCY_STORE, rdtsc() - store_start);
 
     if (rc == E_FAIL || key_handle == Component::IKVStore::KEY_NONE) {
       PWRN("PUT_ADVANCE failed to lock value");
       status = E_INVAL;
-      _stats.op_failed_request_count++;
+      stats().op_failed_request_count++;
       goto send_response;
     }
 
     if (target_len != msg->val_len) {
       PWRN("existing entry length does NOT equal request length");
       status = E_INVAL;
-      _stats.op_failed_request_count++;
+      stats().op_failed_request_count++;
       goto send_response;
     }
 
@@ -675,7 +1182,7 @@ void Shard::process_message_IO_request(Connection_handler *handler, Protocol::Me
     handler->post_send_buffer(iob);
 
     /* update stats */
-    _stats.op_put_direct_count++;
+    stats().op_put_direct_count++;
 
     return;
   }
@@ -684,6 +1191,7 @@ send_response:
 
   Protocol::Message_IO_response *response =
       new (iob->base()) Protocol::Message_IO_response(iob->length(), handler->auth_id());
+  response->request_id = msg->request_id; /* early returns must still carry the id */
 
   /////////////////////////////////////////////////////////////////////////////
   //   PUT           //
@@ -709,12 +1217,17 @@ send_response:
     else {
       const std::string k(msg->key(), msg->key_len);
 
-      status = _i_kvstore->put(msg->pool_id, k, msg->value(), msg->val_len, msg->flags);
+      const cpu_time_t store_start = rdtsc();
+      {
+        const lease_write lw(lease_version(msg->pool_id, k));
+        status = _i_kvstore->put(msg->pool_id, k, msg->value(), msg->val_len, msg->flags);
+      }
+      record_latency(IMCAS::STATS_OP_PUT, IMCAS::STATS_LATENCY_STORE, rdtsc() - store_start);
 
       if (_debug_level > 2) {
         if (status == E_ALREADY_EXISTS) {
           PLOG("kvstore->put returned E_ALREADY_EXISTS");
-          _stats.op_failed_request_count++;
+          stats().op_failed_request_count++;
         }
         else {
           PLOG("kvstore->put returned %d", status);
@@ -724,7 +1237,7 @@ send_response:
       add_index_key(msg->pool_id, k);
     }
     /* update stats */
-    _stats.op_put_count++;
+    stats().op_put_count++;
   }
   /////////////////////////////////////////////////////////////////////////////
   //   GET           //
@@ -747,10 +1260,16 @@ send_response:
       size_t      value_out_len         = 0;
       size_t      client_side_value_len = msg->val_len;
       bool        is_direct             = msg->resvd & Protocol::MSG_RESVD_DIRECT;
+      bool        is_inline             = msg->resvd & Protocol::MSG_RESVD_INLINE;
+      bool        is_write              = msg->resvd & Protocol::MSG_RESVD_WRITE;
+      bool        is_lease              = msg->resvd & Protocol::MSG_RESVD_LEASE;
+      bool        is_range              = msg->resvd & Protocol::MSG_RESVD_RANGE;
       std::string k(msg->key(), msg->key_len);
 
       Component::IKVStore::key_t key_handle;
+      const cpu_time_t           store_start = rdtsc();
       status_t rc = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_READ, value_out, value_out_len, key_handle);
+      record_latency(IMCAS::STATS_OP_GET, IMCAS::STATS_LATENCY_STORE, rdtsc() - store_start);
 
       if (rc == E_FAIL || key_handle == Component::IKVStore::KEY_NONE) { /* key not found */
         if (_debug_level > 2) PLOG("Shard: locking value failed");
@@ -758,7 +1277,7 @@ send_response:
         response->set_status(Component::IKVStore::E_KEY_NOT_FOUND);
         iob->set_length(response->base_message_size());
         handler->post_response(iob, nullptr);
-        _stats.op_failed_request_count++;
+        stats().op_failed_request_count++;
         return;
       }
 
@@ -774,8 +1293,101 @@ send_response:
       assert(value_out_len);
       assert(value_out);
 
+      /* range: respond as if the value were only [offset, offset + len) */
+      if (is_range) {
+        const auto offset = msg->range_offset();
+        if (offset >= value_out_len) {
+          _i_kvstore->unlock(msg->pool_id, key_handle);
+          response->data_len = 0;
+          response->set_status(offset == value_out_len ? S_OK : E_INVAL);
+          iob->set_length(response->base_message_size());
+          handler->post_response(iob, nullptr);
+          return;
+        }
+        value_out     = static_cast<char *>(value_out) + offset;
+        value_out_len = std::min(value_out_len - offset, msg->range_length());
+        is_lease      = false;
+        is_write      = false;
+      }
+
+      /* lease: tell the client where the value and its version word live so
+         that it can read them with one-sided RDMA reads. The read lock keeps
+         writes out; an odd version word is a put or erase of a key sharing
+         the word, still in progress */
+      if (is_lease) {
+        const auto &version        = lease_version(msg->pool_id, k);
+        const auto  version_now    = version.load();
+        auto        region         = lease_region(handler, msg->pool_id, value_out, value_out_len);
+        auto        version_region = region ? lease_version_region(handler) : nullptr;
+        if (version_region && (version_now & 1) == 0) {
+          const Protocol::Value_lease lease{reinterpret_cast<uint64_t>(value_out),
+                                            handler->get_memory_remote_key(region),
+                                            value_out_len,
+                                            reinterpret_cast<uint64_t>(&version),
+                                            handler->get_memory_remote_key(version_region),
+                                            version_now,
+                                            Common::chksum32(value_out, value_out_len),
+                                            LEASE_MSEC};
+          memcpy(response->data, &lease, sizeof lease);
+          response->data_len = sizeof lease;
+          response->set_status(S_OK);
+          stats().op_get_count++;
+        }
+        else {
+          response->data_len = 0;
+          response->set_status(version_region ? E_LOCKED : E_NOT_SUPPORTED);
+          stats().op_failed_request_count++;
+        }
+        _i_kvstore->unlock(msg->pool_id, key_handle);
+
+        response->request_id = msg->request_id;
+        iob->set_length(response->base_message_size() + response->data_len);
+        handler->post_response(iob);
+        return;
+      }
+
+      /* client offered a registered landing buffer: write the value straight
+         from pool memory (normally a cache hit on the pool's registration),
+         then send the response, which RC ordering delivers after the write */
+      if (is_write && value_out_len <= client_side_value_len) {
+        if (_debug_level > 2) PLOG("Shard: get using RDMA write (value_out_len=%lu)", value_out_len);
+
+        auto region = handler->ondemand_register(value_out, value_out_len);
+        assert(region);
+
+        /* value stays locked until the write completes */
+        add_locked_value(msg->pool_id, key_handle, value_out, value_out_len);
+        handler->post_write_value(value_out, value_out_len, region, msg->landing_addr(), msg->landing_key());
+
+        response->data_len   = value_out_len;
+        response->request_id = msg->request_id;
+        response->set_written_bit();
+        response->set_status(S_OK);
+        iob->set_length(response->base_message_size());
+        handler->post_response(iob);
+
+        stats().op_get_count++;
+        return;
+      }
+
+      /* a pipelining client has other receives posted behind this one,
+         so the value cannot follow as a separate message */
+      const size_t inline_space = handler->IO_buffer_size() - response->base_message_size();
+      if (is_inline && (value_out_len > inline_space || value_out_len > client_side_value_len)) {
+        _i_kvstore->unlock(msg->pool_id, key_handle);
+        response->data_len = value_out_len;
+        if (value_out_len > inline_space)
+          response->set_status(IKVStore::E_TOO_LARGE);
+        else
+          response->set_status(E_INSUFFICIENT_SPACE);
+        iob->set_length(response->base_message_size());
+        handler->post_response(iob, nullptr);
+        stats().op_failed_request_count++;
+        return;
+      }
+
       /* optimize based on size */
-      if (!is_direct && (value_out_len < TWO_STAGE_THRESHOLD)) {
+      if (is_inline || (!is_direct && (value_out_len < TWO_STAGE_THRESHOLD))) {
         /* value can fit in message buffer, let's copy instead of
            performing two-part DMA */
         if (_debug_level > 2) PLOG("Shard: performing memcpy for small get");
@@ -792,7 +1404,7 @@ send_response:
         assert(iob);
         handler->post_response(iob);
 
-        _stats.op_get_count++;
+        stats().op_get_count++;
       }
       else {
         if (_debug_level > 2) PLOG("Shard: get using two stage get response (value_out_len=%lu)", value_out_len);
@@ -804,7 +1416,7 @@ send_response:
           iob->set_length(response->base_message_size());
           handler->post_response(iob, nullptr);
           PWRN("Shard: responding with Client posted insufficient space.");
-          _stats.op_failed_request_count++;
+          stats().op_failed_request_count++;
           return;
         }
 
@@ -852,7 +1464,7 @@ send_response:
           handler->post_send_value_buffer(value_buffer);
           handler->set_state_wait_send_value();
         }
-        _stats.op_get_twostage_count++;
+        stats().op_get_twostage_count++;
       }
     }
     return;
@@ -863,21 +1475,33 @@ send_response:
   else if (msg->op == Protocol::OP_ERASE) {
     std::string k(msg->key(), msg->key_len);
 
-    status = _i_kvstore->erase(msg->pool_id, k);
+    const cpu_time_t store_start = rdtsc();
+    {
+      const lease_write lw(lease_version(msg->pool_id, k));
+      status = _i_kvstore->erase(msg->pool_id, k);
+    }
+    record_latency(IMCAS::STATS_OP_ERASE, IMCAS::STATS_LATENCY_STORE, rdtsc() - store_start);
 
     if (status == S_OK)
       remove_index_key(msg->pool_id, k);
     else
-      _stats.op_failed_request_count++;
+      stats().op_failed_request_count++;
 
-    _stats.op_erase_count++;
+    stats().op_erase_count++;
   }
   /////////////////////////////////////////////////////////////////////////////
   //   CONFIGURE     //
   /////////////////////
   else if (msg->op == Protocol::OP_CONFIGURE) {
     if (_debug_level > 1) PMAJOR("Shard: pool CONFIGURE (%s)", msg->cmd());
-    status = process_configure(msg);
+    status = process_configure(handler, msg);
+  }
+  /////////////////////////////////////////////////////////////////////////////
+  //   PUT SEGMENT   //
+  /////////////////////
+  else if (msg->op == Protocol::OP_PUT_SEGMENT) {
+    status = process_put_segment(handler, msg);
+    if (status != S_OK) stats().op_failed_request_count++;
   }
   else {
     throw Protocol_exception("operation not implemented");
@@ -890,15 +1514,189 @@ send_response:
   handler->post_response(iob);  // issue IO request response
 }
 
+void Shard::process_message_IO_batch_request(Connection_handler *handler, Protocol::Message_IO_batch_request *msg)
+{
+  using namespace Component;
+
+  const auto iob = handler->allocate();
+  assert(iob);
+
+  const size_t buffer_size = iob->length();
+  auto response = new (iob->base()) Protocol::Message_IO_batch_response(buffer_size, handler->auth_id(), msg->request_id);
+  response->set_status(S_OK);
+
+  if (_debug_level > 2)
+    PLOG("IO_BATCH: (%p) op=%u count=%u request_id=%lu", static_cast<const void *>(this), msg->op, msg->count,
+         msg->request_id);
+
+  /* stats are accumulated locally and applied once per batch */
+  uint64_t put_count    = 0;
+  uint64_t get_count    = 0;
+  uint64_t erase_count  = 0;
+  uint64_t failed_count = 0;
+
+  if ((msg->op != Protocol::OP_PUT && msg->op != Protocol::OP_GET && msg->op != Protocol::OP_ERASE) ||
+      !msg->valid(handler->pending_msg_buffer_len())) {
+    response->set_status(E_INVAL);
+    failed_count++;
+  }
+  else {
+    auto rec = msg->first_record();
+    for (uint32_t i = 0; i < msg->count; i++, rec = Protocol::Message_IO_batch_request::next_record(rec)) {
+      const std::string k(rec->key(), rec->key_len);
+      status_t          status = S_OK;
+
+      if (msg->op == Protocol::OP_PUT) {
+        {
+          const lease_write lw(lease_version(msg->pool_id, k));
+          status = _i_kvstore->put(msg->pool_id, k, rec->value(), rec->value_len, msg->flags);
+        }
+        if (status == S_OK) add_index_key(msg->pool_id, k);
+        put_count++;
+      }
+      else if (msg->op == Protocol::OP_ERASE) {
+        {
+          const lease_write lw(lease_version(msg->pool_id, k));
+          status = _i_kvstore->erase(msg->pool_id, k);
+        }
+        if (status == S_OK) remove_index_key(msg->pool_id, k);
+        erase_count++;
+      }
+      else { /* OP_GET */
+        void *          value_out     = nullptr;
+        size_t          value_out_len = 0;
+        IKVStore::key_t key_handle;
+        status_t rc = _i_kvstore->lock(msg->pool_id, k, IKVStore::STORE_LOCK_READ, value_out, value_out_len, key_handle);
+
+        if (rc == E_FAIL || key_handle == IKVStore::KEY_NONE) {
+          status = IKVStore::E_KEY_NOT_FOUND;
+        }
+        else {
+          const bool fits = response->append(buffer_size, S_OK, value_out, value_out_len);
+          _i_kvstore->unlock(msg->pool_id, key_handle);
+
+          if (fits) {
+            get_count++;
+            continue;
+          }
+
+          /* out of response space; client re-issues the remainder */
+          if (response->count > 0) break;
+
+          /* single value too large for the IO buffer */
+          status = E_INSUFFICIENT_SPACE;
+        }
+        get_count++;
+      }
+
+      if (status != S_OK) failed_count++;
+
+      if (!response->append(buffer_size, status)) break;
+    }
+  }
+
+  stats().op_request_count++;
+  stats().op_batch_count++;
+  stats().op_put_count += put_count;
+  stats().op_get_count += get_count;
+  stats().op_erase_count += erase_count;
+  stats().op_failed_request_count += failed_count;
+
+  iob->set_length(response->msg_len);
+  handler->post_response(iob);
+}
+
+void Shard::process_scan_request(Connection_handler *handler, Protocol::Message_scan_request *msg)
+{
+  using namespace Component;
+
+  const auto iob = handler->allocate();
+  assert(iob);
+
+  const size_t buffer_size = iob->length();
+  auto response = new (iob->base()) Protocol::Message_scan_response(buffer_size, handler->auth_id(), msg->request_id);
+  response->set_status(S_OK);
+
+  const bool        with_values = msg->flags & Protocol::Message_scan_request::FLAG_WITH_VALUES;
+  const bool        exclusive   = msg->flags & Protocol::Message_scan_request::FLAG_EXCLUSIVE_START;
+  const std::string start_key   = msg->start_key();
+  const size_t      page_space  = buffer_size - sizeof(Protocol::Message_scan_response);
+
+  if (_debug_level > 2)
+    PLOG("SCAN: (%p) start=(%s) end=(%s) limit=%u flags=%x", static_cast<const void *>(this), start_key.c_str(),
+         msg->end_key().c_str(), msg->limit, msg->flags);
+
+  stats().op_request_count++;
+
+  auto     ig    = shared_guard(_index_lock);
+  auto     index = lookup_index(msg->pool_id);
+  status_t rc;
+
+  if (index == nullptr) {
+    PWRN("Shard: scan requires an index; use configure('AddIndex::VolatileTree')");
+    rc = E_INVAL;
+  }
+  else {
+    rc = index->scan(start_key, msg->end_key(), [&](const std::string &key) {
+      if (exclusive && key == start_key) return true;
+
+      if (msg->limit && response->count >= msg->limit) {
+        response->more = 1;
+        return false;
+      }
+
+      if (!with_values) {
+        if (response->append(buffer_size, key.data(), key.length())) return true;
+        response->more = 1;
+        return false;
+      }
+
+      void *          value     = nullptr;
+      size_t          value_len = 0;
+      IKVStore::key_t key_handle;
+      const status_t  lrc = _i_kvstore->lock(msg->pool_id, key, IKVStore::STORE_LOCK_READ, value, value_len, key_handle);
+      if (lrc < S_OK || key_handle == IKVStore::KEY_NONE) {
+        /* the key is returned without its value: a writer holds the value,
+           or index and store briefly disagree (e.g. erase in flight) */
+        const status_t s = lrc == E_LOCKED ? status_t(E_LOCKED) : status_t(IKVStore::E_KEY_NOT_FOUND);
+        if (response->append(buffer_size, key.data(), key.length(), s)) return true;
+        response->more = 1;
+        return false;
+      }
+
+      bool appended;
+      if (Protocol::Message_scan_response::record_size(key.length(), value_len) > page_space) {
+        /* value will never fit in a page; client fetches it separately */
+        appended = response->append(buffer_size, key.data(), key.length(), E_INSUFFICIENT_SPACE);
+      }
+      else {
+        appended = response->append(buffer_size, key.data(), key.length(), S_OK, value, value_len);
+      }
+      _i_kvstore->unlock(msg->pool_id, key_handle);
+
+      if (!appended) response->more = 1;
+      return appended;
+    });
+  }
+  ig.unlock();
+
+  if (rc != S_OK) stats().op_failed_request_count++;
+
+  response->set_status(rc);
+  iob->set_length(response->msg_len);
+  handler->post_response(iob);
+}
+
 void Shard::process_info_request(Connection_handler *handler, Protocol::Message_INFO_request *msg)
 {
   if (msg->type == Protocol::INFO_TYPE_FIND_KEY) {
     if (_debug_level > 1) PLOG("Shard: INFO request INFO_TYPE_FIND_KEY (%s)", msg->c_str());
 
+    auto g = shared_guard(_index_lock);
     if (_index_map == nullptr) { /* index does not exist */
       PLOG("Shard: cannot perform regex request, no index!! use "
            "configure('AddIndex::VolatileTree') ");
-      const auto                       iob      = handler->allocate();
+      const auto                       iob      = handler->allocate(sizeof(Protocol::Message_INFO_response));
       Protocol::Message_INFO_response *response = new (iob->base()) Protocol::Message_INFO_response(handler->auth_id());
 
       response->set_status(E_INVAL);
@@ -910,7 +1708,7 @@ void Shard::process_info_request(Connection_handler *handler, Protocol::Message_
       add_task_list(new Key_find_task(msg->c_str(), msg->offset, handler, _index_map->at(msg->pool_id)));
     }
     catch (...) {
-      const auto                       iob      = handler->allocate();
+      const auto                       iob      = handler->allocate(sizeof(Protocol::Message_INFO_response));
       Protocol::Message_INFO_response *response = new (iob->base()) Protocol::Message_INFO_response(handler->auth_id());
 
       response->set_status(E_INVAL);
@@ -928,7 +1726,7 @@ void Shard::process_info_request(Connection_handler *handler, Protocol::Message_
 
   /* stats request handler */
   if (msg->type == Protocol::INFO_TYPE_GET_STATS) {
-    Protocol::Message_stats *response = new (iob->base()) Protocol::Message_stats(handler->auth_id(), _stats);
+    Protocol::Message_stats *response = new (iob->base()) Protocol::Message_stats(handler->auth_id(), aggregate_stats());
     response->set_status(S_OK);
     iob->set_length(sizeof(Protocol::Message_stats));
 
@@ -1005,19 +1803,25 @@ void Shard::process_info_request(Connection_handler *handler, Protocol::Message_
   return;
 }
 
-void Shard::process_tasks(unsigned &idle)
+void Shard::process_tasks(unsigned &idle, const Connection_handler *owner)
 {
+  /* lock order is index then task list (see Key_find_task creation) */
+  auto ig = shared_guard(_index_lock);
+  auto g  = shared_guard(_tasks_lock);
 retry:
   for (task_list_t::iterator i = _tasks.begin(); i != _tasks.end(); i++) {
     auto t = *i;
     assert(t);
+    if (owner && t->handler() != owner) continue;
     idle = 0;
 
     status_t s = t->do_work();
     if (s != Component::IKVStore::S_MORE) {
       auto handler      = t->handler();
-      auto response_iob = handler->allocate();
-      assert(response_iob);
+      auto response_iob = handler->try_allocate();
+      /* no buffer: leave the task queued; its search resumes at the match,
+         so the next pass finds the same result */
+      if (!response_iob) continue;
       Protocol::Message_INFO_response *response =
           new (response_iob->base()) Protocol::Message_INFO_response(handler->auth_id());
 
@@ -1038,6 +1842,7 @@ retry:
 
       handler->post_send_buffer(response_iob);
       _tasks.erase(i);
+      _task_count--;
 
       goto retry;
     }
@@ -1052,71 +1857,278 @@ void Shard::check_for_new_connections()
 
   while ((handler = get_new_connection()) != nullptr) {
     if (_debug_level > 1) PMAJOR("Shard: processing new connection (%p)", static_cast<const void *>(handler));
-    _handlers.push_back(handler);
+    {
+      std::lock_guard<std::mutex> g(_handlers_lock);
+      _handlers.push_back(handler);
+    }
+    if (_scheduler) _scheduler->add(handler);
+  }
+}
+
+void Shard::close_index(const pool_t pool_id)
+{
+  auto     g          = shared_guard(_index_lock);
+  auto     index      = lookup_index(pool_id);
+  uint64_t generation = 0;
+
+  if (index) {
+    _index_map->erase(pool_id);
+    /* index first: a crash before the pool records it forces a rebuild */
+    generation = uint64_t(std::chrono::system_clock::now().time_since_epoch().count()) | 1;
+    if (index->set_generation(generation) != S_OK) generation = 0;
+    index->release_ref();
+    if (_debug_level > 1) PLOG("Shard: closed index on pool (%lx)", pool_id);
   }
+  else {
+    /* no index opened, and no key changed: the old generation still holds */
+    auto i = _index_generations.find(pool_id);
+    if (i != _index_generations.end()) generation = i->second;
+  }
+  _index_generations.erase(pool_id);
+
+  if (generation) _i_kvstore->put(pool_id, INDEX_GENERATION_KEY, &generation, sizeof generation);
+}
+
+void Shard::load_index_generation(const pool_t pool_id)
+{
+  if (_index_dir.empty()) return;
+
+  void *   p          = nullptr;
+  size_t   p_len      = 0;
+  uint64_t generation = 0;
+  if (_i_kvstore->get(pool_id, INDEX_GENERATION_KEY, p, p_len) != S_OK) return;
+  if (p_len == sizeof generation) memcpy(&generation, p, sizeof generation);
+  _i_kvstore->free_memory(p);
+
+  /* absent while the pool is open, so that a crash spoils it */
+  _i_kvstore->erase(pool_id, INDEX_GENERATION_KEY);
+  if (generation == 0) return;
+
+  auto g = shared_guard(_index_lock);
+  _index_generations[pool_id] = generation;
+  _index_present.store(true, std::memory_order_release);
 }
 
-status_t Shard::process_configure(Protocol::Message_IO_request *msg)
+std::string Shard::index_file(const std::string &pool_name) const
+{
+  if (_index_dir.empty()) return std::string();
+
+  /* pool names may contain path separators */
+  std::ostringstream ss;
+  ss << _index_dir << "/";
+  for (auto c : pool_name) {
+    if (isalnum(c) || c == '.' || c == '_' || c == '-')
+      ss << c;
+    else
+      ss << '%' << std::hex << std::setw(2) << std::setfill('0') << unsigned(static_cast<unsigned char>(c)) << std::dec;
+  }
+  ss << ".index";
+  return ss.str();
+}
+
+status_t Shard::process_put_segment(Connection_handler *handler, Protocol::Message_IO_request *msg)
 {
   using namespace Component;
 
-  std::string command(msg->cmd());
+  const pool_t pool_id = msg->pool_id;
+  const auto   offset  = msg->segment_offset();
+  const auto   total   = msg->segment_total();
 
-  if (command.substr(0, 10) == "AddIndex::") {
-    std::string index_str = command.substr(10);
+  if (_debug_level > 2)
+    PLOG("PUT_SEGMENT: key=(%.*s) offset=%lu len=%lu total=%lu", int(msg->key_len), msg->key(), offset, msg->val_len,
+         total);
 
-    /* TODO: use shard configuration */
-    if (index_str == "VolatileTree") {
-      if (_index_map == nullptr) _index_map = new index_map_t();
+  std::string actual_key(msg->key(), msg->key_len);
+
+  /* a bad segment spoils any put in progress */
+  if ((msg->flags & IKVStore::FLAGS_DONT_STOMP) || total == 0 || offset > total || total - offset < msg->val_len) {
+    abandon_segmented_put(handler, pool_id, actual_key);
+    return E_INVAL;
+  }
 
-      /* create index component and put into shard index map */
-      IBase *comp = load_component("libcomponent-indexrbtree.so", rbtreeindex_factory);
-      if (!comp) throw General_exception("unable to load libcomponent-indexrbtree.so");
-      auto factory = static_cast<IKVIndex_factory *>(comp->query_interface(IKVIndex_factory::iid()));
-      assert(factory);
+  auto &puts = handler->segmented_puts();
+  auto  i    = puts.find(std::make_pair(pool_id, actual_key));
 
-      std::ostringstream ss;
-      ss << "auth_id:" << msg->auth_id;
-      auto index = factory->create(ss.str(), "");
-      assert(index);
+  if (i == puts.end()) {
+    /* as for PUT_ADVANCE, the value is built under a pending key */
+    const std::string k("___pending_" + actual_key);
+    void *            target     = nullptr;
+    size_t            target_len = total;
+    IKVStore::key_t   key_handle;
 
-      _index_map->insert(std::make_pair(reinterpret_cast<IKVStore::pool_t>(msg->pool_id), index));
+    const cpu_time_t store_start = rdtsc();
+    status_t rc = _i_kvstore->lock(pool_id, k, IKVStore::STORE_LOCK_WRITE, target, target_len, key_handle);
+    record_latency(IMCAS::STATS_OP_PUT, IMCAS::STATS_LATENCY_STORE, rdtsc() - store_start);
 
-      factory->release_ref();
+    if (rc == E_FAIL || key_handle == IKVStore::KEY_NONE) {
+      PWRN("PUT_SEGMENT failed to lock value");
+      return E_INVAL;
+    }
+    if (target_len != total) {
+      PWRN("PUT_SEGMENT existing pending entry length does NOT equal value length");
+      _i_kvstore->unlock(pool_id, key_handle);
+      return E_INVAL;
+    }
+    i = puts.emplace(std::make_pair(pool_id, actual_key),
+                     Connection_handler::segmented_put_t{target, total, key_handle}).first;
+  }
 
-      if (_debug_level > 1) PLOG("Shard: rebuilding volatile index ...");
+  auto &s = i->second;
+  if (s.len != total) {
+    abandon_segmented_put(handler, pool_id, actual_key);
+    return E_INVAL;
+  }
 
-      status_t hr;
-      if ((hr = _i_kvstore->map_keys(msg->pool_id, [&index](const std::string &key) {
-            index->insert(key);
-            return 0;
-          })) != S_OK) {
-        hr = _i_kvstore->map(
-            msg->pool_id, [&index](const void *key, const size_t key_len, const void *value, const size_t value_len) {
-              std::string k(reinterpret_cast<const char *>(key), key_len);
-              index->insert(k);
-              return 0;
-            });
-      }
+  /* segments may be reordered or resent: the value is complete when every
+     byte has arrived, however often */
+  memcpy(static_cast<char *>(s.target) + offset, msg->value(), msg->val_len);
+  s.add_range(offset, msg->val_len);
+
+  if (!s.complete()) return S_OK;
+
+  /* last segment: make the value durable and visible */
+  if (_store_requires_flush) {
+    pmem_flush(s.target, s.len);
+    pmem_drain();
+  }
+  _i_kvstore->unlock(pool_id, s.key_handle);
+  puts.erase(i);
+
+  commit_pending_value(pool_id, "___pending_" + actual_key, actual_key);
+  add_index_key(pool_id, actual_key);
+  stats().op_put_count++;
+
+  return S_OK;
+}
+
+status_t Shard::process_configure(Connection_handler *handler, Protocol::Message_IO_request *msg)
+{
+  using namespace Component;
+
+  std::string command(msg->cmd());
+  auto        g = shared_guard(_index_lock);
 
-      return hr;
+  if (command.substr(0, 10) == "AddIndex::") {
+    std::string index_str = command.substr(10);
+
+    /* existing index is kept current by put/erase */
+    if (lookup_index(msg->pool_id)) {
+      if (_debug_level > 1) PLOG("Shard: pool (%lx) already has an index", msg->pool_id);
+      return S_OK;
+    }
+
+    /* TODO: use shard configuration */
+    const char *      dll;
+    Component::uuid_t factory_id;
+    std::string       path;
+    if (index_str == "VolatileTree" || index_str == "BTree") {
+      dll        = "libcomponent-indexbtree.so";
+      factory_id = btreeindex_factory;
+    }
+    else if (index_str == "RBTree") {
+      dll        = "libcomponent-indexrbtree.so";
+      factory_id = rbtreeindex_factory;
+    }
+    else if (index_str == "PersistentTree") {
+      path = index_file(handler->pool_manager().pool_name(msg->pool_id));
+      if (path.empty()) {
+        PWRN("Shard: persistent index requires shard 'index_dir' configuration");
+        return E_BAD_PARAM;
+      }
+      dll        = "libcomponent-indexpmtree.so";
+      factory_id = pmtreeindex_factory;
     }
     else {
       PWRN("unknown index (%s)", index_str.c_str());
       return E_BAD_PARAM;
     }
-  }
-  else if (command == "RemoveIndex::") {
+
+    if (_index_map == nullptr) _index_map = new index_map_t();
+
+    /* create index component and put into shard index map */
+    IBase *comp = load_component(dll, factory_id);
+    if (!comp) throw General_exception("unable to load %s", dll);
+    auto factory = static_cast<IKVIndex_factory *>(comp->query_interface(IKVIndex_factory::iid()));
+    assert(factory);
+
+    std::ostringstream ss;
+    ss << "auth_id:" << msg->auth_id;
+    IKVIndex *index;
     try {
-      auto index = _index_map->at(msg->pool_id);
-      _index_map->erase(msg->pool_id);
-      delete index;
-      if (_debug_level > 1) PLOG("Shard: removed index on pool (%lx)", msg->pool_id);
+      index = path.empty() ? factory->create(ss.str(), "") : factory->create(ss.str(), "", path);
     }
-    catch (...) {
-      return E_BAD_PARAM;
+    catch (const General_exception &e) {
+      PWRN("Shard: unable to create index (%s): %s", index_str.c_str(), e.cause());
+      factory->release_ref();
+      return E_FAIL;
+    }
+    assert(index);
+
+    _index_map->insert(std::make_pair(reinterpret_cast<IKVStore::pool_t>(msg->pool_id), index));
+    _index_present.store(true, std::memory_order_release);
+
+    factory->release_ref();
+
+    /* A persistent index is reused only if it was closed cleanly along
+       with the pool (the generations match) and no key has changed since
+       the pool was opened.  After a crash it may lack keys whose put
+       completed in the store but not in the index, and keys put while no
+       index was configured were never added. */
+    const auto gen = _index_generations.find(msg->pool_id);
+    const bool current = index->reopened_clean() && gen != _index_generations.end() &&
+                         gen->second == index->generation() && index->count() == _i_kvstore->count(msg->pool_id);
+    if (gen != _index_generations.end()) _index_generations.erase(gen); /* the open index tracks changes now */
+
+    if (current) {
+      if (_debug_level > 1) PLOG("Shard: reopened persistent index (%lu keys)", index->count());
+      return S_OK;
     }
 
+    if (_debug_level > 1) PLOG("Shard: rebuilding index (%s) ...", index_str.c_str());
+
+    std::vector<std::string> keys;
+    status_t                 hr;
+    if ((hr = _i_kvstore->map_keys(msg->pool_id, [&keys](const std::string &key) {
+          keys.push_back(key);
+          return 0;
+        })) != S_OK) {
+      hr = _i_kvstore->map(
+          msg->pool_id, [&keys](const void *key, const size_t key_len, const void *value, const size_t value_len) {
+            keys.emplace_back(reinterpret_cast<const char *>(key), key_len);
+            return 0;
+          });
+    }
+
+    /* bulk load avoids per-key rebalancing when the index supports it */
+    if (index->bulk_load(std::move(keys)) == E_NOT_IMPL) {
+      index->clear();
+      for (auto &k : keys) index->insert(k);
+    }
+
+    return hr;
+  }
+  else if (command == "Lease::on" || command == "Lease::off") {
+    /* leases already handed out stay usable, being validated by version */
+    auto g = shared_guard(_lease_pools_lock);
+    if (command == "Lease::on")
+      _lease_pools.insert(msg->pool_id);
+    else
+      _lease_pools.erase(msg->pool_id);
+    if (_debug_level > 1) PLOG("Shard: %s on pool (%lx)", command.c_str(), msg->pool_id);
+    return S_OK;
+  }
+  else if (command == "RemoveIndex::") {
+    auto index = lookup_index(msg->pool_id);
+    if (index == nullptr) return E_BAD_PARAM;
+
+    _index_map->erase(msg->pool_id);
+    index->release_ref();
+    if (_debug_level > 1) PLOG("Shard: removed index on pool (%lx)", msg->pool_id);
+
+    /* a removed persistent index must not be reopened later as current */
+    auto path = index_file(handler->pool_manager().pool_name(msg->pool_id));
+    if (!path.empty()) ::unlink(path.c_str());
+
     return S_OK;
   }
   else {
@@ -26,8 +26,12 @@
 #include <common/logging.h>
 #include <xpmem.h> /* XPMEM kernel module */
 
+#include <atomic>
+#include <functional> /* hash */
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <thread>
 #include <unordered_map>
@@ -35,6 +39,9 @@
 #include "config_file.h"
 #include "connection_handler.h"
 #include "fabric_transport.h"
+#include "handler_scheduler.h"
+#include "latency_histogram.h"
+#include "metrics.h"
 #include "mcas_config.h"
 #include "pool_manager.h"
 #include "security.h"
@@ -48,10 +55,25 @@ class Connection_handler;
 /* Adapter point */
 using Shard_transport = Fabric_transport;
 
+/* a thread's statistics as last published, for other threads to read */
+struct Stats_snapshot {
+  std::mutex                    lock{};
+  Component::IMCAS::Shard_stats stats{};
+  Shard_latency                 latency{};
+};
+
 class Shard : public Shard_transport {
  private:
   static constexpr size_t TWO_STAGE_THRESHOLD = KiB(8); /* above this two stage protocol is used */
   static constexpr size_t ADO_MAP_RESERVE     = 2048;
+  static constexpr unsigned WORKER_ACCEPT_INTERVAL_USEC = 1000; /* worker mode connection check */
+  static constexpr unsigned METRICS_PUBLISH_USEC        = 500000; /* metrics snapshot period */
+  static constexpr unsigned WORKER_IDLE_SLEEP_USEC      = 50;
+  static constexpr unsigned CONNECTION_CHECK_USEC       = 1000; /* new connection check while busy */
+  static constexpr unsigned ADO_MAX_BLOCK_MSEC          = 1;    /* ADO replies do not wake the fabric wait */
+  static constexpr unsigned LEASE_MSEC                  = 1000; /* longest a client may use a lease */
+  static constexpr size_t   LEASE_VERSION_SLOTS         = 4096; /* version words leases are validated against */
+  static constexpr const char *INDEX_GENERATION_KEY     = "___index_generation"; /* in a closed pool only */
 
  private:
 
@@ -99,10 +121,18 @@ class Shard : public Shard_transport {
         const bool         forced_exit)
       : Shard_transport(config_file.get_net_providers(),
                         config_file.get_shard("net", shard_index),
-                        config_file.get_shard_port(shard_index)),
+                        config_file.get_shard_port(shard_index),
+                        size_t(config_file.get_shard_mr_cache_mb(shard_index)) << 20,
+                        size_t(config_file.get_shard_buffer_pool_mb(shard_index)) << 20),
         _debug_level(debug_level), _forced_exit(forced_exit), _core(config_file.get_shard_core(shard_index)),
+        _port(config_file.get_shard_port(shard_index)),
         _ado_map(ADO_MAP_RESERVE), _ado_path(config_file.get_ado_path()),
         _ado_plugins(config_file.get_shard_ado_plugins(shard_index)), _security(config_file.get_cert_path()),
+        _worker_count(config_file.get_shard_worker_count(shard_index)),
+        _worker_cores(config_file.get_shard_worker_cores(shard_index)),
+        _poll_spin_usec(config_file.get_shard_poll_spin_usec(shard_index)),
+        _poll_block_msec(config_file.get_shard_poll_block_msec(shard_index)),
+        _index_dir(config_file.get_shard("index_dir", shard_index)),
         _thread(&Shard::thread_entry,
                 this,
                 config_file.get_shard("default_backend", shard_index),
@@ -143,6 +173,9 @@ class Shard : public Shard_transport {
 
   bool exited() const { return _thread_exit; }
 
+  /* latest metrics snapshot; safe to read from any thread */
+  const Shard_metrics_snapshot &metrics() const { return _metrics; }
+
  private:
   void thread_entry(const std::string &backend,
                     const std::string &index,
@@ -160,6 +193,52 @@ class Shard : public Shard_transport {
   void add_pending_rename(const pool_t pool_id, const void * target, const std::string& from, const std::string& to);
   void release_pending_rename(const void * target);
 
+  /* move a value written under a pending key to its actual key; caller holds the store guard */
+  void commit_pending_value(const pool_t pool_id, const std::string &from, const std::string &to);
+
+  /* remote-read-only registration through which a leased value may be
+     read, or nullptr if the pool does not grant leases */
+  Connection_base::memory_region_t lease_region(Connection_handler *handler, const pool_t pool_id, const void *target, size_t target_len);
+
+  /* pool is closing and no longer grants leases */
+  void close_leases(const pool_t pool_id);
+
+  /* remote-read-only registration of the lease version words */
+  Connection_base::memory_region_t lease_version_region(Connection_handler *handler);
+
+  /* version word of a key's value, against which leases on it are
+     validated; keys share words, so a write may fail others' leases too.
+     Taking a write lock on a value advances it by two (no lease is granted
+     while the lock is held); a change made without one goes through
+     lease_write */
+  std::atomic<uint64_t> &lease_version(const pool_t pool_id, const std::string &key)
+  {
+    return _lease_versions[(std::hash<std::string>{}(key) + pool_id * 0x9e3779b97f4a7c15ULL) % LEASE_VERSION_SLOTS];
+  }
+
+  /* brackets a put or erase: the version word is odd meanwhile, and has
+     moved on after, so that a lease granted before the change, or read
+     during it, fails validation */
+  class lease_write {
+    std::atomic<uint64_t> &_version;
+
+   public:
+    explicit lease_write(std::atomic<uint64_t> &version) : _version(version) { ++_version; }
+    lease_write(const lease_write &) = delete;
+    lease_write &operator=(const lease_write &) = delete;
+    ~lease_write() { ++_version; }
+  };
+
+  /* give up a session's segmented put: unlock its pending value and erase it;
+     the caller holds the pool's store guard */
+  void abandon_segmented_put(Connection_handler *handler, const pool_t pool_id, const std::string &key);
+
+  /* give up all of a session's segmented puts to a pool, as above */
+  void abandon_segmented_puts(Connection_handler *handler, const pool_t pool_id);
+
+  /* drop every session's registrations of a pool's memory before the pool is closed */
+  void forget_pool_regions(const pool_t pool_id);
+
   void initialize_components(const std::string &backend,
                              const std::string &index,
                              const std::string &pci_addr,
@@ -173,22 +252,80 @@ class Shard : public Shard_transport {
 
   void main_loop();
 
+  /* optional worker pool: connection handlers are spread over
+     worker threads with work-stealing; the shard thread only accepts
+     new connections */
+  void start_workers();
+
+  void worker_loop(const unsigned worker_id, const int core);
+
+  bool service_handler(Connection_handler *handler, unsigned &idle);
+
+  void close_session_pools(Connection_handler *handler);
+
+  /* block on fabric completion queues once the spin budget is spent */
+  void wait_for_activity();
+
+  /* shard-wide state guard; a no-op unless the worker pool is running */
+  inline std::unique_lock<std::mutex> shared_guard(std::mutex &m)
+  {
+    return _scheduler ? std::unique_lock<std::mutex>(m) : std::unique_lock<std::mutex>();
+  }
+
+  /* serialize store access according to the store's declared thread model */
+  std::unique_lock<std::mutex> store_guard(const pool_t pool);
+
+  inline Component::IMCAS::Shard_stats &stats();
+
+  /* record one latency sample (in cycles) for an operation class */
+  inline void record_latency(unsigned op, unsigned kind, cpu_time_t cycles);
+
+  /* statistics of the shard thread and all workers; in worker mode, other
+     threads' counts are as they last published them (publish_stats) */
+  Component::IMCAS::Shard_stats aggregate_stats();
+
+  /* copy this thread's statistics to its snapshot, the only copy which
+     other threads read; workers call it every METRICS_PUBLISH_USEC */
+  void publish_stats();
+
+  /* publish a metrics snapshot; called from the thread running main_loop */
+  void publish_metrics();
+
   void process_message_pool_request(Connection_handler *handler, Protocol::Message_pool_request *msg);
 
   void process_message_IO_request(Connection_handler *handler, Protocol::Message_IO_request *msg);
 
+  void process_message_IO_batch_request(Connection_handler *handler, Protocol::Message_IO_batch_request *msg);
+
+  void process_scan_request(Connection_handler *handler, Protocol::Message_scan_request *msg);
+
   void process_info_request(Connection_handler *handler, Protocol::Message_INFO_request *msg);
 
   void process_ado_request(Connection_handler *handler, Protocol::Message_ado_request *msg);
 
   void process_put_ado_request(Connection_handler *handler, Protocol::Message_put_ado_request *msg);
 
+  void process_ado_batch_request(Connection_handler *handler, Protocol::Message_ado_batch_request *msg);
+
   void process_messages_from_ado();
 
-  status_t process_configure(Protocol::Message_IO_request *msg);
+  status_t process_configure(Connection_handler *handler, Protocol::Message_IO_request *msg);
+
+  status_t process_put_segment(Connection_handler *handler, Protocol::Message_IO_request *msg);
+
+  /* release the pool's index, if any; persistent indexes close cleanly,
+     recording a generation shared with the pool */
+  void close_index(const pool_t pool_id);
 
-  void process_tasks(unsigned &idle);
+  /* on first open of a pool, take the generation recorded by close_index */
+  void load_index_generation(const pool_t pool_id);
 
+  /* per-pool file of the persistent index; empty if index_dir is not set */
+  std::string index_file(const std::string &pool_name) const;
+
+  void process_tasks(unsigned &idle, const Connection_handler *owner = nullptr);
+
+  /* caller must hold _index_lock when the worker pool is running */
   Component::IKVIndex *lookup_index(const pool_t pool_id)
   {
     if (_index_map) {
@@ -202,19 +339,44 @@ class Shard : public Shard_transport {
 
   void add_index_key(const pool_t pool_id, const std::string &k)
   {
+    if (!_index_present.load(std::memory_order_acquire)) return;
+    auto g     = shared_guard(_index_lock);
     auto index = lookup_index(pool_id);
-    if (index) index->insert(k);
+    if (index) {
+      try {
+        index->insert(k);
+      }
+      catch (const API_exception &e) { /* e.g. key too long for a persistent index */
+        PWRN("Shard: key not indexed: %s", e.cause());
+      }
+    }
+    else
+      _index_generations.erase(pool_id); /* changed behind a closed index */
   }
 
   void remove_index_key(const pool_t pool_id, const std::string &k)
   {
+    if (!_index_present.load(std::memory_order_acquire)) return;
+    auto g     = shared_guard(_index_lock);
     auto index = lookup_index(pool_id);
-    if (index) index->erase(k);
+    if (index)
+      index->erase(k);
+    else
+      _index_generations.erase(pool_id);
   }
 
-  inline void add_task_list(Shard_task *task) { _tasks.push_back(task); }
+  inline void add_task_list(Shard_task *task)
+  {
+    auto g = shared_guard(_tasks_lock);
+    _tasks.push_back(task);
+    _task_count++;
+  }
 
-  inline size_t session_count() const { return _handlers.size(); }
+  inline size_t session_count() const
+  {
+    std::lock_guard<std::mutex> g(_handlers_lock);
+    return _handlers.size();
+  }
 
  private:
   bool ado_enabled() const { return (_i_ado_mgr && _ado_plugins->size() > 0); }
@@ -236,24 +398,87 @@ class Shard : public Shard_transport {
 
   /* per-shard statistics */
   Component::IMCAS::Shard_stats _stats alignas(8);
+  Shard_latency                 _latency;
 
   void dump_stats()
   {
+    const auto s = aggregate_stats();
     PINF("------------------------------------------------");
     PINF("| Shard Statistics                             |");
     PINF("------------------------------------------------");
-    PINF("PUT count          : %lu", _stats.op_put_count);
-    PINF("GET count          : %lu", _stats.op_get_count);
-    PINF("PUT_DIRECT count   : %lu", _stats.op_put_direct_count);
-    PINF("GET 2-stage count  : %lu", _stats.op_get_twostage_count);
-    PINF("ERASE count        : %lu", _stats.op_erase_count);
-    PINF("ADO count          : %lu (enabled=%s)", _stats.op_ado_count, ado_enabled() ? "yes" : "no");
-    PINF("Failed count       : %lu", _stats.op_failed_request_count);
+    PINF("PUT count          : %lu", s.op_put_count);
+    PINF("GET count          : %lu", s.op_get_count);
+    PINF("PUT_DIRECT count   : %lu", s.op_put_direct_count);
+    PINF("GET 2-stage count  : %lu", s.op_get_twostage_count);
+    PINF("ERASE count        : %lu", s.op_erase_count);
+    PINF("ADO count          : %lu (enabled=%s)", s.op_ado_count, ado_enabled() ? "yes" : "no");
+    PINF("Batch count        : %lu", s.op_batch_count);
+    PINF("Failed count       : %lu", s.op_failed_request_count);
     PINF("Session count      : %lu", session_count());
+    {
+      static const char *op_names[]   = {"PUT", "GET", "ERASE", "BATCH", "ADO", "OTHER"};
+      static const char *kind_names[] = {"queue", "service", "store", "ado"};
+      for (unsigned op = 0; op < Component::IMCAS::STATS_OP_COUNT; op++)
+        for (unsigned kind = 0; kind < Component::IMCAS::STATS_LATENCY_COUNT; kind++) {
+          const auto &l = s.latency[op][kind];
+          if (l.count == 0) continue;
+          PINF("%-5s %-7s (ns)  : n=%lu p50=%lu p99=%lu p999=%lu max=%lu", op_names[op], kind_names[kind], l.count,
+               l.p50_ns, l.p99_ns, l.p999_ns, l.max_ns);
+        }
+    }
+    if (_scheduler) {
+      PINF("Worker threads     : %u", _scheduler->worker_count());
+      PINF("Handler steals     : %lu", _scheduler->steal_count());
+    }
     PINF("------------------------------------------------");
   }
 
  private:
+  /* batched ADO invocation; records go to the ADO in waves, a key at
+     most once per wave so that repeated keys run in request order */
+  struct ado_batch_t {
+    Component::IKVStore::pool_t pool;
+    uint64_t                    request_id;
+    Connection_handler *        handler; /*< session awaiting the response; null once closed */
+    uint32_t                    flags;
+    size_t                      ondemand_val_len;
+    std::vector<std::string>    keys;
+    std::vector<std::string>    requests;
+    std::vector<status_t>       status;
+    std::vector<std::string>    responses; /*< encoded as in Message_ado_response */
+    std::vector<uint32_t>       pending;   /*< records not yet sent to the ADO */
+    size_t                      in_flight;
+  };
+
+  void send_ado_batch_wave(Component::IADO_proxy *ado, ado_batch_t *batch);
+
+  /* resume batches which found no free work request, as ADO completions free them */
+  void resume_stalled_ado_batches();
+
+  void complete_ado_batch(ado_batch_t *batch);
+
+  /* drop responses owed to a closing session */
+  void forget_ado_requests(Connection_handler *handler);
+
+  /* an ADO response built while its session had no free buffer */
+  struct deferred_ado_response_t {
+    Connection_handler * handler; /*< null once the session closed */
+    std::vector<char>    msg;
+  };
+
+  /**
+   * Send an ADO response whose work has already completed. If no buffer is
+   * free the response is kept and sent by flush_ado_responses, because the
+   * completion cannot be replayed.
+   *
+   * @param handler Session awaiting the response
+   * @param build Writes the message into (base, len) and returns its length
+   */
+  template <typename Build>
+  void post_ado_response(Connection_handler *handler, Build build);
+
+  void flush_ado_responses();
+
   struct work_request_t {
     Component::IKVStore::pool_t      pool;
     Component::IKVStore::key_t       key_handle;
@@ -261,7 +486,11 @@ class Shard : public Shard_transport {
     size_t                           key_len;
     Component::IKVStore::lock_type_t lock_type;
     uint64_t                         request_id; /* original client request */
+    Connection_handler *             handler;    /* session awaiting the response; null once closed */
     uint32_t                         flags;
+    ado_batch_t *                    batch; /* owning batch, if any */
+    uint32_t                         batch_index;
+    cpu_time_t                       start_tsc; /* for ADO round-trip latency */
 
     inline bool is_async() const { return flags & Component::IMCAS::ADO_FLAG_ASYNC; }
   };
@@ -298,6 +527,8 @@ class Shard : public Shard_transport {
 
     inline void free_wr(work_request_t *wr) { _free.push_back(wr); }
 
+    inline size_t available() const { return _free.size(); }
+
   } _wr_allocator;
 
   using ado_map_t =
@@ -312,10 +543,12 @@ class Shard : public Shard_transport {
 
   /* Shard class members */
   index_map_t *                             _index_map            = nullptr;
-  bool                                      _thread_exit          = false;
+  std::map<pool_t, uint64_t>                _index_generations; /*< pools unchanged since open; see load_index_generation */
+  std::atomic<bool>                         _thread_exit{false};
   bool                                      _store_requires_flush = false;
   bool                                      _forced_exit;
   unsigned                                  _core;
+  unsigned                                  _port;
   size_t                                    _max_message_size;
   Component::IKVStore *                     _i_kvstore;
   Component::IADO_manager_proxy *           _i_ado_mgr = nullptr; /*< null indicate non-ADO mode */
@@ -326,9 +559,46 @@ class Shard : public Shard_transport {
   task_list_t                               _tasks;
   std::set<work_request_key_t>              _outstanding_work;
   std::vector<work_request_t *>             _failed_async_requests;
+  std::list<deferred_ado_response_t>        _deferred_ado_responses;
+  std::list<ado_batch_t *>                  _stalled_ado_batches; /*< awaiting a free work request */
   const std::string                         _ado_path;
   std::unique_ptr<std::vector<std::string>> _ado_plugins;
   Shard_security                            _security;
+
+  /* worker pool state */
+  const unsigned                                                    _worker_count;
+  const std::string                                                 _worker_cores;
+  std::unique_ptr<Handler_scheduler>                                _scheduler;
+  std::vector<std::thread>                                          _workers;
+  std::vector<std::unique_ptr<Component::IMCAS::Shard_stats>>       _worker_stats;
+  std::vector<std::unique_ptr<Shard_latency>>                       _worker_latency;
+  std::vector<std::unique_ptr<Stats_snapshot>>                      _worker_snapshots;
+  Stats_snapshot                                                    _shard_snapshot; /*< the shard thread's, in worker mode */
+  int                                                               _store_thread_model = 0;
+  bool                                                              _store_serialized   = false;
+  std::atomic<bool>                                                 _index_present{false}; /*< any index or generation */
+  std::atomic<size_t>                                               _task_count{0};
+  std::mutex                                                        _admin_lock;
+  std::mutex                                                        _locked_values_lock;
+  std::mutex                                                        _index_lock;
+  std::mutex                                                        _tasks_lock;
+  mutable std::mutex                                                _handlers_lock;
+  std::mutex                                                        _store_lock;
+  std::mutex                                                        _pool_locks_lock;
+  std::unordered_map<pool_t, std::unique_ptr<std::mutex>>           _pool_locks;
+  std::mutex                                                        _lease_pools_lock;
+  std::set<pool_t>                                                  _lease_pools; /* granting leases (Lease::on) */
+  std::unique_ptr<std::atomic<uint64_t>[]>                          _lease_versions{new std::atomic<uint64_t>[LEASE_VERSION_SLOTS]()};
+
+  /* adaptive polling */
+  const unsigned                            _poll_spin_usec;
+  const unsigned                            _poll_block_msec;
+
+  /* persistent index files */
+  const std::string                         _index_dir;
+
+  Shard_metrics_snapshot                    _metrics;
+
   std::thread                               _thread;
 };
 
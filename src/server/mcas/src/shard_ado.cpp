@@ -116,6 +116,39 @@ status_t Shard::conditional_bootstrap_ado_process(Component::IKVStore*        kv
   return S_OK;
 }
 
+template <typename Build>
+void Shard::post_ado_response(Connection_handler* handler, Build build)
+{
+  if (auto iob = handler->try_allocate()) {
+    iob->set_length(build(iob->base(), iob->length()));
+    handler->post_send_buffer(iob);
+    return;
+  }
+
+  std::vector<char> msg(handler->IO_buffer_size());
+  msg.resize(build(msg.data(), msg.size()));
+  _deferred_ado_responses.push_back(deferred_ado_response_t{handler, std::move(msg)});
+
+  if (_debug_level > 1) PLOG("Shard_ado: deferred ADO response (%lu waiting)", _deferred_ado_responses.size());
+}
+
+void Shard::flush_ado_responses()
+{
+  for (auto it = _deferred_ado_responses.begin(); it != _deferred_ado_responses.end();) {
+    if (auto handler = it->handler) {
+      auto iob = handler->try_allocate();
+      if (!iob) {
+        ++it;
+        continue;
+      }
+      memcpy(iob->base(), it->msg.data(), it->msg.size());
+      iob->set_length(it->msg.size());
+      handler->post_send_buffer(iob);
+    }
+    it = _deferred_ado_responses.erase(it);
+  }
+}
+
 void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Message_put_ado_request* msg)
 {
   using namespace Component;
@@ -129,25 +162,24 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
   const char*     key_ptr    = nullptr;
   bool            new_root   = false;
 
-  static const auto error_func = [&](const char* message) {
+  static const auto error_func = [&](status_t status, const char* message) {
     auto response_iob = handler->allocate();
     auto response     = new (response_iob->base())
-        Protocol::Message_ado_response(response_iob->length(), E_FAIL, handler->auth_id(), msg->request_id);
+        Protocol::Message_ado_response(response_iob->length(), status, handler->auth_id(), msg->request_id);
 
     response->append_response(const_cast<char*>(message), strlen(message), 0 /* layer id */);
 
-    response->set_status(E_INVAL);
     response_iob->set_length(response->message_size());
     handler->post_send_buffer(response_iob);
   };
 
 #ifdef SHORT_CIRCUIT_ADO_HANDLING
-  error_func("ADO!SC");
+  error_func(E_INVAL, "ADO!SC");
   return;
 #endif
 
   if (!_i_ado_mgr) {
-    error_func("ADO!NOT_ENABLED");
+    error_func(E_INVAL, "ADO!NOT_ENABLED");
     return;
   }
 
@@ -156,7 +188,7 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
   if (!ado) throw General_exception("ADO is not running");
 
   if (msg->value_len() == 0) {
-    error_func("ADO!ZERO_VALUE_LEN");
+    error_func(E_INVAL, "ADO!ZERO_VALUE_LEN");
     return;
   }
 
@@ -180,7 +212,7 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
 
     status_t s = _i_kvstore->lock(msg->pool_id, msg->key(), locktype, value, value_len, key_handle, &key_ptr);
     if (s < S_OK) {
-      error_func("ADO!ALREADY_LOCKED");
+      error_func(E_INVAL, "ADO!ALREADY_LOCKED");
       return;
     }
     if (key_handle == IKVStore::KEY_NONE) throw Logic_exception("lock gave KEY_NONE");
@@ -202,7 +234,7 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
                                           detached_val_ptr);
     if (rc != S_OK) {
       PWRN("allocate_pool_memory for detached value failed (len=%lu, rc=%d)", size_to_allocate, rc);
-      error_func("ADO!OUT_OF_MEMORY");
+      error_func(E_INVAL, "ADO!OUT_OF_MEMORY");
       return;
     }
     detached_val_len = size_to_allocate;
@@ -215,6 +247,7 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
   }
   else {
     /* write value passed with invocation message */
+    const lease_write lw(lease_version(msg->pool_id, msg->key()));
     rc = _i_kvstore->put(msg->pool_id, msg->key(), msg->value(), msg->value_len());
     if (rc != S_OK) throw Logic_exception("put_ado_invoke: put failed");
   }
@@ -225,17 +258,18 @@ void Shard::process_put_ado_request(Connection_handler* handler, Protocol::Messa
   */
   if (!value) { /* now take the lock if not already locked */
     if (_i_kvstore->lock(msg->pool_id, msg->key(), locktype, value, value_len, key_handle, &key_ptr) != S_OK) {
-      error_func("ADO!ALREADY_LOCKED");
+      error_func(E_INVAL, "ADO!ALREADY_LOCKED");
       return;
     }
     if (key_handle == IKVStore::KEY_NONE) throw Logic_exception("lock gave KEY_NONE");
   }
+  lease_version(msg->pool_id, msg->key()) += 2; /* the ADO may write the value */
 
   if (_debug_level > 2) PLOG("Shard_ado: locked KV pair (value=%p, value_len=%lu)", value, value_len);
 
   /* register outstanding work */
   auto wr = _wr_allocator.allocate();
-  *wr     = {msg->pool_id, key_handle, key_ptr, msg->get_key_len(), locktype, msg->request_id, msg->flags};
+  *wr     = {msg->pool_id, key_handle, key_ptr, msg->get_key_len(), locktype, msg->request_id, handler, msg->flags, nullptr, 0, rdtsc()};
 
   auto wr_key = reinterpret_cast<work_request_key_t>(wr); /* pointer to uint64_t */
   _outstanding_work.insert(wr_key);
@@ -295,9 +329,14 @@ void Shard::process_ado_request(Connection_handler* handler, Protocol::Message_a
       return;
     }
 
+    /* the key is created below, so a retry for want of a buffer would
+       report E_ALREADY_EXISTS; take the response buffer first */
+    auto response_iob = handler->allocate();
+
     IKVStore::key_t key_handle;
     status_t s = _i_kvstore->lock(msg->pool_id, msg->key(), IKVStore::STORE_LOCK_READ, value, value_len, key_handle);
     if (s < S_OK) {
+      handler->free_buffer(response_iob);
       error_func(E_LOCKED, "ADO!ALREADY_LOCKED");
       if (_debug_level > 1) PWRN("process_ado_request: key already locked (ADO_FLAG_CREATE_ONLY)");
       return;
@@ -310,7 +349,6 @@ void Shard::process_ado_request(Connection_handler* handler, Protocol::Message_a
       throw Logic_exception("unable to unlock after lock");
 
     /* copy value address into response */
-    auto response_iob = handler->allocate();
     auto response     = new (response_iob->base())
         Protocol::Message_ado_response(response_iob->length(), S_OK, handler->auth_id(), msg->request_id);
     response->append_response(&value, sizeof(value), 0 /* layer id */);
@@ -356,12 +394,13 @@ void Shard::process_ado_request(Connection_handler* handler, Protocol::Message_a
   }
 
   if (key_handle == IKVStore::KEY_NONE) throw Logic_exception("lock gave KEY_NONE");
+  lease_version(msg->pool_id, msg->key()) += 2; /* the ADO may write the value */
 
   if (_debug_level > 2) PLOG("Shard_ado: locked KV pair (value=%p, value_len=%lu)", value, value_len);
 
   /* register outstanding work */
   auto wr = _wr_allocator.allocate();
-  *wr     = {msg->pool_id, key_handle, key_ptr, msg->get_key_len(), locktype, msg->request_id, msg->flags};
+  *wr     = {msg->pool_id, key_handle, key_ptr, msg->get_key_len(), locktype, msg->request_id, handler, msg->flags, nullptr, 0, rdtsc()};
 
   auto wr_key = reinterpret_cast<work_request_key_t>(wr); /* pointer to uint64_t */
   _outstanding_work.insert(wr_key); /* save request by index on key-handle */
@@ -383,6 +422,196 @@ void Shard::process_ado_request(Connection_handler* handler, Protocol::Message_a
      operations */
 }
 
+void Shard::process_ado_batch_request(Connection_handler* handler, Protocol::Message_ado_batch_request* msg)
+{
+  using namespace Component;
+
+  if (_debug_level > 2) PLOG("Shard_ado: process_ado_batch_request (count=%u)", msg->count);
+
+  if (!msg->valid(handler->pending_msg_buffer_len())) {
+    /* the records cannot be read, so the reply carries only the status */
+    const auto iob      = handler->allocate();
+    const auto response = new (iob->base())
+        Protocol::Message_ado_batch_response(iob->length(), handler->auth_id(), msg->request_id);
+    response->set_status(E_INVAL);
+    iob->set_length(response->msg_len);
+    handler->post_response(iob);
+    return;
+  }
+
+  auto batch = new ado_batch_t{msg->pool_id, msg->request_id, handler, msg->flags, msg->ondemand_val_len, {}, {}, {}, {}, {}, 0};
+  batch->keys.reserve(msg->count);
+  batch->requests.reserve(msg->count);
+  batch->status.assign(msg->count, E_FAIL);
+  batch->responses.resize(msg->count);
+
+  auto rec = msg->first_record();
+  for (uint32_t i = 0; i < msg->count; i++, rec = Protocol::Message_ado_batch_request::next_record(rec)) {
+    batch->keys.emplace_back(rec->key(), rec->key_len);
+    batch->requests.emplace_back(rec->request(), rec->request_len);
+  }
+
+  /* asynchronous, detached and create-only invocations are single-key only */
+  const uint32_t unsupported = IMCAS::ADO_FLAG_ASYNC | IMCAS::ADO_FLAG_DETACHED | IMCAS::ADO_FLAG_CREATE_ONLY;
+
+  if (!ado_enabled() || (msg->flags & unsupported)) {
+    batch->status.assign(msg->count, E_INVAL);
+    complete_ado_batch(batch);
+    return;
+  }
+
+  /*  ADO should already be running */
+  auto ado = _ado_map[msg->pool_id].first;
+  assert(ado);
+
+  for (uint32_t i = 0; i < msg->count; i++) {
+    if (ado->work_batch_item_space(batch->requests[i].size()) > ado->work_batch_capacity())
+      batch->status[i] = E_INVAL; /* invocation data too large for an IPC message */
+    else
+      batch->pending.push_back(i);
+  }
+
+  send_ado_batch_wave(ado, batch);
+}
+
+void Shard::send_ado_batch_wave(Component::IADO_proxy* ado, ado_batch_t* batch)
+{
+  using namespace Component;
+
+  const size_t capacity = ado->work_batch_capacity();
+
+  while (!batch->pending.empty()) {
+    std::vector<IADO_proxy::work_item_t> items;
+    std::set<std::string>                wave_keys;
+    std::vector<uint32_t>                deferred;
+    size_t                               space     = 0;
+    bool                                 exhausted = false;
+
+    for (auto i : batch->pending) {
+      const std::string& key        = batch->keys[i];
+      const size_t       item_space = ado->work_batch_item_space(batch->requests[i].size());
+
+      if (space + item_space > capacity || wave_keys.count(key)) {
+        deferred.push_back(i);
+        continue;
+      }
+
+      if (_wr_allocator.available() == 0) {
+        exhausted = true;
+        deferred.push_back(i);
+        continue;
+      }
+
+      IKVStore::key_t key_handle;
+      const char*     key_ptr   = nullptr;
+      void*           value     = nullptr;
+      size_t          value_len = batch->ondemand_val_len;
+
+      auto     locktype = IKVStore::STORE_LOCK_WRITE;
+      status_t s        = _i_kvstore->lock(batch->pool, key, locktype, value, value_len, key_handle, &key_ptr);
+      if (s < S_OK) {
+        if (_debug_level > 1) PWRN("process_ado_batch_request: key already locked");
+        batch->status[i] = E_LOCKED;
+        continue;
+      }
+
+      if (key_handle == IKVStore::KEY_NONE) throw Logic_exception("lock gave KEY_NONE");
+      lease_version(batch->pool, key) += 2; /* the ADO may write the value */
+
+      /* register outstanding work */
+      auto wr = _wr_allocator.allocate();
+      *wr     = {batch->pool, key_handle, key_ptr, key.size(), locktype, batch->request_id, batch->handler, batch->flags, batch, i, rdtsc()};
+
+      auto wr_key = reinterpret_cast<work_request_key_t>(wr);
+      _outstanding_work.insert(wr_key);
+
+      items.push_back({wr_key, key_ptr, key.size(), value, value_len, batch->requests[i].data(),
+                       batch->requests[i].size(), (s == S_OK_CREATED)});
+      wave_keys.insert(key);
+      space += item_space;
+    }
+
+    batch->pending.swap(deferred);
+
+    if (!items.empty()) {
+      batch->in_flight = items.size();
+
+      wmb();
+
+      ado->send_work_batch_request(items);
+
+      if (_debug_level > 2) PLOG("Shard_ado: sent work batch (count=%lu)", items.size());
+      return;
+    }
+
+    if (exhausted) {
+      /* every work request is in use; ADO completions will free some */
+      _stalled_ado_batches.push_back(batch);
+      return;
+    }
+  }
+
+  complete_ado_batch(batch);
+}
+
+void Shard::resume_stalled_ado_batches()
+{
+  while (!_stalled_ado_batches.empty() && _wr_allocator.available() > 0) {
+    auto batch = _stalled_ado_batches.front();
+    _stalled_ado_batches.pop_front();
+
+    auto i = _ado_map.find(batch->pool);
+    if (i == _ado_map.end()) { /* pool closed meanwhile */
+      for (auto p : batch->pending) batch->status[p] = E_FAIL;
+      batch->pending.clear();
+      complete_ado_batch(batch);
+      continue;
+    }
+    send_ado_batch_wave(i->second.first, batch);
+  }
+}
+
+void Shard::complete_ado_batch(ado_batch_t* batch)
+{
+  auto handler = batch->handler;
+  if (!handler) { /* session closed */
+    delete batch;
+    return;
+  }
+
+  /* the batch's work is done, so the response must not be lost to a buffer shortage */
+  post_ado_response(handler, [handler, batch](void* base, size_t buffer_size) -> size_t {
+    auto response = new (base) Protocol::Message_ado_batch_response(buffer_size, handler->auth_id(), batch->request_id);
+
+    /* a result without responses takes no more space than its request
+       record, so every record is answered */
+    for (size_t i = 0; i < batch->status.size(); i++) {
+      if (!response->append(buffer_size, batch->status[i], batch->responses[i].data(), batch->responses[i].size()))
+        throw Logic_exception("Shard_ado: batch response overflow");
+    }
+    response->set_status(S_OK);
+    return response->msg_len;
+  });
+
+  delete batch;
+}
+
+void Shard::forget_ado_requests(Connection_handler* handler)
+{
+  /* the work itself completes as usual; only the response is dropped */
+  for (auto wr_key : _outstanding_work) {
+    auto wr = request_key_to_record(wr_key);
+    if (wr->handler == handler) wr->handler = nullptr;
+    if (wr->batch && wr->batch->handler == handler) wr->batch->handler = nullptr;
+  }
+  for (auto& r : _deferred_ado_responses) {
+    if (r.handler == handler) r.handler = nullptr;
+  }
+  for (auto b : _stalled_ado_batches) {
+    if (b->handler == handler) b->handler = nullptr;
+  }
+}
+
 /**
  * Handle messages coming back from the ADO process.
  *
@@ -391,6 +620,9 @@ void Shard::process_messages_from_ado()
 {
   using namespace Component;
 
+  /* responses owed from earlier completions go first */
+  flush_ado_responses();
+
   for (auto record : _ado_map) { /* for each ADO process */
 
     IADO_proxy*         ado     = record.second.first;
@@ -428,6 +660,7 @@ void Shard::process_messages_from_ado()
         }
 
         _outstanding_work.erase(work_item);
+        record_latency(IMCAS::STATS_OP_ADO, IMCAS::STATS_LATENCY_ADO, rdtsc() - request_record->start_tsc);
 
         /* unlock the KV pair */
         if (_i_kvstore->unlock(request_record->pool, request_record->key_handle) != S_OK)
@@ -451,15 +684,30 @@ void Shard::process_messages_from_ado()
         /* handle erasing target */
         if(response_status == IADO_plugin::S_ERASE_TARGET) {
 
-          status_t s = _i_kvstore->erase(request_record->pool,
-                                         std::string(request_record->key_ptr, request_record->key_len));
+          const std::string target_key(request_record->key_ptr, request_record->key_len);
+          const lease_write lw(lease_version(request_record->pool, target_key));
+          status_t s = _i_kvstore->erase(request_record->pool, target_key);
           if(s != S_OK)
             PWRN("Shard_ado: request to erase target failed unexpectedly (key=%s,rc=%d)", request_record->key_ptr, s);
           response_status = s;
         }
         
+        if (request_record->batch) { /* record of a batch; respond when the batch is done */
+          auto  batch   = request_record->batch;
+          auto& encoded = batch->responses[request_record->batch_index];
+
+          batch->status[request_record->batch_index] = response_status;
+          for (auto& rb : response_buffers) {
+            assert(rb.ptr);
+            const uint32_t header[2] = {boost::numeric_cast<uint32_t>(rb.len), rb.layer_id};
+            encoded.append(reinterpret_cast<const char*>(header), sizeof header);
+            encoded.append(static_cast<const char*>(rb.ptr), rb.len);
+          }
+
+          if (--batch->in_flight == 0) send_ado_batch_wave(ado, batch);
+        }
         /* for async, save failed requests */
-        if (request_record->is_async()) {
+        else if (request_record->is_async()) {
           /* if the ADO operation response is bad, save it for
              later, otherwise don't do anything */
           if (response_status < S_OK) {
@@ -470,27 +718,24 @@ void Shard::process_messages_from_ado()
             if (_debug_level > 2) PWRN("Shard_ado: async ADO completion OK!");
           }
         }
-        else /* for sync, give response */
+        else if (request_record->handler) /* for sync, give response on the requesting session */
         {
-          auto iob = handler->allocate();
-
-          auto response_msg = new (iob->base()) Protocol::Message_ado_response(
-              iob->length(), response_status, handler->auth_id(), request_record->request_id);
-
-          /* TODO: for the moment copy pool buffers in, we should
-             be able to do zero copy though.
-           */
-          size_t appended_buffer_size = 0;
-
-          for (auto& rb : response_buffers) {
-            assert(rb.ptr);
-            response_msg->append_response(rb.ptr, boost::numeric_cast<uint32_t>(rb.len), rb.layer_id);
-            appended_buffer_size += rb.len;
-          }
-
-          iob->set_length(response_msg->message_size());
-
-          handler->post_send_buffer(iob);
+          auto requester = request_record->handler;
+
+          /* the completion is consumed, so the response must not be lost to a buffer shortage */
+          post_ado_response(requester, [&](void* base, size_t buffer_size) -> size_t {
+            auto response_msg = new (base) Protocol::Message_ado_response(
+                buffer_size, response_status, requester->auth_id(), request_record->request_id);
+
+            /* TODO: for the moment copy pool buffers in, we should
+               be able to do zero copy though.
+             */
+            for (auto& rb : response_buffers) {
+              assert(rb.ptr);
+              response_msg->append_response(rb.ptr, boost::numeric_cast<uint32_t>(rb.len), rb.layer_id);
+            }
+            return response_msg->message_size();
+          });
         }
         _wr_allocator.free_wr(request_record);
       }
@@ -550,6 +795,7 @@ void Shard::process_messages_from_ado()
                 PLOG("Shard_ado: locked KV pair (keyhandle=%p, value=%p,len=%lu) invoke_completion_unlock=%d",
                      static_cast<void*>(key_handle), value, value_len, invoke_completion_unlock);
 
+              lease_version(ado->pool_id(), key) += 2; /* the ADO may write the value */
               add_index_key(ado->pool_id(), key);
 
               /* auto-unlock means we add a deferred unlock that happens after
@@ -581,6 +827,7 @@ void Shard::process_messages_from_ado()
           } break;
           case ADO_op::ERASE: {
             if (_debug_level > 2) PLOG("Shard_ado: received table op erase");
+            const lease_write lw(lease_version(ado->pool_id(), key));
             ado->send_table_op_response(_i_kvstore->erase(ado->pool_id(), key));
             break;
           } 
@@ -621,6 +868,7 @@ void Shard::process_messages_from_ado()
             if (_i_kvstore->lock(ado->pool_id(), key, IKVStore::STORE_LOCK_WRITE, new_value, new_value_len,
                                  wr->key_handle /* update key handle in record */, &key_ptr) != S_OK)
               throw Logic_exception("ADO OP_RESIZE request failed to relock");
+            lease_version(ado->pool_id(), key) += 2; /* the value may have moved */
 
             /* update deferred locks */
             if (ado->update_deferred_unlock(work_id, wr->key_handle) != S_OK) {
@@ -857,4 +1105,6 @@ void Shard::process_messages_from_ado()
       ado->free_callback_buffer(buffer);
     }
   }
+
+  resume_stalled_ado_batches();
 }